@@ -26,6 +26,12 @@ typedef struct OC_APPLE_CHUNKLIST_CONTEXT_ {
   CONST APPLE_CHUNKLIST_CHUNK    *Chunks;
   APPLE_CHUNKLIST_SIG            *Signature;
   UINT8                          Hash[SHA256_DIGEST_SIZE];
+  //
+  // Lazy verification state, chunk data offsets and verified chunk bitmap.
+  //
+  UINT64                         *ChunkOffsets;
+  UINT8                          *VerifiedChunks;
+  UINT8                          *ScratchBuffer;
 } OC_APPLE_CHUNKLIST_CONTEXT;
 
 //
@@ -57,7 +63,8 @@ OcAppleChunklistVerifySignature (
   );
 
 /**
-  Verifies the specified data against a chunklist context.
+  Verifies the specified data against a chunklist context. Up to
+  OC_SHA256_MULTI_LANES chunks are hashed per pass.
 
   @param[in] Context            The Context to verify against.
   @param[in] ExtentTable        A pointer to the RAM disk extent table to be
@@ -74,4 +81,53 @@ OcAppleChunklistVerifyData (
   IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable
   );
 
+/**
+  Prepares a chunklist context for lazy verification, where every chunk is
+  verified on first access with OcAppleChunklistVerifyRange. Chunk descriptors
+  are copied, so the chunklist buffer may be freed afterwards.
+
+  @param[in,out] Context   The Context with verified signature.
+  @param[in]     DataSize  The size of the data covered by the chunklist.
+
+  @retval TRUE   The Context was prepared successfully.
+  @retval FALSE  The chunklist does not cover DataSize or allocation failed.
+**/
+BOOLEAN
+OcAppleChunklistInitializeLazyVerification (
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT  *Context,
+  IN     UINT64                      DataSize
+  );
+
+/**
+  Verifies all chunks overlapping the specified data range, which were not
+  verified before, against a chunklist context prepared for lazy verification.
+  Up to OC_SHA256_MULTI_LANES chunks are hashed per pass.
+
+  @param[in,out] Context      The Context to verify against.
+  @param[in]     ExtentTable  A pointer to the RAM disk extent table to be
+                              verified.
+  @param[in]     Offset       The offset of the data range.
+  @param[in]     Length       The length of the data range.
+
+  @retval TRUE   The data range was verified successfully.
+  @retval FALSE  The data range is out of bounds or failed verification.
+**/
+BOOLEAN
+OcAppleChunklistVerifyRange (
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT         *Context,
+  IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN     UINT64                             Offset,
+  IN     UINT64                             Length
+  );
+
+/**
+  Frees lazy verification state of a chunklist context.
+
+  @param[in,out] Context  The Context to free.
+**/
+VOID
+OcAppleChunklistFreeContext (
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT  *Context
+  );
+
 #endif // APPLE_CHUNKLIST_LIB_H
@@ -15,21 +15,88 @@
 
 #include <IndustryStandard/AppleDiskImage.h>
 
+#include <Protocol/MpService.h>
 #include <Protocol/SimpleFileSystem.h>
 
 #include <Library/OcAppleChunklistLib.h>
 #include <Library/OcAppleRamDiskLib.h>
 
+//
+// Default memory budget of decompressed chunk cache.
+//
+#define OC_APPLE_DISK_IMAGE_DEFAULT_CACHE_SIZE  BASE_4MB
+
+//
+// Default amount of chunks inflated ahead of sequential reads.
+//
+#define OC_APPLE_DISK_IMAGE_DEFAULT_READ_AHEAD  8
+
+//
+// Decompressed chunk cache statistics.
+//
+typedef struct {
+  UINT64    Hits;
+  UINT64    Misses;
+  UINT64    BytesInflated;
+  UINT64    ReadAhead;
+} OC_APPLE_DISK_IMAGE_CACHE_STATS;
+
+//
+// Disk image chunk mapping, sorted by sector.
+//
+typedef struct {
+  UINT64                         SectorStart;
+  UINT64                         SectorEnd;
+  APPLE_DISK_IMAGE_BLOCK_DATA    *Block;
+  APPLE_DISK_IMAGE_CHUNK         *Chunk;
+} OC_APPLE_DISK_IMAGE_CHUNK_INDEX;
+
 //
 // Disk image context.
 //
 typedef struct {
   CONST APPLE_RAM_DISK_EXTENT_TABLE    *ExtentTable;
+  UINTN                                FileSize;
 
   UINTN                                SectorCount;
 
+  //
+  // Property list location, verified before lazy chunklist verification.
+  //
+  UINT64                               XmlOffset;
+  UINT64                               XmlLength;
+
   UINT32                               BlockCount;
   APPLE_DISK_IMAGE_BLOCK_DATA          **Blocks;
+
+  //
+  // Chunks with data, last used index speeds up sequential access.
+  //
+  UINT32                               ChunkCount;
+  OC_APPLE_DISK_IMAGE_CHUNK_INDEX      *ChunkIndex;
+  UINT32                               LastChunk;
+
+  //
+  // Decompressed chunks, most recently used first.
+  //
+  LIST_ENTRY                           ChunkCache;
+  UINTN                                ChunkCacheSize;
+  UINTN                                ChunkCacheBudget;
+  OC_APPLE_DISK_IMAGE_CACHE_STATS      CacheStats;
+
+  //
+  // Sequential read detection and read-ahead window, chunks before
+  // ReadAheadEnd are already inflated ahead.
+  //
+  UINTN                                NextReadLba;
+  UINT32                               ReadAheadChunks;
+  UINT32                               ReadAheadEnd;
+  EFI_MP_SERVICES_PROTOCOL             *MpServices;
+
+  //
+  // Chunklist to verify data against on first read, when set.
+  //
+  OC_APPLE_CHUNKLIST_CONTEXT           *Chunklist;
 } OC_APPLE_DISK_IMAGE_CONTEXT;
 
 BOOLEAN
@@ -61,6 +128,38 @@ OcAppleDiskImageVerifyData (
   IN OUT OC_APPLE_CHUNKLIST_CONTEXT   *ChunklistContext
   );
 
+/**
+  Verify disk image data against a chunklist lazily. Disk image metadata is
+  verified immediately, while every chunklist chunk is verified on the first
+  read of any data within it, failing the read on mismatch.
+
+  @param[in,out] Context           DMG context.
+  @param[in]     ChunklistContext  Chunklist context with verified signature.
+                                   The chunklist buffer may be freed after return.
+
+  @return  TRUE when disk image metadata was verified successfully.
+**/
+BOOLEAN
+OcAppleDiskImageVerifyDataLazy (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT       *Context,
+  IN     CONST OC_APPLE_CHUNKLIST_CONTEXT  *ChunklistContext
+  );
+
+/**
+  Verify disk image data not yet read since OcAppleDiskImageVerifyDataLazy.
+  This must happen before the RAM disk is handed over to the operating system,
+  which reads it directly. Disk image data is wiped on verification failure.
+
+  @param[in,out] Context  DMG context.
+
+  @return  TRUE when the entire disk image is verified or lazy verification
+           is not used.
+**/
+BOOLEAN
+OcAppleDiskImageVerifyRemaining (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  );
+
 BOOLEAN
 OcAppleDiskImageRead (
   IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
@@ -69,6 +168,35 @@ OcAppleDiskImageRead (
   OUT VOID                         *Buffer
   );
 
+/**
+  Set memory budget of decompressed chunk cache.
+  Chunks over the new budget are evicted immediately.
+
+  @param[in,out] Context    DMG context.
+  @param[in]     CacheSize  Cache budget in bytes, 0 disables the cache.
+**/
+VOID
+OcAppleDiskImageSetCacheSize (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        CacheSize
+  );
+
+/**
+  Configure inflating chunks ahead of sequential reads into the chunk cache.
+  Cache budget is grown to fit the read-ahead window when necessary.
+
+  @param[in,out] Context        DMG context.
+  @param[in]     ChunkCount     Amount of chunks to inflate ahead, 0 disables.
+  @param[in]     UseMpServices  Spread decompression across application
+                                processors when MP services are available.
+**/
+VOID
+OcAppleDiskImageSetReadAhead (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT32                       ChunkCount,
+  IN     BOOLEAN                      UseMpServices
+  );
+
 EFI_HANDLE
 OcAppleDiskImageInstallBlockIo (
   IN  OC_APPLE_DISK_IMAGE_CONTEXT     *Context,
@@ -167,6 +167,111 @@ typedef enum KERNEL_CACHE_TYPE_ {
 #define KERNEL_VERSION_BIG_SUR_MAX        (KERNEL_VERSION_MONTEREY_MIN - 1)
 #define KERNEL_VERSION_MONTEREY_MAX       (KERNEL_VERSION_VENTURA_MIN - 1)
 
+//
+// Key types of OC_HASH_MAP.
+//
+typedef enum {
+  OcHashMapKeyAscii,
+  OcHashMapKeyUnicode,
+  OcHashMapKeyNumeric
+} OC_HASH_MAP_KEY_TYPE;
+
+//
+// Open addressing hash map used for lookups in kernel contexts.
+// String keys are not copied and must outlive the map.
+//
+typedef struct {
+  UINT64    Key;    ///< String key pointer or numeric key.
+  VOID      *Value; ///< Entry value or NULL for free slot.
+  UINT32    Hash;
+} OC_HASH_MAP_ENTRY;
+
+typedef struct {
+  OC_HASH_MAP_ENTRY       *Entries; ///< Slots or NULL when not initialised.
+  UINT32                  Capacity; ///< Number of slots, power of two.
+  UINT32                  Count;    ///< Number of used slots.
+  OC_HASH_MAP_KEY_TYPE    KeyType;
+} OC_HASH_MAP;
+
+//
+// Linked kext cache key size, matches SHA-384 digest size.
+//
+#define OC_KEXT_LINK_CACHE_KEY_SIZE  48U
+
+//
+// Linked kext cache build version size, including null terminator.
+//
+#define OC_KEXT_LINK_CACHE_BUILD_VERSION_SIZE  32U
+
+//
+// Linked kext cache, stores kext images after linking to skip relinking
+// unchanged kexts on the next boot.
+//
+typedef struct {
+  //
+  // Digest of the kernel this cache is built for.
+  //
+  UINT8          KernelDigest[OC_KEXT_LINK_CACHE_KEY_SIZE];
+  //
+  // Version of the build producing linked images, zero padded.
+  //
+  CHAR8          BuildVersion[OC_KEXT_LINK_CACHE_BUILD_VERSION_SIZE];
+  //
+  // Key of the last injected kext, starts with kernel digest.
+  // Every kext key covers all previously injected kexts.
+  //
+  UINT8          ChainKey[OC_KEXT_LINK_CACHE_KEY_SIZE];
+  //
+  // Previously saved cache contents, owned by this cache.
+  //
+  UINT8          *Cache;
+  //
+  // Previously saved cache size.
+  //
+  UINT32         CacheSize;
+  //
+  // Number of entries in previously saved cache.
+  //
+  UINT32         CacheEntries;
+  //
+  // Previously saved cache entries indexed by leading key bytes.
+  //
+  OC_HASH_MAP    CacheIndex;
+  //
+  // New cache contents with entries used during this boot.
+  //
+  UINT8          *NewCache;
+  //
+  // New cache size.
+  //
+  UINT32         NewCacheSize;
+  //
+  // New cache allocated size.
+  //
+  UINT32         NewCacheAllocSize;
+  //
+  // Number of entries in new cache.
+  //
+  UINT32         NewCacheEntries;
+  //
+  // New cache could not be completed and must not be saved.
+  //
+  BOOLEAN        NewCacheFailed;
+  //
+  // Number of kexts copied from cache.
+  //
+  UINT32         Hits;
+  //
+  // Number of kexts linked and added to cache.
+  //
+  UINT32         Misses;
+} OC_KEXT_LINK_CACHE;
+
+//
+// Lazily parsed PRELINK_INFO_DICTIONARY_KEY kext list.
+//
+typedef struct PRELINKED_INFO_INDEX_ PRELINKED_INFO_INDEX;
+
 //
 // Prelinked context used for kernel modification.
 //
@@ -304,6 +409,21 @@ typedef struct {
   //
   LIST_ENTRY                             PrelinkedKexts;
   //
+  // Bundle identifier index of PrelinkedKexts, first entry wins.
+  // Not initialised when out of resources, PrelinkedKexts are walked then.
+  //
+  OC_HASH_MAP                            PrelinkedKextIndex;
+  //
+  // Bundle identifier index of KextList plist dictionaries, values are KextList indices plus one.
+  // Built on demand and dropped when KextList entries are removed.
+  //
+  OC_HASH_MAP                            KextListIndex;
+  //
+  // Offsets of original KextList dictionaries in PrelinkedInfo, NULL when PrelinkedInfoDocument
+  // was parsed in full. Dictionaries are parsed on first access.
+  //
+  PRELINKED_INFO_INDEX                   *PrelinkedInfoIndex;
+  //
   // Used for caching prelinked kexts, which we inject.
   // This is a sublist of PrelinkedKexts.
   //
@@ -332,6 +452,10 @@ typedef struct {
   // Prelinked is 32-bit.
   //
   BOOLEAN                                Is32Bit;
+  //
+  // Linked kext cache, optional.
+  //
+  OC_KEXT_LINK_CACHE                     *LinkCache;
 } PRELINKED_CONTEXT;
 
 //
@@ -370,6 +494,23 @@ typedef struct {
   // Patcher context is contained within a kernel collection.
   //
   BOOLEAN             IsKernelCollection;
+  //
+  // Disable symbol index and always perform linear symbol lookup.
+  //
+  BOOLEAN             DisableSymbolIndex;
+  //
+  // Symbol name index, lazily built on repeated symbol lookup.
+  // Owned by this context and freed by PatcherFreeContext.
+  //
+  VOID                *SymbolIndex;
+  //
+  // Number of symbol lookups performed through this context.
+  //
+  UINT32              SymbolLookups;
+  //
+  // Number of symbol table entries visited by linear lookup and indexing.
+  //
+  UINT32              SymbolsVisited;
 } PATCHER_CONTEXT;
 
 //
@@ -447,6 +588,17 @@ typedef struct {
   //
   LIST_ENTRY           BuiltInKexts;
   //
+  // Bundle identifier, plist path and binary path indices of BuiltInKexts.
+  // Not initialised when out of resources, BuiltInKexts are walked then.
+  //
+  OC_HASH_MAP          BuiltInKextIdentifiers;
+  OC_HASH_MAP          BuiltInKextPlistPaths;
+  OC_HASH_MAP          BuiltInKextBinaryPaths;
+  //
+  // Bundle identifier index of PatchedKexts.
+  //
+  OC_HASH_MAP          PatchedKextIdentifiers;
+  //
   // Current kernel version.
   //
   UINT32               KernelVersion;
@@ -669,6 +821,64 @@ KernelApplyQuirk (
   IN     UINT32             KernelVersion
   );
 
+//
+// Kernel processing phases tracked for profiling.
+//
+typedef enum {
+  //
+  // Reading and decompressing kernel image.
+  //
+  KernelPhaseRead,
+  //
+  // Calculating kernel image digest.
+  //
+  KernelPhaseDigest,
+  //
+  // Parsing prelinked plist info.
+  //
+  KernelPhaseInfoParse,
+  //
+  // Linking injected kexts.
+  //
+  KernelPhaseLink,
+  //
+  // Patching kernel and kexts.
+  //
+  KernelPhasePatch,
+  //
+  // Kernel collection fixups.
+  //
+  KernelPhaseFixups,
+  //
+  // Exporting prelinked plist info.
+  //
+  KernelPhaseExport,
+
+  KernelPhaseMax
+} KERNEL_PHASE;
+
+//
+// Kernel processing phase statistics.
+//
+typedef struct {
+  //
+  // Total amount of TSC ticks spent.
+  //
+  UINT64    Ticks;
+  //
+  // Shortest span in TSC ticks.
+  //
+  UINT64    MinTicks;
+  //
+  // Longest span in TSC ticks.
+  //
+  UINT64    MaxTicks;
+  //
+  // Number of recorded spans.
+  //
+  UINT32    Count;
+} KERNEL_PHASE_STATS;
+
 /**
   Read Apple kernel for target architecture (possibly decompressing)
   into pool allocated buffer. If CpuType does not exist in fat
@@ -723,6 +933,84 @@ ReadAppleMkext (
   IN     UINT32             NumReservedKexts
   );
 
+/**
+  Reset kernel processing phase statistics.
+**/
+VOID
+OcKernelPhaseReset (
+  VOID
+  );
+
+/**
+  Start kernel processing phase span.
+
+  @returns Span start timestamp.
+**/
+UINT64
+OcKernelPhaseStart (
+  VOID
+  );
+
+/**
+  Record kernel processing phase span of known duration.
+
+  @param[in]  Phase  Kernel processing phase.
+  @param[in]  Ticks  Span duration in TSC ticks.
+**/
+VOID
+OcKernelPhaseAdd (
+  IN KERNEL_PHASE  Phase,
+  IN UINT64        Ticks
+  );
+
+/**
+  Finish kernel processing phase span started with OcKernelPhaseStart.
+
+  @param[in]  Phase  Kernel processing phase.
+  @param[in]  Start  Span start timestamp.
+
+  @returns Span duration in TSC ticks.
+**/
+UINT64
+OcKernelPhaseStop (
+  IN KERNEL_PHASE  Phase,
+  IN UINT64        Start
+  );
+
+/**
+  Get kernel processing phase statistics.
+
+  @param[in]  Phase  Kernel processing phase.
+
+  @returns Phase statistics.
+**/
+CONST KERNEL_PHASE_STATS *
+OcKernelPhaseGetStats (
+  IN KERNEL_PHASE  Phase
+  );
+
+/**
+  Get kernel processing phase name.
+
+  @param[in]  Phase  Kernel processing phase.
+
+  @returns Phase name.
+**/
+CONST CHAR8 *
+OcKernelPhaseGetName (
+  IN KERNEL_PHASE  Phase
+  );
+
+/**
+  Print kernel processing phase statistics to the log.
+
+  @param[in]  TscFrequency  TSC frequency in Hz, 0 to print raw ticks.
+**/
+VOID
+OcKernelPhaseReport (
+  IN UINT64  TscFrequency
+  );
+
 /**
   Create Apple kernel version in integer format.
   See KERNEL_VERSION on how to build it from integers.
@@ -894,6 +1182,48 @@ PrelinkedInjectKext (
   OUT    CHAR8              BundleVersion[MAX_INFO_BUNDLE_VERSION_KEY_SIZE] OPTIONAL
   );
 
+/**
+  Enable linked kext cache for kext injection. Kexts found in the cache
+  are copied in place instead of linking, other kexts are linked and added
+  to the new cache. Must be called before any kext injection.
+
+  Cache saved by a different build is discarded as a whole, as linker
+  output may differ between builds.
+
+  @param[in,out] Context       Prelinked context.
+  @param[in]     KernelDigest  SHA-384 digest of the original kernel.
+  @param[in]     BuildVersion  Version of the current build, e.g. OpenCore
+                               version string. Truncated to
+                               OC_KEXT_LINK_CACHE_BUILD_VERSION_SIZE - 1.
+  @param[in]     Cache         Pool allocated previously saved cache, optional.
+                               Ownership is transferred to the context.
+  @param[in]     CacheSize     Previously saved cache size.
+
+  @return  EFI_SUCCESS on success.
+**/
+EFI_STATUS
+PrelinkedLinkCacheInit (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CONST UINT8        *KernelDigest,
+  IN     CONST CHAR8        *BuildVersion,
+  IN     VOID               *Cache OPTIONAL,
+  IN     UINT32             CacheSize
+  );
+
+/**
+  Export linked kext cache after kext injection.
+
+  @param[in,out] Context    Prelinked context.
+  @param[out]    CacheSize  Exported cache size.
+
+  @return  Pool allocated cache to be saved or NULL when saved cache is up to date.
+**/
+VOID *
+PrelinkedLinkCacheExport (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  OUT    UINT32             *CacheSize
+  );
+
 /**
   Apply kext patch to prelinked.
 
@@ -990,8 +1320,12 @@ KcInitKextFixupChains (
   @param[in]     MachContext  The context of the Mach-O to index. It must have
                               been prelinked by OcAppleKernelLib. The image
                               must reside in Segment.
+
+  @retval EFI_SUCCESS           All relocations have been indexed.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failure.
+  @retval EFI_UNSUPPORTED       Relocations cannot be expressed as fixups.
 **/
-VOID
+EFI_STATUS
 KcKextIndexFixups (
   IN OUT PRELINKED_CONTEXT  *Context,
   IN     OC_MACHO_CONTEXT   *MachContext
@@ -1093,6 +1427,17 @@ PatcherInitContextFromBuffer (
   IN     BOOLEAN          Use32Bit
   );
 
+/**
+  Free resources owned by patcher context, e.g. symbol index.
+  Patcher context may continue to be used afterwards.
+
+  @param[in,out] Context         Patcher context.
+**/
+VOID
+PatcherFreeContext (
+  IN OUT PATCHER_CONTEXT  *Context
+  );
+
 /**
   Get local symbol address.
 
@@ -1157,6 +1502,24 @@ PatcherApplyGenericPatch (
   IN     PATCHER_GENERIC_PATCH  *Patch
   );
 
+/**
+  Apply multiple generic patches with a single scan over the binary.
+  The result is identical to calling PatcherApplyGenericPatch for every
+  patch in order.
+
+  @param[in,out] Context         Patcher context.
+  @param[in]     Patches         Patch descriptions.
+  @param[in]     NumPatches      Number of patches.
+  @param[out]    Results         Result for every patch.
+**/
+VOID
+PatcherApplyGenericPatches (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patches,
+  IN     UINT32                 NumPatches,
+  OUT    EFI_STATUS             *Results
+  );
+
 /**
   Exclude kext from prelinked.
 
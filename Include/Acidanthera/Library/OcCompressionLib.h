@@ -21,6 +21,12 @@
 **/
 #define OC_COMPRESSION_MAX_LENGTH  BASE_1GB
 
+/**
+  Scratch buffer size for decompression without memory allocation,
+  which is required e.g. on application processors.
+**/
+#define OC_DECOMPRESS_SCRATCH_SIZE  BASE_64KB
+
 /**
   Allow the use of extra adler32 validation.
   Not very useful as dmg has own checks.
@@ -63,6 +69,49 @@ DecompressLZSS (
   IN  UINT32  SrcLen
   );
 
+/**
+  Create streaming LZSS decompressor. Source is supplied with
+  DecompressLZSSStreamFeed in blocks of arbitrary size.
+
+  @param[out]  Dst         Destination buffer fitting the whole output.
+  @param[in]   DstLen      Destination buffer size.
+
+  @return  Decompressor to free with DecompressLZSSStreamFree or NULL.
+**/
+VOID *
+DecompressLZSSStreamInit (
+  OUT UINT8   *Dst,
+  IN  UINT32  DstLen
+  );
+
+/**
+  Decompress next source block with streaming LZSS decompressor.
+
+  @param[in,out]  Stream      Decompressor.
+  @param[in]      Src         Source block.
+  @param[in]      SrcLen      Source block size.
+
+  @return  FALSE when destination buffer is full and no more data is accepted.
+**/
+BOOLEAN
+DecompressLZSSStreamFeed (
+  IN OUT VOID         *Stream,
+  IN     CONST UINT8  *Src,
+  IN     UINT32       SrcLen
+  );
+
+/**
+  Free streaming LZSS decompressor.
+
+  @param[in]  Stream      Decompressor.
+
+  @return  DecompressedLen.
+**/
+UINT32
+DecompressLZSSStreamFree (
+  IN VOID  *Stream
+  );
+
 /**
   Decompress buffer with LZVN algorithm.
 
@@ -81,6 +130,117 @@ DecompressLZVN (
   IN  UINTN        SrcLen
   );
 
+/**
+  Default amount of match candidates examined per position by CompressLZVN.
+**/
+#define OC_LZVN_DEFAULT_EFFORT  16
+
+/**
+  Compress buffer with LZVN algorithm.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+  @param[in]   Effort      Maximum amount of match candidates examined per
+                           position, 0 for OC_LZVN_DEFAULT_EFFORT. Higher
+                           values improve ratio at the cost of speed.
+
+  @return  Dst + CompressedLen on success otherwise NULL.
+**/
+UINT8 *
+CompressLZVN (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen,
+  IN  UINT32       Effort
+  );
+
+/**
+  Create streaming LZVN decompressor. Source is supplied with
+  DecompressLZVNStreamFeed in blocks of arbitrary size.
+
+  @param[out]  Dst         Destination buffer fitting the whole output.
+  @param[in]   DstLen      Destination buffer size.
+
+  @return  Decompressor to free with DecompressLZVNStreamFree or NULL.
+**/
+VOID *
+DecompressLZVNStreamInit (
+  OUT UINT8  *Dst,
+  IN  UINTN  DstLen
+  );
+
+/**
+  Decompress next source block with streaming LZVN decompressor.
+
+  @param[in,out]  Stream      Decompressor.
+  @param[in]      Src         Source block.
+  @param[in]      SrcLen      Source block size.
+
+  @return  FALSE when end of stream is reached, destination buffer is full,
+           or source is invalid, and no more data is accepted.
+**/
+BOOLEAN
+DecompressLZVNStreamFeed (
+  IN OUT VOID         *Stream,
+  IN     CONST UINT8  *Src,
+  IN     UINTN        SrcLen
+  );
+
+/**
+  Free streaming LZVN decompressor.
+
+  @param[in]  Stream      Decompressor.
+
+  @return  DecompressedLen.
+**/
+UINTN
+DecompressLZVNStreamFree (
+  IN VOID  *Stream
+  );
+
+/**
+  Decompress buffer with LZFSE algorithm.
+  Both FSE-coded and LZVN-coded blocks are supported.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+
+  @return  DecompressedLen on success otherwise 0.
+**/
+UINTN
+DecompressLZFSE (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  );
+
+/**
+  Decompress buffer with LZFSE algorithm without allocating memory.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+  @param[in]   Scratch     Scratch buffer of OC_DECOMPRESS_SCRATCH_SIZE bytes,
+                           aligned to 8 bytes.
+
+  @return  DecompressedLen on success otherwise 0.
+**/
+UINTN
+DecompressLZFSEWithScratch (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen,
+  IN  VOID         *Scratch
+  );
+
 /**
   Compress buffer with ZLIB algorithm.
 
@@ -117,6 +277,84 @@ DecompressZLIB (
   IN  UINTN        SrcLen
   );
 
+/**
+  Decompress buffer with ZLIB algorithm without allocating memory.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+  @param[in]   Scratch     Scratch buffer of OC_DECOMPRESS_SCRATCH_SIZE bytes,
+                           aligned to 8 bytes.
+
+  @return  DecompressedLen on success otherwise 0.
+**/
+UINTN
+DecompressZLIBWithScratch (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen,
+  IN  VOID         *Scratch
+  );
+
+/**
+  Decompress buffer with ADC algorithm.
+  This algorithm is used for legacy Apple disk images.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+
+  @return  DecompressedLen on success otherwise 0.
+**/
+UINTN
+DecompressADC (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  );
+
+/**
+  Decompress buffer with BZIP2 algorithm.
+  Only the first stream is decoded, randomised blocks are not supported.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+
+  @return  DecompressedLen on success otherwise 0.
+**/
+UINTN
+DecompressBZIP2 (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  );
+
+/**
+  Decompress buffer with LZMA algorithm.
+  The buffer is expected to be a single XZ stream with LZMA2 filter.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+
+  @return  DecompressedLen on success otherwise 0.
+**/
+UINTN
+DecompressLZMA (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  );
+
 /**
   Decompress buffer with RLE24 algorithm and 8-bit alpha.
   This algorithm is used for encoding IT32/T8MK images in ICNS.
@@ -154,4 +392,51 @@ Adler32 (
   IN UINT32       BufferLen
   );
 
+/**
+  Calculates CRC-32 checksum (IEEE 802.3, as used by zlib and XZ).
+  @param[in]   Buffer         Source buffer.
+  @param[in]   BufferLen      Source buffer size.
+  @return  Checksum.
+**/
+UINT32
+Crc32 (
+  IN CONST UINT8  *Buffer,
+  IN UINTN        BufferLen
+  );
+
+/**
+  Checksum implementations used by Adler32 and Crc32, including the checks
+  performed by zlib. Vector modes also use PCLMULQDQ folding for CRC-32
+  when the CPU supports it.
+**/
+typedef enum {
+  OcChecksumScalar,
+  OcChecksumSsse3,
+  OcChecksumAvx2
+} OC_CHECKSUM_MODE;
+
+/**
+  Select checksum implementation. The best supported implementation
+  is selected automatically on first use, this is mainly meant for testing
+  and for code running on processors with different features enabled.
+
+  @param[in] Mode  Requested implementation, downgraded when unsupported.
+
+  @return  Implementation in use.
+**/
+OC_CHECKSUM_MODE
+OcSetChecksumMode (
+  IN OC_CHECKSUM_MODE  Mode
+  );
+
+/**
+  Get checksum implementation in use.
+
+  @return  Implementation in use.
+**/
+OC_CHECKSUM_MODE
+OcGetChecksumMode (
+  VOID
+  );
+
 #endif // OC_COMPRESSION_LIB_H
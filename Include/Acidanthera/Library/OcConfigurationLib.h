@@ -311,7 +311,8 @@ OC_DECLARE (OC_KERNEL_QUIRKS)
   _(OC_STRING                   , KernelArch       ,     , OC_STRING_CONSTR ("Auto", _, __), OC_DESTR (OC_STRING)) \
   _(OC_STRING                   , KernelCache      ,     , OC_STRING_CONSTR ("Auto", _, __), OC_DESTR (OC_STRING)) \
   _(BOOLEAN                     , CustomKernel     ,     , FALSE  , ()) \
-  _(BOOLEAN                     , FuzzyMatch       ,     , FALSE  , ())
+  _(BOOLEAN                     , FuzzyMatch       ,     , FALSE  , ()) \
+  _(BOOLEAN                     , KextLinkCache    ,     , FALSE  , ())
 OC_DECLARE (OC_KERNEL_SCHEME)
 
 #define OC_KERNEL_CONFIG_FIELDS(_, __) \
@@ -55,6 +55,11 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define SHA512_BLOCK_SIZE  128
 #define SHA384_BLOCK_SIZE  SHA512_BLOCK_SIZE
 
+//
+// Maximum amount of messages hashed in parallel by Sha256UpdateMulti.
+//
+#define OC_SHA256_MULTI_LANES  8
+
 //
 // Derived parameters.
 //
@@ -236,6 +241,29 @@ AesCtrXcryptBuffer (
   IN     UINT32       Len
   );
 
+/**
+  AES block implementations. AES-NI performs a whole round per instruction
+  and processes independent CBC decryption and CTR blocks in parallel.
+**/
+typedef enum {
+  OcAesPortable,
+  OcAesNi
+} OC_AES_MODE;
+
+/**
+  Override AES-NI use by AES CBC and CTR functions, e.g. to compare their
+  output with table-based code. AES-NI is used by default when present.
+
+  @param[in] Mode  OcAesNi to use AES-NI when the CPU has it,
+                   OcAesPortable to always use table-based code.
+
+  @return  Implementation in use.
+**/
+OC_AES_MODE
+OcSetAesMode (
+  IN OC_AES_MODE  Mode
+  );
+
 /**
   Setup ChaCha context (IETF variant).
 
@@ -269,6 +297,31 @@ ChaChaCryptBuffer (
   IN     UINT32          Length
   );
 
+/**
+  ChaCha block implementations. SSE2 and AVX2 calculate 4 and 8 consecutive
+  keystream blocks at once, shorter tails use portable code.
+**/
+typedef enum {
+  OcChaChaPortable,
+  OcChaChaSse2,
+  OcChaChaAvx2
+} OC_CHACHA_MODE;
+
+/**
+  Limit the widest keystream implementation used by ChaChaCryptBuffer.
+  AVX2 is the default limit, until TryEnableAccel or the OS enables YMM
+  state SSE2 is used on X64.
+
+  @param[in] Mode  Widest implementation to use, OcChaChaPortable disables
+                   vector code.
+
+  @return  Widest implementation in use.
+**/
+OC_CHACHA_MODE
+OcSetChaChaMode (
+  IN OC_CHACHA_MODE  Mode
+  );
+
 VOID
 Md5Init (
   MD5_CONTEXT  *Context
@@ -344,6 +397,40 @@ Sha256 (
   UINTN        Len
   );
 
+/**
+  Update multiple independent SHA-256 contexts, equivalent to calling
+  Sha256Update for every context. Messages are hashed in parallel lanes
+  when supported, see OC_SHA256_MODE.
+
+  @param[in,out] Contexts  Array of Count initialized contexts.
+  @param[in]     Data      Array of Count message parts.
+  @param[in]     Len       Array of Count message part lengths.
+  @param[in]     Count     Amount of contexts.
+**/
+VOID
+Sha256UpdateMulti (
+  IN OUT SHA256_CONTEXT  *Contexts,
+  IN     CONST UINT8     **Data,
+  IN     CONST UINTN     *Len,
+  IN     UINTN           Count
+  );
+
+/**
+  Hash multiple independent messages with SHA-256.
+
+  @param[out] Hashes  Count consecutive SHA256_DIGEST_SIZE digests.
+  @param[in]  Data    Array of Count messages.
+  @param[in]  Len     Array of Count message lengths.
+  @param[in]  Count   Amount of messages.
+**/
+VOID
+Sha256Multi (
+  OUT UINT8        *Hashes,
+  IN  CONST UINT8  **Data,
+  IN  CONST UINTN  *Len,
+  IN  UINTN        Count
+  );
+
 VOID
 Sha512Init (
   SHA512_CONTEXT  *Context
@@ -400,6 +487,33 @@ TryEnableAccel (
   VOID
   );
 
+/**
+  SHA-256 block implementations. SSE2 and AVX2 hash 4 and 8 independent
+  messages at once with Sha256UpdateMulti, single messages use portable code
+  with SSE2. SHA-NI hashes multiple messages one after another.
+**/
+typedef enum {
+  OcSha256Scalar,
+  OcSha256Sse2,
+  OcSha256Avx2,
+  OcSha256ShaNi
+} OC_SHA256_MODE;
+
+/**
+  Request SHA-256 block implementation used by Sha256Update and
+  Sha256UpdateMulti. SHA-NI is requested by default. AVX2 additionally needs
+  YMM state, so the choice is repeated once TryEnableAccel enables it.
+
+  @param[in] Mode  Requested implementation. When the CPU lacks features
+                   for it, the next slower supported one is used instead.
+
+  @return  Implementation in use.
+**/
+OC_SHA256_MODE
+OcSetSha256Mode (
+  IN OC_SHA256_MODE  Mode
+  );
+
 /**
   Verifies Data against Hash with the appropiate SHA2 algorithm for HashSize.
 
@@ -436,6 +550,30 @@ STATIC_ASSERT (
   "The definition of RSA_SCRATCH_BUFFER_SIZE may cause an overflow"
   );
 
+/**
+  RSA Montgomery multiplication implementations. MULX and ADX allow
+  accumulating products with two independent carry chains.
+**/
+typedef enum {
+  OcRsaPortable,
+  OcRsaAdx
+} OC_RSA_MODE;
+
+/**
+  Choose Montgomery multiplication used by RSA signature verification.
+  MULX and ADX are used by default when the CPU has BMI2 and ADX. Both
+  implementations give identical results, only the speed differs.
+
+  @param[in] Mode  Montgomery multiplication to use. Portable code is used
+                   when the CPU does not support it.
+
+  @return  Montgomery multiplication in use.
+**/
+OC_RSA_MODE
+OcSetRsaMode (
+  IN OC_RSA_MODE  Mode
+  );
+
 /**
   Verify a RSA PKCS1.5 signature against an expected hash.
   The exponent is always 65537 as per the format specification.
@@ -61,6 +61,8 @@
 
 #define OPEN_CORE_TOOL_PATH  L"Tools\\"
 
+#define OPEN_CORE_KEXT_LINK_CACHE_PATH  L"KextLinkCache.bin"
+
 /**
   Obtain cryptographic key if it was installed.
 
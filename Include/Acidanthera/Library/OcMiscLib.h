@@ -36,6 +36,28 @@
 #define SECONDS_TO_NANOSECONDS(x)  ((x) * 1000000000)
 #define MS_TO_NANOSECONDS(x)       ((x) * 1000000)
 
+/**
+  Pattern search implementations used by FindPattern and ApplyPatch.
+**/
+typedef enum {
+  OcPatternSearchScalar,
+  OcPatternSearchSse2,
+  OcPatternSearchAvx2
+} OC_PATTERN_SEARCH_MODE;
+
+/**
+  Select pattern search implementation. The best supported implementation
+  is selected automatically on first use, this is mainly meant for testing.
+
+  @param[in] Mode  Requested implementation, downgraded when unsupported.
+
+  @return  Implementation in use.
+**/
+OC_PATTERN_SEARCH_MODE
+OcSetPatternSearchMode (
+  IN OC_PATTERN_SEARCH_MODE  Mode
+  );
+
 BOOLEAN
 FindPattern (
   IN CONST UINT8   *Pattern,
@@ -59,6 +81,61 @@ ApplyPatch (
   IN UINT32        Skip
   );
 
+/**
+  Patch set entry for ApplyPatchSet.
+**/
+typedef struct {
+  //
+  // Pattern to find and its optional mask.
+  //
+  CONST UINT8    *Pattern;
+  CONST UINT8    *PatternMask;
+  //
+  // Replacement and its optional mask.
+  //
+  CONST UINT8    *Replace;
+  CONST UINT8    *ReplaceMask;
+  //
+  // Pattern and replacement size.
+  //
+  UINT32         PatternSize;
+  //
+  // Replacement count or 0 for all.
+  //
+  UINT32         Count;
+  //
+  // Amount of matches to skip.
+  //
+  UINT32         Skip;
+  //
+  // Patched region within the data.
+  //
+  UINT32         DataOffset;
+  UINT32         DataSize;
+  //
+  // Amount of replacements performed, set by ApplyPatchSet.
+  //
+  UINT32         ReplaceCount;
+} OC_PATCH_SET_ENTRY;
+
+/**
+  Apply multiple patches with a single scan over the data.
+  The result is identical to calling ApplyPatch for every entry in order
+  on its region of the data.
+
+  @param[in,out] Entries     Patch set entries.
+  @param[in]     NumEntries  Number of patch set entries.
+  @param[in,out] Data        Data to patch.
+  @param[in]     DataSize    Data size.
+**/
+VOID
+ApplyPatchSet (
+  IN OUT OC_PATCH_SET_ENTRY  *Entries,
+  IN     UINT32              NumEntries,
+  IN OUT UINT8               *Data,
+  IN     UINT32              DataSize
+  );
+
 /**
   Obtain application arguments.
 
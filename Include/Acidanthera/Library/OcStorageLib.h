@@ -168,6 +168,28 @@ OcStorageReadFileUnicode (
   OUT UINT32              *FileSize OPTIONAL
   );
 
+/**
+  Read multiple files from storage like OcStorageReadFileUnicode.
+  Vault signature checking hashes up to OC_SHA256_MULTI_LANES files
+  per pass.
+
+  @param[in]  Context      Storage context.
+  @param[in]  FilePaths    Array of Count full paths to the files on the device.
+  @param[in]  Count        Amount of files.
+  @param[out] Buffers      Array of Count pointers to buffers containing files
+                           read or NULL.
+  @param[out] FileSizes    Array of Count sizes of the files read, 0 for
+                           files not read (optional).
+**/
+VOID
+OcStorageReadFilesUnicode (
+  IN  OC_STORAGE_CONTEXT  *Context,
+  IN  CONST CHAR16        **FilePaths,
+  IN  UINTN               Count,
+  OUT VOID                **Buffers,
+  OUT UINT32              *FileSizes OPTIONAL
+  );
+
 /**
   Get information about the storage file when possible.
 
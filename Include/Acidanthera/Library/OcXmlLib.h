@@ -108,6 +108,46 @@ struct XML_NODE_;
 typedef struct XML_DOCUMENT_  XML_DOCUMENT;
 typedef struct XML_NODE_      XML_NODE;
 
+/**
+  Text range within an XML buffer.
+**/
+typedef struct XML_SPAN_ {
+  UINT32    Offset;
+  UINT32    Size;
+} XML_SPAN;
+
+/**
+  Offset index of plist array dictionaries, built by scanning the text
+  without parsing it.
+**/
+typedef struct XML_INDEX_ {
+  //
+  // Array contents start, right after the opening tag.
+  //
+  UINT32      ArrayStart;
+  //
+  // Array contents end, at the closing tag.
+  //
+  UINT32      ArrayEnd;
+  //
+  // Dictionary contents between <dict> and </dict> tags.
+  //
+  XML_SPAN    *Dicts;
+  //
+  // Content of the first string value for the requested key of every
+  // dictionary with IDREF resolved, Size is 0 when missing.
+  //
+  XML_SPAN    *Values;
+  UINT32      DictCount;
+  UINT32      DictAllocCount;
+  //
+  // Whole nodes defined with ID attribute indexed by ID, Size is 0 when
+  // undefined.
+  //
+  XML_SPAN    *References;
+  UINT32      ReferenceCount;
+} XML_INDEX;
+
 /**
   Parse the XML fragment in buffer.
   References in the document to allow deduplicated node reading:
@@ -539,4 +579,57 @@ PlistMultiDataSize (
   OUT  UINT32    *Size
   );
 
+/**
+  Index dictionaries of plist array following the key without parsing.
+  Comments, declarations and ID definitions are recognised, but nothing
+  besides the nesting is validated, so the document must still be parsed.
+  Dictionaries must have no attributes to be indexed.
+
+  @param[in]  Buffer      XML buffer.
+  @param[in]  BufferSize  XML buffer size.
+  @param[in]  ArrayKey    Key preceding the array, e.g. _PrelinkInfoDictionary.
+  @param[in]  ValueKey    Key to look up string values for, optional.
+  @param[out] Index       Offset index, free with XmlIndexFree.
+
+  @return  TRUE on success.
+**/
+BOOLEAN
+XmlIndexPlistArray (
+  IN  CONST CHAR8  *Buffer,
+  IN  UINT32       BufferSize,
+  IN  CONST CHAR8  *ArrayKey,
+  IN  CONST CHAR8  *ValueKey  OPTIONAL,
+  OUT XML_INDEX    *Index
+  );
+
+/**
+  Build standalone dictionary from indexed dictionary contents with
+  IDREF nodes replaced by their definitions, suitable for parsing
+  without reference support.
+
+  @param[in]  Index         Offset index.
+  @param[in]  Buffer        XML buffer Index was built for.
+  @param[in]  Contents      Dictionary contents.
+  @param[out] ExpandedSize  Dictionary size.
+
+  @return  Pool allocated dictionary or NULL.
+**/
+CHAR8 *
+XmlIndexExpandDict (
+  IN  CONST XML_INDEX  *Index,
+  IN  CONST CHAR8      *Buffer,
+  IN  CONST XML_SPAN   *Contents,
+  OUT UINT32           *ExpandedSize
+  );
+
+/**
+  Free offset index resources.
+
+  @param[in,out] Index  Offset index.
+**/
+VOID
+XmlIndexFree (
+  IN OUT XML_INDEX  *Index
+  );
+
 #endif // OC_XML_LIB_H
@@ -20,6 +20,107 @@
 #include <Library/OcAppleRamDiskLib.h>
 #include <Library/OcCryptoLib.h>
 
+//
+// Size of the buffer chunk data is hashed through in lazy verification.
+//
+#define CHUNKLIST_SCRATCH_SIZE  BASE_64KB
+
+/**
+  Verifies multiple chunks, hashing them in parallel through equal parts of
+  the scratch buffer.
+
+  @param[in] Context      The Context to verify against.
+  @param[in] ExtentTable  A pointer to the RAM disk extent table.
+  @param[in] Indices      The indices of the chunks to verify.
+  @param[in] Offsets      The data offsets of the chunks to verify.
+  @param[in] Count        The amount of chunks, at most OC_SHA256_MULTI_LANES.
+  @param[in] Scratch      The scratch buffer to read chunk data into.
+  @param[in] ScratchSize  The size of the scratch buffer.
+
+  @return  TRUE when all chunks were verified successfully.
+**/
+STATIC
+BOOLEAN
+InternalVerifyChunks (
+  IN CONST OC_APPLE_CHUNKLIST_CONTEXT   *Context,
+  IN CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN CONST UINTN                        *Indices,
+  IN CONST UINT64                       *Offsets,
+  IN UINTN                              Count,
+  IN UINT8                              *Scratch,
+  IN UINT32                             ScratchSize
+  )
+{
+  BOOLEAN         Result;
+  BOOLEAN         Pending;
+  SHA256_CONTEXT  HashContexts[OC_SHA256_MULTI_LANES];
+  CONST UINT8     *Data[OC_SHA256_MULTI_LANES];
+  UINTN           Sizes[OC_SHA256_MULTI_LANES];
+  UINT32          Positions[OC_SHA256_MULTI_LANES];
+  UINT8           ChunkHash[SHA256_DIGEST_SIZE];
+  UINT32          LaneSize;
+  UINTN           Lane;
+
+  ASSERT (Count > 0 && Count <= OC_SHA256_MULTI_LANES);
+
+  //
+  // Whole blocks per lane keep the lanes in lockstep.
+  //
+  LaneSize = (UINT32)(ScratchSize / Count) & ~(UINT32)(SHA256_BLOCK_SIZE - 1);
+
+  for (Lane = 0; Lane < Count; ++Lane) {
+    DEBUG ((
+      DEBUG_VERBOSE,
+      "OCCL: Validating chunk %lu of %lu\n",
+      (UINT64)Indices[Lane] + 1,
+      (UINT64)Context->ChunkCount
+      ));
+    Sha256Init (&HashContexts[Lane]);
+    Data[Lane]      = &Scratch[Lane * LaneSize];
+    Positions[Lane] = 0;
+  }
+
+  do {
+    Pending = FALSE;
+
+    for (Lane = 0; Lane < Count; ++Lane) {
+      Sizes[Lane] = MIN (Context->Chunks[Indices[Lane]].Length - Positions[Lane], LaneSize);
+      if (Sizes[Lane] == 0) {
+        continue;
+      }
+
+      Result = OcAppleRamDiskRead (
+                 ExtentTable,
+                 (UINTN)(Offsets[Lane] + Positions[Lane]),
+                 Sizes[Lane],
+                 &Scratch[Lane * LaneSize]
+                 );
+      if (!Result) {
+        DEBUG ((DEBUG_WARN, "OCCL: Chunk %Lu cannot be read\n", (UINT64)Indices[Lane]));
+        return FALSE;
+      }
+
+      Positions[Lane] += (UINT32)Sizes[Lane];
+      Pending          = TRUE;
+    }
+
+    if (Pending) {
+      Sha256UpdateMulti (HashContexts, Data, Sizes, Count);
+    }
+  } while (Pending);
+
+  Result = TRUE;
+  for (Lane = 0; Lane < Count; ++Lane) {
+    Sha256Final (&HashContexts[Lane], ChunkHash);
+    if (CompareMem (ChunkHash, Context->Chunks[Indices[Lane]].Checksum, SHA256_DIGEST_SIZE) != 0) {
+      DEBUG ((DEBUG_WARN, "OCCL: Chunk %Lu failed verification\n", (UINT64)Indices[Lane]));
+      Result = FALSE;
+    }
+  }
+
+  return Result;
+}
+
 BOOLEAN
 OcAppleChunklistInitializeContext (
   OUT OC_APPLE_CHUNKLIST_CONTEXT  *Context,
@@ -40,6 +141,10 @@ OcAppleChunklistInitializeContext (
 
   ChunklistHeader = (APPLE_CHUNKLIST_HEADER *)Buffer;
 
+  Context->ChunkOffsets   = NULL;
+  Context->VerifiedChunks = NULL;
+  Context->ScratchBuffer  = NULL;
+
   if (BufferSize < sizeof (APPLE_CHUNKLIST_HEADER)) {
     return FALSE;
   }
@@ -136,69 +241,216 @@ OcAppleChunklistVerifyData (
   )
 {
   BOOLEAN  Result;
+  UINTN    Index;
+  UINTN    Count;
+  UINTN    Indices[OC_SHA256_MULTI_LANES];
+  UINT64   Offsets[OC_SHA256_MULTI_LANES];
+  UINT64   CurrentOffset;
+  UINT8    *Scratch;
 
-  UINTN                        Index;
-  UINT8                        ChunkHash[SHA256_DIGEST_SIZE];
-  CONST APPLE_CHUNKLIST_CHUNK  *CurrentChunk;
-  UINTN                        CurrentOffset;
+  ASSERT (Context != NULL);
+  ASSERT (Context->Chunks != NULL);
+  ASSERT (ExtentTable != NULL);
 
-  UINT32  ChunkDataSize;
-  VOID    *ChunkData;
+  DEBUG_CODE (
+    ASSERT (Context->Signature == NULL);
+    );
+
+  Scratch = AllocatePool (CHUNKLIST_SCRATCH_SIZE * OC_SHA256_MULTI_LANES);
+  if (Scratch == NULL) {
+    return FALSE;
+  }
+
+  //
+  // Hash up to OC_SHA256_MULTI_LANES consecutive chunks per pass.
+  //
+  Result        = TRUE;
+  CurrentOffset = 0;
+  for (Index = 0; Index < Context->ChunkCount && Result; Index += Count) {
+    for (Count = 0; Count < OC_SHA256_MULTI_LANES && Index + Count < Context->ChunkCount; ++Count) {
+      Indices[Count] = Index + Count;
+      Offsets[Count] = CurrentOffset;
+      CurrentOffset += Context->Chunks[Index + Count].Length;
+    }
+
+    Result = InternalVerifyChunks (
+               Context,
+               ExtentTable,
+               Indices,
+               Offsets,
+               Count,
+               Scratch,
+               CHUNKLIST_SCRATCH_SIZE * OC_SHA256_MULTI_LANES
+               );
+  }
+
+  FreePool (Scratch);
+  return Result;
+}
+
+BOOLEAN
+OcAppleChunklistInitializeLazyVerification (
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT  *Context,
+  IN     UINT64                      DataSize
+  )
+{
+  UINTN                  Index;
+  UINT64                 Offset;
+  UINTN                  BitmapSize;
+  UINTN                  AllocationSize;
+  UINT64                 *ChunkOffsets;
+  UINT8                  *ScratchBuffer;
+  APPLE_CHUNKLIST_CHUNK  *Chunks;
 
   ASSERT (Context != NULL);
   ASSERT (Context->Chunks != NULL);
-  ASSERT (ExtentTable != NULL);
+  ASSERT (Context->ChunkOffsets == NULL);
 
   DEBUG_CODE (
     ASSERT (Context->Signature == NULL);
     );
 
-  ChunkDataSize = 0;
+  //
+  // Offsets go first to stay naturally aligned, followed by the scratch
+  // buffer, chunk descriptors and the verified chunk bitmap.
+  //
+  BitmapSize = (Context->ChunkCount + 7) / 8;
+  if (  BaseOverflowMulAddUN (sizeof (UINT64), Context->ChunkCount + 1, CHUNKLIST_SCRATCH_SIZE + BitmapSize, &AllocationSize)
+     || BaseOverflowMulAddUN (sizeof (APPLE_CHUNKLIST_CHUNK), Context->ChunkCount, AllocationSize, &AllocationSize))
+  {
+    return FALSE;
+  }
+
+  ChunkOffsets = AllocateZeroPool (AllocationSize);
+  if (ChunkOffsets == NULL) {
+    return FALSE;
+  }
+
+  ScratchBuffer = (UINT8 *)&ChunkOffsets[Context->ChunkCount + 1];
+  Chunks        = (APPLE_CHUNKLIST_CHUNK *)(ScratchBuffer + CHUNKLIST_SCRATCH_SIZE);
+  CopyMem (Chunks, Context->Chunks, Context->ChunkCount * sizeof (APPLE_CHUNKLIST_CHUNK));
+
+  Offset = 0;
   for (Index = 0; Index < Context->ChunkCount; ++Index) {
-    CurrentChunk = &Context->Chunks[Index];
-    if (ChunkDataSize < CurrentChunk->Length) {
-      ChunkDataSize = CurrentChunk->Length;
-    }
+    ChunkOffsets[Index] = Offset;
+    Offset             += Chunks[Index].Length;
   }
 
-  ChunkData = AllocatePool (ChunkDataSize);
-  if (ChunkData == NULL) {
+  ChunkOffsets[Context->ChunkCount] = Offset;
+
+  //
+  // Lazy verification must not leave any data unverified.
+  //
+  if (Offset != DataSize) {
+    DEBUG ((DEBUG_INFO, "OCCL: Chunklist covers %Lu of %Lu bytes\n", Offset, DataSize));
+    FreePool (ChunkOffsets);
     return FALSE;
   }
 
-  CurrentOffset = 0;
-  for (Index = 0; Index < Context->ChunkCount; Index++) {
-    CurrentChunk = &Context->Chunks[Index];
+  Context->Chunks         = Chunks;
+  Context->ChunkOffsets   = ChunkOffsets;
+  Context->ScratchBuffer  = ScratchBuffer;
+  Context->VerifiedChunks = (UINT8 *)&Chunks[Context->ChunkCount];
 
-    Result = OcAppleRamDiskRead (
-               ExtentTable,
-               CurrentOffset,
-               CurrentChunk->Length,
-               ChunkData
-               );
-    if (!Result) {
-      FreePool (ChunkData);
-      return FALSE;
+  return TRUE;
+}
+
+BOOLEAN
+OcAppleChunklistVerifyRange (
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT         *Context,
+  IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN     UINT64                             Offset,
+  IN     UINT64                             Length
+  )
+{
+  UINT64  End;
+  UINTN   Low;
+  UINTN   High;
+  UINTN   Middle;
+  UINTN   Index;
+  UINTN   Count;
+  UINTN   Lane;
+  UINTN   Indices[OC_SHA256_MULTI_LANES];
+  UINT64  Offsets[OC_SHA256_MULTI_LANES];
+
+  ASSERT (Context != NULL);
+  ASSERT (Context->ChunkOffsets != NULL);
+  ASSERT (ExtentTable != NULL);
+
+  if (  BaseOverflowAddU64 (Offset, Length, &End)
+     || (End > Context->ChunkOffsets[Context->ChunkCount]))
+  {
+    return FALSE;
+  }
+
+  if (Length == 0) {
+    return TRUE;
+  }
+
+  //
+  // Find the last chunk starting at or before Offset.
+  //
+  Low  = 0;
+  High = Context->ChunkCount;
+  while (High - Low > 1) {
+    Middle = Low + (High - Low) / 2;
+    if (Context->ChunkOffsets[Middle] <= Offset) {
+      Low = Middle;
+    } else {
+      High = Middle;
     }
+  }
 
-    //
-    // Calculate checksum of data and ensure they match.
-    //
-    DEBUG ((
-      DEBUG_VERBOSE,
-      "OCCL: Validating chunk %lu of %lu\n",
-      (UINT64)Index + 1,
-      (UINT64)Context->ChunkCount
-      ));
-    Sha256 (ChunkHash, ChunkData, CurrentChunk->Length);
-    if (CompareMem (ChunkHash, CurrentChunk->Checksum, SHA256_DIGEST_SIZE) != 0) {
-      FreePool (ChunkData);
+  //
+  // Collect up to OC_SHA256_MULTI_LANES unverified chunks per pass.
+  //
+  Index = Low;
+  while (TRUE) {
+    Count = 0;
+    for ( ; Index < Context->ChunkCount && Context->ChunkOffsets[Index] < End && Count < OC_SHA256_MULTI_LANES; ++Index) {
+      if ((Context->VerifiedChunks[Index / 8] & (1U << (Index % 8))) == 0) {
+        Indices[Count] = Index;
+        Offsets[Count] = Context->ChunkOffsets[Index];
+        ++Count;
+      }
+    }
+
+    if (Count == 0) {
+      return TRUE;
+    }
+
+    if (!InternalVerifyChunks (
+           Context,
+           ExtentTable,
+           Indices,
+           Offsets,
+           Count,
+           Context->ScratchBuffer,
+           CHUNKLIST_SCRATCH_SIZE
+           ))
+    {
       return FALSE;
     }
 
-    CurrentOffset += CurrentChunk->Length;
+    for (Lane = 0; Lane < Count; ++Lane) {
+      Context->VerifiedChunks[Indices[Lane] / 8] |= (UINT8)(1U << (Indices[Lane] % 8));
+    }
   }
+}
 
-  FreePool (ChunkData);
-  return TRUE;
+VOID
+OcAppleChunklistFreeContext (
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT  *Context
+  )
+{
+  ASSERT (Context != NULL);
+
+  if (Context->ChunkOffsets != NULL) {
+    FreePool (Context->ChunkOffsets);
+    Context->ChunkCount     = 0;
+    Context->Chunks         = NULL;
+    Context->ChunkOffsets   = NULL;
+    Context->VerifiedChunks = NULL;
+    Context->ScratchBuffer  = NULL;
+  }
 }
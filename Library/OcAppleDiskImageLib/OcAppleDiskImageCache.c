@@ -0,0 +1,200 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcAppleDiskImageLib.h>
+
+#include "OcAppleDiskImageLibInternal.h"
+
+#define OC_APPLE_DISK_IMAGE_CACHE_ENTRY_SIGNATURE  \
+  SIGNATURE_32 ('D', 'M', 'G', 'C')
+
+typedef struct {
+  UINT32                          Signature;
+  LIST_ENTRY                      Link;
+  CONST APPLE_DISK_IMAGE_CHUNK    *Chunk;
+  UINTN                           DataSize;
+  //
+  // UINT8  Data[DataSize] follows.
+  //
+} OC_APPLE_DISK_IMAGE_CACHE_ENTRY;
+
+#define OC_APPLE_DISK_IMAGE_CACHE_ENTRY_FROM_LINK(This)  \
+  (CR (                                                  \
+     (This),                                             \
+     OC_APPLE_DISK_IMAGE_CACHE_ENTRY,                    \
+     Link,                                               \
+     OC_APPLE_DISK_IMAGE_CACHE_ENTRY_SIGNATURE           \
+     ))
+
+#define OC_APPLE_DISK_IMAGE_CACHE_ENTRY_FROM_DATA(Data)  \
+  ((OC_APPLE_DISK_IMAGE_CACHE_ENTRY *)(Data) - 1)
+
+VOID
+InternalChunkCacheInit (
+  OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  InitializeListHead (&Context->ChunkCache);
+  Context->ChunkCacheSize   = 0;
+  Context->ChunkCacheBudget = OC_APPLE_DISK_IMAGE_DEFAULT_CACHE_SIZE;
+  ZeroMem (&Context->CacheStats, sizeof (Context->CacheStats));
+}
+
+VOID
+InternalChunkCacheTrim (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        Budget
+  )
+{
+  LIST_ENTRY                       *Link;
+  OC_APPLE_DISK_IMAGE_CACHE_ENTRY  *Entry;
+
+  while (Context->ChunkCacheSize > Budget) {
+    ASSERT (!IsListEmpty (&Context->ChunkCache));
+
+    Link  = GetPreviousNode (&Context->ChunkCache, &Context->ChunkCache);
+    Entry = OC_APPLE_DISK_IMAGE_CACHE_ENTRY_FROM_LINK (Link);
+
+    RemoveEntryList (Link);
+    Context->ChunkCacheSize -= Entry->DataSize;
+    FreePool (Entry);
+  }
+}
+
+CONST UINT8 *
+InternalChunkCacheLookup (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT   *Context,
+  IN     CONST APPLE_DISK_IMAGE_CHUNK  *Chunk
+  )
+{
+  LIST_ENTRY                       *Link;
+  OC_APPLE_DISK_IMAGE_CACHE_ENTRY  *Entry;
+
+  for (
+       Link = GetFirstNode (&Context->ChunkCache);
+       !IsNull (&Context->ChunkCache, Link);
+       Link = GetNextNode (&Context->ChunkCache, Link)
+       )
+  {
+    Entry = OC_APPLE_DISK_IMAGE_CACHE_ENTRY_FROM_LINK (Link);
+    if (Entry->Chunk == Chunk) {
+      if (Link != GetFirstNode (&Context->ChunkCache)) {
+        RemoveEntryList (Link);
+        InsertHeadList (&Context->ChunkCache, Link);
+      }
+
+      ++Context->CacheStats.Hits;
+      return (CONST UINT8 *)(Entry + 1);
+    }
+  }
+
+  ++Context->CacheStats.Misses;
+  return NULL;
+}
+
+BOOLEAN
+InternalChunkCacheContains (
+  IN CONST OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN CONST APPLE_DISK_IMAGE_CHUNK       *Chunk
+  )
+{
+  LIST_ENTRY                       *Link;
+  OC_APPLE_DISK_IMAGE_CACHE_ENTRY  *Entry;
+
+  for (
+       Link = GetFirstNode (&Context->ChunkCache);
+       !IsNull (&Context->ChunkCache, Link);
+       Link = GetNextNode (&Context->ChunkCache, Link)
+       )
+  {
+    Entry = OC_APPLE_DISK_IMAGE_CACHE_ENTRY_FROM_LINK (Link);
+    if (Entry->Chunk == Chunk) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+UINT8 *
+InternalChunkCacheAllocate (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        DataSize
+  )
+{
+  OC_APPLE_DISK_IMAGE_CACHE_ENTRY  *Entry;
+
+  if (DataSize > Context->ChunkCacheBudget) {
+    return NULL;
+  }
+
+  InternalChunkCacheTrim (Context, Context->ChunkCacheBudget - DataSize);
+
+  Entry = AllocatePool (sizeof (*Entry) + DataSize);
+  if (Entry == NULL) {
+    return NULL;
+  }
+
+  Entry->Signature = OC_APPLE_DISK_IMAGE_CACHE_ENTRY_SIGNATURE;
+  Entry->Chunk     = NULL;
+  Entry->DataSize  = DataSize;
+
+  return (UINT8 *)(Entry + 1);
+}
+
+VOID
+InternalChunkCacheInsert (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT   *Context,
+  IN     CONST APPLE_DISK_IMAGE_CHUNK  *Chunk,
+  IN     UINT8                         *Data
+  )
+{
+  OC_APPLE_DISK_IMAGE_CACHE_ENTRY  *Entry;
+
+  Entry = OC_APPLE_DISK_IMAGE_CACHE_ENTRY_FROM_DATA (Data);
+  ASSERT (Entry->Signature == OC_APPLE_DISK_IMAGE_CACHE_ENTRY_SIGNATURE);
+
+  Entry->Chunk = Chunk;
+  InsertHeadList (&Context->ChunkCache, &Entry->Link);
+  Context->ChunkCacheSize += Entry->DataSize;
+}
+
+VOID
+InternalChunkCacheDiscard (
+  IN UINT8  *Data
+  )
+{
+  OC_APPLE_DISK_IMAGE_CACHE_ENTRY  *Entry;
+
+  Entry = OC_APPLE_DISK_IMAGE_CACHE_ENTRY_FROM_DATA (Data);
+  ASSERT (Entry->Signature == OC_APPLE_DISK_IMAGE_CACHE_ENTRY_SIGNATURE);
+
+  FreePool (Entry);
+}
+
+VOID
+OcAppleDiskImageSetCacheSize (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        CacheSize
+  )
+{
+  ASSERT (Context != NULL);
+
+  Context->ChunkCacheBudget = CacheSize;
+  InternalChunkCacheTrim (Context, CacheSize);
+}
@@ -186,9 +186,32 @@ OcAppleDiskImageInitializeContext (
   }
 
   Context->ExtentTable = ExtentTable;
+  Context->FileSize    = FileSize;
   Context->BlockCount  = DmgBlockCount;
   Context->Blocks      = DmgBlocks;
   Context->SectorCount = (UINTN)SectorCount;
+  Context->XmlOffset   = XmlOffset;
+  Context->XmlLength   = XmlLength;
+  Context->Chunklist   = NULL;
+
+  Context->NextReadLba     = 0;
+  Context->ReadAheadChunks = 0;
+  Context->ReadAheadEnd    = 0;
+  Context->MpServices      = NULL;
+
+  Result = InternalBuildChunkIndex (Context);
+  if (!Result) {
+    DEBUG ((DEBUG_INFO, "OCDI: DMG chunk index error: %u\n", DmgBlockCount));
+
+    while (DmgBlockCount-- > 0) {
+      FreePool (DmgBlocks[DmgBlockCount]);
+    }
+
+    FreePool (DmgBlocks);
+    return FALSE;
+  }
+
+  InternalChunkCacheInit (Context);
 
   return TRUE;
 }
@@ -254,6 +277,92 @@ OcAppleDiskImageVerifyData (
            );
 }
 
+BOOLEAN
+OcAppleDiskImageVerifyDataLazy (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT       *Context,
+  IN     CONST OC_APPLE_CHUNKLIST_CONTEXT  *ChunklistContext
+  )
+{
+  BOOLEAN                     Result;
+  OC_APPLE_CHUNKLIST_CONTEXT  *Chunklist;
+
+  ASSERT (Context != NULL);
+  ASSERT (ChunklistContext != NULL);
+  ASSERT (Context->Chunklist == NULL);
+
+  Chunklist = AllocateCopyPool (sizeof (*Chunklist), ChunklistContext);
+  if (Chunklist == NULL) {
+    return FALSE;
+  }
+
+  Result = OcAppleChunklistInitializeLazyVerification (Chunklist, Context->FileSize);
+  if (!Result) {
+    FreePool (Chunklist);
+    return FALSE;
+  }
+
+  //
+  // Trailer and property list were parsed before the chunklist was
+  // available, and they describe where all other data resides.
+  //
+  Result = OcAppleChunklistVerifyRange (
+             Chunklist,
+             Context->ExtentTable,
+             Context->FileSize - sizeof (APPLE_DISK_IMAGE_TRAILER),
+             sizeof (APPLE_DISK_IMAGE_TRAILER)
+             );
+  if (Result) {
+    Result = OcAppleChunklistVerifyRange (
+               Chunklist,
+               Context->ExtentTable,
+               Context->XmlOffset,
+               Context->XmlLength
+               );
+  }
+
+  if (!Result) {
+    OcAppleChunklistFreeContext (Chunklist);
+    FreePool (Chunklist);
+    return FALSE;
+  }
+
+  Context->Chunklist = Chunklist;
+  return TRUE;
+}
+
+BOOLEAN
+OcAppleDiskImageVerifyRemaining (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  BOOLEAN                      Result;
+  UINT32                       Index;
+  CONST APPLE_RAM_DISK_EXTENT  *Extent;
+
+  ASSERT (Context != NULL);
+
+  if (Context->Chunklist == NULL) {
+    return TRUE;
+  }
+
+  Result = OcAppleChunklistVerifyRange (
+             Context->Chunklist,
+             Context->ExtentTable,
+             0,
+             Context->FileSize
+             );
+  if (!Result) {
+    DEBUG ((DEBUG_WARN, "OCDI: DMG has been altered, wiping\n"));
+
+    for (Index = 0; Index < Context->ExtentTable->ExtentCount; ++Index) {
+      Extent = &Context->ExtentTable->Extents[Index];
+      ZeroMem ((VOID *)(UINTN)Extent->Start, (UINTN)Extent->Length);
+    }
+  }
+
+  return Result;
+}
+
 VOID
 OcAppleDiskImageFreeContext (
   IN OC_APPLE_DISK_IMAGE_CONTEXT  *Context
@@ -263,11 +372,28 @@ OcAppleDiskImageFreeContext (
 
   ASSERT (Context != NULL);
 
+  DEBUG ((
+    DEBUG_INFO,
+    "OCDI: Chunk cache hits %Lu misses %Lu inflated %Lu bytes read ahead %Lu\n",
+    Context->CacheStats.Hits,
+    Context->CacheStats.Misses,
+    Context->CacheStats.BytesInflated,
+    Context->CacheStats.ReadAhead
+    ));
+
+  InternalChunkCacheTrim (Context, 0);
+
   for (Index = 0; Index < Context->BlockCount; ++Index) {
     FreePool (Context->Blocks[Index]);
   }
 
   FreePool (Context->Blocks);
+  FreePool (Context->ChunkIndex);
+
+  if (Context->Chunklist != NULL) {
+    OcAppleChunklistFreeContext (Context->Chunklist);
+    FreePool (Context->Chunklist);
+  }
 }
 
 VOID
@@ -279,6 +405,146 @@ OcAppleDiskImageFreeFile (
   OcAppleDiskImageFreeContext (Context);
 }
 
+BOOLEAN
+InternalVerifyData (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT64                       Offset,
+  IN     UINT64                       Length
+  )
+{
+  if (Context->Chunklist == NULL) {
+    return TRUE;
+  }
+
+  return OcAppleChunklistVerifyRange (
+           Context->Chunklist,
+           Context->ExtentTable,
+           Offset,
+           Length
+           );
+}
+
+UINTN
+InternalDecompressChunk (
+  IN  UINT32       Type,
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  )
+{
+  switch (Type) {
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_ADC:
+      return DecompressADC (Dst, DstLen, Src, SrcLen);
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_ZLIB:
+      return DecompressZLIB (Dst, DstLen, Src, SrcLen);
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_BZ2:
+      return DecompressBZIP2 (Dst, DstLen, Src, SrcLen);
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_LZFSE:
+      return DecompressLZFSE (Dst, DstLen, Src, SrcLen);
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_LZMA:
+      return DecompressLZMA (Dst, DstLen, Src, SrcLen);
+    default:
+      ASSERT (FALSE);
+      return 0;
+  }
+}
+
+/**
+  Read data from a compressed chunk, inflating it on cache miss.
+
+  @param[in,out] Context           DMG context.
+  @param[in]     Chunk             Compressed chunk.
+  @param[in]     ChunkTotalLength  Decompressed chunk size.
+  @param[in]     ChunkOffset       Offset to read from within the chunk.
+  @param[in]     BufferSize        Size to read.
+  @param[out]    Buffer            Buffer to read to.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalReadCompressedChunk (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT   *Context,
+  IN     CONST APPLE_DISK_IMAGE_CHUNK  *Chunk,
+  IN     UINTN                         ChunkTotalLength,
+  IN     UINTN                         ChunkOffset,
+  IN     UINTN                         BufferSize,
+  OUT    UINT8                         *Buffer
+  )
+{
+  BOOLEAN      Result;
+  BOOLEAN      Cached;
+  CONST UINT8  *CachedData;
+  UINT8        *ChunkData;
+  UINT8        *ChunkDataCompressed;
+  UINTN        OutSize;
+
+  CachedData = InternalChunkCacheLookup (Context, Chunk);
+  if (CachedData != NULL) {
+    CopyMem (Buffer, CachedData + ChunkOffset, BufferSize);
+    return TRUE;
+  }
+
+  //
+  // Chunks over the cache budget are inflated into a temporary buffer.
+  //
+  ChunkData = InternalChunkCacheAllocate (Context, ChunkTotalLength);
+  Cached    = ChunkData != NULL;
+  if (!Cached) {
+    ChunkData = AllocatePool (ChunkTotalLength);
+    if (ChunkData == NULL) {
+      return FALSE;
+    }
+  }
+
+  Result              = FALSE;
+  ChunkDataCompressed = AllocatePool ((UINTN)Chunk->CompressedLength);
+  if (ChunkDataCompressed != NULL) {
+    Result = InternalVerifyData (
+               Context,
+               Chunk->CompressedOffset,
+               Chunk->CompressedLength
+               );
+    if (Result) {
+      Result = OcAppleRamDiskRead (
+                 Context->ExtentTable,
+                 (UINTN)Chunk->CompressedOffset,
+                 (UINTN)Chunk->CompressedLength,
+                 ChunkDataCompressed
+                 );
+    }
+
+    if (Result) {
+      OutSize = InternalDecompressChunk (
+                  Chunk->Type,
+                  ChunkData,
+                  ChunkTotalLength,
+                  ChunkDataCompressed,
+                  (UINTN)Chunk->CompressedLength
+                  );
+      Context->CacheStats.BytesInflated += OutSize;
+      Result                             = OutSize == ChunkTotalLength;
+    }
+
+    FreePool (ChunkDataCompressed);
+  }
+
+  if (Result) {
+    CopyMem (Buffer, ChunkData + ChunkOffset, BufferSize);
+  }
+
+  if (!Cached) {
+    FreePool (ChunkData);
+  } else if (Result) {
+    InternalChunkCacheInsert (Context, Chunk, ChunkData);
+  } else {
+    InternalChunkCacheDiscard (ChunkData);
+  }
+
+  return Result;
+}
+
 BOOLEAN
 OcAppleDiskImageRead (
   IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
@@ -288,14 +554,13 @@ OcAppleDiskImageRead (
   )
 {
   BOOLEAN  Result;
+  BOOLEAN  Sequential;
 
   APPLE_DISK_IMAGE_BLOCK_DATA  *BlockData;
   APPLE_DISK_IMAGE_CHUNK       *Chunk;
   UINT64                       ChunkTotalLength;
   UINT64                       ChunkLength;
   UINT64                       ChunkOffset;
-  UINT8                        *ChunkData;
-  UINT8                        *ChunkDataCompressed;
 
   UINTN  LbaCurrent;
   UINTN  LbaOffset;
@@ -304,12 +569,11 @@ OcAppleDiskImageRead (
   UINTN  BufferChunkSize;
   UINT8  *BufferCurrent;
 
-  UINTN  OutSize;
-
   ASSERT (Context != NULL);
   ASSERT (Buffer != NULL);
   ASSERT (Lba < Context->SectorCount);
 
+  Sequential          = Lba == Context->NextReadLba;
   LbaCurrent          = Lba;
   RemainingBufferSize = BufferSize;
   BufferCurrent       = Buffer;
@@ -355,6 +619,15 @@ OcAppleDiskImageRead (
 
       case APPLE_DISK_IMAGE_CHUNK_TYPE_RAW:
       {
+        Result = InternalVerifyData (
+                   Context,
+                   Chunk->CompressedOffset + ChunkOffset,
+                   BufferChunkSize
+                   );
+        if (!Result) {
+          return FALSE;
+        }
+
         Result = OcAppleRamDiskRead (
                    Context->ExtentTable,
                    (UINTN)(Chunk->CompressedOffset + ChunkOffset),
@@ -368,38 +641,24 @@ OcAppleDiskImageRead (
         break;
       }
 
+      case APPLE_DISK_IMAGE_CHUNK_TYPE_ADC:
       case APPLE_DISK_IMAGE_CHUNK_TYPE_ZLIB:
+      case APPLE_DISK_IMAGE_CHUNK_TYPE_BZ2:
+      case APPLE_DISK_IMAGE_CHUNK_TYPE_LZFSE:
+      case APPLE_DISK_IMAGE_CHUNK_TYPE_LZMA:
       {
-        ChunkData = AllocatePool ((UINTN)(ChunkTotalLength + Chunk->CompressedLength));
-        if (ChunkData == NULL) {
-          return FALSE;
-        }
-
-        ChunkDataCompressed = (ChunkData + (UINTN)ChunkTotalLength);
-        Result              = OcAppleRamDiskRead (
-                                Context->ExtentTable,
-                                (UINTN)Chunk->CompressedOffset,
-                                (UINTN)Chunk->CompressedLength,
-                                ChunkDataCompressed
-                                );
+        Result = InternalReadCompressedChunk (
+                   Context,
+                   Chunk,
+                   (UINTN)ChunkTotalLength,
+                   (UINTN)ChunkOffset,
+                   BufferChunkSize,
+                   BufferCurrent
+                   );
         if (!Result) {
-          FreePool (ChunkData);
-          return FALSE;
-        }
-
-        OutSize = DecompressZLIB (
-                    ChunkData,
-                    (UINTN)ChunkTotalLength,
-                    ChunkDataCompressed,
-                    (UINTN)Chunk->CompressedLength
-                    );
-        if (OutSize != (UINTN)ChunkTotalLength) {
-          FreePool (ChunkData);
           return FALSE;
         }
 
-        CopyMem (BufferCurrent, (ChunkData + ChunkOffset), BufferChunkSize);
-        FreePool (ChunkData);
         break;
       }
 
@@ -419,5 +678,13 @@ OcAppleDiskImageRead (
     LbaCurrent          += LbaLength;
   }
 
+  Context->NextReadLba = Lba + BufferSize / APPLE_DISK_IMAGE_SECTOR_SIZE;
+
+  if (!Sequential) {
+    Context->ReadAheadEnd = 0;
+  } else if (Context->ReadAheadChunks > 0) {
+    InternalReadAhead (Context, Context->LastChunk + 1);
+  }
+
   return TRUE;
 }
@@ -322,6 +322,105 @@ DONE_ERROR:
   return Result;
 }
 
+BOOLEAN
+InternalBuildChunkIndex (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  BOOLEAN                          Result;
+  UINT32                           BlockIndex;
+  UINT32                           ChunkIndex;
+  UINT32                           Index;
+  UINT32                           ChunkCount;
+  UINT32                           IndexSize;
+  APPLE_DISK_IMAGE_BLOCK_DATA      *BlockData;
+  APPLE_DISK_IMAGE_CHUNK           *BlockChunk;
+  OC_APPLE_DISK_IMAGE_CHUNK_INDEX  *Entry;
+  UINT64                           SectorEnd;
+
+  //
+  // Blocks are almost always stored in order, so insertion sort is linear.
+  //
+  for (BlockIndex = 1; BlockIndex < Context->BlockCount; ++BlockIndex) {
+    BlockData = Context->Blocks[BlockIndex];
+    for (Index = BlockIndex; Index > 0; --Index) {
+      if (Context->Blocks[Index - 1]->SectorNumber <= BlockData->SectorNumber) {
+        break;
+      }
+
+      Context->Blocks[Index] = Context->Blocks[Index - 1];
+    }
+
+    Context->Blocks[Index] = BlockData;
+  }
+
+  ChunkCount = 0;
+  for (BlockIndex = 0; BlockIndex < Context->BlockCount; ++BlockIndex) {
+    BlockData = Context->Blocks[BlockIndex];
+    for (ChunkIndex = 0; ChunkIndex < BlockData->ChunkCount; ++ChunkIndex) {
+      if (BlockData->Chunks[ChunkIndex].SectorCount != 0) {
+        ++ChunkCount;
+      }
+    }
+  }
+
+  if (ChunkCount == 0) {
+    return FALSE;
+  }
+
+  Result = BaseOverflowMulU32 (ChunkCount, sizeof (*Context->ChunkIndex), &IndexSize);
+  if (Result) {
+    return FALSE;
+  }
+
+  Context->ChunkIndex = AllocatePool (IndexSize);
+  if (Context->ChunkIndex == NULL) {
+    return FALSE;
+  }
+
+  //
+  // Chunks within a block must be ordered, and blocks are sorted above,
+  // so any overlap shows up between adjacent entries.
+  //
+  Index     = 0;
+  SectorEnd = 0;
+  for (BlockIndex = 0; BlockIndex < Context->BlockCount; ++BlockIndex) {
+    BlockData = Context->Blocks[BlockIndex];
+    for (ChunkIndex = 0; ChunkIndex < BlockData->ChunkCount; ++ChunkIndex) {
+      BlockChunk = &BlockData->Chunks[ChunkIndex];
+      if (BlockChunk->SectorCount == 0) {
+        continue;
+      }
+
+      Entry              = &Context->ChunkIndex[Index];
+      Entry->SectorStart = DMG_SECTOR_START_ABS (BlockData, BlockChunk);
+      Entry->SectorEnd   = Entry->SectorStart + BlockChunk->SectorCount;
+      Entry->Block       = BlockData;
+      Entry->Chunk       = BlockChunk;
+
+      if (Entry->SectorStart < SectorEnd) {
+        DEBUG ((
+          DEBUG_INFO,
+          "OCDI: DMG chunk at %Lu is unordered or overlaps chunk ending at %Lu\n",
+          Entry->SectorStart,
+          SectorEnd
+          ));
+        FreePool (Context->ChunkIndex);
+        Context->ChunkIndex = NULL;
+        return FALSE;
+      }
+
+      SectorEnd = Entry->SectorEnd;
+      ++Index;
+    }
+  }
+
+  Context->ChunkCount = ChunkCount;
+  Context->LastChunk  = 0;
+
+  return TRUE;
+}
+
 BOOLEAN
 InternalGetBlockChunk (
   IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
@@ -330,30 +429,53 @@ InternalGetBlockChunk (
   OUT APPLE_DISK_IMAGE_CHUNK       **Chunk
   )
 {
-  UINT32                       BlockIndex;
-  UINT32                       ChunkIndex;
-  APPLE_DISK_IMAGE_BLOCK_DATA  *BlockData;
-  APPLE_DISK_IMAGE_CHUNK       *BlockChunk;
-
-  for (BlockIndex = 0; BlockIndex < Context->BlockCount; ++BlockIndex) {
-    BlockData = Context->Blocks[BlockIndex];
+  OC_APPLE_DISK_IMAGE_CHUNK_INDEX  *Entry;
+  UINT32                           Index;
+  UINT32                           Low;
+  UINT32                           High;
+  UINT32                           Middle;
+
+  //
+  // Reads are mostly sequential, try the last used chunk and its successor.
+  //
+  Index = Context->LastChunk;
+  Entry = &Context->ChunkIndex[Index];
+  if (Lba >= Entry->SectorEnd) {
+    if ((Index + 1 < Context->ChunkCount) && (Lba >= Entry[1].SectorStart)) {
+      ++Index;
+      ++Entry;
+    }
+  }
 
-    if (  (Lba >= BlockData->SectorNumber)
-       && (Lba < (BlockData->SectorNumber + BlockData->SectorCount)))
-    {
-      for (ChunkIndex = 0; ChunkIndex < BlockData->ChunkCount; ++ChunkIndex) {
-        BlockChunk = &BlockData->Chunks[ChunkIndex];
-
-        if (  (Lba >= DMG_SECTOR_START_ABS (BlockData, BlockChunk))
-           && (Lba < (DMG_SECTOR_START_ABS (BlockData, BlockChunk) + BlockChunk->SectorCount)))
-        {
-          *Data  = BlockData;
-          *Chunk = BlockChunk;
-          return TRUE;
-        }
+  if ((Lba < Entry->SectorStart) || (Lba >= Entry->SectorEnd)) {
+    //
+    // Find the last chunk starting at or before the LBA.
+    //
+    Low  = 0;
+    High = Context->ChunkCount;
+    while (Low < High) {
+      Middle = Low + (High - Low) / 2;
+      if (Context->ChunkIndex[Middle].SectorStart <= Lba) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
       }
     }
+
+    if (Low == 0) {
+      return FALSE;
+    }
+
+    Index = Low - 1;
+    Entry = &Context->ChunkIndex[Index];
+    if (Lba >= Entry->SectorEnd) {
+      return FALSE;
+    }
   }
 
-  return FALSE;
+  Context->LastChunk = Index;
+
+  *Data  = Entry->Block;
+  *Chunk = Entry->Chunk;
+  return TRUE;
 }
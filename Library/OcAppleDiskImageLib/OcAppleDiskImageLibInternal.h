@@ -37,6 +37,19 @@ InternalParsePlist (
   OUT APPLE_DISK_IMAGE_BLOCK_DATA  ***Blocks
   );
 
+/**
+  Build sorted chunk index of parsed disk image blocks.
+  Blocks are reordered by their starting sector.
+
+  @param[in,out] Context  DMG context with parsed blocks.
+
+  @return  FALSE when chunks overlap or memory allocation fails.
+**/
+BOOLEAN
+InternalBuildChunkIndex (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  );
+
 BOOLEAN
 InternalGetBlockChunk (
   IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
@@ -45,4 +58,144 @@ InternalGetBlockChunk (
   OUT APPLE_DISK_IMAGE_CHUNK       **Chunk
   );
 
+/**
+  Verify disk image data against the chunklist when verifying lazily.
+
+  @param[in,out] Context  DMG context.
+  @param[in]     Offset   Data offset within disk image file.
+  @param[in]     Length   Data length.
+
+  @return  TRUE when the data is verified or lazy verification is not used.
+**/
+BOOLEAN
+InternalVerifyData (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT64                       Offset,
+  IN     UINT64                       Length
+  );
+
+/**
+  Decompress chunk data with the algorithm matching chunk type.
+
+  @param[in]  Type    Chunk type.
+  @param[out] Dst     Destination buffer.
+  @param[in]  DstLen  Destination buffer size.
+  @param[in]  Src     Source buffer.
+  @param[in]  SrcLen  Source buffer size.
+
+  @return  DecompressedLen on success otherwise 0.
+**/
+UINTN
+InternalDecompressChunk (
+  IN  UINT32       Type,
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  );
+
+/**
+  Inflate chunks following a sequential read into the chunk cache.
+
+  @param[in,out] Context  DMG context.
+  @param[in]     First    Index of the first chunk following the read.
+**/
+VOID
+InternalReadAhead (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT32                       First
+  );
+
+/**
+  Initialise empty decompressed chunk cache with default budget.
+
+  @param[out] Context  DMG context.
+**/
+VOID
+InternalChunkCacheInit (
+  OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  );
+
+/**
+  Evict least recently used chunks until cache fits the budget.
+
+  @param[in,out] Context  DMG context.
+  @param[in]     Budget   Cache size to fit into.
+**/
+VOID
+InternalChunkCacheTrim (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        Budget
+  );
+
+/**
+  Find decompressed chunk data and mark it most recently used.
+
+  @param[in,out] Context  DMG context.
+  @param[in]     Chunk    Compressed chunk.
+
+  @return  Decompressed chunk data or NULL.
+**/
+CONST UINT8 *
+InternalChunkCacheLookup (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT   *Context,
+  IN     CONST APPLE_DISK_IMAGE_CHUNK  *Chunk
+  );
+
+/**
+  Check whether decompressed chunk data is cached without updating
+  recency or statistics.
+
+  @param[in] Context  DMG context.
+  @param[in] Chunk    Compressed chunk.
+
+  @return  TRUE when chunk data is cached.
+**/
+BOOLEAN
+InternalChunkCacheContains (
+  IN CONST OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN CONST APPLE_DISK_IMAGE_CHUNK       *Chunk
+  );
+
+/**
+  Allocate cached buffer for decompressed chunk data, evicting least
+  recently used chunks when over the budget. The buffer must be either
+  committed with InternalChunkCacheInsert or released with
+  InternalChunkCacheDiscard.
+
+  @param[in,out] Context   DMG context.
+  @param[in]     DataSize  Decompressed chunk size.
+
+  @return  Chunk data buffer or NULL when it does not fit into the cache.
+**/
+UINT8 *
+InternalChunkCacheAllocate (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        DataSize
+  );
+
+/**
+  Insert decompressed chunk data as most recently used.
+
+  @param[in,out] Context  DMG context.
+  @param[in]     Chunk    Compressed chunk.
+  @param[in]     Data     Buffer from InternalChunkCacheAllocate.
+**/
+VOID
+InternalChunkCacheInsert (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT   *Context,
+  IN     CONST APPLE_DISK_IMAGE_CHUNK  *Chunk,
+  IN     UINT8                         *Data
+  );
+
+/**
+  Release buffer from InternalChunkCacheAllocate without inserting it.
+
+  @param[in] Data  Buffer from InternalChunkCacheAllocate.
+**/
+VOID
+InternalChunkCacheDiscard (
+  IN UINT8  *Data
+  );
+
 #endif // APPLE_DISK_IMAGE_LIB_INTERNAL_H
@@ -0,0 +1,509 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Uefi.h>
+
+#include <Protocol/MpService.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseOverflowLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcAppleDiskImageLib.h>
+#include <Library/OcCompressionLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "OcAppleDiskImageLibInternal.h"
+
+//
+// Upper limit of cache budget grown for read-ahead window.
+//
+#define READ_AHEAD_MAX_CACHE_SIZE  BASE_32MB
+
+//
+// Chunk inflated ahead of reading it.
+//
+typedef struct {
+  CONST APPLE_DISK_IMAGE_CHUNK    *Chunk;
+  UINT8                           *Compressed;
+  UINT8                           *Data;
+  UINTN                           DataLength;
+  //
+  // Decompression scratch buffer, set for jobs inflated with MP services.
+  //
+  VOID                            *Scratch;
+  //
+  // Job may be run on an application processor, which cannot allocate.
+  //
+  BOOLEAN                         ApSafe;
+  volatile BOOLEAN                Done;
+  UINTN                           Result;
+} READ_AHEAD_JOB;
+
+//
+// Read-ahead batch shared with application processors.
+//
+typedef struct {
+  EFI_MP_SERVICES_PROTOCOL    *MpServices;
+  READ_AHEAD_JOB              *Jobs;
+  UINTN                       JobCount;
+  UINTN                       BspNumber;
+  UINTN                       ApCount;
+} READ_AHEAD_BATCH;
+
+STATIC
+BOOLEAN
+InternalIsCompressedChunk (
+  IN CONST APPLE_DISK_IMAGE_CHUNK  *Chunk
+  )
+{
+  switch (Chunk->Type) {
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_ADC:
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_ZLIB:
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_BZ2:
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_LZFSE:
+    case APPLE_DISK_IMAGE_CHUNK_TYPE_LZMA:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/**
+  Inflate read-ahead job. Jobs with scratch buffer do not allocate memory.
+
+  @param[in,out] Job  Read-ahead job.
+**/
+STATIC
+VOID
+InternalInflateJob (
+  IN OUT READ_AHEAD_JOB  *Job
+  )
+{
+  UINTN  OutSize;
+
+  if ((Job->Scratch != NULL) && (Job->Chunk->Type == APPLE_DISK_IMAGE_CHUNK_TYPE_ZLIB)) {
+    OutSize = DecompressZLIBWithScratch (
+                Job->Data,
+                Job->DataLength,
+                Job->Compressed,
+                (UINTN)Job->Chunk->CompressedLength,
+                Job->Scratch
+                );
+  } else if ((Job->Scratch != NULL) && (Job->Chunk->Type == APPLE_DISK_IMAGE_CHUNK_TYPE_LZFSE)) {
+    OutSize = DecompressLZFSEWithScratch (
+                Job->Data,
+                Job->DataLength,
+                Job->Compressed,
+                (UINTN)Job->Chunk->CompressedLength,
+                Job->Scratch
+                );
+  } else {
+    OutSize = InternalDecompressChunk (
+                Job->Chunk->Type,
+                Job->Data,
+                Job->DataLength,
+                Job->Compressed,
+                (UINTN)Job->Chunk->CompressedLength
+                );
+  }
+
+  Job->Result = OutSize;
+  Job->Done   = TRUE;
+}
+
+/**
+  Inflate AP-safe jobs assigned to the current application processor.
+
+  @param[in,out] Buffer  Read-ahead batch.
+**/
+STATIC
+VOID
+EFIAPI
+InternalReadAheadAp (
+  IN OUT VOID  *Buffer
+  )
+{
+  EFI_STATUS        Status;
+  READ_AHEAD_BATCH  *Batch;
+  UINTN             Number;
+  UINTN             Index;
+
+  Batch = Buffer;
+
+  Status = Batch->MpServices->WhoAmI (Batch->MpServices, &Number);
+  if (EFI_ERROR (Status) || (Number == Batch->BspNumber)) {
+    return;
+  }
+
+  if (Number > Batch->BspNumber) {
+    --Number;
+  }
+
+  for (Index = Number; Index < Batch->JobCount; Index += Batch->ApCount) {
+    if (Batch->Jobs[Index].ApSafe) {
+      InternalInflateJob (&Batch->Jobs[Index]);
+    }
+  }
+}
+
+/**
+  Check whether application processors may inflate read-ahead jobs.
+
+  @param[in]  Context  DMG context.
+  @param[out] Batch    Read-ahead batch to fill processor information in.
+
+  @return  TRUE when MP services can be used.
+**/
+STATIC
+BOOLEAN
+InternalReadAheadCanUseMp (
+  IN  CONST OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  OUT READ_AHEAD_BATCH                   *Batch
+  )
+{
+  EFI_STATUS  Status;
+  EFI_TPL     OldTpl;
+  UINTN       NumberOfProcessors;
+  UINTN       NumberOfEnabledProcessors;
+
+  if (Context->MpServices == NULL) {
+    return FALSE;
+  }
+
+  //
+  // Non-blocking StartupAllAPs is serviced by a timer event, which cannot
+  // fire at or above TPL_NOTIFY.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  gBS->RestoreTPL (OldTpl);
+  if (OldTpl >= TPL_NOTIFY) {
+    return FALSE;
+  }
+
+  Status = Context->MpServices->GetNumberOfProcessors (
+                                  Context->MpServices,
+                                  &NumberOfProcessors,
+                                  &NumberOfEnabledProcessors
+                                  );
+  if (EFI_ERROR (Status) || (NumberOfProcessors < 2)) {
+    return FALSE;
+  }
+
+  Status = Context->MpServices->WhoAmI (
+                                  Context->MpServices,
+                                  &Batch->BspNumber
+                                  );
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  Batch->MpServices = Context->MpServices;
+  Batch->ApCount    = NumberOfProcessors - 1;
+  return TRUE;
+}
+
+/**
+  Inflate read-ahead jobs, spreading AP-safe jobs across application
+  processors when possible. Jobs not inflated by application processors
+  are inflated on the bootstrap processor.
+
+  @param[in,out] Batch  Read-ahead batch.
+  @param[in]     UseMp  Use MP services from the batch.
+**/
+STATIC
+VOID
+InternalReadAheadRun (
+  IN OUT READ_AHEAD_BATCH  *Batch,
+  IN     BOOLEAN           UseMp
+  )
+{
+  EFI_STATUS        Status;
+  EFI_EVENT         Event;
+  UINTN             Index;
+  OC_CHECKSUM_MODE  ChecksumMode;
+
+  Event        = NULL;
+  ChecksumMode = OcGetChecksumMode ();
+
+  if (UseMp && (Batch->JobCount > 0)) {
+    //
+    // YMM state may only be enabled on the bootstrap processor,
+    // keep zlib checksums on application processors to SSSE3.
+    //
+    if (ChecksumMode > OcChecksumSsse3) {
+      OcSetChecksumMode (OcChecksumSsse3);
+    }
+
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Event);
+    if (EFI_ERROR (Status)) {
+      Event = NULL;
+    } else {
+      Status = Batch->MpServices->StartupAllAPs (
+                                    Batch->MpServices,
+                                    InternalReadAheadAp,
+                                    FALSE,
+                                    Event,
+                                    0,
+                                    Batch,
+                                    NULL
+                                    );
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_VERBOSE, "OCDI: Read-ahead StartupAllAPs failure - %r\n", Status));
+        gBS->CloseEvent (Event);
+        Event = NULL;
+      }
+    }
+  }
+
+  if (Event != NULL) {
+    //
+    // Inflate jobs application processors cannot handle meanwhile.
+    //
+    for (Index = 0; Index < Batch->JobCount; ++Index) {
+      if (!Batch->Jobs[Index].ApSafe) {
+        InternalInflateJob (&Batch->Jobs[Index]);
+      }
+    }
+
+    while (gBS->CheckEvent (Event) == EFI_NOT_READY) {
+      CpuPause ();
+    }
+
+    gBS->CloseEvent (Event);
+  }
+
+  if (ChecksumMode != OcGetChecksumMode ()) {
+    OcSetChecksumMode (ChecksumMode);
+  }
+
+  for (Index = 0; Index < Batch->JobCount; ++Index) {
+    if (!Batch->Jobs[Index].Done) {
+      InternalInflateJob (&Batch->Jobs[Index]);
+    }
+  }
+}
+
+/**
+  Prepare read-ahead job reading compressed chunk data.
+
+  @param[in,out] Context  DMG context.
+  @param[in]     Chunk    Compressed chunk.
+  @param[in]     UseMp    Allocate scratch buffer for application processors.
+  @param[out]    Job      Read-ahead job.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalReadAheadPrepare (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT   *Context,
+  IN     CONST APPLE_DISK_IMAGE_CHUNK  *Chunk,
+  IN     BOOLEAN                       UseMp,
+  OUT    READ_AHEAD_JOB                *Job
+  )
+{
+  BOOLEAN  Result;
+
+  Job->Chunk      = Chunk;
+  Job->DataLength = (UINTN)Chunk->SectorCount * APPLE_DISK_IMAGE_SECTOR_SIZE;
+
+  Job->Data = InternalChunkCacheAllocate (Context, Job->DataLength);
+  if (Job->Data == NULL) {
+    return FALSE;
+  }
+
+  Job->Compressed = AllocatePool ((UINTN)Chunk->CompressedLength);
+  if (Job->Compressed == NULL) {
+    InternalChunkCacheDiscard (Job->Data);
+    return FALSE;
+  }
+
+  Result = InternalVerifyData (
+             Context,
+             Chunk->CompressedOffset,
+             Chunk->CompressedLength
+             );
+  if (Result) {
+    Result = OcAppleRamDiskRead (
+               Context->ExtentTable,
+               (UINTN)Chunk->CompressedOffset,
+               (UINTN)Chunk->CompressedLength,
+               Job->Compressed
+               );
+  }
+
+  if (!Result) {
+    FreePool (Job->Compressed);
+    InternalChunkCacheDiscard (Job->Data);
+    return FALSE;
+  }
+
+  if (  UseMp
+     && (  (Chunk->Type == APPLE_DISK_IMAGE_CHUNK_TYPE_ZLIB)
+        || (Chunk->Type == APPLE_DISK_IMAGE_CHUNK_TYPE_LZFSE)))
+  {
+    Job->Scratch = AllocatePool (OC_DECOMPRESS_SCRATCH_SIZE);
+  }
+
+  Job->ApSafe = Chunk->Type == APPLE_DISK_IMAGE_CHUNK_TYPE_ADC || Job->Scratch != NULL;
+  return TRUE;
+}
+
+VOID
+InternalReadAhead (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT32                       First
+  )
+{
+  BOOLEAN                       UseMp;
+  READ_AHEAD_BATCH              Batch;
+  READ_AHEAD_JOB                *Job;
+  CONST APPLE_DISK_IMAGE_CHUNK  *Chunk;
+  UINT32                        Index;
+  UINT32                        End;
+  UINTN                         BatchSize;
+
+  //
+  // Refill the window once half of it has been read.
+  //
+  if (  (First >= Context->ChunkCount)
+     || ((UINT64)First + Context->ReadAheadChunks / 2 < Context->ReadAheadEnd))
+  {
+    return;
+  }
+
+  Index = MAX (First, Context->ReadAheadEnd);
+  End   = (UINT32)MIN ((UINT64)First + Context->ReadAheadChunks, Context->ChunkCount);
+  if (Index >= End) {
+    return;
+  }
+
+  ZeroMem (&Batch, sizeof (Batch));
+  Batch.Jobs = AllocateZeroPool ((End - Index) * sizeof (*Batch.Jobs));
+  if (Batch.Jobs == NULL) {
+    return;
+  }
+
+  UseMp = InternalReadAheadCanUseMp (Context, &Batch);
+
+  //
+  // Leave half of the cache to chunks read before.
+  //
+  BatchSize = 0;
+  for (; Index < End; ++Index) {
+    Chunk = Context->ChunkIndex[Index].Chunk;
+    if (  !InternalIsCompressedChunk (Chunk)
+       || InternalChunkCacheContains (Context, Chunk))
+    {
+      continue;
+    }
+
+    if (  (Chunk->SectorCount * APPLE_DISK_IMAGE_SECTOR_SIZE
+           > Context->ChunkCacheBudget / 2 - BatchSize)
+       || !InternalReadAheadPrepare (Context, Chunk, UseMp, &Batch.Jobs[Batch.JobCount]))
+    {
+      break;
+    }
+
+    BatchSize += Batch.Jobs[Batch.JobCount].DataLength;
+    ++Batch.JobCount;
+  }
+
+  Context->ReadAheadEnd = Index;
+
+  InternalReadAheadRun (&Batch, UseMp);
+
+  //
+  // Insert the nearest chunk last to have it evicted last.
+  //
+  for (Index = (UINT32)Batch.JobCount; Index > 0; --Index) {
+    Job = &Batch.Jobs[Index - 1];
+
+    Context->CacheStats.BytesInflated += Job->Result;
+    if (Job->Result == Job->DataLength) {
+      InternalChunkCacheInsert (Context, Job->Chunk, Job->Data);
+      ++Context->CacheStats.ReadAhead;
+    } else {
+      InternalChunkCacheDiscard (Job->Data);
+    }
+
+    FreePool (Job->Compressed);
+    if (Job->Scratch != NULL) {
+      FreePool (Job->Scratch);
+    }
+  }
+
+  FreePool (Batch.Jobs);
+
+  InternalChunkCacheTrim (Context, Context->ChunkCacheBudget);
+}
+
+VOID
+OcAppleDiskImageSetReadAhead (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT32                       ChunkCount,
+  IN     BOOLEAN                      UseMpServices
+  )
+{
+  EFI_STATUS                    Status;
+  UINT32                        Index;
+  CONST APPLE_DISK_IMAGE_CHUNK  *Chunk;
+  UINT64                        MaxSectorCount;
+  UINT64                        CacheSize;
+
+  ASSERT (Context != NULL);
+
+  Context->ReadAheadChunks = ChunkCount;
+  Context->ReadAheadEnd    = 0;
+  Context->MpServices      = NULL;
+
+  if (ChunkCount == 0) {
+    return;
+  }
+
+  if (UseMpServices) {
+    Status = gBS->LocateProtocol (
+                    &gEfiMpServiceProtocolGuid,
+                    NULL,
+                    (VOID **)&Context->MpServices
+                    );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_INFO, "OCDI: No MP services for read-ahead - %r\n", Status));
+      Context->MpServices = NULL;
+    }
+  }
+
+  MaxSectorCount = 0;
+  for (Index = 0; Index < Context->ChunkCount; ++Index) {
+    Chunk = Context->ChunkIndex[Index].Chunk;
+    if (InternalIsCompressedChunk (Chunk)) {
+      MaxSectorCount = MAX (MaxSectorCount, Chunk->SectorCount);
+    }
+  }
+
+  //
+  // Fit two read-ahead windows, so that half of the cache remains
+  // for chunks read before.
+  //
+  if (  !BaseOverflowMulU64 (MaxSectorCount, APPLE_DISK_IMAGE_SECTOR_SIZE * 2, &CacheSize)
+     && !BaseOverflowMulU64 (CacheSize, ChunkCount, &CacheSize))
+  {
+    CacheSize = MIN (CacheSize, READ_AHEAD_MAX_CACHE_SIZE);
+    if (CacheSize > Context->ChunkCacheBudget) {
+      Context->ChunkCacheBudget = (UINTN)CacheSize;
+    }
+  } else {
+    Context->ChunkCacheBudget = MAX (Context->ChunkCacheBudget, READ_AHEAD_MAX_CACHE_SIZE);
+  }
+}
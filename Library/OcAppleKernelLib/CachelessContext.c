@@ -70,6 +70,39 @@ FreeBuiltInKext (
   FreePool (BuiltinKext);
 }
 
+/**
+  Add entry to cacheless lookup index. Index is dropped on failure,
+  and list walking is used for lookups instead.
+
+  @param[in,out] Map    Lookup index.
+  @param[in]     Key    Null-terminated ASCII or Unicode key.
+  @param[in]     Value  Indexed entry.
+**/
+STATIC
+VOID
+InternalIndexCachelessKext (
+  IN OUT OC_HASH_MAP  *Map,
+  IN     CONST VOID   *Key,
+  IN     VOID         *Value
+  )
+{
+  BOOLEAN  Result;
+
+  if (Map->Entries == NULL) {
+    return;
+  }
+
+  if (Map->KeyType == OcHashMapKeyUnicode) {
+    Result = InternalHashMapInsertUnicode (Map, Key, Value);
+  } else {
+    Result = InternalHashMapInsert (Map, Key, Value);
+  }
+
+  if (!Result) {
+    InternalHashMapFree (Map);
+  }
+}
+
 STATIC
 EFI_STATUS
 AddKextDependency (
@@ -420,6 +453,12 @@ ScanExtensions (
           }
 
           InsertTailList (&Context->BuiltInKexts, &BuiltinKext->Link);
+          InternalIndexCachelessKext (&Context->BuiltInKextIdentifiers, BuiltinKext->Identifier, BuiltinKext);
+          InternalIndexCachelessKext (&Context->BuiltInKextPlistPaths, BuiltinKext->PlistPath, BuiltinKext);
+          if (BuiltinKext->BinaryPath != NULL) {
+            InternalIndexCachelessKext (&Context->BuiltInKextBinaryPaths, BuiltinKext->BinaryPath, BuiltinKext);
+          }
+
           DEBUG ((
             DEBUG_VERBOSE,
             "OCAK: Discovered bundle %a %s %s %u\n",
@@ -482,6 +521,10 @@ LookupPatchedKextForIdentifier (
   PATCHED_KEXT  *PatchedKext;
   LIST_ENTRY    *KextLink;
 
+  if (Context->PatchedKextIdentifiers.Entries != NULL) {
+    return InternalHashMapFind (&Context->PatchedKextIdentifiers, Identifier);
+  }
+
   KextLink = GetFirstNode (&Context->PatchedKexts);
   while (!IsNull (&Context->PatchedKexts, KextLink)) {
     PatchedKext = GET_PATCHED_KEXT_FROM_LINK (KextLink);
@@ -506,6 +549,10 @@ LookupBuiltinKextForIdentifier (
   BUILTIN_KEXT  *BuiltinKext;
   LIST_ENTRY    *KextLink;
 
+  if (Context->BuiltInKextIdentifiers.Entries != NULL) {
+    return InternalHashMapFind (&Context->BuiltInKextIdentifiers, Identifier);
+  }
+
   KextLink = GetFirstNode (&Context->BuiltInKexts);
   while (!IsNull (&Context->BuiltInKexts, KextLink)) {
     BuiltinKext = GET_BUILTIN_KEXT_FROM_LINK (KextLink);
@@ -530,6 +577,10 @@ LookupBuiltinKextForPlistPath (
   BUILTIN_KEXT  *BuiltinKext;
   LIST_ENTRY    *KextLink;
 
+  if (Context->BuiltInKextPlistPaths.Entries != NULL) {
+    return InternalHashMapFindUnicode (&Context->BuiltInKextPlistPaths, PlistPath);
+  }
+
   KextLink = GetFirstNode (&Context->BuiltInKexts);
   while (!IsNull (&Context->BuiltInKexts, KextLink)) {
     BuiltinKext = GET_BUILTIN_KEXT_FROM_LINK (KextLink);
@@ -554,6 +605,10 @@ LookupBuiltinKextForBinaryPath (
   BUILTIN_KEXT  *BuiltinKext;
   LIST_ENTRY    *KextLink;
 
+  if (Context->BuiltInKextBinaryPaths.Entries != NULL) {
+    return InternalHashMapFindUnicode (&Context->BuiltInKextBinaryPaths, BinaryPath);
+  }
+
   KextLink = GetFirstNode (&Context->BuiltInKexts);
   while (!IsNull (&Context->BuiltInKexts, KextLink)) {
     BuiltinKext = GET_BUILTIN_KEXT_FROM_LINK (KextLink);
@@ -640,6 +695,7 @@ InternalAddPatchedKext (
   InitializeListHead (&PatchedKext->Patches);
 
   InsertTailList (&Context->PatchedKexts, &PatchedKext->Link);
+  InternalIndexCachelessKext (&Context->PatchedKextIdentifiers, PatchedKext->Identifier, PatchedKext);
 
   *Kext = PatchedKext;
   return EFI_SUCCESS;
@@ -727,6 +783,14 @@ CachelessContextInit (
   InitializeListHead (&Context->PatchedKexts);
   InitializeListHead (&Context->BuiltInKexts);
 
+  //
+  // Lookup indices are optional, lookups walk the lists without them.
+  //
+  InternalHashMapInit (&Context->BuiltInKextIdentifiers, 0, OcHashMapKeyAscii);
+  InternalHashMapInit (&Context->BuiltInKextPlistPaths, 0, OcHashMapKeyUnicode);
+  InternalHashMapInit (&Context->BuiltInKextBinaryPaths, 0, OcHashMapKeyUnicode);
+  InternalHashMapInit (&Context->PatchedKextIdentifiers, 0, OcHashMapKeyAscii);
+
   return EFI_SUCCESS;
 }
 
@@ -800,6 +864,11 @@ CachelessContextFree (
     FreePool (BuiltinKext);
   }
 
+  InternalHashMapFree (&Context->BuiltInKextIdentifiers);
+  InternalHashMapFree (&Context->BuiltInKextPlistPaths);
+  InternalHashMapFree (&Context->BuiltInKextBinaryPaths);
+  InternalHashMapFree (&Context->PatchedKextIdentifiers);
+
   ZeroMem (Context, sizeof (*Context));
 }
 
@@ -1631,6 +1700,8 @@ CachelessContextHookBuiltin (
           ));
       }
 
+      PatcherFreeContext (&Patcher);
+
       //
       // Virtualize patched binary.
       //
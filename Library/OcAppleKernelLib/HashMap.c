@@ -0,0 +1,417 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Base.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "PrelinkedInternal.h"
+
+//
+// Minimum amount of slots allocated for a map.
+//
+#define OC_HASH_MAP_MIN_CAPACITY  16U
+
+//
+// Maximum amount of slots allocated for a map, keeps size computations in range.
+//
+#define OC_HASH_MAP_MAX_CAPACITY  BIT28
+
+//
+// FNV-1a parameters.
+//
+#define OC_HASH_MAP_FNV_BASIS  0x811C9DC5U
+#define OC_HASH_MAP_FNV_PRIME  0x01000193U
+
+//
+// 2^64 divided by the golden ratio, used for numeric keys.
+//
+#define OC_HASH_MAP_FIB_MULTIPLIER  0x9E3779B97F4A7C15ULL
+
+/**
+  Calculate hash map ASCII key hash.
+
+  @param[in] Key  Null-terminated key.
+
+  @return  Key hash.
+**/
+STATIC
+UINT32
+InternalHashMapHashAscii (
+  IN CONST CHAR8  *Key
+  )
+{
+  UINT32  Hash;
+
+  Hash = OC_HASH_MAP_FNV_BASIS;
+  while (*Key != '\0') {
+    Hash ^= (UINT8)*Key;
+    Hash *= OC_HASH_MAP_FNV_PRIME;
+    ++Key;
+  }
+
+  return Hash;
+}
+
+/**
+  Calculate hash map Unicode key hash.
+
+  @param[in] Key  Null-terminated key.
+
+  @return  Key hash.
+**/
+STATIC
+UINT32
+InternalHashMapHashUnicode (
+  IN CONST CHAR16  *Key
+  )
+{
+  UINT32  Hash;
+
+  Hash = OC_HASH_MAP_FNV_BASIS;
+  while (*Key != L'\0') {
+    Hash ^= (UINT8)*Key;
+    Hash *= OC_HASH_MAP_FNV_PRIME;
+    Hash ^= (UINT8)(*Key >> 8U);
+    Hash *= OC_HASH_MAP_FNV_PRIME;
+    ++Key;
+  }
+
+  return Hash;
+}
+
+/**
+  Calculate hash map numeric key hash.
+
+  @param[in] Key  Numeric key.
+
+  @return  Key hash.
+**/
+STATIC
+UINT32
+InternalHashMapHashNumeric (
+  IN UINT64  Key
+  )
+{
+  //
+  // Fibonacci hashing, upper bits are the best mixed ones.
+  //
+  return (UINT32)RShiftU64 (MultU64x64 (Key, OC_HASH_MAP_FIB_MULTIPLIER), 32);
+}
+
+/**
+  Locate the slot for the specified key. This is either the slot holding
+  the key or the first free slot in its probe sequence.
+
+  @param[in] Map   Hash map with at least one free slot.
+  @param[in] Key   Key to locate, string pointer or numeric key.
+  @param[in] Hash  Key hash.
+
+  @return  Slot for the key.
+**/
+STATIC
+OC_HASH_MAP_ENTRY *
+InternalHashMapLocate (
+  IN CONST OC_HASH_MAP  *Map,
+  IN UINT64             Key,
+  IN UINT32             Hash
+  )
+{
+  OC_HASH_MAP_ENTRY  *Entry;
+  UINT32             Mask;
+  UINT32             Index;
+
+  ASSERT (Map->Capacity > Map->Count);
+
+  Mask  = Map->Capacity - 1;
+  Index = Hash & Mask;
+
+  while (TRUE) {
+    Entry = &Map->Entries[Index];
+    if (Entry->Value == NULL) {
+      return Entry;
+    }
+
+    if (Entry->Hash == Hash) {
+      switch (Map->KeyType) {
+        case OcHashMapKeyAscii:
+          if (AsciiStrCmp ((CONST CHAR8 *)(UINTN)Entry->Key, (CONST CHAR8 *)(UINTN)Key) == 0) {
+            return Entry;
+          }
+
+          break;
+        case OcHashMapKeyUnicode:
+          if (StrCmp ((CONST CHAR16 *)(UINTN)Entry->Key, (CONST CHAR16 *)(UINTN)Key) == 0) {
+            return Entry;
+          }
+
+          break;
+        default:
+          if (Entry->Key == Key) {
+            return Entry;
+          }
+
+          break;
+      }
+    }
+
+    Index = (Index + 1) & Mask;
+  }
+}
+
+/**
+  Reallocate hash map slots and rehash all present entries.
+
+  @param[in,out] Map       Hash map.
+  @param[in]     Capacity  New capacity, power of two.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalHashMapResize (
+  IN OUT OC_HASH_MAP  *Map,
+  IN     UINT32       Capacity
+  )
+{
+  OC_HASH_MAP_ENTRY  *OldEntries;
+  UINT32             OldCapacity;
+  OC_HASH_MAP_ENTRY  *Entry;
+  UINT32             Index;
+
+  ASSERT ((Capacity & (Capacity - 1)) == 0);
+  ASSERT (Capacity > Map->Count);
+
+  if (Capacity > OC_HASH_MAP_MAX_CAPACITY) {
+    return FALSE;
+  }
+
+  OldEntries  = Map->Entries;
+  OldCapacity = Map->Capacity;
+
+  Map->Entries = AllocateZeroPool (Capacity * sizeof (*Map->Entries));
+  if (Map->Entries == NULL) {
+    Map->Entries = OldEntries;
+    return FALSE;
+  }
+
+  Map->Capacity = Capacity;
+
+  for (Index = 0; Index < OldCapacity; ++Index) {
+    if (OldEntries[Index].Value != NULL) {
+      Entry = InternalHashMapLocate (Map, OldEntries[Index].Key, OldEntries[Index].Hash);
+      CopyMem (Entry, &OldEntries[Index], sizeof (*Entry));
+    }
+  }
+
+  if (OldEntries != NULL) {
+    FreePool (OldEntries);
+  }
+
+  return TRUE;
+}
+
+/**
+  Insert entry into hash map, growing it if necessary.
+
+  @param[in,out] Map    Initialised hash map.
+  @param[in]     Key    String pointer or numeric key.
+  @param[in]     Hash   Key hash.
+  @param[in]     Value  Entry value.
+
+  @return  FALSE when out of resources.
+**/
+STATIC
+BOOLEAN
+InternalHashMapInsertWorker (
+  IN OUT OC_HASH_MAP  *Map,
+  IN     UINT64       Key,
+  IN     UINT32       Hash,
+  IN     VOID         *Value
+  )
+{
+  OC_HASH_MAP_ENTRY  *Entry;
+
+  ASSERT (Map->Entries != NULL);
+  ASSERT (Value != NULL);
+
+  if (  ((Map->Count + 1) > Map->Capacity / 4 * 3)
+     && !InternalHashMapResize (Map, Map->Capacity * 2))
+  {
+    return FALSE;
+  }
+
+  Entry = InternalHashMapLocate (Map, Key, Hash);
+
+  //
+  // Preserve the first inserted value, which matches linear lookup order.
+  //
+  if (Entry->Value == NULL) {
+    Entry->Key   = Key;
+    Entry->Value = Value;
+    Entry->Hash  = Hash;
+    ++Map->Count;
+  }
+
+  return TRUE;
+}
+
+/**
+  Find entry in hash map.
+
+  @param[in] Map   Hash map.
+  @param[in] Key   String pointer or numeric key.
+  @param[in] Hash  Key hash.
+
+  @return  Entry value or NULL when missing.
+**/
+STATIC
+VOID *
+InternalHashMapFindWorker (
+  IN CONST OC_HASH_MAP  *Map,
+  IN UINT64             Key,
+  IN UINT32             Hash
+  )
+{
+  if (Map->Entries == NULL) {
+    return NULL;
+  }
+
+  return InternalHashMapLocate (Map, Key, Hash)->Value;
+}
+
+BOOLEAN
+InternalHashMapInit (
+  OUT OC_HASH_MAP           *Map,
+  IN  UINT32                ExpectedCount,
+  IN  OC_HASH_MAP_KEY_TYPE  KeyType
+  )
+{
+  UINT32  Capacity;
+
+  ASSERT (Map != NULL);
+
+  ZeroMem (Map, sizeof (*Map));
+  Map->KeyType = KeyType;
+
+  //
+  // Keep load factor under 3/4 for the expected amount of entries.
+  //
+  if (ExpectedCount > OC_HASH_MAP_MAX_CAPACITY / 4 * 3) {
+    return FALSE;
+  }
+
+  Capacity = OC_HASH_MAP_MIN_CAPACITY;
+  while (Capacity / 4 * 3 <= ExpectedCount) {
+    Capacity *= 2;
+  }
+
+  return InternalHashMapResize (Map, Capacity);
+}
+
+VOID
+InternalHashMapFree (
+  IN OUT OC_HASH_MAP  *Map
+  )
+{
+  ASSERT (Map != NULL);
+
+  if (Map->Entries != NULL) {
+    FreePool (Map->Entries);
+  }
+
+  ZeroMem (Map, sizeof (*Map));
+}
+
+BOOLEAN
+InternalHashMapInsert (
+  IN OUT OC_HASH_MAP  *Map,
+  IN     CONST CHAR8  *Key,
+  IN     VOID         *Value
+  )
+{
+  ASSERT (Map != NULL);
+  ASSERT (Map->KeyType == OcHashMapKeyAscii);
+  ASSERT (Key != NULL);
+
+  return InternalHashMapInsertWorker (Map, (UINTN)Key, InternalHashMapHashAscii (Key), Value);
+}
+
+VOID *
+InternalHashMapFind (
+  IN CONST OC_HASH_MAP  *Map,
+  IN CONST CHAR8        *Key
+  )
+{
+  ASSERT (Map != NULL);
+  ASSERT (Map->KeyType == OcHashMapKeyAscii);
+  ASSERT (Key != NULL);
+
+  return InternalHashMapFindWorker (Map, (UINTN)Key, InternalHashMapHashAscii (Key));
+}
+
+BOOLEAN
+InternalHashMapInsertUnicode (
+  IN OUT OC_HASH_MAP   *Map,
+  IN     CONST CHAR16  *Key,
+  IN     VOID          *Value
+  )
+{
+  ASSERT (Map != NULL);
+  ASSERT (Map->KeyType == OcHashMapKeyUnicode);
+  ASSERT (Key != NULL);
+
+  return InternalHashMapInsertWorker (Map, (UINTN)Key, InternalHashMapHashUnicode (Key), Value);
+}
+
+VOID *
+InternalHashMapFindUnicode (
+  IN CONST OC_HASH_MAP  *Map,
+  IN CONST CHAR16       *Key
+  )
+{
+  ASSERT (Map != NULL);
+  ASSERT (Map->KeyType == OcHashMapKeyUnicode);
+  ASSERT (Key != NULL);
+
+  return InternalHashMapFindWorker (Map, (UINTN)Key, InternalHashMapHashUnicode (Key));
+}
+
+BOOLEAN
+InternalHashMapInsertNumeric (
+  IN OUT OC_HASH_MAP  *Map,
+  IN     UINT64       Key,
+  IN     VOID         *Value
+  )
+{
+  ASSERT (Map != NULL);
+  ASSERT (Map->KeyType == OcHashMapKeyNumeric);
+
+  return InternalHashMapInsertWorker (Map, Key, InternalHashMapHashNumeric (Key), Value);
+}
+
+VOID *
+InternalHashMapFindNumeric (
+  IN CONST OC_HASH_MAP  *Map,
+  IN UINT64             Key
+  )
+{
+  ASSERT (Map != NULL);
+  ASSERT (Map->KeyType == OcHashMapKeyNumeric);
+
+  return InternalHashMapFindWorker (Map, Key, InternalHashMapHashNumeric (Key));
+}
@@ -417,145 +417,107 @@ KcInitKextFixupChains (
 }
 
 /*
-  Indexes RelocInfo into the fixup chains SegChain of Segment.
+  Sorts fixup offsets in ascending order.
 
-  @param[in,out] Context      Prelinked context.
-  @param[in]     MachContext  The context of the Mach-O RelocInfo belongs to. It
-                              must have been prelinked by OcAppleKernelLib. The
-                              image must reside in Segment.
-  @param[in]     RelocInfo    The relocation to add a fixup of.
-  @param[in]     RelocBase    The relocation base address.
+  Relocation tables are usually emitted sorted (in either direction) by the
+  linker, so these cases are handled without sorting. Otherwise an LSD radix
+  sort is used to keep the complexity linear in the relocation count.
+
+  @param[in,out] Offsets      Offsets to sort.
+  @param[in,out] Scratch      Scratch buffer of NumOffsets elements.
+  @param[in]     NumOffsets   Number of offsets.
+  @param[in]     MaxOffset    Largest offset in Offsets.
+
+  @returns  Sorted offsets, either Offsets or Scratch.
 */
 STATIC
-VOID
-InternalKcConvertRelocToFixup (
-  IN OUT PRELINKED_CONTEXT           *Context,
-  IN     OC_MACHO_CONTEXT            *MachContext,
-  IN     CONST MACH_RELOCATION_INFO  *RelocInfo,
-  IN     UINT64                      RelocBase
+UINT32 *
+InternalKcSortFixupOffsets (
+  IN OUT UINT32  *Offsets,
+  IN OUT UINT32  *Scratch,
+  IN     UINT32  NumOffsets,
+  IN     UINT32  MaxOffset
   )
 {
-  UINT8  *SegmentData;
-  UINT8  *SegmentPageData;
-
-  UINT64  RelocAddress;
-  UINT32  RelocOffsetInSeg;
-  VOID    *RelocDest;
-
-  UINT16                                        NewFixupPage;
-  UINT16                                        NewFixupPageOffset;
-  MACH_DYLD_CHAINED_PTR_64_KERNEL_CACHE_REBASE  NewFixup;
-
-  UINT16                                        IterFixupPageOffset;
-  VOID                                          *IterFixupData;
-  MACH_DYLD_CHAINED_PTR_64_KERNEL_CACHE_REBASE  IterFixup;
-  UINT16                                        NextIterFixupPageOffset;
+  UINT32  Counts[256];
+  UINT32  *Source;
+  UINT32  *Target;
+  UINT32  *Swap;
+  UINT32  Index;
+  UINT32  Sum;
+  UINT32  Count;
+  UINT32  Shift;
+  BOOLEAN  Ascending;
+  BOOLEAN  Descending;
+
+  Ascending  = TRUE;
+  Descending = TRUE;
+  for (Index = 1; Index < NumOffsets; ++Index) {
+    if (Offsets[Index - 1] > Offsets[Index]) {
+      Ascending = FALSE;
+    } else if (Offsets[Index - 1] < Offsets[Index]) {
+      Descending = FALSE;
+    }
+  }
 
-  UINT16  FixupDelta;
+  if (Ascending) {
+    return Offsets;
+  }
 
-  ASSERT (Context != NULL);
-  ASSERT (MachContext != NULL);
-  ASSERT (RelocInfo != NULL);
+  if (Descending) {
+    for (Index = 0; Index < NumOffsets; ++Index) {
+      Scratch[Index] = Offsets[NumOffsets - Index - 1];
+    }
 
-  ASSERT (Context->KextsFixupChains != NULL);
-  ASSERT (Context->KextsFixupChains->PageSize == MACHO_PAGE_SIZE);
-  //
-  // The entire KEXT and thus its relocations must be in Segment.
-  // Mach-O images are limited to 4 GB size by OcMachoLib, so the cast is safe.
-  //
-  RelocAddress     = RelocBase + (UINT32)RelocInfo->Address;
-  RelocOffsetInSeg = (UINT32)(RelocAddress - Context->KextsVmAddress);
-  //
-  // For now we assume we prelinked already and the relocations are sane.
-  //
-  ASSERT (RelocInfo->Extern == 0);
-  ASSERT (RelocInfo->Type == MachX8664RelocUnsigned);
-  ASSERT (RelocAddress >= Context->KextsVmAddress);
-  ASSERT (RelocOffsetInSeg <= Context->PrelinkedSize - Context->KextsFileOffset);
-  ASSERT (Context->KextsFileOffset - RelocOffsetInSeg >= 8);
-  //
-  // Create a new fixup based on the data of RelocInfo.
-  //
-  SegmentData = Context->Prelinked + Context->KextsFileOffset;
-  RelocDest   = SegmentData + RelocOffsetInSeg;
-  //
-  // It has been observed all fields but target and next are 0 for the kernel
-  // KC. For isAuth, this is because x86 does not support Pointer
-  // Authentication.
-  //
-  ZeroMem (&NewFixup, sizeof (NewFixup));
-  //
-  // This 1MB here is a bit of a hack. I think it is just the same thing
-  // as KERNEL_BASE_PADDR in OcAfterBootCompatLib.
-  //
-  NewFixup.Target = ReadUnaligned64 (RelocDest) - KERNEL_FIXUP_OFFSET;
+    return Scratch;
+  }
 
-  NewFixupPage       = (UINT16)(RelocOffsetInSeg / MACHO_PAGE_SIZE);
-  NewFixupPageOffset = (UINT16)(RelocOffsetInSeg % MACHO_PAGE_SIZE);
+  Source = Offsets;
+  Target = Scratch;
 
-  IterFixupPageOffset = Context->KextsFixupChains->PageStart[NewFixupPage];
+  for (Shift = 0; Shift < 32 && (MaxOffset >> Shift) != 0; Shift += 8) {
+    ZeroMem (Counts, sizeof (Counts));
 
-  if (IterFixupPageOffset == MACH_DYLD_CHAINED_PTR_START_NONE) {
-    //
-    // The current page has no fixups, just assign and terminate this one.
-    //
-    Context->KextsFixupChains->PageStart[NewFixupPage] = NewFixupPageOffset;
-    //
-    // Fixup.next is 0 (i.e. the chain is terminated) already.
-    //
-  } else if (NewFixupPageOffset < IterFixupPageOffset) {
-    //
-    // RelocInfo preceeds the first fixup of the page - prepend the new fixup.
-    //
-    NewFixup.Next                                      = IterFixupPageOffset - NewFixupPageOffset;
-    Context->KextsFixupChains->PageStart[NewFixupPage] = NewFixupPageOffset;
-  } else {
-    SegmentPageData = SegmentData + NewFixupPage * MACHO_PAGE_SIZE;
-    //
-    // Find the last fixup of this page that preceeds RelocInfo.
-    // FIXME: Consider sorting the relocations in descending order first to
-    //        then always prepend the new fixup.
-    //
-    NextIterFixupPageOffset = IterFixupPageOffset;
-    do {
-      IterFixupPageOffset = NextIterFixupPageOffset;
-      IterFixupData       = SegmentPageData + IterFixupPageOffset;
+    for (Index = 0; Index < NumOffsets; ++Index) {
+      ++Counts[(Source[Index] >> Shift) & 0xFFU];
+    }
 
-      CopyMem (&IterFixup, IterFixupData, sizeof (IterFixup));
-      NextIterFixupPageOffset = (UINT16)(IterFixupPageOffset + IterFixup.Next);
-    } while (NextIterFixupPageOffset < NewFixupPageOffset && IterFixup.Next != 0);
+    Sum = 0;
+    for (Index = 0; Index < ARRAY_SIZE (Counts); ++Index) {
+      Count         = Counts[Index];
+      Counts[Index] = Sum;
+      Sum          += Count;
+    }
 
-    FixupDelta = NewFixupPageOffset - IterFixupPageOffset;
-    //
-    // Our new fixup needs to point to the first fixup following it or terminate
-    // if the previous one was the last.
-    //
-    if (IterFixup.Next != 0) {
-      ASSERT (IterFixup.Next >= FixupDelta);
-      NewFixup.Next = IterFixup.Next - FixupDelta;
-    } else {
-      NewFixup.Next = 0;
+    for (Index = 0; Index < NumOffsets; ++Index) {
+      Target[Counts[(Source[Index] >> Shift) & 0xFFU]++] = Source[Index];
     }
 
-    //
-    // The last fixup preceeding RelocInfo must point to our new fixup.
-    //
-    IterFixup.Next = FixupDelta;
-    CopyMem (IterFixupData, &IterFixup, sizeof (IterFixup));
+    Swap   = Source;
+    Source = Target;
+    Target = Swap;
   }
 
-  CopyMem (RelocDest, &NewFixup, sizeof (NewFixup));
+  return Source;
 }
 
 /*
   Indexes all relocations of MachContext into the kernel described by Context.
 
+  Relocations are sorted once and the fixup chains of every page are emitted
+  in a single forward pass, so the complexity is linear in the relocation
+  count. All relocations are validated before the image is modified.
+
   @param[in,out] Context      Prelinked context.
   @param[in]     MachContext  The context of the Mach-O to index. It must have
                               been prelinked by OcAppleKernelLib. The image
                               must reside in Segment.
+
+  @retval EFI_SUCCESS           All relocations have been indexed.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failure.
+  @retval EFI_UNSUPPORTED       Relocations cannot be expressed as fixups.
 */
-VOID
+EFI_STATUS
 KcKextIndexFixups (
   IN OUT PRELINKED_CONTEXT  *Context,
   IN     OC_MACHO_CONTEXT   *MachContext
@@ -567,18 +529,26 @@ KcKextIndexFixups (
   CONST MACH_RELOCATION_INFO     *Relocations;
   VOID                           *FileData;
   UINT32                         RelocIndex;
+  UINT32                         NumRelocations;
+  UINT64                         RelocAddress;
+  UINT32                         SegmentSize;
+  UINT32                         MaxOffset;
+  UINT32                         *Offsets;
+  UINT32                         *SortedOffsets;
+  UINT8                          *SegmentData;
+  VOID                           *RelocDest;
+  UINT32                         Page;
+  UINT32                         NextOffset;
+
+  MACH_DYLD_CHAINED_PTR_64_KERNEL_CACHE_REBASE  NewFixup;
 
   ASSERT (Context != NULL);
   ASSERT (MachContext != NULL);
 
-  MachHeader = MachoGetMachHeader64 (MachContext);
+  ASSERT (Context->KextsFixupChains != NULL);
+  ASSERT (Context->KextsFixupChains->PageSize == MACHO_PAGE_SIZE);
 
-  //
-  // Kexts with fixups are now dylibs in cache.
-  // This is required for OSKext_protect to work properly
-  // as the kernel map that operates on vm_map no longer has kext addresses.
-  //
-  MachHeader->Flags |= MACH_HEADER_FLAG_DYLIB_IN_CACHE;
+  MachHeader = MachoGetMachHeader64 (MachContext);
 
   //
   // FIXME: The current OcMachoLib was not written with post-linking
@@ -594,8 +564,14 @@ KcKextIndexFixups (
   // If DYSYMTAB does not exist, the KEXT must have already not been flagged for
   // DYLD linkage as otherwise prelinking would have failed.
   //
-  if (DySymtab == NULL) {
-    return;
+  if ((DySymtab == NULL) || (DySymtab->NumOfLocalRelocations == 0)) {
+    //
+    // Kexts with fixups are now dylibs in cache.
+    // This is required for OSKext_protect to work properly
+    // as the kernel map that operates on vm_map no longer has kext addresses.
+    //
+    MachHeader->Flags |= MACH_HEADER_FLAG_DYLIB_IN_CACHE;
+    return EFI_SUCCESS;
   }
 
   FirstSegment = MachoGetNextSegment64 (MachContext, NULL);
@@ -603,7 +579,6 @@ KcKextIndexFixups (
   // DYSYMTAB and at least one segment must exist, otherwise prelinking would
   // have failed.
   //
-  ASSERT (DySymtab != NULL);
   ASSERT (FirstSegment != NULL);
   //
   // The Mach-O file to index must be included in Segment.
@@ -614,29 +589,140 @@ KcKextIndexFixups (
   // Prelinking must have eliminated all external relocations.
   //
   ASSERT (DySymtab->NumExternalRelocations == 0);
-  //
-  // Convert all relocations to fixups.
-  //
-  FileData    = MachoGetFileData (MachContext);
-  Relocations = (MACH_RELOCATION_INFO *)(
-                                         (UINTN)FileData + DySymtab->LocalRelocationsOffset
-                                         );
+
+  FileData       = MachoGetFileData (MachContext);
+  Relocations    = (MACH_RELOCATION_INFO *)(
+                                            (UINTN)FileData + DySymtab->LocalRelocationsOffset
+                                            );
+  NumRelocations = DySymtab->NumOfLocalRelocations;
+  SegmentSize    = (UINT32)Context->KextsFixupChains->PageCount * MACHO_PAGE_SIZE;
 
   DEBUG ((
     DEBUG_INFO,
     "OCAK: Local relocs %u on %LX\n",
-    DySymtab->NumOfLocalRelocations,
+    NumRelocations,
     FirstSegment->VirtualAddress
     ));
 
-  for (RelocIndex = 0; RelocIndex < DySymtab->NumOfLocalRelocations; ++RelocIndex) {
-    InternalKcConvertRelocToFixup (
-      Context,
-      MachContext,
-      &Relocations[RelocIndex],
-      FirstSegment->VirtualAddress
-      );
+  if (NumRelocations > MAX_UINT32 / (2 * sizeof (*Offsets))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Offsets = AllocatePool (2 * NumRelocations * sizeof (*Offsets));
+  if (Offsets == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Gather the offsets of all relocations within the KEXTs segment.
+  // The entire KEXT and thus its relocations must be in Segment.
+  // Mach-O images are limited to 4 GB size by OcMachoLib, so the cast is safe.
+  //
+  MaxOffset = 0;
+  for (RelocIndex = 0; RelocIndex < NumRelocations; ++RelocIndex) {
+    RelocAddress = FirstSegment->VirtualAddress + (UINT32)Relocations[RelocIndex].Address;
+
+    if (  (Relocations[RelocIndex].Extern != 0)
+       || (Relocations[RelocIndex].Type != MachX8664RelocUnsigned)
+       || (Relocations[RelocIndex].Size != 3)
+       || (RelocAddress < Context->KextsVmAddress)
+       || (RelocAddress - Context->KextsVmAddress > SegmentSize - sizeof (UINT64))
+       || ((RelocAddress - Context->KextsVmAddress) % MACHO_PAGE_SIZE > MACHO_PAGE_SIZE - sizeof (UINT64)))
+    {
+      DEBUG ((DEBUG_WARN, "OCAK: Unsupported reloc %u at %LX\n", RelocIndex, RelocAddress));
+      FreePool (Offsets);
+      return EFI_UNSUPPORTED;
+    }
+
+    Offsets[RelocIndex] = (UINT32)(RelocAddress - Context->KextsVmAddress);
+    if (Offsets[RelocIndex] > MaxOffset) {
+      MaxOffset = Offsets[RelocIndex];
+    }
   }
+
+  SortedOffsets = InternalKcSortFixupOffsets (
+                    Offsets,
+                    &Offsets[NumRelocations],
+                    NumRelocations,
+                    MaxOffset
+                    );
+
+  //
+  // Validate the chains before modifying the image. Fixups may not overlap,
+  // and each chain link must fit the 12-bit next field (stride 1). KEXTs are
+  // page-aligned, so no page may be shared with previously indexed fixups.
+  //
+  for (RelocIndex = 0; RelocIndex < NumRelocations; ++RelocIndex) {
+    Page = SortedOffsets[RelocIndex] / MACHO_PAGE_SIZE;
+
+    if (  ((RelocIndex == 0) || (SortedOffsets[RelocIndex - 1] / MACHO_PAGE_SIZE != Page))
+       && (Context->KextsFixupChains->PageStart[Page] != MACH_DYLD_CHAINED_PTR_START_NONE))
+    {
+      DEBUG ((DEBUG_WARN, "OCAK: Fixup page %u is already used\n", Page));
+      FreePool (Offsets);
+      return EFI_UNSUPPORTED;
+    }
+
+    if (  (RelocIndex + 1 < NumRelocations)
+       && (SortedOffsets[RelocIndex + 1] / MACHO_PAGE_SIZE == Page)
+       && (SortedOffsets[RelocIndex + 1] - SortedOffsets[RelocIndex] < sizeof (UINT64)))
+    {
+      DEBUG ((DEBUG_WARN, "OCAK: Overlapping fixups at %X\n", SortedOffsets[RelocIndex]));
+      FreePool (Offsets);
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  //
+  // Convert all relocations to fixups in one pass. Each fixup links to the
+  // following one on the same page, the last one terminates the chain.
+  //
+  SegmentData = Context->Prelinked + Context->KextsFileOffset;
+  //
+  // It has been observed all fields but target and next are 0 for the kernel
+  // KC. For isAuth, this is because x86 does not support Pointer
+  // Authentication.
+  //
+  ZeroMem (&NewFixup, sizeof (NewFixup));
+
+  for (RelocIndex = 0; RelocIndex < NumRelocations; ++RelocIndex) {
+    Page      = SortedOffsets[RelocIndex] / MACHO_PAGE_SIZE;
+    RelocDest = SegmentData + SortedOffsets[RelocIndex];
+
+    if ((RelocIndex == 0) || (SortedOffsets[RelocIndex - 1] / MACHO_PAGE_SIZE != Page)) {
+      Context->KextsFixupChains->PageStart[Page] = (UINT16)(SortedOffsets[RelocIndex] % MACHO_PAGE_SIZE);
+    }
+
+    NextOffset = RelocIndex + 1 < NumRelocations ? SortedOffsets[RelocIndex + 1] : 0;
+    if ((NextOffset != 0) && (NextOffset / MACHO_PAGE_SIZE == Page)) {
+      //
+      // In-page distances are below MACHO_PAGE_SIZE and thus always fit.
+      //
+      STATIC_ASSERT (MACHO_PAGE_SIZE <= BIT12, "Fixup chain next may overflow.");
+      NewFixup.Next = NextOffset - SortedOffsets[RelocIndex];
+    } else {
+      NewFixup.Next = 0;
+    }
+
+    //
+    // This 1MB here is a bit of a hack. I think it is just the same thing
+    // as KERNEL_BASE_PADDR in OcAfterBootCompatLib.
+    //
+    NewFixup.Target = ReadUnaligned64 (RelocDest) - KERNEL_FIXUP_OFFSET;
+
+    CopyMem (RelocDest, &NewFixup, sizeof (NewFixup));
+  }
+
+  FreePool (Offsets);
+
+  //
+  // Kexts with fixups are now dylibs in cache.
+  // This is required for OSKext_protect to work properly
+  // as the kernel map that operates on vm_map no longer has kext addresses.
+  //
+  MachHeader->Flags |= MACH_HEADER_FLAG_DYLIB_IN_CACHE;
+
+  return EFI_SUCCESS;
 }
 
 UINT32
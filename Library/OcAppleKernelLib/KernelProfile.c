@@ -0,0 +1,178 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Base.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/OcAppleKernelLib.h>
+
+STATIC KERNEL_PHASE_STATS  mKernelPhaseStats[KernelPhaseMax];
+
+//
+// Must match KERNEL_PHASE order.
+//
+STATIC CONST CHAR8  *mKernelPhaseNames[KernelPhaseMax] = {
+  "read",
+  "digest",
+  "info parse",
+  "link",
+  "patch",
+  "fixups",
+  "export"
+};
+
+/**
+  Convert TSC ticks to microseconds.
+
+  @param[in]  Ticks         TSC ticks.
+  @param[in]  TscFrequency  TSC frequency in Hz.
+
+  @returns Duration in microseconds.
+**/
+STATIC
+UINT64
+InternalKernelPhaseTicksToUs (
+  IN UINT64  Ticks,
+  IN UINT64  TscFrequency
+  )
+{
+  UINT64  Remainder;
+  UINT64  Us;
+
+  //
+  // Split the division to avoid overflowing for long spans.
+  //
+  Us = MultU64x32 (DivU64x64Remainder (Ticks, TscFrequency, &Remainder), 1000000);
+  return Us + DivU64x64Remainder (MultU64x32 (Remainder, 1000000), TscFrequency, NULL);
+}
+
+VOID
+OcKernelPhaseReset (
+  VOID
+  )
+{
+  ZeroMem (mKernelPhaseStats, sizeof (mKernelPhaseStats));
+}
+
+UINT64
+OcKernelPhaseStart (
+  VOID
+  )
+{
+  return AsmReadTsc ();
+}
+
+VOID
+OcKernelPhaseAdd (
+  IN KERNEL_PHASE  Phase,
+  IN UINT64        Ticks
+  )
+{
+  KERNEL_PHASE_STATS  *Stats;
+
+  ASSERT (Phase < KernelPhaseMax);
+
+  Stats = &mKernelPhaseStats[Phase];
+
+  if ((Stats->Count == 0) || (Ticks < Stats->MinTicks)) {
+    Stats->MinTicks = Ticks;
+  }
+
+  if (Ticks > Stats->MaxTicks) {
+    Stats->MaxTicks = Ticks;
+  }
+
+  Stats->Ticks += Ticks;
+  ++Stats->Count;
+}
+
+UINT64
+OcKernelPhaseStop (
+  IN KERNEL_PHASE  Phase,
+  IN UINT64        Start
+  )
+{
+  UINT64  End;
+  UINT64  Ticks;
+
+  End = AsmReadTsc ();
+  //
+  // TSC may go backwards when migrating between unsynchronised cores.
+  //
+  Ticks = End > Start ? End - Start : 0;
+
+  OcKernelPhaseAdd (Phase, Ticks);
+
+  return Ticks;
+}
+
+CONST KERNEL_PHASE_STATS *
+OcKernelPhaseGetStats (
+  IN KERNEL_PHASE  Phase
+  )
+{
+  ASSERT (Phase < KernelPhaseMax);
+
+  return &mKernelPhaseStats[Phase];
+}
+
+CONST CHAR8 *
+OcKernelPhaseGetName (
+  IN KERNEL_PHASE  Phase
+  )
+{
+  ASSERT (Phase < KernelPhaseMax);
+
+  return mKernelPhaseNames[Phase];
+}
+
+VOID
+OcKernelPhaseReport (
+  IN UINT64  TscFrequency
+  )
+{
+  UINT32              Index;
+  KERNEL_PHASE_STATS  *Stats;
+
+  for (Index = 0; Index < KernelPhaseMax; ++Index) {
+    Stats = &mKernelPhaseStats[Index];
+    if (Stats->Count == 0) {
+      continue;
+    }
+
+    if (TscFrequency == 0) {
+      DEBUG ((
+        DEBUG_INFO,
+        "OCAK: Phase %a - %u spans, total %Lu, min %Lu, max %Lu ticks\n",
+        mKernelPhaseNames[Index],
+        Stats->Count,
+        Stats->Ticks,
+        Stats->MinTicks,
+        Stats->MaxTicks
+        ));
+    } else {
+      DEBUG ((
+        DEBUG_INFO,
+        "OCAK: Phase %a - %u spans, total %Lu, min %Lu, max %Lu us\n",
+        mKernelPhaseNames[Index],
+        Stats->Count,
+        InternalKernelPhaseTicksToUs (Stats->Ticks, TscFrequency),
+        InternalKernelPhaseTicksToUs (Stats->MinTicks, TscFrequency),
+        InternalKernelPhaseTicksToUs (Stats->MaxTicks, TscFrequency)
+        ));
+    }
+  }
+}
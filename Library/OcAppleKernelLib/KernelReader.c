@@ -31,9 +31,15 @@
 //
 #define KERNEL_HEADER_SIZE  (EFI_PAGE_SIZE * 2)
 
+//
+// Compressed kernel is read and decompressed in blocks of this size.
+//
+#define KERNEL_STREAM_BLOCK_SIZE  SIZE_256KB
+
 STATIC SHA384_CONTEXT  mKernelDigestContext;
 STATIC UINT32          mKernelDigestPosition;
 STATIC BOOLEAN         mNeedKernelDigest;
+STATIC UINT64          mKernelDigestTicks;
 
 typedef enum {
   KernelArchUnknown,
@@ -84,6 +90,7 @@ KernelGetFileData (
   EFI_STATUS  Status;
   UINT32      RemainingSize;
   UINT32      ChunkSize;
+  UINT64      Start;
 
   //
   // Calculate hash for the prefix.
@@ -103,7 +110,9 @@ KernelGetFileData (
         return Status;
       }
 
+      Start = AsmReadTsc ();
       Sha384Update (&mKernelDigestContext, Buffer, ChunkSize);
+      mKernelDigestTicks += AsmReadTsc () - Start;
       mKernelDigestPosition += ChunkSize;
       RemainingSize         -= ChunkSize;
     }
@@ -125,11 +134,13 @@ KernelGetFileData (
   //
   if (mNeedKernelDigest && (Position >= mKernelDigestPosition)) {
     RemainingSize = Position + Size - mKernelDigestPosition;
+    Start         = AsmReadTsc ();
     Sha384Update (
       &mKernelDigestContext,
       Buffer + (Position - mKernelDigestPosition),
       RemainingSize
       );
+    mKernelDigestTicks += AsmReadTsc () - Start;
     mKernelDigestPosition += RemainingSize;
   }
 
@@ -202,11 +213,15 @@ ParseCompressedHeader (
 
   UINT32            KernelSize;
   MACH_COMP_HEADER  *CompHeader;
-  UINT8             *CompressedBuffer;
+  VOID              *Stream;
+  UINT8             *BlockBuffer;
+  UINT32            BlockSize;
   UINT32            CompressionType;
   UINT32            CompressedSize;
+  UINT32            CompressedOffset;
   UINT32            DecompressedSize;
   UINT32            DecompressedHash;
+  BOOLEAN           Continue;
 
   CompHeader       = (MACH_COMP_HEADER *)*Buffer;
   CompressionType  = CompHeader->Compression;
@@ -225,32 +240,79 @@ ParseCompressedHeader (
     return KernelSize;
   }
 
+  if (  (CompressionType != MACH_COMPRESSED_BINARY_INVERT_LZVN)
+     && (CompressionType != MACH_COMPRESSED_BINARY_INVERT_LZSS))
+  {
+    DEBUG ((DEBUG_INFO, "OCAK: Comp kernel unsupported comp %08X at %08X\n", CompressionType, Offset));
+    return KernelSize;
+  }
+
   Status = ReplaceBuffer (DecompressedSize, Buffer, AllocatedSize, ReservedSize);
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_INFO, "OCAK: Decomp kernel (%u bytes) cannot be allocated at %08X\n", DecompressedSize, Offset));
     return KernelSize;
   }
 
-  CompressedBuffer = AllocatePool (CompressedSize);
-  if (CompressedBuffer == NULL) {
+  BlockBuffer = AllocatePool (MIN (CompressedSize, KERNEL_STREAM_BLOCK_SIZE));
+  if (BlockBuffer == NULL) {
     DEBUG ((DEBUG_INFO, "OCAK: Comp kernel (%u bytes) cannot be allocated at %08X\n", CompressedSize, Offset));
     return KernelSize;
   }
 
-  Status = KernelGetFileData (File, Offset + sizeof (MACH_COMP_HEADER), CompressedSize, CompressedBuffer);
-  if (EFI_ERROR (Status)) {
-    DEBUG ((DEBUG_INFO, "OCAK: Comp kernel (%u bytes) cannot be read at %08X\n", CompressedSize, Offset));
-    FreePool (CompressedBuffer);
+  if (CompressionType == MACH_COMPRESSED_BINARY_INVERT_LZVN) {
+    Stream = DecompressLZVNStreamInit (*Buffer, DecompressedSize);
+  } else {
+    Stream = DecompressLZSSStreamInit (*Buffer, DecompressedSize);
+  }
+
+  if (Stream == NULL) {
+    DEBUG ((DEBUG_INFO, "OCAK: Comp kernel decompressor cannot be allocated at %08X\n", Offset));
+    FreePool (BlockBuffer);
     return KernelSize;
   }
 
+  //
+  // Decompress each block right after reading it, so that no copy of the whole
+  // compressed image is kept in memory. The digest is updated by KernelGetFileData.
+  // Trailing compressed data is left for the digest remainder once the decompressor
+  // stops accepting input.
+  //
+  CompressedOffset = 0;
+  while (CompressedOffset < CompressedSize) {
+    BlockSize = MIN (CompressedSize - CompressedOffset, KERNEL_STREAM_BLOCK_SIZE);
+    Status    = KernelGetFileData (
+                  File,
+                  Offset + sizeof (MACH_COMP_HEADER) + CompressedOffset,
+                  BlockSize,
+                  BlockBuffer
+                  );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_INFO, "OCAK: Comp kernel (%u bytes) cannot be read at %08X\n", CompressedSize, Offset));
+      break;
+    }
+
+    CompressedOffset += BlockSize;
+
+    if (CompressionType == MACH_COMPRESSED_BINARY_INVERT_LZVN) {
+      Continue = DecompressLZVNStreamFeed (Stream, BlockBuffer, BlockSize);
+    } else {
+      Continue = DecompressLZSSStreamFeed (Stream, BlockBuffer, BlockSize);
+    }
+
+    if (!Continue) {
+      break;
+    }
+  }
+
   if (CompressionType == MACH_COMPRESSED_BINARY_INVERT_LZVN) {
-    KernelSize = (UINT32)DecompressLZVN (*Buffer, DecompressedSize, CompressedBuffer, CompressedSize);
-  } else if (CompressionType == MACH_COMPRESSED_BINARY_INVERT_LZSS) {
-    KernelSize = (UINT32)DecompressLZSS (*Buffer, DecompressedSize, CompressedBuffer, CompressedSize);
+    KernelSize = (UINT32)DecompressLZVNStreamFree (Stream);
+  } else {
+    KernelSize = DecompressLZSSStreamFree (Stream);
   }
 
-  if (KernelSize != DecompressedSize) {
+  FreePool (BlockBuffer);
+
+  if (EFI_ERROR (Status) || (KernelSize != DecompressedSize)) {
     KernelSize = 0;
   }
 
@@ -259,8 +321,6 @@ ParseCompressedHeader (
   //
   (VOID)DecompressedHash;
 
-  FreePool (CompressedBuffer);
-
   return KernelSize;
 }
 
@@ -430,6 +490,10 @@ ReadAppleKernel (
   UINT32       FullSize;
   UINT8        *Remainder;
   KERNEL_ARCH  Arch;
+  UINT64       Start;
+  UINT64       RemainderStart;
+  UINT64       DigestTicks;
+  UINT64       ReadTicks;
 
   ASSERT (File != NULL);
   ASSERT (Is32Bit != NULL);
@@ -447,6 +511,9 @@ ReadAppleKernel (
     return EFI_OUT_OF_RESOURCES;
   }
 
+  Start              = OcKernelPhaseStart ();
+  mKernelDigestTicks = 0;
+
   mNeedKernelDigest = Digest != NULL;
   if (mNeedKernelDigest) {
     mKernelDigestPosition = 0;
@@ -481,7 +548,12 @@ ReadAppleKernel (
     }
 
     if (FullSize > mKernelDigestPosition) {
-      Remainder = AllocatePool (FullSize - mKernelDigestPosition);
+      //
+      // Trailing data is only read for the digest.
+      //
+      RemainderStart = AsmReadTsc ();
+      DigestTicks    = mKernelDigestTicks;
+      Remainder      = AllocatePool (FullSize - mKernelDigestPosition);
       if (Remainder == NULL) {
         mNeedKernelDigest = FALSE;
         FreePool (*Kernel);
@@ -502,11 +574,22 @@ ReadAppleKernel (
       }
 
       ASSERT (FullSize == mKernelDigestPosition);
+      mKernelDigestTicks = DigestTicks + AsmReadTsc () - RemainderStart;
     }
 
     Sha384Final (&mKernelDigestContext, Digest);
   }
 
+  //
+  // Digest is calculated while reading, account it separately.
+  //
+  ReadTicks = AsmReadTsc () - Start;
+  if (Digest != NULL) {
+    OcKernelPhaseAdd (KernelPhaseDigest, mKernelDigestTicks);
+  }
+
+  OcKernelPhaseAdd (KernelPhaseRead, ReadTicks > mKernelDigestTicks ? ReadTicks - mKernelDigestTicks : 0);
+
   return EFI_SUCCESS;
 }
 
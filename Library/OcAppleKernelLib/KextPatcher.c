@@ -15,10 +15,12 @@
 #include <Base.h>
 
 #include <IndustryStandard/AppleKmodInfo.h>
+#include <IndustryStandard/AppleKxldState.h>
 
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/OcAppleKernelLib.h>
 #include <Library/OcMachoLib.h>
 #include <Library/OcMiscLib.h>
@@ -27,6 +29,20 @@
 #include "MkextInternal.h"
 #include "PrelinkedInternal.h"
 
+//
+// Symbol name index attached to PATCHER_CONTEXT.
+//
+typedef struct {
+  //
+  // Symbol name to MACH_NLIST_ANY, or to KXLD_SYM_ENTRY_ANY for KXLD state.
+  //
+  OC_HASH_MAP    Symbols;
+  //
+  // Symbols are taken from KXLD state, as there is no symbol table.
+  //
+  BOOLEAN        IsKxld;
+} PATCHER_SYMBOL_INDEX;
+
 STATIC
 BOOLEAN
 GetTextBaseOffset (
@@ -110,6 +126,13 @@ PatcherInitContextFromPrelinked (
   }
 
   CopyMem (Context, &Kext->Context, sizeof (*Context));
+
+  //
+  // Symbol index is owned by the context which built it.
+  //
+  Context->SymbolIndex    = NULL;
+  Context->SymbolLookups  = 0;
+  Context->SymbolsVisited = 0;
   return EFI_SUCCESS;
 }
 
@@ -177,6 +200,10 @@ PatcherInitContextFromBuffer (
   Context->KxldState          = NULL;
   Context->KxldStateSize      = 0;
   Context->IsKernelCollection = FALSE;
+  Context->DisableSymbolIndex = FALSE;
+  Context->SymbolIndex        = NULL;
+  Context->SymbolLookups      = 0;
+  Context->SymbolsVisited     = 0;
 
   KextFindKmodAddress (
     &Context->MachContext,
@@ -230,6 +257,171 @@ PatcherGetSymbolValue (
   return PatcherGetSymbolAddressValue (Context, Name, NULL, Value);
 }
 
+VOID
+PatcherFreeContext (
+  IN OUT PATCHER_CONTEXT  *Context
+  )
+{
+  PATCHER_SYMBOL_INDEX  *SymbolIndex;
+
+  ASSERT (Context != NULL);
+
+  SymbolIndex = Context->SymbolIndex;
+  if (SymbolIndex != NULL) {
+    InternalHashMapFree (&SymbolIndex->Symbols);
+    FreePool (SymbolIndex);
+    Context->SymbolIndex = NULL;
+  }
+}
+
+/**
+  Build symbol name index for patcher context.
+  On failure the context is left without an index and linear lookup is used.
+
+  @param[in,out] Context         Patcher context.
+**/
+STATIC
+VOID
+InternalBuildSymbolIndex (
+  IN OUT PATCHER_CONTEXT  *Context
+  )
+{
+  EFI_STATUS            Status;
+  PATCHER_SYMBOL_INDEX  *SymbolIndex;
+  CONST MACH_NLIST_ANY  *SymbolTable;
+  MACH_NLIST_ANY        *Symbol;
+  CONST CHAR8           *SymbolName;
+  UINT32                NumSymbols;
+  UINT32                Index;
+
+  ASSERT (Context->SymbolIndex == NULL);
+
+  SymbolIndex = AllocateZeroPool (sizeof (*SymbolIndex));
+  if (SymbolIndex == NULL) {
+    return;
+  }
+
+  NumSymbols = MachoGetSymbolTable (
+                 &Context->MachContext,
+                 &SymbolTable,
+                 NULL,
+                 NULL,
+                 NULL,
+                 NULL,
+                 NULL,
+                 NULL,
+                 NULL
+                 );
+
+  if (!InternalHashMapInit (&SymbolIndex->Symbols, NumSymbols, OcHashMapKeyAscii)) {
+    FreePool (SymbolIndex);
+    return;
+  }
+
+  //
+  // Walk symbols exactly like linear lookup does, stopping at the first
+  // malformed symbol, and keep the first occurrence of every name.
+  //
+  Index = 0;
+  while ((Symbol = MachoGetSymbolByIndex (&Context->MachContext, Index)) != NULL) {
+    SymbolName = MachoGetSymbolName (&Context->MachContext, Symbol);
+    if (  (SymbolName != NULL)
+       && !InternalHashMapInsert (&SymbolIndex->Symbols, SymbolName, Symbol))
+    {
+      InternalHashMapFree (&SymbolIndex->Symbols);
+      FreePool (SymbolIndex);
+      return;
+    }
+
+    ++Index;
+  }
+
+  Context->SymbolsVisited += Index;
+
+  //
+  // KXLD state is only used when there are no symbols at all.
+  //
+  if ((Index == 0) && (Context->KxldState != NULL)) {
+    SymbolIndex->IsKxld = TRUE;
+
+    Status = InternalKxldIndexSymbols (
+               Context->Is32Bit,
+               Context->KxldState,
+               Context->KxldStateSize,
+               &SymbolIndex->Symbols,
+               &Index
+               );
+    if (EFI_ERROR (Status)) {
+      InternalHashMapFree (&SymbolIndex->Symbols);
+      FreePool (SymbolIndex);
+      return;
+    }
+
+    Context->SymbolsVisited += Index;
+  }
+
+  DEBUG ((
+    DEBUG_VERBOSE,
+    "OCAK: %a-bit patcher indexed %u %a symbols\n",
+    Context->Is32Bit ? "32" : "64",
+    SymbolIndex->Symbols.Count,
+    SymbolIndex->IsKxld ? "KXLD" : "SYMTAB"
+    ));
+
+  Context->SymbolIndex = SymbolIndex;
+}
+
+/**
+  Find symbol file offset and value through symbol name index.
+
+  @param[in,out] Context         Patcher context with symbol index.
+  @param[in]     Name            Symbol name.
+  @param[out]    Offset          Symbol file offset.
+  @param[out]    SymbolAddress   Symbol value.
+
+  @return  EFI_SUCCESS on success.
+**/
+STATIC
+EFI_STATUS
+InternalGetIndexedSymbol (
+  IN OUT PATCHER_CONTEXT  *Context,
+  IN     CONST CHAR8      *Name,
+  OUT    UINT32           *Offset,
+  OUT    UINT64           *SymbolAddress
+  )
+{
+  PATCHER_SYMBOL_INDEX      *SymbolIndex;
+  VOID                      *Entry;
+  MACH_NLIST_ANY            *Symbol;
+  CONST KXLD_SYM_ENTRY_ANY  *KxldSymbol;
+
+  SymbolIndex = Context->SymbolIndex;
+  ASSERT (SymbolIndex != NULL);
+
+  Entry = InternalHashMapFind (&SymbolIndex->Symbols, Name);
+  if (Entry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (SymbolIndex->IsKxld) {
+    KxldSymbol     = Entry;
+    *SymbolAddress = Context->Is32Bit ? KxldSymbol->Kxld32.Address : KxldSymbol->Kxld64.Address;
+    if ((*SymbolAddress == 0) || !MachoSymbolGetDirectFileOffset (&Context->MachContext, *SymbolAddress, Offset, NULL)) {
+      return EFI_NOT_FOUND;
+    }
+
+    return EFI_SUCCESS;
+  }
+
+  Symbol = Entry;
+  if (!MachoSymbolGetFileOffset (&Context->MachContext, Symbol, Offset, NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *SymbolAddress = Context->Is32Bit ? Symbol->Symbol32.Value : Symbol->Symbol64.Value;
+  return EFI_SUCCESS;
+}
+
 EFI_STATUS
 PatcherGetSymbolAddressValue (
   IN OUT PATCHER_CONTEXT  *Context,
@@ -238,61 +430,84 @@ PatcherGetSymbolAddressValue (
   IN OUT UINT64           *Value
   )
 {
+  EFI_STATUS      Status;
   MACH_NLIST_ANY  *Symbol;
   CONST CHAR8     *SymbolName;
   UINT64          SymbolAddress;
   UINT32          Offset;
   UINT32          Index;
 
-  Index  = 0;
-  Offset = 0;
-  while (TRUE) {
-    //
-    // Try the usual way first via SYMTAB.
-    //
-    Symbol = MachoGetSymbolByIndex (&Context->MachContext, Index);
-    if (Symbol == NULL) {
+  ++Context->SymbolLookups;
+
+  //
+  // Single lookups (e.g. one-off kext quirks) are cheaper to do linearly,
+  // index the symbols once the same context is queried again.
+  //
+  if (  (Context->SymbolIndex == NULL)
+     && !Context->DisableSymbolIndex
+     && (Context->SymbolLookups > 1))
+  {
+    InternalBuildSymbolIndex (Context);
+  }
+
+  if (Context->SymbolIndex != NULL) {
+    Status = InternalGetIndexedSymbol (Context, Name, &Offset, &SymbolAddress);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  } else {
+    Index  = 0;
+    Offset = 0;
+    while (TRUE) {
       //
-      // If we have KxldState, use it.
+      // Try the usual way first via SYMTAB.
       //
-      if ((Index == 0) && (Context->KxldState != NULL)) {
-        SymbolAddress = InternalKxldSolveSymbol (
-                          Context->Is32Bit,
-                          Context->KxldState,
-                          Context->KxldStateSize,
-                          Name
-                          );
+      Symbol = MachoGetSymbolByIndex (&Context->MachContext, Index);
+      if (Symbol == NULL) {
         //
-        // If we have a symbol, get its ondisk offset.
+        // If we have KxldState, use it.
         //
-        if ((SymbolAddress != 0) && MachoSymbolGetDirectFileOffset (&Context->MachContext, SymbolAddress, &Offset, NULL)) {
+        if ((Index == 0) && (Context->KxldState != NULL)) {
+          SymbolAddress = InternalKxldSolveSymbol (
+                            Context->Is32Bit,
+                            Context->KxldState,
+                            Context->KxldStateSize,
+                            Name
+                            );
           //
-          // Proceed to success.
+          // If we have a symbol, get its ondisk offset.
           //
-          break;
+          if ((SymbolAddress != 0) && MachoSymbolGetDirectFileOffset (&Context->MachContext, SymbolAddress, &Offset, NULL)) {
+            //
+            // Proceed to success.
+            //
+            break;
+          }
         }
+
+        return EFI_NOT_FOUND;
       }
 
-      return EFI_NOT_FOUND;
-    }
+      ++Context->SymbolsVisited;
 
-    SymbolName = MachoGetSymbolName (&Context->MachContext, Symbol);
-    if ((SymbolName != NULL) && (AsciiStrCmp (Name, SymbolName) == 0)) {
-      //
-      // Once we have a symbol, get its ondisk offset.
-      //
-      if (MachoSymbolGetFileOffset (&Context->MachContext, Symbol, &Offset, NULL)) {
+      SymbolName = MachoGetSymbolName (&Context->MachContext, Symbol);
+      if ((SymbolName != NULL) && (AsciiStrCmp (Name, SymbolName) == 0)) {
         //
-        // Proceed to success.
+        // Once we have a symbol, get its ondisk offset.
         //
-        SymbolAddress = Context->Is32Bit ? Symbol->Symbol32.Value : Symbol->Symbol64.Value;
-        break;
+        if (MachoSymbolGetFileOffset (&Context->MachContext, Symbol, &Offset, NULL)) {
+          //
+          // Proceed to success.
+          //
+          SymbolAddress = Context->Is32Bit ? Symbol->Symbol32.Value : Symbol->Symbol64.Value;
+          break;
+        }
+
+        return EFI_INVALID_PARAMETER;
       }
 
-      return EFI_INVALID_PARAMETER;
+      Index++;
     }
-
-    Index++;
   }
 
   if (Address != NULL) {
@@ -306,21 +521,31 @@ PatcherGetSymbolAddressValue (
   return EFI_SUCCESS;
 }
 
+/**
+  Resolve generic patch area.
+
+  @param[in,out] Context  Patcher context.
+  @param[in]     Patch    Patch description.
+  @param[out]    Base     Patch area start.
+  @param[out]    Size     Patch area size, Limit is not applied.
+
+  @return  EFI_SUCCESS on success.
+**/
+STATIC
 EFI_STATUS
-PatcherApplyGenericPatch (
+InternalGetGenericPatchArea (
   IN OUT PATCHER_CONTEXT        *Context,
-  IN     PATCHER_GENERIC_PATCH  *Patch
+  IN     PATCHER_GENERIC_PATCH  *Patch,
+  OUT    UINT8                  **Base,
+  OUT    UINT32                 *Size
   )
 {
   EFI_STATUS  Status;
-  UINT8       *Base;
-  UINT32      Size;
-  UINT32      ReplaceCount;
 
-  Base = (UINT8 *)MachoGetMachHeader (&Context->MachContext);
-  Size = MachoGetInnerSize (&Context->MachContext);
+  *Base = (UINT8 *)MachoGetMachHeader (&Context->MachContext);
+  *Size = MachoGetInnerSize (&Context->MachContext);
   if (Patch->Base != NULL) {
-    Status = PatcherGetSymbolAddress (Context, Patch->Base, &Base);
+    Status = PatcherGetSymbolAddress (Context, Patch->Base, Base);
     if (EFI_ERROR (Status)) {
       DEBUG ((
         DEBUG_INFO,
@@ -332,40 +557,62 @@ PatcherApplyGenericPatch (
       return Status;
     }
 
-    Size -= (UINT32)(Base - (UINT8 *)MachoGetMachHeader (&Context->MachContext));
+    *Size -= (UINT32)(*Base - (UINT8 *)MachoGetMachHeader (&Context->MachContext));
   }
 
-  if (Patch->Find == NULL) {
-    if (Size < Patch->Size) {
-      DEBUG ((
-        DEBUG_INFO,
-        "OCAK: %a-bit %a is borked, not found\n",
-        Context->Is32Bit ? "32" : "64",
-        Patch->Comment != NULL ? Patch->Comment : "Patch"
-        ));
-      return EFI_NOT_FOUND;
-    }
+  return EFI_SUCCESS;
+}
 
-    CopyMem (Base, Patch->Replace, Patch->Size);
-    return EFI_SUCCESS;
-  }
+/**
+  Apply generic patch without find data.
 
-  if ((Patch->Limit > 0) && (Patch->Limit < Size)) {
-    Size = Patch->Limit;
+  @param[in,out] Context  Patcher context.
+  @param[in]     Patch    Patch description.
+  @param[in]     Base     Patch area start.
+  @param[in]     Size     Patch area size.
+
+  @return  EFI_SUCCESS on success.
+**/
+STATIC
+EFI_STATUS
+InternalApplyGenericReplace (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patch,
+  IN     UINT8                  *Base,
+  IN     UINT32                 Size
+  )
+{
+  if (Size < Patch->Size) {
+    DEBUG ((
+      DEBUG_INFO,
+      "OCAK: %a-bit %a is borked, not found\n",
+      Context->Is32Bit ? "32" : "64",
+      Patch->Comment != NULL ? Patch->Comment : "Patch"
+      ));
+    return EFI_NOT_FOUND;
   }
 
-  ReplaceCount = ApplyPatch (
-                   Patch->Find,
-                   Patch->Mask,
-                   Patch->Size,
-                   Patch->Replace,
-                   Patch->ReplaceMask,
-                   Base,
-                   Size,
-                   Patch->Count,
-                   Patch->Skip
-                   );
+  CopyMem (Base, Patch->Replace, Patch->Size);
+  return EFI_SUCCESS;
+}
+
+/**
+  Report generic patch replacement count.
 
+  @param[in] Context       Patcher context.
+  @param[in] Patch         Patch description.
+  @param[in] ReplaceCount  Amount of replacements performed.
+
+  @return  EFI_SUCCESS when anything was replaced.
+**/
+STATIC
+EFI_STATUS
+InternalReportGenericPatch (
+  IN CONST PATCHER_CONTEXT        *Context,
+  IN CONST PATCHER_GENERIC_PATCH  *Patch,
+  IN UINT32                       ReplaceCount
+  )
+{
   DEBUG ((
     DEBUG_INFO,
     "OCAK: %a-bit %a replace count - %u\n",
@@ -392,6 +639,181 @@ PatcherApplyGenericPatch (
   return EFI_NOT_FOUND;
 }
 
+EFI_STATUS
+PatcherApplyGenericPatch (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patch
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Base;
+  UINT32      Size;
+  UINT32      ReplaceCount;
+
+  Status = InternalGetGenericPatchArea (Context, Patch, &Base, &Size);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Patch->Find == NULL) {
+    return InternalApplyGenericReplace (Context, Patch, Base, Size);
+  }
+
+  if ((Patch->Limit > 0) && (Patch->Limit < Size)) {
+    Size = Patch->Limit;
+  }
+
+  ReplaceCount = ApplyPatch (
+                   Patch->Find,
+                   Patch->Mask,
+                   Patch->Size,
+                   Patch->Replace,
+                   Patch->ReplaceMask,
+                   Base,
+                   Size,
+                   Patch->Count,
+                   Patch->Skip
+                   );
+
+  return InternalReportGenericPatch (Context, Patch, ReplaceCount);
+}
+
+/**
+  Apply pending generic patches with a single scan.
+
+  @param[in,out] Context       Patcher context.
+  @param[in]     Patches       Patch descriptions.
+  @param[in,out] Entries       Pending patch set entries.
+  @param[in]     PatchIndices  Patch index for every pending entry.
+  @param[in]     NumPending    Number of pending entries.
+  @param[out]    Results       Patch results.
+**/
+STATIC
+VOID
+InternalFlushGenericPatches (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patches,
+  IN OUT OC_PATCH_SET_ENTRY     *Entries,
+  IN     CONST UINT32           *PatchIndices,
+  IN     UINT32                 NumPending,
+  OUT    EFI_STATUS             *Results
+  )
+{
+  UINT32  Index;
+
+  if (NumPending == 0) {
+    return;
+  }
+
+  ApplyPatchSet (
+    Entries,
+    NumPending,
+    (UINT8 *)MachoGetMachHeader (&Context->MachContext),
+    MachoGetInnerSize (&Context->MachContext)
+    );
+
+  for (Index = 0; Index < NumPending; ++Index) {
+    Results[PatchIndices[Index]] = InternalReportGenericPatch (
+                                     Context,
+                                     &Patches[PatchIndices[Index]],
+                                     Entries[Index].ReplaceCount
+                                     );
+  }
+}
+
+VOID
+PatcherApplyGenericPatches (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patches,
+  IN     UINT32                 NumPatches,
+  OUT    EFI_STATUS             *Results
+  )
+{
+  EFI_STATUS             Status;
+  OC_PATCH_SET_ENTRY     *Entries;
+  UINT32                 *PatchIndices;
+  UINT32                 NumPending;
+  UINT32                 Index;
+  UINT8                  *Header;
+  UINT8                  *Base;
+  UINT32                 Size;
+  PATCHER_GENERIC_PATCH  *Patch;
+
+  ASSERT (Context != NULL);
+  ASSERT (Patches != NULL || NumPatches == 0);
+  ASSERT (Results != NULL || NumPatches == 0);
+
+  if (NumPatches == 0) {
+    return;
+  }
+
+  Entries      = NULL;
+  PatchIndices = NULL;
+  if (NumPatches <= MAX_UINT32 / sizeof (*Entries)) {
+    Entries      = AllocatePool (NumPatches * sizeof (*Entries));
+    PatchIndices = AllocatePool (NumPatches * sizeof (*PatchIndices));
+  }
+
+  if ((Entries == NULL) || (PatchIndices == NULL)) {
+    if (Entries != NULL) {
+      FreePool (Entries);
+    }
+
+    if (PatchIndices != NULL) {
+      FreePool (PatchIndices);
+    }
+
+    for (Index = 0; Index < NumPatches; ++Index) {
+      Results[Index] = PatcherApplyGenericPatch (Context, &Patches[Index]);
+    }
+
+    return;
+  }
+
+  Header     = (UINT8 *)MachoGetMachHeader (&Context->MachContext);
+  NumPending = 0;
+
+  for (Index = 0; Index < NumPatches; ++Index) {
+    Patch  = &Patches[Index];
+    Status = InternalGetGenericPatchArea (Context, Patch, &Base, &Size);
+    if (EFI_ERROR (Status)) {
+      Results[Index] = Status;
+      continue;
+    }
+
+    if (Patch->Find == NULL) {
+      //
+      // Direct writes must observe every earlier patch.
+      //
+      InternalFlushGenericPatches (Context, Patches, Entries, PatchIndices, NumPending, Results);
+      NumPending     = 0;
+      Results[Index] = InternalApplyGenericReplace (Context, Patch, Base, Size);
+      continue;
+    }
+
+    if ((Patch->Limit > 0) && (Patch->Limit < Size)) {
+      Size = Patch->Limit;
+    }
+
+    Entries[NumPending].Pattern     = Patch->Find;
+    Entries[NumPending].PatternMask = Patch->Mask;
+    Entries[NumPending].Replace     = Patch->Replace;
+    Entries[NumPending].ReplaceMask = Patch->ReplaceMask;
+    Entries[NumPending].PatternSize = Patch->Size;
+    Entries[NumPending].Count       = Patch->Count;
+    Entries[NumPending].Skip        = Patch->Skip;
+    Entries[NumPending].DataOffset  = (UINT32)(Base - Header);
+    Entries[NumPending].DataSize    = Size;
+    PatchIndices[NumPending]        = Index;
+    ++NumPending;
+  }
+
+  InternalFlushGenericPatches (Context, Patches, Entries, PatchIndices, NumPending, Results);
+
+  FreePool (Entries);
+  FreePool (PatchIndices);
+}
+
 EFI_STATUS
 PatcherExcludePrelinkedKext (
   IN     CONST CHAR8        *Identifier,
@@ -409,11 +831,6 @@ PatcherExcludePrelinkedKext (
 
   UINT32       KextCount;
   UINT32       Index;
-  UINT32       Index2;
-  XML_NODE     *KextPlist;
-  UINT32       KextPlistCount;
-  CONST CHAR8  *KextPlistKey;
-  XML_NODE     *KextPlistValue;
   CONST CHAR8  *KextIdentifier;
   EFI_STATUS   Status;
 
@@ -475,68 +892,37 @@ PatcherExcludePrelinkedKext (
   //
   // Find kext info to be removed in prelinked context.
   //
-  KextCount      = XmlNodeChildren (PrelinkedContext->KextList);
-  KextPlist      = NULL;
-  KextPlistKey   = NULL;
-  KextIdentifier = NULL;
+  KextCount = XmlNodeChildren (PrelinkedContext->KextList);
 
   for (Index = 0; Index < KextCount; ++Index) {
-    KextPlist = PlistNodeCast (XmlNodeChild (PrelinkedContext->KextList, Index), PLIST_NODE_TYPE_DICT);
-    if (KextPlist == NULL) {
+    KextIdentifier = InternalKextListIdentifier (PrelinkedContext, Index);
+    if ((KextIdentifier == NULL) || (AsciiStrCmp (KextIdentifier, Identifier) != 0)) {
       continue;
     }
 
-    KextPlistCount = PlistDictChildren (KextPlist);
-    for (Index2 = 0; Index2 < KextPlistCount; ++Index2) {
-      KextPlistKey = PlistKeyValue (PlistDictChild (KextPlist, Index2, &KextPlistValue));
-      if (KextPlistKey == NULL) {
-        continue;
-      }
-
-      if (AsciiStrCmp (KextPlistKey, INFO_BUNDLE_IDENTIFIER_KEY) == 0) {
-        KextIdentifier = XmlNodeContent (KextPlistValue);
-        if ((PlistNodeCast (KextPlistValue, PLIST_NODE_TYPE_STRING) == NULL) || (KextIdentifier == NULL)) {
-          DEBUG ((
-            DEBUG_INFO,
-            "OCAK: Plist value cannot be interpreted as string, or current kext identifier is null (dict index %u, plist %p, plist index %u)\n",
-            Index2,
-            KextPlist,
-            Index
-            ));
-          return EFI_NOT_FOUND;
-        }
-
-        if (AsciiStrCmp (KextIdentifier, Identifier) == 0) {
-          //
-          // Erase kext.
-          //
-          Status = InternalDropCachedPrelinkedKext (PrelinkedContext, KextIdentifier);
-          if (EFI_ERROR (Status)) {
-            DEBUG ((
-              DEBUG_INFO,
-              "OCAK: Failed to drop %a under dict index %u, plist %p, plist index %u - %r\n",
-              KextIdentifier,
-              Index2,
-              KextPlist,
-              Index,
-              Status
-              ));
-            return Status;
-          }
-
-          DEBUG ((
-            DEBUG_INFO,
-            "OCAK: Erasing %a from prelinked kext under dict index %u, plist %p, plist index %u\n",
-            Identifier,
-            Index2,
-            KextPlist,
-            Index
-            ));
-          XmlNodeRemoveByIndex (PrelinkedContext->KextList, Index);
-          return EFI_SUCCESS;
-        }
-      }
+    //
+    // Erase kext.
+    //
+    Status = InternalDropCachedPrelinkedKext (PrelinkedContext, KextIdentifier);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((
+        DEBUG_INFO,
+        "OCAK: Failed to drop %a under plist index %u - %r\n",
+        KextIdentifier,
+        Index,
+        Status
+        ));
+      return Status;
     }
+
+    DEBUG ((
+      DEBUG_INFO,
+      "OCAK: Erasing %a from prelinked kext under plist index %u\n",
+      Identifier,
+      Index
+      ));
+    InternalKextListRemove (PrelinkedContext, Index);
+    return EFI_SUCCESS;
   }
 
   return EFI_NOT_FOUND;
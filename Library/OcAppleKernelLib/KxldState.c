@@ -285,6 +285,8 @@ InternalKxldStateBuildLinkedSymbolTable (
   Kext->NumberOfCxxSymbols = NumCxxSymbols;
   Kext->LinkedSymbolTable  = SymbolTable;
 
+  InternalBuildLinkedSymbolIndex (Kext);
+
   return EFI_SUCCESS;
 }
 
@@ -392,6 +394,8 @@ InternalKxldStateBuildLinkedVtables (
   Kext->LinkedVtables   = LinkedVtables;
   Kext->NumberOfVtables = NumVtables;
 
+  InternalBuildVtableIndex (Kext, LinkedVtables, NumVtables);
+
   return EFI_SUCCESS;
 }
 
@@ -412,6 +416,11 @@ InternalKxldStateRebasePlist (
   XML_NODE     *KextPlistValue;
   UINT64       KxldState;
 
+  //
+  // Lazily parsed dictionaries are exported verbatim and cannot be updated.
+  //
+  ASSERT (Context->PrelinkedInfoIndex == NULL);
+
   KextCount = XmlNodeChildren (Context->KextList);
 
   Context->KextScratchBuffer = ScratchWalker = AllocatePool (KextCount * KEXT_OFFSET_STR_LEN);
@@ -420,7 +429,7 @@ InternalKxldStateRebasePlist (
   }
 
   for (Index = 0; Index < KextCount; ++Index) {
-    KextPlist = PlistNodeCast (XmlNodeChild (Context->KextList, Index), PLIST_NODE_TYPE_DICT);
+    KextPlist = InternalKextListPlist (Context, Index);
 
     if (KextPlist == NULL) {
       continue;
@@ -642,3 +651,59 @@ InternalKxldSolveSymbol (
 
   return 0;
 }
+
+EFI_STATUS
+InternalKxldIndexSymbols (
+  IN     BOOLEAN      Is32Bit,
+  IN     CONST VOID   *KxldState,
+  IN     UINT32       KxldStateSize,
+  IN OUT OC_HASH_MAP  *Map,
+  OUT    UINT32       *NumVisited
+  )
+{
+  CONST CHAR8               *LocalName;
+  CONST KXLD_SYM_ENTRY_ANY  *KxldSymbols;
+  UINT32                    Index;
+  UINT32                    NumSymbols;
+
+  ASSERT (KxldState != NULL);
+  ASSERT (KxldStateSize > 0);
+  ASSERT (Map != NULL);
+  ASSERT (NumVisited != NULL);
+
+  *NumVisited = 0;
+
+  KxldSymbols = InternalGetKxldSymbols (
+                  KxldState,
+                  KxldStateSize,
+                  Is32Bit ? MachCpuTypeI386 : MachCpuTypeX8664,
+                  &NumSymbols
+                  );
+
+  if (KxldSymbols == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  for (Index = 0; Index < NumSymbols; ++Index) {
+    LocalName = InternalGetKxldString (
+                  KxldState,
+                  KxldStateSize,
+                  Is32Bit ? KxldSymbols->Kxld32.NameOffset : KxldSymbols->Kxld64.NameOffset
+                  );
+    //
+    // Match InternalKxldSolveSymbol, which stops at the first malformed name.
+    //
+    if (LocalName == NULL) {
+      break;
+    }
+
+    if (!InternalHashMapInsert (Map, LocalName, (VOID *)KxldSymbols)) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    KxldSymbols = KXLD_ANY_NEXT (Is32Bit, KxldSymbols);
+  }
+
+  *NumVisited = Index;
+  return EFI_SUCCESS;
+}
@@ -35,6 +35,55 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 // Symbols
 //
 
+VOID
+InternalFreeLinkedSymbolIndex (
+  IN OUT PRELINKED_KEXT  *Kext
+  )
+{
+  InternalHashMapFree (&Kext->LinkedSymbolNames);
+  InternalHashMapFree (&Kext->LinkedCxxSymbolNames);
+  InternalHashMapFree (&Kext->LinkedCxxSymbolValues);
+}
+
+VOID
+InternalBuildLinkedSymbolIndex (
+  IN OUT PRELINKED_KEXT  *Kext
+  )
+{
+  PRELINKED_KEXT_SYMBOL  *Symbol;
+  UINT32                 NumCSymbols;
+  UINT32                 Index;
+  BOOLEAN                Result;
+
+  ASSERT (Kext->LinkedSymbolTable != NULL);
+  ASSERT (Kext->LinkedCxxSymbolNames.Entries == NULL);
+
+  NumCSymbols = Kext->NumberOfSymbols - Kext->NumberOfCxxSymbols;
+
+  Result = InternalHashMapInit (&Kext->LinkedSymbolNames, NumCSymbols, OcHashMapKeyAscii)
+           && InternalHashMapInit (&Kext->LinkedCxxSymbolNames, Kext->NumberOfCxxSymbols, OcHashMapKeyAscii)
+           && InternalHashMapInit (&Kext->LinkedCxxSymbolValues, Kext->NumberOfCxxSymbols, OcHashMapKeyNumeric);
+
+  //
+  // C++ symbols are always placed at the end of the table, so the first match
+  // in each map is the first match of the linear walk.
+  //
+  for (Index = 0; Result && Index < Kext->NumberOfSymbols; ++Index) {
+    Symbol = &Kext->LinkedSymbolTable[Index];
+    if (Index < NumCSymbols) {
+      Result = InternalHashMapInsert (&Kext->LinkedSymbolNames, Symbol->Name, Symbol);
+    } else {
+      Result = InternalHashMapInsert (&Kext->LinkedCxxSymbolNames, Symbol->Name, Symbol)
+               && InternalHashMapInsertNumeric (&Kext->LinkedCxxSymbolValues, Symbol->Value, Symbol);
+    }
+  }
+
+  if (!Result) {
+    DEBUG ((DEBUG_INFO, "OCAK: Failed to index %u symbols of %a\n", Kext->NumberOfSymbols, Kext->Identifier));
+    InternalFreeLinkedSymbolIndex (Kext);
+  }
+}
+
 STATIC
 CONST PRELINKED_KEXT_SYMBOL *
 InternalOcGetSymbolWorkerName (
@@ -55,7 +104,20 @@ InternalOcGetSymbolWorkerName (
   //
   Kext->Processed = TRUE;
 
-  if (Kext->LinkedSymbolTable != NULL) {
+  if (Kext->LinkedCxxSymbolNames.Entries != NULL) {
+    Symbols = NULL;
+    if (SymbolLevel != OcGetSymbolOnlyCxx) {
+      Symbols = InternalHashMapFind (&Kext->LinkedSymbolNames, LookupValue);
+    }
+
+    if (Symbols == NULL) {
+      Symbols = InternalHashMapFind (&Kext->LinkedCxxSymbolNames, LookupValue);
+    }
+
+    if (Symbols != NULL) {
+      return Symbols;
+    }
+  } else if (Kext->LinkedSymbolTable != NULL) {
     NumSymbols = Kext->NumberOfSymbols;
     Symbols    = Kext->LinkedSymbolTable;
 
@@ -136,7 +198,12 @@ InternalOcGetSymbolWorkerValue (
   //
   Kext->Processed = TRUE;
 
-  if (Kext->LinkedSymbolTable != NULL) {
+  if ((SymbolLevel == OcGetSymbolOnlyCxx) && (Kext->LinkedCxxSymbolValues.Entries != NULL)) {
+    Symbols = InternalHashMapFindNumeric (&Kext->LinkedCxxSymbolValues, LookupValue);
+    if (Symbols != NULL) {
+      return Symbols;
+    }
+  } else if (Kext->LinkedSymbolTable != NULL) {
     NumSymbols = Kext->NumberOfSymbols;
     Symbols    = Kext->LinkedSymbolTable;
 
@@ -0,0 +1,457 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Base.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/BaseOverflowLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcCryptoLib.h>
+
+#include "PrelinkedInternal.h"
+
+#define OC_KEXT_LINK_CACHE_SIGNATURE  SIGNATURE_32 ('O', 'C', 'L', 'K')
+#define OC_KEXT_LINK_CACHE_VERSION    2U
+
+//
+// Linker revision, must be bumped whenever linked images may change
+// for the same inputs. Build version covers official releases, this
+// covers builds sharing the same version string.
+//
+#define OC_KEXT_LINK_CACHE_LINKER_VERSION  1U
+
+//
+// Cache entries are padded to keep headers naturally aligned.
+//
+#define OC_KEXT_LINK_CACHE_ALIGNMENT  8U
+
+//
+// Minimum allocation for new cache contents.
+//
+#define OC_KEXT_LINK_CACHE_MIN_SIZE  BASE_1MB
+
+#pragma pack(push, 1)
+
+typedef struct {
+  UINT32    Signature;
+  UINT32    Version;
+  UINT32    NumEntries;
+  UINT32    LinkerVersion;
+  CHAR8     BuildVersion[OC_KEXT_LINK_CACHE_BUILD_VERSION_SIZE];
+  UINT8     KernelDigest[OC_KEXT_LINK_CACHE_KEY_SIZE];
+} OC_KEXT_LINK_CACHE_HEADER;
+
+typedef struct {
+  UINT8     Key[OC_KEXT_LINK_CACHE_KEY_SIZE];
+  UINT32    ImageSize;
+  UINT32    LinkedSize;
+  //
+  // UINT8  Image[ImageSize] follows, padded to OC_KEXT_LINK_CACHE_ALIGNMENT.
+  //
+} OC_KEXT_LINK_CACHE_ENTRY;
+
+#pragma pack(pop)
+
+STATIC_ASSERT (
+  OC_KEXT_LINK_CACHE_KEY_SIZE == SHA384_DIGEST_SIZE,
+  "Linked kext cache key must match kernel digest size"
+  );
+
+STATIC_ASSERT (
+  sizeof (OC_KEXT_LINK_CACHE_HEADER) % OC_KEXT_LINK_CACHE_ALIGNMENT == 0,
+  "Linked kext cache header must keep entries aligned"
+  );
+
+STATIC_ASSERT (
+  sizeof (OC_KEXT_LINK_CACHE_ENTRY) % OC_KEXT_LINK_CACHE_ALIGNMENT == 0,
+  "Linked kext cache entry must keep images aligned"
+  );
+
+/**
+  Validate previously saved cache and index its entries.
+
+  @param[in,out] LinkCache  Linked kext cache with previously saved cache.
+
+  @return  TRUE when the cache is valid for current kernel and build.
+**/
+STATIC
+BOOLEAN
+InternalLinkCacheIndex (
+  IN OUT OC_KEXT_LINK_CACHE  *LinkCache
+  )
+{
+  OC_KEXT_LINK_CACHE_HEADER  *Header;
+  OC_KEXT_LINK_CACHE_ENTRY   *Entry;
+  UINT32                     Offset;
+  UINT32                     Remaining;
+  UINT32                     Index;
+
+  if (LinkCache->CacheSize < sizeof (*Header)) {
+    return FALSE;
+  }
+
+  Header = (OC_KEXT_LINK_CACHE_HEADER *)LinkCache->Cache;
+  if (  (Header->Signature != OC_KEXT_LINK_CACHE_SIGNATURE)
+     || (Header->Version != OC_KEXT_LINK_CACHE_VERSION)
+     || (Header->LinkerVersion != OC_KEXT_LINK_CACHE_LINKER_VERSION)
+     || (CompareMem (Header->BuildVersion, LinkCache->BuildVersion, sizeof (Header->BuildVersion)) != 0)
+     || (Header->NumEntries > (LinkCache->CacheSize - sizeof (*Header)) / sizeof (*Entry))
+     || (CompareMem (Header->KernelDigest, LinkCache->KernelDigest, sizeof (Header->KernelDigest)) != 0))
+  {
+    return FALSE;
+  }
+
+  if (!InternalHashMapInit (&LinkCache->CacheIndex, Header->NumEntries, OcHashMapKeyNumeric)) {
+    return FALSE;
+  }
+
+  Offset = sizeof (*Header);
+  for (Index = 0; Index < Header->NumEntries; ++Index) {
+    Remaining = LinkCache->CacheSize - Offset;
+    if (Remaining < sizeof (*Entry)) {
+      return FALSE;
+    }
+
+    Entry      = (OC_KEXT_LINK_CACHE_ENTRY *)(LinkCache->Cache + Offset);
+    Remaining -= sizeof (*Entry);
+
+    if (  (Entry->ImageSize == 0)
+       || (Entry->ImageSize > Remaining - Remaining % OC_KEXT_LINK_CACHE_ALIGNMENT)
+       || (Entry->LinkedSize == 0)
+       || (Entry->LinkedSize > Entry->ImageSize))
+    {
+      return FALSE;
+    }
+
+    //
+    // Key is a digest, so leading bytes are good enough for the index.
+    // Full key is compared on lookup.
+    //
+    if (!InternalHashMapInsertNumeric (&LinkCache->CacheIndex, ReadUnaligned64 ((UINT64 *)Entry->Key), Entry)) {
+      return FALSE;
+    }
+
+    Offset += sizeof (*Entry) + ALIGN_VALUE (Entry->ImageSize, OC_KEXT_LINK_CACHE_ALIGNMENT);
+  }
+
+  LinkCache->CacheEntries = Header->NumEntries;
+  return TRUE;
+}
+
+/**
+  Append linked image to new cache contents.
+
+  @param[in,out] LinkCache   Linked kext cache.
+  @param[in]     Image       Linked kext image.
+  @param[in]     ImageSize   Linked kext image size.
+  @param[in]     LinkedSize  Linked Mach-O size.
+**/
+STATIC
+VOID
+InternalLinkCacheAppend (
+  IN OUT OC_KEXT_LINK_CACHE  *LinkCache,
+  IN     CONST UINT8         *Image,
+  IN     UINT32              ImageSize,
+  IN     UINT32              LinkedSize
+  )
+{
+  OC_KEXT_LINK_CACHE_ENTRY  *Entry;
+  UINT32                    EntrySize;
+  UINT32                    NewSize;
+  UINT32                    NewAllocSize;
+  UINT8                     *NewCache;
+
+  if (LinkCache->NewCacheFailed) {
+    return;
+  }
+
+  if (LinkCache->NewCacheSize == 0) {
+    LinkCache->NewCacheSize = sizeof (OC_KEXT_LINK_CACHE_HEADER);
+  }
+
+  if (BaseOverflowTriAddU32 (ImageSize, sizeof (*Entry), OC_KEXT_LINK_CACHE_ALIGNMENT - 1, &EntrySize)) {
+    LinkCache->NewCacheFailed = TRUE;
+    return;
+  }
+
+  EntrySize &= ~(OC_KEXT_LINK_CACHE_ALIGNMENT - 1);
+
+  if (BaseOverflowAddU32 (LinkCache->NewCacheSize, EntrySize, &NewSize)) {
+    LinkCache->NewCacheFailed = TRUE;
+    return;
+  }
+
+  if (NewSize > LinkCache->NewCacheAllocSize) {
+    NewAllocSize = MAX (NewSize, OC_KEXT_LINK_CACHE_MIN_SIZE);
+    if (LinkCache->NewCacheAllocSize < MAX_UINT32 / 2) {
+      NewAllocSize = MAX (NewAllocSize, LinkCache->NewCacheAllocSize * 2);
+    }
+
+    NewCache = ReallocatePool (LinkCache->NewCacheAllocSize, NewAllocSize, LinkCache->NewCache);
+    if (NewCache == NULL) {
+      LinkCache->NewCacheFailed = TRUE;
+      return;
+    }
+
+    LinkCache->NewCache          = NewCache;
+    LinkCache->NewCacheAllocSize = NewAllocSize;
+  }
+
+  Entry = (OC_KEXT_LINK_CACHE_ENTRY *)(LinkCache->NewCache + LinkCache->NewCacheSize);
+  CopyMem (Entry->Key, LinkCache->ChainKey, sizeof (Entry->Key));
+  Entry->ImageSize  = ImageSize;
+  Entry->LinkedSize = LinkedSize;
+  CopyMem (Entry + 1, Image, ImageSize);
+  ZeroMem ((UINT8 *)(Entry + 1) + ImageSize, EntrySize - sizeof (*Entry) - ImageSize);
+
+  LinkCache->NewCacheSize = NewSize;
+  ++LinkCache->NewCacheEntries;
+}
+
+EFI_STATUS
+PrelinkedLinkCacheInit (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CONST UINT8        *KernelDigest,
+  IN     CONST CHAR8        *BuildVersion,
+  IN     VOID               *Cache OPTIONAL,
+  IN     UINT32             CacheSize
+  )
+{
+  OC_KEXT_LINK_CACHE  *LinkCache;
+
+  ASSERT (Context != NULL);
+  ASSERT (KernelDigest != NULL);
+  ASSERT (BuildVersion != NULL);
+  ASSERT (Context->LinkCache == NULL);
+
+  //
+  // 32-bit object kexts are linked regardless of dynamic linker flag,
+  // so there is no way to skip linking for them.
+  //
+  if (Context->Is32Bit) {
+    if (Cache != NULL) {
+      FreePool (Cache);
+    }
+
+    return EFI_UNSUPPORTED;
+  }
+
+  LinkCache = AllocateZeroPool (sizeof (*LinkCache));
+  if (LinkCache == NULL) {
+    if (Cache != NULL) {
+      FreePool (Cache);
+    }
+
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyMem (LinkCache->KernelDigest, KernelDigest, sizeof (LinkCache->KernelDigest));
+  CopyMem (LinkCache->ChainKey, KernelDigest, sizeof (LinkCache->ChainKey));
+  //
+  // Keep the rest zeroed, so that the version is compared as a whole.
+  //
+  AsciiStrnCpyS (
+    LinkCache->BuildVersion,
+    sizeof (LinkCache->BuildVersion),
+    BuildVersion,
+    sizeof (LinkCache->BuildVersion) - 1
+    );
+
+  if (Cache != NULL) {
+    LinkCache->Cache     = Cache;
+    LinkCache->CacheSize = CacheSize;
+
+    if (!InternalLinkCacheIndex (LinkCache)) {
+      DEBUG ((DEBUG_INFO, "OCAK: Discarding outdated linked kext cache of %u bytes\n", CacheSize));
+      InternalHashMapFree (&LinkCache->CacheIndex);
+      FreePool (LinkCache->Cache);
+      LinkCache->Cache        = NULL;
+      LinkCache->CacheSize    = 0;
+      LinkCache->CacheEntries = 0;
+    }
+  }
+
+  DEBUG ((DEBUG_INFO, "OCAK: Linked kext cache has %u entries\n", LinkCache->CacheEntries));
+
+  Context->LinkCache = LinkCache;
+  return EFI_SUCCESS;
+}
+
+VOID *
+PrelinkedLinkCacheExport (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  OUT    UINT32             *CacheSize
+  )
+{
+  OC_KEXT_LINK_CACHE         *LinkCache;
+  OC_KEXT_LINK_CACHE_HEADER  *Header;
+  VOID                       *Cache;
+
+  ASSERT (Context != NULL);
+  ASSERT (CacheSize != NULL);
+
+  LinkCache = Context->LinkCache;
+  if (LinkCache == NULL) {
+    return NULL;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "OCAK: Linked kext cache hits %u misses %u entries %u/%u\n",
+    LinkCache->Hits,
+    LinkCache->Misses,
+    LinkCache->NewCacheEntries,
+    LinkCache->CacheEntries
+    ));
+
+  if (  (LinkCache->NewCache == NULL)
+     || LinkCache->NewCacheFailed
+     || ((LinkCache->Misses == 0) && (LinkCache->NewCacheEntries == LinkCache->CacheEntries)))
+  {
+    return NULL;
+  }
+
+  Header                = (OC_KEXT_LINK_CACHE_HEADER *)LinkCache->NewCache;
+  Header->Signature     = OC_KEXT_LINK_CACHE_SIGNATURE;
+  Header->Version       = OC_KEXT_LINK_CACHE_VERSION;
+  Header->NumEntries    = LinkCache->NewCacheEntries;
+  Header->LinkerVersion = OC_KEXT_LINK_CACHE_LINKER_VERSION;
+  CopyMem (Header->BuildVersion, LinkCache->BuildVersion, sizeof (Header->BuildVersion));
+  CopyMem (Header->KernelDigest, LinkCache->KernelDigest, sizeof (Header->KernelDigest));
+
+  Cache      = LinkCache->NewCache;
+  *CacheSize = LinkCache->NewCacheSize;
+
+  LinkCache->NewCache          = NULL;
+  LinkCache->NewCacheSize      = 0;
+  LinkCache->NewCacheAllocSize = 0;
+  LinkCache->NewCacheEntries   = 0;
+
+  return Cache;
+}
+
+VOID
+InternalLinkCacheUpdateKey (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CONST CHAR8        *InfoPlist,
+  IN     UINT32             InfoPlistSize,
+  IN     CONST UINT8        *Executable OPTIONAL,
+  IN     UINT32             ExecutableSize
+  )
+{
+  SHA384_CONTEXT  Sha384Context;
+  UINT64          Layout[5];
+
+  ASSERT (Context->LinkCache != NULL);
+
+  //
+  // Linked images depend on where they are put and on every kext
+  // injected earlier, which is covered by chaining the keys.
+  //
+  Layout[0] = Context->PrelinkedSize;
+  Layout[1] = Context->PrelinkedLastAddress;
+  Layout[2] = Context->PrelinkedLastLoadAddress;
+  Layout[3] = Context->IsKernelCollection;
+  Layout[4] = LShiftU64 (InfoPlistSize, 32) | (Executable != NULL ? ExecutableSize : 0);
+
+  Sha384Init (&Sha384Context);
+  Sha384Update (&Sha384Context, Context->LinkCache->ChainKey, sizeof (Context->LinkCache->ChainKey));
+  Sha384Update (&Sha384Context, (CONST UINT8 *)Layout, sizeof (Layout));
+  Sha384Update (&Sha384Context, (CONST UINT8 *)InfoPlist, InfoPlistSize);
+  if (Executable != NULL) {
+    Sha384Update (&Sha384Context, Executable, ExecutableSize);
+  }
+
+  Sha384Final (&Sha384Context, Context->LinkCache->ChainKey);
+}
+
+BOOLEAN
+InternalLinkCacheLookup (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  OUT    UINT8              *Image,
+  IN     UINT32             ImageSize,
+  OUT    UINT32             *LinkedSize
+  )
+{
+  OC_KEXT_LINK_CACHE        *LinkCache;
+  OC_KEXT_LINK_CACHE_ENTRY  *Entry;
+
+  LinkCache = Context->LinkCache;
+  ASSERT (LinkCache != NULL);
+
+  Entry = InternalHashMapFindNumeric (
+            &LinkCache->CacheIndex,
+            ReadUnaligned64 ((UINT64 *)LinkCache->ChainKey)
+            );
+  if (  (Entry == NULL)
+     || (Entry->ImageSize != ImageSize)
+     || (CompareMem (Entry->Key, LinkCache->ChainKey, sizeof (Entry->Key)) != 0))
+  {
+    return FALSE;
+  }
+
+  CopyMem (Image, Entry + 1, ImageSize);
+  *LinkedSize = Entry->LinkedSize;
+
+  ++LinkCache->Hits;
+
+  //
+  // Carry the entry over, so that the new cache contains all kexts in use.
+  //
+  InternalLinkCacheAppend (LinkCache, Image, ImageSize, Entry->LinkedSize);
+  return TRUE;
+}
+
+VOID
+InternalLinkCacheStore (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CONST UINT8        *Image,
+  IN     UINT32             ImageSize,
+  IN     UINT32             LinkedSize
+  )
+{
+  ASSERT (Context->LinkCache != NULL);
+  ASSERT (LinkedSize <= ImageSize);
+
+  ++Context->LinkCache->Misses;
+  InternalLinkCacheAppend (Context->LinkCache, Image, ImageSize, LinkedSize);
+}
+
+VOID
+InternalLinkCacheFree (
+  IN OUT PRELINKED_CONTEXT  *Context
+  )
+{
+  OC_KEXT_LINK_CACHE  *LinkCache;
+
+  LinkCache = Context->LinkCache;
+  if (LinkCache == NULL) {
+    return;
+  }
+
+  InternalHashMapFree (&LinkCache->CacheIndex);
+
+  if (LinkCache->Cache != NULL) {
+    FreePool (LinkCache->Cache);
+  }
+
+  if (LinkCache->NewCache != NULL) {
+    FreePool (LinkCache->NewCache);
+  }
+
+  FreePool (LinkCache);
+  Context->LinkCache = NULL;
+}
@@ -1507,7 +1507,9 @@ MkextContextApplyPatch (
     return Status;
   }
 
-  return PatcherApplyGenericPatch (&Patcher, Patch);
+  Status = PatcherApplyGenericPatch (&Patcher, Patch);
+  PatcherFreeContext (&Patcher);
+  return Status;
 }
 
 EFI_STATUS
@@ -1528,7 +1530,9 @@ MkextContextApplyQuirk (
 
   Status = PatcherInitContextFromMkext (&Patcher, Context, KernelQuirk->Identifier);
   if (!EFI_ERROR (Status)) {
-    return KernelQuirk->PatchFunction (&Patcher, KernelVersion);
+    Status = KernelQuirk->PatchFunction (&Patcher, KernelVersion);
+    PatcherFreeContext (&Patcher);
+    return Status;
   }
 
   //
@@ -1557,7 +1561,9 @@ MkextContextBlock (
     return Status;
   }
 
-  return PatcherBlockKext (&Patcher);
+  Status = PatcherBlockKext (&Patcher);
+  PatcherFreeContext (&Patcher);
+  return Status;
 }
 
 EFI_STATUS
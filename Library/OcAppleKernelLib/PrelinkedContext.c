@@ -29,7 +29,7 @@
 STATIC
 UINT64
 PrelinkedFindLastLoadAddress (
-  IN XML_NODE  *KextList
+  IN OUT PRELINKED_CONTEXT  *Context
   )
 {
   UINT32       KextCount;
@@ -42,7 +42,7 @@ PrelinkedFindLastLoadAddress (
   UINT64       LoadAddress;
   UINT64       LoadSize;
 
-  KextCount = XmlNodeChildren (KextList);
+  KextCount = XmlNodeChildren (Context->KextList);
   if (KextCount == 0) {
     return 0;
   }
@@ -52,7 +52,7 @@ PrelinkedFindLastLoadAddress (
   // yet there might be an arbitrary amount of trailing executable-less kexts.
   //
   for (KextIndex = 1; KextIndex <= KextCount; ++KextIndex) {
-    LastKext = PlistNodeCast (XmlNodeChild (KextList, KextCount - KextIndex), PLIST_NODE_TYPE_DICT);
+    LastKext = InternalKextListPlist (Context, KextCount - KextIndex);
     if (LastKext == NULL) {
       return 0;
     }
@@ -218,9 +218,11 @@ PrelinkedContextInit (
   XML_NODE        *PrelinkedInfoRoot;
   CONST CHAR8     *PrelinkedInfoRootKey;
   UINT64          SegmentEndOffset;
+  UINT32          InfoSize;
   UINT32          PrelinkedInfoRootIndex;
   UINT32          PrelinkedInfoRootCount;
   PRELINKED_KEXT  *PrelinkedKext;
+  UINT64          Start;
 
   ASSERT (Context != NULL);
   ASSERT (Prelinked != NULL);
@@ -268,6 +270,10 @@ PrelinkedContextInit (
   //
   InitializeListHead (&Context->PrelinkedKexts);
   InitializeListHead (&Context->InjectedKexts);
+  //
+  // Identifier index is optional, lookups walk the list without it.
+  //
+  InternalHashMapInit (&Context->PrelinkedKextIndex, 0, OcHashMapKeyAscii);
   PrelinkedKext = InternalCachedPrelinkedKernel (Context);
   if (PrelinkedKext == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -353,17 +359,29 @@ PrelinkedContextInit (
     return EFI_OUT_OF_RESOURCES;
   }
 
-  Context->PrelinkedInfoDocument = XmlDocumentParse (
-                                     Context->PrelinkedInfo,
-                                     (UINT32)(Context->Is32Bit ?
-                                              Context->PrelinkedInfoSection->Section32.Size : Context->PrelinkedInfoSection->Section64.Size),
-                                     TRUE
-                                     );
-  if (Context->PrelinkedInfoDocument == NULL) {
-    PrelinkedContextFree (Context);
-    return EFI_INVALID_PARAMETER;
+  InfoSize = (UINT32)(Context->Is32Bit ?
+                       Context->PrelinkedInfoSection->Section32.Size : Context->PrelinkedInfoSection->Section64.Size);
+
+  //
+  // Prefer indexing kext dictionaries and parsing them on demand.
+  // KXLD state rebasing (10.6.8) rewrites existing dictionaries and requires full parsing.
+  //
+  Start  = OcKernelPhaseStart ();
+  Status = EFI_UNSUPPORTED;
+  if (Context->PrelinkedStateSegment == NULL) {
+    Status = InternalPrelinkedInfoParse (Context, InfoSize);
   }
 
+  if (EFI_ERROR (Status)) {
+    Context->PrelinkedInfoDocument = XmlDocumentParse (Context->PrelinkedInfo, InfoSize, TRUE);
+    if (Context->PrelinkedInfoDocument == NULL) {
+      PrelinkedContextFree (Context);
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  OcKernelPhaseStop (KernelPhaseInfoParse, Start);
+
   //
   // For a kernel collection the this is a full plist, while for legacy prelinked format
   // it starts with a <dict> node.
@@ -407,7 +425,7 @@ PrelinkedContextInit (
     if (AsciiStrCmp (PrelinkedInfoRootKey, PRELINK_INFO_DICTIONARY_KEY) == 0) {
       if (PlistNodeCast (Context->KextList, PLIST_NODE_TYPE_ARRAY) != NULL) {
         if (Context->PrelinkedLastLoadAddress == 0) {
-          Context->PrelinkedLastLoadAddress = PrelinkedFindLastLoadAddress (Context->KextList);
+          Context->PrelinkedLastLoadAddress = PrelinkedFindLastLoadAddress (Context);
         }
 
         if (Context->PrelinkedLastLoadAddress != 0) {
@@ -437,6 +455,8 @@ PrelinkedContextFree (
     Context->PrelinkedInfoDocument = NULL;
   }
 
+  InternalPrelinkedInfoFree (Context);
+
   if (Context->KextScratchBuffer != NULL) {
     FreePool (Context->KextScratchBuffer);
     Context->KextScratchBuffer = NULL;
@@ -480,6 +500,9 @@ PrelinkedContextFree (
   }
 
   ZeroMem (&Context->PrelinkedKexts, sizeof (Context->PrelinkedKexts));
+  InternalHashMapFree (&Context->PrelinkedKextIndex);
+  InternalHashMapFree (&Context->KextListIndex);
+  InternalLinkCacheFree (Context);
 
   //
   // We do not need to iterate InjectedKexts here, as its memory was freed above.
@@ -764,6 +787,7 @@ PrelinkedInjectComplete (
   UINT32      NewSize;
   UINT32      KextsSize;
   UINT32      ChainSize;
+  UINT64      Start;
 
   if (Context->IsKernelCollection) {
     //
@@ -779,7 +803,9 @@ PrelinkedInjectComplete (
     Context->KextsFixupChains->Size      = ChainSize;
     Context->KextsFixupChains->PageCount = (UINT16)(KextsSize / MACHO_PAGE_SIZE);
 
+    Start  = OcKernelPhaseStart ();
     Status = KcRebuildMachHeader (Context);
+    OcKernelPhaseStop (KernelPhaseFixups, Start);
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -793,7 +819,9 @@ PrelinkedInjectComplete (
     }
   }
 
+  Start        = OcKernelPhaseStart ();
   ExportedInfo = XmlDocumentExport (Context->PrelinkedInfoDocument, &ExportedInfoSize, 0, FALSE);
+  OcKernelPhaseStop (KernelPhaseExport, Start);
   if (ExportedInfo == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -983,6 +1011,9 @@ PrelinkedInjectKext (
   UINT64            FileOffset;
   UINT64            LoadAddressOffset;
   CONST CHAR8       *BundleVerStr;
+  BOOLEAN           CacheHit;
+  UINT32            LinkedSize;
+  UINT64            Start;
 
   PrelinkedKext = NULL;
 
@@ -1005,6 +1036,10 @@ PrelinkedInjectKext (
     }
   }
 
+  if (Context->LinkCache != NULL) {
+    InternalLinkCacheUpdateKey (Context, InfoPlist, InfoPlistSize, Executable, ExecutableSize);
+  }
+
   //
   // Copy executable to prelinkedkernel.
   //
@@ -1149,6 +1184,22 @@ PrelinkedInjectKext (
   }
 
   if (Executable != NULL) {
+    //
+    // Cached images have no dynamic linker flag, so linking is skipped for them.
+    //
+    CacheHit = FALSE;
+    if (Context->LinkCache != NULL) {
+      CacheHit = InternalLinkCacheLookup (Context, &Context->Prelinked[KextOffset], ExecutableSize, &LinkedSize);
+      if (  CacheHit
+         && !MachoInitializeContext (&ExecutableContext, &Context->Prelinked[KextOffset], LinkedSize, 0, LinkedSize, Context->Is32Bit))
+      {
+        XmlDocumentFree (InfoPlistDocument);
+        FreePool (TmpInfoPlist);
+        return EFI_INVALID_PARAMETER;
+      }
+    }
+
+    Start         = OcKernelPhaseStart ();
     PrelinkedKext = InternalLinkPrelinkedKext (
                       Context,
                       &ExecutableContext,
@@ -1157,6 +1208,7 @@ PrelinkedInjectKext (
                       KmodAddress,
                       FileOffset
                       );
+    OcKernelPhaseStop (KernelPhaseLink, Start);
 
     if (PrelinkedKext == NULL) {
       XmlDocumentFree (InfoPlistDocument);
@@ -1164,6 +1216,18 @@ PrelinkedInjectKext (
       return EFI_INVALID_PARAMETER;
     }
 
+    //
+    // Save the image before KC rebasing, which is redone on every injection.
+    //
+    if ((Context->LinkCache != NULL) && !CacheHit) {
+      InternalLinkCacheStore (
+        Context,
+        &Context->Prelinked[KextOffset],
+        ExecutableSize,
+        MachoGetFileSize (&PrelinkedKext->Context.MachContext)
+        );
+    }
+
     //
     // XNU assumes that load size and source size are same, so we should append
     // whatever is bigger to all sizes.
@@ -1179,8 +1243,22 @@ PrelinkedInjectKext (
       // Note, we are no longer using ExecutableContext here, as the context
       // ownership was transferred by InternalLinkPrelinkedKext.
       //
-      KcKextIndexFixups (Context, &PrelinkedKext->Context.MachContext);
+      Start  = OcKernelPhaseStart ();
+      Status = KcKextIndexFixups (Context, &PrelinkedKext->Context.MachContext);
+      if (EFI_ERROR (Status)) {
+        OcKernelPhaseStop (KernelPhaseFixups, Start);
+        DEBUG ((
+          DEBUG_WARN,
+          "Failed to index fixups of injected kext %a/%a - %r\n",
+          BundlePath,
+          ExecutablePath,
+          Status
+          ));
+        return Status;
+      }
+
       Status = KcKextApplyFileDelta (Context, &PrelinkedKext->Context.MachContext, KextOffset);
+      OcKernelPhaseStop (KernelPhaseFixups, Start);
       if (EFI_ERROR (Status)) {
         DEBUG ((
           DEBUG_WARN,
@@ -1245,7 +1323,7 @@ PrelinkedInjectKext (
   // Let other kexts depend on this one.
   //
   if (PrelinkedKext != NULL) {
-    InsertTailList (&Context->PrelinkedKexts, &PrelinkedKext->Link);
+    InternalInsertCachedPrelinkedKext (Context, PrelinkedKext);
     //
     // Additionally register this kext in the injected list, as this is required
     // for KernelCollection support.
@@ -1276,7 +1354,9 @@ PrelinkedContextApplyPatch (
     return Status;
   }
 
-  return PatcherApplyGenericPatch (&Patcher, Patch);
+  Status = PatcherApplyGenericPatch (&Patcher, Patch);
+  PatcherFreeContext (&Patcher);
+  return Status;
 }
 
 EFI_STATUS
@@ -1297,7 +1377,9 @@ PrelinkedContextApplyQuirk (
 
   Status = PatcherInitContextFromPrelinked (&Patcher, Context, KernelQuirk->Identifier);
   if (!EFI_ERROR (Status)) {
-    return KernelQuirk->PatchFunction (&Patcher, KernelVersion);
+    Status = KernelQuirk->PatchFunction (&Patcher, KernelVersion);
+    PatcherFreeContext (&Patcher);
+    return Status;
   }
 
   //
@@ -1326,5 +1408,7 @@ PrelinkedContextBlock (
     return Status;
   }
 
-  return Exclude ? PatcherExcludePrelinkedKext (Identifier, &Patcher, Context) : PatcherBlockKext (&Patcher);
+  Status = Exclude ? PatcherExcludePrelinkedKext (Identifier, &Patcher, Context) : PatcherBlockKext (&Patcher);
+  PatcherFreeContext (&Patcher);
+  return Status;
 }
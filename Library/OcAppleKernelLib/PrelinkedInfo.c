@@ -0,0 +1,356 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Base.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcAppleKernelLib.h>
+
+#include "PrelinkedInternal.h"
+
+/**
+  Find kext list array in parsed skeleton.
+
+  @param[in] Context   Prelinked context.
+  @param[in] Document  Parsed skeleton.
+
+  @return  Empty kext list array or NULL.
+**/
+STATIC
+XML_NODE *
+InternalInfoFindKextList (
+  IN CONST PRELINKED_CONTEXT  *Context,
+  IN XML_DOCUMENT             *Document
+  )
+{
+  XML_NODE     *DocumentRoot;
+  XML_NODE     *InfoRoot;
+  XML_NODE     *KextList;
+  CONST CHAR8  *InfoRootKey;
+  UINT32       Index;
+  UINT32       Count;
+
+  if (Context->IsKernelCollection) {
+    DocumentRoot = PlistDocumentRoot (Document);
+  } else {
+    DocumentRoot = XmlDocumentRoot (Document);
+  }
+
+  InfoRoot = PlistNodeCast (DocumentRoot, PLIST_NODE_TYPE_DICT);
+  if (InfoRoot == NULL) {
+    return NULL;
+  }
+
+  Count = PlistDictChildren (InfoRoot);
+  for (Index = 0; Index < Count; ++Index) {
+    InfoRootKey = PlistKeyValue (PlistDictChild (InfoRoot, Index, &KextList));
+    if ((InfoRootKey != NULL) && (AsciiStrCmp (InfoRootKey, PRELINK_INFO_DICTIONARY_KEY) == 0)) {
+      if ((PlistNodeCast (KextList, PLIST_NODE_TYPE_ARRAY) == NULL) || (XmlNodeChildren (KextList) != 0)) {
+        return NULL;
+      }
+
+      return KextList;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Free lazy PrelinkedInfo index.
+
+  @param[in] InfoIndex  Lazy PrelinkedInfo index.
+**/
+STATIC
+VOID
+InternalInfoIndexFree (
+  IN PRELINKED_INFO_INDEX  *InfoIndex
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < InfoIndex->KextCount; ++Index) {
+    if (InfoIndex->Kexts[Index].Document != NULL) {
+      XmlDocumentFree (InfoIndex->Kexts[Index].Document);
+    }
+
+    if (InfoIndex->Kexts[Index].Buffer != NULL) {
+      FreePool (InfoIndex->Kexts[Index].Buffer);
+    }
+  }
+
+  if (InfoIndex->Kexts != NULL) {
+    FreePool (InfoIndex->Kexts);
+  }
+
+  XmlIndexFree (&InfoIndex->XmlIndex);
+
+  if (InfoIndex->Identifiers != NULL) {
+    FreePool (InfoIndex->Identifiers);
+  }
+
+  if (InfoIndex->Skeleton != NULL) {
+    FreePool (InfoIndex->Skeleton);
+  }
+
+  FreePool (InfoIndex);
+}
+
+EFI_STATUS
+InternalPrelinkedInfoParse (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             InfoSize
+  )
+{
+  PRELINKED_INFO_INDEX  *InfoIndex;
+  XML_INDEX             *XmlIndex;
+  XML_DOCUMENT          *Document;
+  XML_NODE              *KextList;
+  CHAR8                 *Info;
+  CHAR8                 *Walker;
+  UINT32                SkeletonSize;
+  UINT32                IdentifiersSize;
+  UINT32                Index;
+
+  ASSERT (Context->PrelinkedInfoDocument == NULL);
+  ASSERT (Context->PrelinkedInfoIndex == NULL);
+
+  Info = Context->PrelinkedInfo;
+
+  InfoIndex = AllocateZeroPool (sizeof (*InfoIndex));
+  if (InfoIndex == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  XmlIndex = &InfoIndex->XmlIndex;
+
+  if (!XmlIndexPlistArray (Info, InfoSize, PRELINK_INFO_DICTIONARY_KEY, INFO_BUNDLE_IDENTIFIER_KEY, XmlIndex)) {
+    FreePool (InfoIndex);
+    return EFI_UNSUPPORTED;
+  }
+
+  if (XmlIndex->DictCount > 0) {
+    InfoIndex->Kexts = AllocateZeroPool (XmlIndex->DictCount * sizeof (*InfoIndex->Kexts));
+    if (InfoIndex->Kexts == NULL) {
+      InternalInfoIndexFree (InfoIndex);
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    InfoIndex->KextCount = XmlIndex->DictCount;
+  }
+
+  //
+  // Copy bundle identifiers, as kext dictionaries are terminated in place.
+  // Match InternalCreatePrelinkedKext, which only checks the first identifier.
+  //
+  IdentifiersSize = 0;
+  for (Index = 0; Index < InfoIndex->KextCount; ++Index) {
+    InfoIndex->Kexts[Index].Contents = XmlIndex->Dicts[Index];
+    if (XmlIndex->Values[Index].Size > 0) {
+      IdentifiersSize += XmlIndex->Values[Index].Size + 1;
+    }
+  }
+
+  if (IdentifiersSize > 0) {
+    InfoIndex->Identifiers = AllocatePool (IdentifiersSize);
+    if (InfoIndex->Identifiers == NULL) {
+      InternalInfoIndexFree (InfoIndex);
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Walker = InfoIndex->Identifiers;
+    for (Index = 0; Index < InfoIndex->KextCount; ++Index) {
+      if (XmlIndex->Values[Index].Size > 0) {
+        CopyMem (Walker, &Info[XmlIndex->Values[Index].Offset], XmlIndex->Values[Index].Size);
+        Walker[XmlIndex->Values[Index].Size] = '\0';
+        InfoIndex->Kexts[Index].Identifier   = Walker;
+        Walker                              += XmlIndex->Values[Index].Size + 1;
+      }
+    }
+  }
+
+  //
+  // Parse the document without kext list contents.
+  //
+  SkeletonSize = InfoSize - (XmlIndex->ArrayEnd - XmlIndex->ArrayStart);
+
+  InfoIndex->Skeleton = AllocatePool (SkeletonSize);
+  if (InfoIndex->Skeleton == NULL) {
+    InternalInfoIndexFree (InfoIndex);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyMem (InfoIndex->Skeleton, Info, XmlIndex->ArrayStart);
+  CopyMem (&InfoIndex->Skeleton[XmlIndex->ArrayStart], &Info[XmlIndex->ArrayEnd], InfoSize - XmlIndex->ArrayEnd);
+
+  Document = XmlDocumentParse (InfoIndex->Skeleton, SkeletonSize, TRUE);
+  if (Document == NULL) {
+    InternalInfoIndexFree (InfoIndex);
+    return EFI_UNSUPPORTED;
+  }
+
+  KextList = InternalInfoFindKextList (Context, Document);
+  if (KextList == NULL) {
+    XmlDocumentFree (Document);
+    InternalInfoIndexFree (InfoIndex);
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Kext dictionaries are kept as raw nodes, which are exported verbatim.
+  //
+  for (Index = 0; Index < InfoIndex->KextCount; ++Index) {
+    if (XmlNodeAppend (KextList, "dict", NULL, &Info[InfoIndex->Kexts[Index].Contents.Offset]) == NULL) {
+      XmlDocumentFree (Document);
+      InternalInfoIndexFree (InfoIndex);
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  for (Index = 0; Index < InfoIndex->KextCount; ++Index) {
+    Info[InfoIndex->Kexts[Index].Contents.Offset + InfoIndex->Kexts[Index].Contents.Size] = '\0';
+  }
+
+  DEBUG ((DEBUG_VERBOSE, "OCAK: Indexed %u prelinked kexts lazily\n", InfoIndex->KextCount));
+
+  Context->PrelinkedInfoDocument = Document;
+  Context->PrelinkedInfoIndex    = InfoIndex;
+  return EFI_SUCCESS;
+}
+
+VOID
+InternalPrelinkedInfoFree (
+  IN OUT PRELINKED_CONTEXT  *Context
+  )
+{
+  if (Context->PrelinkedInfoIndex != NULL) {
+    InternalInfoIndexFree (Context->PrelinkedInfoIndex);
+    Context->PrelinkedInfoIndex = NULL;
+  }
+}
+
+XML_NODE *
+InternalKextListPlist (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             Index
+  )
+{
+  PRELINKED_INFO_INDEX  *InfoIndex;
+  PRELINKED_INFO_KEXT   *Kext;
+  CHAR8                 *Buffer;
+  UINT32                BufferSize;
+
+  ASSERT (Index < XmlNodeChildren (Context->KextList));
+
+  InfoIndex = Context->PrelinkedInfoIndex;
+  if ((InfoIndex == NULL) || (Index >= InfoIndex->KextCount)) {
+    return PlistNodeCast (XmlNodeChild (Context->KextList, Index), PLIST_NODE_TYPE_DICT);
+  }
+
+  Kext = &InfoIndex->Kexts[Index];
+  if (Kext->Document == NULL) {
+    Buffer = XmlIndexExpandDict (&InfoIndex->XmlIndex, Context->PrelinkedInfo, &Kext->Contents, &BufferSize);
+    if (Buffer == NULL) {
+      return NULL;
+    }
+
+    Kext->Document = XmlDocumentParse (Buffer, BufferSize, FALSE);
+    if (Kext->Document == NULL) {
+      FreePool (Buffer);
+      return NULL;
+    }
+
+    Kext->Buffer = Buffer;
+  }
+
+  return PlistNodeCast (XmlDocumentRoot (Kext->Document), PLIST_NODE_TYPE_DICT);
+}
+
+CONST CHAR8 *
+InternalKextListIdentifier (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             Index
+  )
+{
+  XML_NODE     *KextPlist;
+  UINT32       FieldIndex;
+  UINT32       FieldCount;
+  CONST CHAR8  *KextPlistKey;
+  XML_NODE     *KextPlistValue;
+
+  if ((Context->PrelinkedInfoIndex != NULL) && (Index < Context->PrelinkedInfoIndex->KextCount)) {
+    return Context->PrelinkedInfoIndex->Kexts[Index].Identifier;
+  }
+
+  KextPlist = InternalKextListPlist (Context, Index);
+  if (KextPlist == NULL) {
+    return NULL;
+  }
+
+  //
+  // Match InternalCreatePrelinkedKext, which only checks the first identifier.
+  //
+  FieldCount = PlistDictChildren (KextPlist);
+  for (FieldIndex = 0; FieldIndex < FieldCount; ++FieldIndex) {
+    KextPlistKey = PlistKeyValue (PlistDictChild (KextPlist, FieldIndex, &KextPlistValue));
+    if ((KextPlistKey == NULL) || (AsciiStrCmp (KextPlistKey, INFO_BUNDLE_IDENTIFIER_KEY) != 0)) {
+      continue;
+    }
+
+    if (PlistNodeCast (KextPlistValue, PLIST_NODE_TYPE_STRING) == NULL) {
+      return NULL;
+    }
+
+    return XmlNodeContent (KextPlistValue);
+  }
+
+  return NULL;
+}
+
+VOID
+InternalKextListRemove (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             Index
+  )
+{
+  PRELINKED_INFO_INDEX  *InfoIndex;
+
+  //
+  // Identifier index references KextList indices.
+  //
+  InternalHashMapFree (&Context->KextListIndex);
+
+  InfoIndex = Context->PrelinkedInfoIndex;
+  if ((InfoIndex != NULL) && (Index < InfoIndex->KextCount)) {
+    if (InfoIndex->Kexts[Index].Document != NULL) {
+      XmlDocumentFree (InfoIndex->Kexts[Index].Document);
+    }
+
+    if (InfoIndex->Kexts[Index].Buffer != NULL) {
+      FreePool (InfoIndex->Kexts[Index].Buffer);
+    }
+
+    CopyMem (
+      &InfoIndex->Kexts[Index],
+      &InfoIndex->Kexts[Index + 1],
+      (InfoIndex->KextCount - Index - 1) * sizeof (*InfoIndex->Kexts)
+      );
+    --InfoIndex->KextCount;
+  }
+
+  XmlNodeRemoveByIndex (Context->KextList, Index);
+}
@@ -37,6 +37,125 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 //
 extern KERNEL_QUIRK  gKernelQuirks[];
 
+/**
+  Initialise hash map.
+
+  @param[out] Map            Hash map to initialise.
+  @param[in]  ExpectedCount  Number of entries to preallocate for.
+  @param[in]  KeyType        Hash map key type.
+
+  @return  TRUE on success.
+**/
+BOOLEAN
+InternalHashMapInit (
+  OUT OC_HASH_MAP           *Map,
+  IN  UINT32                ExpectedCount,
+  IN  OC_HASH_MAP_KEY_TYPE  KeyType
+  );
+
+/**
+  Free hash map resources. Freed map may be initialised again.
+
+  @param[in,out] Map  Hash map to free.
+**/
+VOID
+InternalHashMapFree (
+  IN OUT OC_HASH_MAP  *Map
+  );
+
+/**
+  Insert entry into hash map with ASCII keys, growing it if necessary.
+  When the key is already present the original value is preserved.
+
+  @param[in,out] Map    Initialised hash map.
+  @param[in]     Key    Null-terminated key, referenced by the map.
+  @param[in]     Value  Entry value, not NULL.
+
+  @return  FALSE when out of resources.
+**/
+BOOLEAN
+InternalHashMapInsert (
+  IN OUT OC_HASH_MAP  *Map,
+  IN     CONST CHAR8  *Key,
+  IN     VOID         *Value
+  );
+
+/**
+  Find entry in hash map with ASCII keys.
+
+  @param[in] Map  Hash map.
+  @param[in] Key  Null-terminated key.
+
+  @return  Entry value or NULL when missing.
+**/
+VOID *
+InternalHashMapFind (
+  IN CONST OC_HASH_MAP  *Map,
+  IN CONST CHAR8        *Key
+  );
+
+/**
+  Insert entry into hash map with Unicode keys, growing it if necessary.
+  When the key is already present the original value is preserved.
+
+  @param[in,out] Map    Initialised hash map.
+  @param[in]     Key    Null-terminated key, referenced by the map.
+  @param[in]     Value  Entry value, not NULL.
+
+  @return  FALSE when out of resources.
+**/
+BOOLEAN
+InternalHashMapInsertUnicode (
+  IN OUT OC_HASH_MAP   *Map,
+  IN     CONST CHAR16  *Key,
+  IN     VOID          *Value
+  );
+
+/**
+  Find entry in hash map with Unicode keys.
+
+  @param[in] Map  Hash map.
+  @param[in] Key  Null-terminated key.
+
+  @return  Entry value or NULL when missing.
+**/
+VOID *
+InternalHashMapFindUnicode (
+  IN CONST OC_HASH_MAP  *Map,
+  IN CONST CHAR16       *Key
+  );
+
+/**
+  Insert entry into hash map with numeric keys, growing it if necessary.
+  When the key is already present the original value is preserved.
+
+  @param[in,out] Map    Initialised hash map.
+  @param[in]     Key    Numeric key.
+  @param[in]     Value  Entry value, not NULL.
+
+  @return  FALSE when out of resources.
+**/
+BOOLEAN
+InternalHashMapInsertNumeric (
+  IN OUT OC_HASH_MAP  *Map,
+  IN     UINT64       Key,
+  IN     VOID         *Value
+  );
+
+/**
+  Find entry in hash map with numeric keys.
+
+  @param[in] Map  Hash map.
+  @param[in] Key  Numeric key.
+
+  @return  Entry value or NULL when missing.
+**/
+VOID *
+InternalHashMapFindNumeric (
+  IN CONST OC_HASH_MAP  *Map,
+  IN UINT64             Key
+  );
+
 typedef struct PRELINKED_KEXT_ PRELINKED_KEXT;
 
 typedef struct {
@@ -127,6 +246,16 @@ struct PRELINKED_KEXT_ {
   //
   PRELINKED_KEXT_SYMBOL       *LinkedSymbolTable;
   //
+  // Name indices of LinkedSymbolTable for non-C++ symbols and for C++ symbols.
+  // Not initialised (NULL Entries) when indexing failed and linear lookup is used.
+  //
+  OC_HASH_MAP                 LinkedSymbolNames;
+  OC_HASH_MAP                 LinkedCxxSymbolNames;
+  //
+  // Value index of LinkedSymbolTable C++ symbols.
+  //
+  OC_HASH_MAP                 LinkedCxxSymbolValues;
+  //
   // A flag set during dependency walk BFS to avoid going through the same path.
   //
   BOOLEAN                     Processed;
@@ -138,6 +267,10 @@ struct PRELINKED_KEXT_ {
   // Scanned vtable buffer. Iterated with GET_NEXT_PRELINKED_VTABLE.
   //
   PRELINKED_VTABLE            *LinkedVtables;
+  //
+  // Name index of LinkedVtables.
+  //
+  OC_HASH_MAP                 LinkedVtableNames;
 };
 
 //
@@ -188,6 +321,15 @@ InternalFreePrelinkedKext (
   IN PRELINKED_KEXT  *Kext
   );
 
+/**
+  Adds PRELINKED_KEXT to PRELINKED_CONTEXT cache.
+**/
+VOID
+InternalInsertCachedPrelinkedKext (
+  IN OUT PRELINKED_CONTEXT  *Prelinked,
+  IN OUT PRELINKED_KEXT     *Kext
+  );
+
 /**
   Gets cached PRELINKED_KEXT from PRELINKED_CONTEXT.
 **/
@@ -391,6 +533,21 @@ InternalGetOcVtableByName (
   IN CONST CHAR8        *Name
   );
 
+/**
+  Build name index of kext vtables. The index is optional and is not
+  created when out of resources.
+
+  @param[in,out] Kext        Kext to index vtables for.
+  @param[in]     Vtables     Vtable buffer.
+  @param[in]     NumVtables  Number of vtables in the buffer.
+**/
+VOID
+InternalBuildVtableIndex (
+  IN OUT PRELINKED_KEXT          *Kext,
+  IN     CONST PRELINKED_VTABLE  *Vtables,
+  IN     UINT32                  NumVtables
+  );
+
 //
 // Prelink
 //
@@ -406,6 +563,27 @@ typedef enum {
   OcGetSymbolOnlyCxx
 } OC_GET_SYMBOL_LEVEL;
 
+/**
+  Build name and value indices for a constructed LinkedSymbolTable.
+  Failure is not fatal, symbol lookup falls back to linear search.
+
+  @param[in,out] Kext  KEXT with LinkedSymbolTable.
+**/
+VOID
+InternalBuildLinkedSymbolIndex (
+  IN OUT PRELINKED_KEXT  *Kext
+  );
+
+/**
+  Free name and value indices of LinkedSymbolTable.
+
+  @param[in,out] Kext  KEXT with LinkedSymbolTable.
+**/
+VOID
+InternalFreeLinkedSymbolIndex (
+  IN OUT PRELINKED_KEXT  *Kext
+  );
+
 CONST PRELINKED_KEXT_SYMBOL *
 InternalOcGetSymbolName (
   IN PRELINKED_CONTEXT    *Context,
@@ -509,4 +687,196 @@ InternalKxldSolveSymbol (
   IN CONST CHAR8  *Name
   );
 
+/**
+  Index KXLD state symbols by name.
+
+  @param[in]     Is32Bit         KXLD is 32-bit.
+  @param[in]     KxldState       KXLD state.
+  @param[in]     KxldStateSize   KXLD state size.
+  @param[in,out] Map             Initialised hash map receiving symbol entries
+                                 (KXLD_SYM_ENTRY_ANY) by name.
+  @param[out]    NumVisited      Number of indexed symbols.
+
+  @retval EFI_SUCCESS on success.
+**/
+EFI_STATUS
+InternalKxldIndexSymbols (
+  IN     BOOLEAN      Is32Bit,
+  IN     CONST VOID   *KxldState,
+  IN     UINT32       KxldStateSize,
+  IN OUT OC_HASH_MAP  *Map,
+  OUT    UINT32       *NumVisited
+  );
+
+/**
+  Advance linked kext cache key to the kext being injected.
+  Layout values are included to make linked images position-dependent.
+
+  @param[in,out] Context         Prelinked context with linked kext cache.
+  @param[in]     InfoPlist       Kext Info.plist.
+  @param[in]     InfoPlistSize   Kext Info.plist size.
+  @param[in]     Executable      Kext executable, optional.
+  @param[in]     ExecutableSize  Kext executable size, optional.
+**/
+VOID
+InternalLinkCacheUpdateKey (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CONST CHAR8        *InfoPlist,
+  IN     UINT32             InfoPlistSize,
+  IN     CONST UINT8        *Executable OPTIONAL,
+  IN     UINT32             ExecutableSize
+  );
+
+/**
+  Lookup linked image of the kext being injected and copy it in place.
+
+  @param[in,out] Context     Prelinked context with linked kext cache.
+  @param[out]    Image       Expanded kext image to overwrite.
+  @param[in]     ImageSize   Expanded kext image size.
+  @param[out]    LinkedSize  Linked Mach-O size.
+
+  @return  TRUE when the image was found and copied.
+**/
+BOOLEAN
+InternalLinkCacheLookup (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  OUT    UINT8              *Image,
+  IN     UINT32             ImageSize,
+  OUT    UINT32             *LinkedSize
+  );
+
+/**
+  Store linked image of the kext being injected.
+
+  @param[in,out] Context     Prelinked context with linked kext cache.
+  @param[in]     Image       Linked kext image.
+  @param[in]     ImageSize   Linked kext image size, same as expanded size.
+  @param[in]     LinkedSize  Linked Mach-O size.
+**/
+VOID
+InternalLinkCacheStore (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CONST UINT8        *Image,
+  IN     UINT32             ImageSize,
+  IN     UINT32             LinkedSize
+  );
+
+/**
+  Free linked kext cache resources.
+
+  @param[in,out] Context  Prelinked context.
+**/
+VOID
+InternalLinkCacheFree (
+  IN OUT PRELINKED_CONTEXT  *Context
+  );
+
+/**
+  Lazily parsed kext dictionary of PRELINK_INFO_DICTIONARY_KEY.
+**/
+typedef struct {
+  //
+  // Dictionary contents in PrelinkedInfo.
+  //
+  XML_SPAN        Contents;
+  //
+  // First bundle identifier, NULL when missing.
+  //
+  CONST CHAR8     *Identifier;
+  //
+  // Parsed dictionary with expanded references, NULL until first access.
+  //
+  XML_DOCUMENT    *Document;
+  //
+  // Buffer backing Document.
+  //
+  CHAR8           *Buffer;
+} PRELINKED_INFO_KEXT;
+
+struct PRELINKED_INFO_INDEX_ {
+  //
+  // PrelinkedInfo copy without kext dictionaries backing PrelinkedInfoDocument.
+  //
+  CHAR8                  *Skeleton;
+  //
+  // Null-terminated bundle identifiers of Kexts.
+  //
+  CHAR8                  *Identifiers;
+  //
+  // Kext dictionaries matching first KextCount KextList entries.
+  //
+  PRELINKED_INFO_KEXT    *Kexts;
+  UINT32                 KextCount;
+  //
+  // Offset index of PrelinkedInfo used for reference expansion.
+  //
+  XML_INDEX              XmlIndex;
+};
+
+/**
+  Parse PrelinkedInfo lazily. Only the document skeleton is parsed,
+  while kext dictionaries are indexed and kept as raw KextList nodes.
+  On failure the context is unchanged and PrelinkedInfo may be parsed in full.
+
+  @param[in,out] Context   Prelinked context with PrelinkedInfo.
+  @param[in]     InfoSize  PrelinkedInfo size.
+
+  @retval EFI_SUCCESS on success.
+**/
+EFI_STATUS
+InternalPrelinkedInfoParse (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             InfoSize
+  );
+
+/**
+  Free lazy PrelinkedInfo parsing resources.
+
+  @param[in,out] Context  Prelinked context.
+**/
+VOID
+InternalPrelinkedInfoFree (
+  IN OUT PRELINKED_CONTEXT  *Context
+  );
+
+/**
+  Get KextList plist dictionary, parsing it when necessary.
+
+  @param[in,out] Context  Prelinked context.
+  @param[in]     Index    KextList index.
+
+  @return  Plist dictionary or NULL.
+**/
+XML_NODE *
+InternalKextListPlist (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             Index
+  );
+
+/**
+  Get first bundle identifier of KextList plist dictionary.
+
+  @param[in,out] Context  Prelinked context.
+  @param[in]     Index    KextList index.
+
+  @return  Bundle identifier or NULL.
+**/
+CONST CHAR8 *
+InternalKextListIdentifier (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             Index
+  );
+
+/**
+  Remove KextList plist dictionary.
+
+  @param[in,out] Context  Prelinked context.
+  @param[in]     Index    KextList index.
+**/
+VOID
+InternalKextListRemove (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             Index
+  );
+
 #endif // PRELINKED_INTERNAL_H
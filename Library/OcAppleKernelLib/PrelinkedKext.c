@@ -472,6 +472,8 @@ InternalScanBuildLinkedSymbolTable (
   Kext->NumberOfCxxSymbols = NumCxxSymbols;
   Kext->LinkedSymbolTable  = SymbolTable;
 
+  InternalBuildLinkedSymbolIndex (Kext);
+
   return EFI_SUCCESS;
 }
 
@@ -684,18 +686,106 @@ InternalFreePrelinkedKext (
   )
 {
   if (Kext->LinkedSymbolTable != NULL) {
+    InternalFreeLinkedSymbolIndex (Kext);
     FreePool (Kext->LinkedSymbolTable);
     Kext->LinkedSymbolTable = NULL;
   }
 
   if (Kext->LinkedVtables != NULL) {
+    InternalHashMapFree (&Kext->LinkedVtableNames);
     FreePool (Kext->LinkedVtables);
     Kext->LinkedVtables = NULL;
   }
 
+  PatcherFreeContext (&Kext->Context);
+
   FreePool (Kext);
 }
 
+VOID
+InternalInsertCachedPrelinkedKext (
+  IN OUT PRELINKED_CONTEXT  *Prelinked,
+  IN OUT PRELINKED_KEXT     *Kext
+  )
+{
+  InsertTailList (&Prelinked->PrelinkedKexts, &Kext->Link);
+
+  if (  (Prelinked->PrelinkedKextIndex.Entries != NULL)
+     && !InternalHashMapInsert (&Prelinked->PrelinkedKextIndex, Kext->Identifier, Kext))
+  {
+    //
+    // Fallback to walking the list.
+    //
+    InternalHashMapFree (&Prelinked->PrelinkedKextIndex);
+  }
+}
+
+/**
+  Rebuild bundle identifier index of cached PRELINKED_KEXT entries.
+
+  @param[in,out] Prelinked  Prelinked context.
+**/
+STATIC
+VOID
+InternalRebuildPrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Prelinked
+  )
+{
+  LIST_ENTRY      *Link;
+  PRELINKED_KEXT  *Kext;
+
+  InternalHashMapFree (&Prelinked->PrelinkedKextIndex);
+  if (!InternalHashMapInit (&Prelinked->PrelinkedKextIndex, 0, OcHashMapKeyAscii)) {
+    return;
+  }
+
+  Link = GetFirstNode (&Prelinked->PrelinkedKexts);
+  while (!IsNull (&Prelinked->PrelinkedKexts, Link)) {
+    Kext = GET_PRELINKED_KEXT_FROM_LINK (Link);
+    if (!InternalHashMapInsert (&Prelinked->PrelinkedKextIndex, Kext->Identifier, Kext)) {
+      InternalHashMapFree (&Prelinked->PrelinkedKextIndex);
+      return;
+    }
+
+    Link = GetNextNode (&Prelinked->PrelinkedKexts, Link);
+  }
+}
+
+/**
+  Build bundle identifier index of KextList plist dictionaries.
+
+  @param[in,out] Prelinked  Prelinked context.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalBuildKextListIndex (
+  IN OUT PRELINKED_CONTEXT  *Prelinked
+  )
+{
+  UINT32       Index;
+  UINT32       KextCount;
+  CONST CHAR8  *KextIdentifier;
+
+  KextCount = XmlNodeChildren (Prelinked->KextList);
+  if (!InternalHashMapInit (&Prelinked->KextListIndex, KextCount, OcHashMapKeyAscii)) {
+    return FALSE;
+  }
+
+  for (Index = 0; Index < KextCount; ++Index) {
+    KextIdentifier = InternalKextListIdentifier (Prelinked, Index);
+    if (  (KextIdentifier != NULL)
+       && !InternalHashMapInsert (&Prelinked->KextListIndex, KextIdentifier, (VOID *)(UINTN)(Index + 1)))
+    {
+      InternalHashMapFree (&Prelinked->KextListIndex);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
 PRELINKED_KEXT *
 InternalCachedPrelinkedKext (
   IN OUT PRELINKED_CONTEXT  *Prelinked,
@@ -711,30 +801,47 @@ InternalCachedPrelinkedKext (
   //
   // Find cached entry if any.
   //
-  Kext = GetFirstNode (&Prelinked->PrelinkedKexts);
-  while (!IsNull (&Prelinked->PrelinkedKexts, Kext)) {
-    if (AsciiStrCmp (Identifier, GET_PRELINKED_KEXT_FROM_LINK (Kext)->Identifier) == 0) {
-      return GET_PRELINKED_KEXT_FROM_LINK (Kext);
+  if (Prelinked->PrelinkedKextIndex.Entries != NULL) {
+    NewKext = InternalHashMapFind (&Prelinked->PrelinkedKextIndex, Identifier);
+    if (NewKext != NULL) {
+      return NewKext;
     }
+  } else {
+    Kext = GetFirstNode (&Prelinked->PrelinkedKexts);
+    while (!IsNull (&Prelinked->PrelinkedKexts, Kext)) {
+      if (AsciiStrCmp (Identifier, GET_PRELINKED_KEXT_FROM_LINK (Kext)->Identifier) == 0) {
+        return GET_PRELINKED_KEXT_FROM_LINK (Kext);
+      }
 
-    Kext = GetNextNode (&Prelinked->PrelinkedKexts, Kext);
+      Kext = GetNextNode (&Prelinked->PrelinkedKexts, Kext);
+    }
   }
 
   //
   // Try with real entry.
   //
-  NewKext   = NULL;
-  KextCount = XmlNodeChildren (Prelinked->KextList);
-  for (Index = 0; Index < KextCount; ++Index) {
-    KextPlist = PlistNodeCast (XmlNodeChild (Prelinked->KextList, Index), PLIST_NODE_TYPE_DICT);
-
-    if (KextPlist == NULL) {
-      continue;
+  NewKext = NULL;
+  if ((Prelinked->KextListIndex.Entries != NULL) || InternalBuildKextListIndex (Prelinked)) {
+    Index = (UINT32)(UINTN)InternalHashMapFind (&Prelinked->KextListIndex, Identifier);
+    if (Index != 0) {
+      KextPlist = InternalKextListPlist (Prelinked, Index - 1);
+      if (KextPlist != NULL) {
+        NewKext = InternalCreatePrelinkedKext (Prelinked, KextPlist, Identifier, Prelinked->Is32Bit);
+      }
     }
+  } else {
+    KextCount = XmlNodeChildren (Prelinked->KextList);
+    for (Index = 0; Index < KextCount; ++Index) {
+      KextPlist = InternalKextListPlist (Prelinked, Index);
 
-    NewKext = InternalCreatePrelinkedKext (Prelinked, KextPlist, Identifier, Prelinked->Is32Bit);
-    if (NewKext != NULL) {
-      break;
+      if (KextPlist == NULL) {
+        continue;
+      }
+
+      NewKext = InternalCreatePrelinkedKext (Prelinked, KextPlist, Identifier, Prelinked->Is32Bit);
+      if (NewKext != NULL) {
+        break;
+      }
     }
   }
 
@@ -742,7 +849,7 @@ InternalCachedPrelinkedKext (
     return NULL;
   }
 
-  InsertTailList (&Prelinked->PrelinkedKexts, &NewKext->Link);
+  InternalInsertCachedPrelinkedKext (Prelinked, NewKext);
 
   return NewKext;
 }
@@ -788,6 +895,7 @@ InternalDropCachedPrelinkedKext (
     ));
 
   RemoveEntryList (Link);
+  InternalRebuildPrelinkedKextIndex (Prelinked);
   InternalFreePrelinkedKext (Kext);
 
   return EFI_SUCCESS;
@@ -937,7 +1045,7 @@ InternalCachedPrelinkedKernel (
     }
   }
 
-  InsertTailList (&Prelinked->PrelinkedKexts, &NewKext->Link);
+  InternalInsertCachedPrelinkedKext (Prelinked, NewKext);
 
   return NewKext;
 }
@@ -1225,6 +1333,7 @@ InternalLinkPrelinkedKext (
   // yet it was prone to errors and was already removed once.
   //
   if (Kext->LinkedVtables != NULL) {
+    InternalHashMapFree (&Kext->LinkedVtableNames);
     FreePool (Kext->LinkedVtables);
     Kext->LinkedVtables   = NULL;
     Kext->NumberOfVtables = 0;
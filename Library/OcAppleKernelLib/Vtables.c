@@ -40,16 +40,23 @@ InternalGetOcVtableByNameWorker (
 
   Kext->Processed = TRUE;
 
-  for (
-       Index = 0, Vtable = Kext->LinkedVtables;
-       Index < Kext->NumberOfVtables;
-       ++Index, Vtable = GET_NEXT_PRELINKED_VTABLE (Vtable)
-       )
-  {
-    Result = AsciiStrCmp (Vtable->Name, Name);
-    if (Result == 0) {
+  if (Kext->LinkedVtableNames.Entries != NULL) {
+    Vtable = InternalHashMapFind (&Kext->LinkedVtableNames, Name);
+    if (Vtable != NULL) {
       return Vtable;
     }
+  } else {
+    for (
+         Index = 0, Vtable = Kext->LinkedVtables;
+         Index < Kext->NumberOfVtables;
+         ++Index, Vtable = GET_NEXT_PRELINKED_VTABLE (Vtable)
+         )
+    {
+      Result = AsciiStrCmp (Vtable->Name, Name);
+      if (Result == 0) {
+        return Vtable;
+      }
+    }
   }
 
   for (Index = 0; Index < ARRAY_SIZE (Kext->Dependencies); ++Index) {
@@ -87,6 +94,49 @@ InternalGetOcVtableByName (
   return Vtable;
 }
 
+/**
+  Add vtable to kext vtable name index, dropping the index when out of resources.
+
+  @param[in,out] Kext    Kext owning the vtable.
+  @param[in]     Vtable  Vtable to add.
+**/
+STATIC
+VOID
+InternalIndexVtable (
+  IN OUT PRELINKED_KEXT          *Kext,
+  IN     CONST PRELINKED_VTABLE  *Vtable
+  )
+{
+  if (  (Kext->LinkedVtableNames.Entries != NULL)
+     && !InternalHashMapInsert (&Kext->LinkedVtableNames, Vtable->Name, (VOID *)Vtable))
+  {
+    InternalHashMapFree (&Kext->LinkedVtableNames);
+  }
+}
+
+VOID
+InternalBuildVtableIndex (
+  IN OUT PRELINKED_KEXT          *Kext,
+  IN     CONST PRELINKED_VTABLE  *Vtables,
+  IN     UINT32                  NumVtables
+  )
+{
+  UINT32  Index;
+
+  ASSERT (Kext != NULL);
+
+  InternalHashMapFree (&Kext->LinkedVtableNames);
+
+  if (!InternalHashMapInit (&Kext->LinkedVtableNames, NumVtables, OcHashMapKeyAscii)) {
+    return;
+  }
+
+  for (Index = 0; Index < NumVtables; ++Index) {
+    InternalIndexVtable (Kext, Vtables);
+    Vtables = GET_NEXT_PRELINKED_VTABLE (Vtables);
+  }
+}
+
 STATIC
 VOID
 InternalConstructVtablePrelinked (
@@ -244,6 +294,9 @@ InternalCreateVtablesPrelinked (
 
   ASSERT (Kext != NULL);
 
+  InternalHashMapFree (&Kext->LinkedVtableNames);
+  InternalHashMapInit (&Kext->LinkedVtableNames, NumVtables, OcHashMapKeyAscii);
+
   for (Index = 0; Index < NumVtables; ++Index) {
     InternalConstructVtablePrelinked (
       Context,
@@ -251,6 +304,7 @@ InternalCreateVtablesPrelinked (
       &VtableLookups[Index],
       VtableBuffer
       );
+    InternalIndexVtable (Kext, VtableBuffer);
     VtableBuffer = GET_NEXT_PRELINKED_VTABLE (VtableBuffer);
   }
 }
@@ -611,6 +665,7 @@ InternalPatchByVtables (
   CHAR8                   FinalSymbolName[SYM_MAX_NAME_LEN];
   BOOLEAN                 SuccessfulIteration;
   PRELINKED_VTABLE        *CurrentVtable;
+  PRELINKED_VTABLE        *ClassVtable;
 
   //
   // LinkBuffer is at least as big as __LINKEDIT, so it can store all symbols.
@@ -706,6 +761,12 @@ InternalPatchByVtables (
     return FALSE;
   }
 
+  //
+  // Vtables are indexed as they are patched, as later classes may inherit from them.
+  //
+  InternalHashMapFree (&Kext->LinkedVtableNames);
+  InternalHashMapInit (&Kext->LinkedVtableNames, NumTables * 2, OcHashMapKeyAscii);
+
   CurrentVtable = Kext->LinkedVtables;
   //
   // Patch via the previously retrieved SMCPs.
@@ -842,6 +903,8 @@ InternalPatchByVtables (
       //
       // Patch the class's vtable
       //
+      ClassVtable = CurrentVtable;
+
       Result = InternalInitializeVtableByEntriesAndRelocations (
                  Context,
                  Kext,
@@ -918,6 +981,9 @@ InternalPatchByVtables (
 
       Kext->NumberOfVtables += 2;
 
+      InternalIndexVtable (Kext, ClassVtable);
+      InternalIndexVtable (Kext, GET_NEXT_PRELINKED_VTABLE (ClassVtable));
+
       EntryWalker->Smcp = NULL;
 
       ++NumPatched;
@@ -102,6 +102,7 @@ typedef struct {
   EFI_DEVICE_PATH_PROTOCOL       *DevicePath;
   OC_APPLE_DISK_IMAGE_CONTEXT    *DmgContext;
   EFI_HANDLE                     BlockIoHandle;
+  EFI_EVENT                      VerifyEvent;
 } INTERNAL_DMG_LOAD_CONTEXT;
 
 typedef struct {
@@ -107,6 +107,44 @@ InternalGetFirstDeviceBootFilePath (
   return BootDevicePath;
 }
 
+/**
+  Close DMG verification event if any.
+
+  @param[in,out] Context  DMG load context.
+**/
+STATIC
+VOID
+InternalCloseDmgVerifyEvent (
+  IN OUT INTERNAL_DMG_LOAD_CONTEXT  *Context
+  )
+{
+  if (Context->VerifyEvent != NULL) {
+    gBS->CloseEvent (Context->VerifyEvent);
+    Context->VerifyEvent = NULL;
+  }
+}
+
+/**
+  Verify DMG data not read through Block I/O before the RAM disk is handed
+  over to the operating system.
+
+  @param[in] Event    Exit boot services event.
+  @param[in] Context  DMG context.
+**/
+STATIC
+VOID
+EFIAPI
+InternalDmgExitBootServicesHandler (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  //
+  // Data is wiped on failure, so the operating system cannot use it.
+  //
+  OcAppleDiskImageVerifyRemaining (Context);
+}
+
 STATIC
 EFI_DEVICE_PATH_PROTOCOL *
 InternalGetDiskImageBootFile (
@@ -119,6 +157,7 @@ InternalGetDiskImageBootFile (
 {
   EFI_DEVICE_PATH_PROTOCOL  *DevPath;
 
+  EFI_STATUS                  Status;
   BOOLEAN                     Result;
   OC_APPLE_CHUNKLIST_CONTEXT  ChunklistContext;
 
@@ -128,6 +167,8 @@ InternalGetDiskImageBootFile (
   ASSERT (Context != NULL);
   ASSERT (DmgFileSize > 0);
 
+  Context->VerifyEvent = NULL;
+
   if (DmgLoading == OcDmgLoadingAppleSigned) {
     if (ChunklistBuffer == NULL) {
       DEBUG ((DEBUG_WARN, "OCB: Missing DMG signature, aborting\n"));
@@ -169,7 +210,11 @@ InternalGetDiskImageBootFile (
       return NULL;
     }
 
-    Result = OcAppleDiskImageVerifyData (
+    //
+    // Chunks are verified on first read, the rest before the operating system
+    // takes over the RAM disk.
+    //
+    Result = OcAppleDiskImageVerifyDataLazy (
                Context->DmgContext,
                &ChunklistContext
                );
@@ -177,8 +222,26 @@ InternalGetDiskImageBootFile (
       DEBUG ((DEBUG_WARN, "OCB: DMG has been altered\n"));
       return NULL;
     }
+
+    Status = gBS->CreateEvent (
+                    EVT_SIGNAL_EXIT_BOOT_SERVICES,
+                    TPL_CALLBACK,
+                    InternalDmgExitBootServicesHandler,
+                    Context->DmgContext,
+                    &Context->VerifyEvent
+                    );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_WARN, "OCB: Failed to create DMG verification event - %r\n", Status));
+      return NULL;
+    }
   }
 
+  OcAppleDiskImageSetReadAhead (
+    Context->DmgContext,
+    OC_APPLE_DISK_IMAGE_DEFAULT_READ_AHEAD,
+    TRUE
+    );
+
   Context->BlockIoHandle = OcAppleDiskImageInstallBlockIo (
                              Context->DmgContext,
                              DmgFileSize,
@@ -187,6 +250,7 @@ InternalGetDiskImageBootFile (
                              );
   if (Context->BlockIoHandle == NULL) {
     DEBUG ((DEBUG_INFO, "OCB: Failed to install DMG Block I/O\n"));
+    InternalCloseDmgVerifyEvent (Context);
     return NULL;
   }
 
@@ -201,6 +265,7 @@ InternalGetDiskImageBootFile (
       Context->DmgContext,
       Context->BlockIoHandle
       );
+    InternalCloseDmgVerifyEvent (Context);
     return NULL;
   }
 
@@ -507,6 +572,7 @@ InternalUnloadDmg (
       DmgLoadContext->DmgContext,
       DmgLoadContext->BlockIoHandle
       );
+    InternalCloseDmgVerifyEvent (DmgLoadContext);
     OcAppleDiskImageFreeContext (DmgLoadContext->DmgContext);
     FreePool (DmgLoadContext->DmgContext);
     DmgLoadContext->DevicePath = NULL;
@@ -12,6 +12,7 @@
   WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 **/
 
+#include <Library/BaseMemoryLib.h>
 #include <Library/OcCompressionLib.h>
 
 UINT32
@@ -138,3 +139,85 @@ DecompressMaskedRLE24 (
 
   return MaskLen * sizeof (UINT32);
 }
+
+UINTN
+DecompressADC (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  )
+{
+  //
+  // Apple Data Compression is a simple LZ77 variant with three opcodes:
+  //  1. 1LLLLLLL - literal run of L + 1 bytes.
+  //  2. 01LLLLLL DDDDDDDD DDDDDDDD - L + 4 bytes at distance D + 1.
+  //  3. 00LLLLDD DDDDDDDD - L + 3 bytes at distance D + 1.
+  //
+
+  CONST UINT8  *SrcEnd;
+  UINT8        *DstCur;
+  UINT8        *DstEnd;
+  UINT8        Control;
+  UINTN        Length;
+  UINTN        Distance;
+
+  if ((SrcLen > OC_COMPRESSION_MAX_LENGTH) || (DstLen > OC_COMPRESSION_MAX_LENGTH)) {
+    return 0;
+  }
+
+  SrcEnd = Src + SrcLen;
+  DstCur = Dst;
+  DstEnd = Dst + DstLen;
+
+  while (Src < SrcEnd) {
+    Control = *Src++;
+
+    if ((Control & BIT7) != 0) {
+      Length = (UINTN)(Control & 0x7FU) + 1;
+      if (((UINTN)(SrcEnd - Src) < Length) || ((UINTN)(DstEnd - DstCur) < Length)) {
+        return 0;
+      }
+
+      CopyMem (DstCur, Src, Length);
+      Src    += Length;
+      DstCur += Length;
+      continue;
+    }
+
+    if ((Control & BIT6) != 0) {
+      if ((SrcEnd - Src) < 2) {
+        return 0;
+      }
+
+      Length   = (UINTN)(Control & 0x3FU) + 4;
+      Distance = ((UINTN)Src[0] << 8U) | Src[1];
+      Src     += 2;
+    } else {
+      if ((SrcEnd - Src) < 1) {
+        return 0;
+      }
+
+      Length   = (UINTN)((Control >> 2U) & 0x0FU) + 3;
+      Distance = ((UINTN)(Control & 0x03U) << 8U) | Src[0];
+      Src     += 1;
+    }
+
+    ++Distance;
+
+    if (((UINTN)(DstCur - Dst) < Distance) || ((UINTN)(DstEnd - DstCur) < Length)) {
+      return 0;
+    }
+
+    //
+    // References may overlap the output, copy bytewise.
+    //
+    while (Length > 0) {
+      *DstCur = DstCur[-(INTN)Distance];
+      ++DstCur;
+      --Length;
+    }
+  }
+
+  return (UINTN)(DstCur - Dst);
+}
@@ -0,0 +1,710 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcCompressionLib.h>
+
+//
+// Stream and block format constants, see bzip2 1.0.8 documentation.
+//
+#define BZIP2_BLOCK_SIZE_UNIT  100000U
+#define BZIP2_BLOCK_MAGIC_HI   0x314159U
+#define BZIP2_BLOCK_MAGIC_LO   0x265359U
+#define BZIP2_END_MAGIC_HI     0x177245U
+#define BZIP2_END_MAGIC_LO     0x385090U
+#define BZIP2_MIN_GROUPS       2U
+#define BZIP2_MAX_GROUPS       6U
+#define BZIP2_GROUP_SIZE       50U
+#define BZIP2_MAX_SELECTORS    18002U
+#define BZIP2_MAX_ALPHA_SIZE   258U
+#define BZIP2_MAX_CODE_LENGTH  20U
+#define BZIP2_SYMBOL_RUNA      0U
+#define BZIP2_SYMBOL_RUNB      1U
+#define BZIP2_CRC_POLYNOMIAL   0x04C11DB7U
+#define BZIP2_INVALID_SYMBOL   MAX_UINT32
+
+//
+// Codes up to this length are decoded with a single table lookup.
+//
+#define BZIP2_LOOKUP_BITS  9U
+
+//
+// Lookup entries pack symbol and code length.
+//
+#define BZIP2_LOOKUP_LENGTH_MASK   0x1FU
+#define BZIP2_LOOKUP_SYMBOL_SHIFT  5U
+
+typedef struct {
+  UINT16    Lookup[1U << BZIP2_LOOKUP_BITS];
+  UINT32    First[BZIP2_MAX_CODE_LENGTH + 1];
+  UINT32    Limit[BZIP2_MAX_CODE_LENGTH + 1];
+  UINT32    Offset[BZIP2_MAX_CODE_LENGTH + 1];
+  UINT16    Symbols[BZIP2_MAX_ALPHA_SIZE];
+  UINT32    MinLength;
+  UINT32    MaxLength;
+} BZIP2_HUFFMAN_TABLE;
+
+typedef struct {
+  //
+  // Input bit reader, most significant bit first.
+  //
+  CONST UINT8            *Src;
+  CONST UINT8            *SrcEnd;
+  UINT64                 Bits;
+  UINT32                 BitCount;
+  UINT32                 PadBits;
+  //
+  // Per-block state.
+  //
+  UINT32                 *Tt;
+  UINT32                 TtSize;
+  UINT32                 InUseCount;
+  UINT32                 SelectorCount;
+  UINT32                 Counts[256];
+  UINT8                  SeqToUnseq[256];
+  UINT8                  Selectors[BZIP2_MAX_SELECTORS];
+  BZIP2_HUFFMAN_TABLE    Tables[BZIP2_MAX_GROUPS];
+  UINT32                 CrcTable[256];
+} BZIP2_DECODER;
+
+/**
+  Ensure bit reader holds at least 57 bits.
+  Missing input is replaced with zero bits, which are tracked to detect overruns.
+
+  @param[in,out]  Decoder  Decoder context.
+**/
+STATIC
+VOID
+InternalBzip2Refill (
+  IN OUT BZIP2_DECODER  *Decoder
+  )
+{
+  while (Decoder->BitCount <= 56) {
+    if (Decoder->Src < Decoder->SrcEnd) {
+      Decoder->Bits |= LShiftU64 (*Decoder->Src, 56 - Decoder->BitCount);
+      ++Decoder->Src;
+    } else {
+      Decoder->PadBits += 8;
+    }
+
+    Decoder->BitCount += 8;
+  }
+}
+
+/**
+  Read bits from the input.
+
+  @param[in,out]  Decoder  Decoder context.
+  @param[in]      Count    Number of bits to read, 1 to 32.
+
+  @return  Read bits.
+**/
+STATIC
+UINT32
+InternalBzip2GetBits (
+  IN OUT BZIP2_DECODER  *Decoder,
+  IN     UINT32         Count
+  )
+{
+  UINT32  Value;
+
+  if (Decoder->BitCount < Count) {
+    InternalBzip2Refill (Decoder);
+  }
+
+  Value              = (UINT32)RShiftU64 (Decoder->Bits, 64 - Count);
+  Decoder->Bits      = LShiftU64 (Decoder->Bits, Count);
+  Decoder->BitCount -= Count;
+  return Value;
+}
+
+/**
+  Check whether the decoder consumed bits past the end of input.
+
+  @param[in]  Decoder  Decoder context.
+
+  @return  TRUE on input overrun.
+**/
+STATIC
+BOOLEAN
+InternalBzip2Overrun (
+  IN CONST BZIP2_DECODER  *Decoder
+  )
+{
+  return Decoder->PadBits > Decoder->BitCount;
+}
+
+/**
+  Build canonical Huffman decoding table.
+
+  @param[out]  Table      Decoding table.
+  @param[in]   Lengths    Code lengths per symbol, 1 to BZIP2_MAX_CODE_LENGTH.
+  @param[in]   AlphaSize  Number of symbols.
+
+  @return  TRUE when the code is valid.
+**/
+STATIC
+BOOLEAN
+InternalBzip2BuildTable (
+  OUT BZIP2_HUFFMAN_TABLE  *Table,
+  IN  CONST UINT8          *Lengths,
+  IN  UINT32               AlphaSize
+  )
+{
+  UINT32  Counts[BZIP2_MAX_CODE_LENGTH + 1];
+  UINT32  Next[BZIP2_MAX_CODE_LENGTH + 1];
+  UINT32  Code;
+  UINT32  Index;
+  UINT32  Length;
+  UINT32  Symbol;
+  UINT32  Entry;
+  UINT32  Start;
+  UINT32  End;
+
+  ZeroMem (Counts, sizeof (Counts));
+  ZeroMem (Table->Lookup, sizeof (Table->Lookup));
+
+  Table->MinLength = BZIP2_MAX_CODE_LENGTH;
+  Table->MaxLength = 1;
+
+  for (Symbol = 0; Symbol < AlphaSize; ++Symbol) {
+    ++Counts[Lengths[Symbol]];
+    Table->MinLength = MIN (Table->MinLength, Lengths[Symbol]);
+    Table->MaxLength = MAX (Table->MaxLength, Lengths[Symbol]);
+  }
+
+  //
+  // Assign canonical codes, shorter codes first.
+  // Incomplete codes are allowed, oversubscribed codes are not.
+  //
+  Code  = 0;
+  Index = 0;
+  for (Length = 1; Length <= BZIP2_MAX_CODE_LENGTH; ++Length) {
+    Table->First[Length]  = Code;
+    Table->Offset[Length] = Index;
+    Table->Limit[Length]  = Code + Counts[Length];
+    Next[Length]          = Index;
+
+    if (Table->Limit[Length] > (1U << Length)) {
+      return FALSE;
+    }
+
+    Code   = Table->Limit[Length] << 1U;
+    Index += Counts[Length];
+  }
+
+  for (Symbol = 0; Symbol < AlphaSize; ++Symbol) {
+    Length                       = Lengths[Symbol];
+    Table->Symbols[Next[Length]] = (UINT16)Symbol;
+
+    if (Length <= BZIP2_LOOKUP_BITS) {
+      Code  = Table->First[Length] + Next[Length] - Table->Offset[Length];
+      Start = Code << (BZIP2_LOOKUP_BITS - Length);
+      End   = (Code + 1) << (BZIP2_LOOKUP_BITS - Length);
+      Entry = (Symbol << BZIP2_LOOKUP_SYMBOL_SHIFT) | Length;
+      while (Start < End) {
+        Table->Lookup[Start++] = (UINT16)Entry;
+      }
+    }
+
+    ++Next[Length];
+  }
+
+  return TRUE;
+}
+
+/**
+  Decode one Huffman-coded symbol.
+
+  @param[in,out]  Decoder  Decoder context.
+  @param[in]      Table    Decoding table.
+
+  @return  Decoded symbol or BZIP2_INVALID_SYMBOL.
+**/
+STATIC
+UINT32
+InternalBzip2DecodeSymbol (
+  IN OUT BZIP2_DECODER              *Decoder,
+  IN     CONST BZIP2_HUFFMAN_TABLE  *Table
+  )
+{
+  UINT32  Peek;
+  UINT32  Entry;
+  UINT32  Length;
+  UINT32  Code;
+
+  if (Decoder->BitCount < BZIP2_MAX_CODE_LENGTH) {
+    InternalBzip2Refill (Decoder);
+  }
+
+  Peek  = (UINT32)RShiftU64 (Decoder->Bits, 64 - BZIP2_MAX_CODE_LENGTH);
+  Entry = Table->Lookup[Peek >> (BZIP2_MAX_CODE_LENGTH - BZIP2_LOOKUP_BITS)];
+  if (Entry != 0) {
+    Length             = Entry & BZIP2_LOOKUP_LENGTH_MASK;
+    Decoder->Bits      = LShiftU64 (Decoder->Bits, Length);
+    Decoder->BitCount -= Length;
+    return Entry >> BZIP2_LOOKUP_SYMBOL_SHIFT;
+  }
+
+  for (Length = MAX (Table->MinLength, BZIP2_LOOKUP_BITS + 1); Length <= Table->MaxLength; ++Length) {
+    Code = Peek >> (BZIP2_MAX_CODE_LENGTH - Length);
+    if (Code < Table->Limit[Length]) {
+      Decoder->Bits      = LShiftU64 (Decoder->Bits, Length);
+      Decoder->BitCount -= Length;
+      return Table->Symbols[Table->Offset[Length] + Code - Table->First[Length]];
+    }
+  }
+
+  return BZIP2_INVALID_SYMBOL;
+}
+
+/**
+  Read symbol map, selectors, and Huffman tables of a block.
+
+  @param[in,out]  Decoder  Decoder context.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalBzip2ReadTables (
+  IN OUT BZIP2_DECODER  *Decoder
+  )
+{
+  UINT8   Lengths[BZIP2_MAX_ALPHA_SIZE];
+  UINT8   GroupMtf[BZIP2_MAX_GROUPS];
+  UINT32  Used;
+  UINT32  UsedGroup;
+  UINT32  Index;
+  UINT32  Index2;
+  UINT32  AlphaSize;
+  UINT32  GroupCount;
+  UINT32  SelectorCount;
+  UINT32  Length;
+  UINT8   Group;
+
+  Decoder->InUseCount = 0;
+  Used                = InternalBzip2GetBits (Decoder, 16);
+  for (Index = 0; Index < 16; ++Index) {
+    if ((Used & (0x8000U >> Index)) != 0) {
+      UsedGroup = InternalBzip2GetBits (Decoder, 16);
+      for (Index2 = 0; Index2 < 16; ++Index2) {
+        if ((UsedGroup & (0x8000U >> Index2)) != 0) {
+          Decoder->SeqToUnseq[Decoder->InUseCount++] = (UINT8)(Index * 16 + Index2);
+        }
+      }
+    }
+  }
+
+  if (Decoder->InUseCount == 0) {
+    return FALSE;
+  }
+
+  AlphaSize = Decoder->InUseCount + 2;
+
+  GroupCount    = InternalBzip2GetBits (Decoder, 3);
+  SelectorCount = InternalBzip2GetBits (Decoder, 15);
+  if ((GroupCount < BZIP2_MIN_GROUPS) || (GroupCount > BZIP2_MAX_GROUPS) || (SelectorCount == 0)) {
+    return FALSE;
+  }
+
+  //
+  // Selectors are MTF-encoded in unary. Selectors past the maximum
+  // can never be used and are ignored just like the reference decoder does.
+  //
+  for (Index = 0; Index < GroupCount; ++Index) {
+    GroupMtf[Index] = (UINT8)Index;
+  }
+
+  for (Index = 0; Index < SelectorCount; ++Index) {
+    Index2 = 0;
+    while (InternalBzip2GetBits (Decoder, 1) != 0) {
+      ++Index2;
+      if (Index2 >= GroupCount) {
+        return FALSE;
+      }
+    }
+
+    Group = GroupMtf[Index2];
+    while (Index2 > 0) {
+      GroupMtf[Index2] = GroupMtf[Index2 - 1];
+      --Index2;
+    }
+
+    GroupMtf[0] = Group;
+
+    if (Index < BZIP2_MAX_SELECTORS) {
+      Decoder->Selectors[Index] = Group;
+    }
+  }
+
+  Decoder->SelectorCount = MIN (SelectorCount, BZIP2_MAX_SELECTORS);
+
+  //
+  // Code lengths are delta-encoded.
+  //
+  for (Index = 0; Index < GroupCount; ++Index) {
+    Length = InternalBzip2GetBits (Decoder, 5);
+    for (Index2 = 0; Index2 < AlphaSize; ++Index2) {
+      while (TRUE) {
+        if ((Length < 1) || (Length > BZIP2_MAX_CODE_LENGTH)) {
+          return FALSE;
+        }
+
+        if (InternalBzip2GetBits (Decoder, 1) == 0) {
+          break;
+        }
+
+        if (InternalBzip2GetBits (Decoder, 1) == 0) {
+          ++Length;
+        } else {
+          --Length;
+        }
+      }
+
+      Lengths[Index2] = (UINT8)Length;
+    }
+
+    if (!InternalBzip2BuildTable (&Decoder->Tables[Index], Lengths, AlphaSize)) {
+      return FALSE;
+    }
+  }
+
+  return !InternalBzip2Overrun (Decoder);
+}
+
+/**
+  Decode Huffman, RUNA/RUNB, and MTF stages of a block.
+  Resulting bytes are stored in the low 8 bits of Tt.
+
+  @param[in,out]  Decoder    Decoder context.
+  @param[out]     BlockSize  Number of decoded bytes.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalBzip2DecodeBlock (
+  IN OUT BZIP2_DECODER  *Decoder,
+  OUT    UINT32         *BlockSize
+  )
+{
+  CONST BZIP2_HUFFMAN_TABLE  *Table;
+  UINT8                      Mtf[256];
+  UINT32                     EndOfBlock;
+  UINT32                     GroupIndex;
+  UINT32                     GroupLeft;
+  UINT32                     Symbol;
+  UINT32                     Size;
+  UINT32                     RunLength;
+  UINT32                     RunWeight;
+  UINT32                     Index;
+  UINT8                      Value;
+  UINT8                      Byte;
+
+  for (Index = 0; Index < ARRAY_SIZE (Mtf); ++Index) {
+    Mtf[Index] = (UINT8)Index;
+  }
+
+  ZeroMem (Decoder->Counts, sizeof (Decoder->Counts));
+
+  EndOfBlock = Decoder->InUseCount + 1;
+  GroupIndex = 0;
+  GroupLeft  = 0;
+  Table      = NULL;
+  Size       = 0;
+  RunLength  = 0;
+  RunWeight  = 1;
+
+  while (TRUE) {
+    if (GroupLeft == 0) {
+      if ((GroupIndex >= Decoder->SelectorCount) || InternalBzip2Overrun (Decoder)) {
+        return FALSE;
+      }
+
+      Table     = &Decoder->Tables[Decoder->Selectors[GroupIndex++]];
+      GroupLeft = BZIP2_GROUP_SIZE;
+    }
+
+    --GroupLeft;
+
+    Symbol = InternalBzip2DecodeSymbol (Decoder, Table);
+    if (Symbol > EndOfBlock) {
+      return FALSE;
+    }
+
+    //
+    // RUNA and RUNB encode zero runs in bijective base 2.
+    //
+    if (Symbol <= BZIP2_SYMBOL_RUNB) {
+      if (RunWeight > Decoder->TtSize) {
+        return FALSE;
+      }
+
+      RunLength  += RunWeight << Symbol;
+      RunWeight <<= 1U;
+      if (RunLength > Decoder->TtSize - Size) {
+        return FALSE;
+      }
+
+      continue;
+    }
+
+    if (RunLength > 0) {
+      Byte                   = Decoder->SeqToUnseq[Mtf[0]];
+      Decoder->Counts[Byte] += RunLength;
+      while (RunLength > 0) {
+        Decoder->Tt[Size++] = Byte;
+        --RunLength;
+      }
+
+      RunWeight = 1;
+    }
+
+    if (Symbol == EndOfBlock) {
+      break;
+    }
+
+    if (Size >= Decoder->TtSize) {
+      return FALSE;
+    }
+
+    Index = Symbol - 1;
+    Value = Mtf[Index];
+    while (Index > 0) {
+      Mtf[Index] = Mtf[Index - 1];
+      --Index;
+    }
+
+    Mtf[0] = Value;
+
+    Byte = Decoder->SeqToUnseq[Value];
+    ++Decoder->Counts[Byte];
+    Decoder->Tt[Size++] = Byte;
+  }
+
+  *BlockSize = Size;
+  return !InternalBzip2Overrun (Decoder);
+}
+
+/**
+  Invert BWT and RLE stages of a block and write the result.
+
+  @param[in,out]  Decoder    Decoder context.
+  @param[in]      BlockSize  Number of bytes in the block.
+  @param[in]      Origin     BWT original pointer.
+  @param[in,out]  Dst        Current output pointer.
+  @param[in]      DstEnd     Output buffer end.
+  @param[out]     BlockCrc   Computed block CRC.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalBzip2WriteBlock (
+  IN OUT BZIP2_DECODER  *Decoder,
+  IN     UINT32         BlockSize,
+  IN     UINT32         Origin,
+  IN OUT UINT8          **Dst,
+  IN     UINT8          *DstEnd,
+  OUT    UINT32         *BlockCrc
+  )
+{
+  UINT32  *Tt;
+  UINT32  Index;
+  UINT32  Sum;
+  UINT32  Temp;
+  UINT32  Position;
+  UINT32  Crc;
+  UINT32  Last;
+  UINT32  Run;
+  UINT8   *Out;
+  UINT8   Byte;
+
+  if (Origin >= BlockSize) {
+    return FALSE;
+  }
+
+  Tt = Decoder->Tt;
+
+  Sum = 0;
+  for (Index = 0; Index < ARRAY_SIZE (Decoder->Counts); ++Index) {
+    Temp                   = Decoder->Counts[Index];
+    Decoder->Counts[Index] = Sum;
+    Sum                   += Temp;
+  }
+
+  for (Index = 0; Index < BlockSize; ++Index) {
+    Byte                         = (UINT8)Tt[Index];
+    Tt[Decoder->Counts[Byte]++] |= Index << 8U;
+  }
+
+  Out      = *Dst;
+  Crc      = MAX_UINT32;
+  Last     = MAX_UINT32;
+  Run      = 0;
+  Position = Tt[Origin] >> 8U;
+
+  for (Index = 0; Index < BlockSize; ++Index) {
+    Position   = Tt[Position];
+    Byte       = (UINT8)Position;
+    Position >>= 8U;
+
+    //
+    // Four equal bytes are followed by an extra repeat count.
+    //
+    if (Run == 4) {
+      if ((UINTN)(DstEnd - Out) < Byte) {
+        return FALSE;
+      }
+
+      while (Byte > 0) {
+        *Out++ = (UINT8)Last;
+        Crc    = (Crc << 8U) ^ Decoder->CrcTable[(Crc >> 24U) ^ Last];
+        --Byte;
+      }
+
+      Run = 0;
+      continue;
+    }
+
+    if (Byte == Last) {
+      ++Run;
+    } else {
+      Run  = 1;
+      Last = Byte;
+    }
+
+    if (Out == DstEnd) {
+      return FALSE;
+    }
+
+    *Out++ = Byte;
+    Crc    = (Crc << 8U) ^ Decoder->CrcTable[(Crc >> 24U) ^ Byte];
+  }
+
+  *Dst      = Out;
+  *BlockCrc = ~Crc;
+  return TRUE;
+}
+
+UINTN
+DecompressBZIP2 (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  )
+{
+  BZIP2_DECODER  *Decoder;
+  UINT8          *DstCur;
+  UINT8          *DstEnd;
+  UINT32         Index;
+  UINT32         Index2;
+  UINT32         Crc;
+  UINT32         MagicHi;
+  UINT32         MagicLo;
+  UINT32         StoredCrc;
+  UINT32         BlockCrc;
+  UINT32         CombinedCrc;
+  UINT32         Origin;
+  UINT32         BlockSize;
+  UINTN          Result;
+
+  if (  (SrcLen > OC_COMPRESSION_MAX_LENGTH) || (DstLen > OC_COMPRESSION_MAX_LENGTH)
+     || (SrcLen < 4) || (Src[0] != 'B') || (Src[1] != 'Z') || (Src[2] != 'h')
+     || (Src[3] < '1') || (Src[3] > '9'))
+  {
+    return 0;
+  }
+
+  Decoder = AllocateZeroPool (sizeof (*Decoder));
+  if (Decoder == NULL) {
+    return 0;
+  }
+
+  //
+  // Each run of 4 to 259 bytes takes 5 bytes in a block, so there is no
+  // need to allocate the full block when the output is smaller.
+  //
+  Decoder->TtSize = (Src[3] - '0') * BZIP2_BLOCK_SIZE_UNIT;
+  Decoder->TtSize = (UINT32)MIN (Decoder->TtSize, DstLen + DstLen / 4 + 4);
+  Decoder->Tt     = AllocatePool (Decoder->TtSize * sizeof (UINT32));
+  if (Decoder->Tt == NULL) {
+    FreePool (Decoder);
+    return 0;
+  }
+
+  for (Index = 0; Index < ARRAY_SIZE (Decoder->CrcTable); ++Index) {
+    Crc = Index << 24U;
+    for (Index2 = 0; Index2 < 8; ++Index2) {
+      Crc = (Crc & BIT31) != 0 ? (Crc << 1U) ^ BZIP2_CRC_POLYNOMIAL : Crc << 1U;
+    }
+
+    Decoder->CrcTable[Index] = Crc;
+  }
+
+  Decoder->Src    = Src + 4;
+  Decoder->SrcEnd = Src + SrcLen;
+
+  DstCur      = Dst;
+  DstEnd      = Dst + DstLen;
+  CombinedCrc = 0;
+  Result      = 0;
+
+  while (TRUE) {
+    MagicHi = InternalBzip2GetBits (Decoder, 24);
+    MagicLo = InternalBzip2GetBits (Decoder, 24);
+
+    if ((MagicHi == BZIP2_END_MAGIC_HI) && (MagicLo == BZIP2_END_MAGIC_LO)) {
+      StoredCrc = InternalBzip2GetBits (Decoder, 32);
+      if ((StoredCrc == CombinedCrc) && !InternalBzip2Overrun (Decoder)) {
+        Result = (UINTN)(DstCur - Dst);
+      }
+
+      break;
+    }
+
+    if ((MagicHi != BZIP2_BLOCK_MAGIC_HI) || (MagicLo != BZIP2_BLOCK_MAGIC_LO)) {
+      break;
+    }
+
+    StoredCrc = InternalBzip2GetBits (Decoder, 32);
+
+    //
+    // Randomised blocks are not produced since bzip2 0.9.5.
+    //
+    if (InternalBzip2GetBits (Decoder, 1) != 0) {
+      break;
+    }
+
+    Origin = InternalBzip2GetBits (Decoder, 24);
+
+    if (  !InternalBzip2ReadTables (Decoder)
+       || !InternalBzip2DecodeBlock (Decoder, &BlockSize)
+       || !InternalBzip2WriteBlock (Decoder, BlockSize, Origin, &DstCur, DstEnd, &BlockCrc)
+       || (BlockCrc != StoredCrc))
+    {
+      break;
+    }
+
+    CombinedCrc = ((CombinedCrc << 1U) | (CombinedCrc >> 31U)) ^ BlockCrc;
+  }
+
+  FreePool (Decoder->Tt);
+  FreePool (Decoder);
+  return Result;
+}
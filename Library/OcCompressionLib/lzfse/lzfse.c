@@ -0,0 +1,777 @@
+/*
+Copyright (c) 2015-2016, Apple Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the distribution.
+
+3.  Neither the name of the copyright holder(s) nor the names of any contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// LZFSE decoder
+
+#include "lzfse.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#  define LZFSE_INLINE __forceinline
+#  define __builtin_expect(X, Y) (X)
+#else
+#  define LZFSE_INLINE static inline __attribute__((__always_inline__))
+#endif
+
+#define LZFSE_STATUS_OK 0
+#define LZFSE_STATUS_ERROR -1
+
+/*! @abstract Block magic numbers. */
+#define LZFSE_ENDOFSTREAM_BLOCK_MAGIC 0x24787662    // bvx$ (end of stream)
+#define LZFSE_UNCOMPRESSED_BLOCK_MAGIC 0x2d787662   // bvx- (raw data)
+#define LZFSE_COMPRESSEDV1_BLOCK_MAGIC 0x31787662   // bvx1 (lzfse compressed, uncompressed tables)
+#define LZFSE_COMPRESSEDV2_BLOCK_MAGIC 0x32787662   // bvx2 (lzfse compressed, compressed tables)
+#define LZFSE_COMPRESSEDLZVN_BLOCK_MAGIC 0x6e787662 // bvxn (lzvn compressed)
+
+/*! @abstract Number of symbols and states of each FSE coded stream. */
+#define LZFSE_ENCODE_L_SYMBOLS 20
+#define LZFSE_ENCODE_M_SYMBOLS 20
+#define LZFSE_ENCODE_D_SYMBOLS 64
+#define LZFSE_ENCODE_LITERAL_SYMBOLS 256
+#define LZFSE_ENCODE_L_STATES 64
+#define LZFSE_ENCODE_M_STATES 64
+#define LZFSE_ENCODE_D_STATES 256
+#define LZFSE_ENCODE_LITERAL_STATES 1024
+
+/*! @abstract Block limits enforced by the encoder. */
+#define LZFSE_MATCHES_PER_BLOCK 10000
+#define LZFSE_LITERALS_PER_BLOCK (4 * LZFSE_MATCHES_PER_BLOCK)
+
+/*! @abstract Fixed part of v2 block header preceding the frequency tables. */
+#define LZFSE_COMPRESSEDV2_HEADER_SIZE 32
+
+/*! @abstract Literal decoder table entry. */
+typedef struct {
+  uint8_t k;      // Number of bits to read
+  uint8_t symbol; // Emitted symbol
+  uint16_t delta; // Signed increment used to compute next state (+bias)
+} fse_decoder_entry;
+
+/*! @abstract L, M, D decoder table entry. */
+typedef struct {
+  uint8_t total_bits; // state bits + extra value bits = shift for next decode
+  uint8_t value_bits; // extra value bits
+  int16_t delta;      // state base (delta)
+  int32_t vbase;      // value base
+} fse_value_decoder_entry;
+
+/*! @abstract FSE bit input stream, consumed backwards from the end. */
+typedef struct {
+  uint64_t accum;      // Input bits
+  int32_t accum_nbits; // Number of valid bits in accum, in [56, 64) after flush
+} fse_in_stream;
+
+/*! @abstract Compressed block header with uncompressed tables. */
+typedef struct {
+  uint32_t magic;
+  uint32_t n_raw_bytes;
+  uint32_t n_payload_bytes;
+  uint32_t n_literals;
+  uint32_t n_matches;
+  uint32_t n_literal_payload_bytes;
+  uint32_t n_lmd_payload_bytes;
+  int32_t literal_bits;
+  uint16_t literal_state[4];
+  int32_t lmd_bits;
+  uint16_t l_state;
+  uint16_t m_state;
+  uint16_t d_state;
+  uint16_t l_freq[LZFSE_ENCODE_L_SYMBOLS];
+  uint16_t m_freq[LZFSE_ENCODE_M_SYMBOLS];
+  uint16_t d_freq[LZFSE_ENCODE_D_SYMBOLS];
+  uint16_t literal_freq[LZFSE_ENCODE_LITERAL_SYMBOLS];
+} lzfse_compressed_block_header_v1;
+
+/*! @abstract Decoder state, allocated once per buffer. */
+typedef struct {
+  // Valid range for source buffer is [src_begin, src_end - 1]
+  const uint8_t *src_begin;
+  const uint8_t *src;
+  const uint8_t *src_end;
+
+  // Valid range for destination buffer is [dst_begin, dst_end - 1]
+  uint8_t *dst_begin;
+  uint8_t *dst;
+  uint8_t *dst_end;
+
+  // Decoder tables of the current block
+  fse_value_decoder_entry l_decoder[LZFSE_ENCODE_L_STATES];
+  fse_value_decoder_entry m_decoder[LZFSE_ENCODE_M_STATES];
+  fse_value_decoder_entry d_decoder[LZFSE_ENCODE_D_STATES];
+  fse_decoder_entry literal_decoder[LZFSE_ENCODE_LITERAL_STATES];
+
+  // Decoded literals of the current block, padded for wide copies
+  uint8_t literals[LZFSE_LITERALS_PER_BLOCK + 64];
+} lzfse_decoder_state;
+
+static const uint8_t l_extra_bits[LZFSE_ENCODE_L_SYMBOLS] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 5, 8};
+static const int32_t l_base_value[LZFSE_ENCODE_L_SYMBOLS] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 20, 28, 60};
+static const uint8_t m_extra_bits[LZFSE_ENCODE_M_SYMBOLS] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 5, 8, 11};
+static const int32_t m_base_value[LZFSE_ENCODE_M_SYMBOLS] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 24, 56, 312};
+static const uint8_t d_extra_bits[LZFSE_ENCODE_D_SYMBOLS] = {
+    0,  0,  0,  0,  1,  1,  1,  1,  2,  2,  2,  2,  3,  3,  3,  3,
+    4,  4,  4,  4,  5,  5,  5,  5,  6,  6,  6,  6,  7,  7,  7,  7,
+    8,  8,  8,  8,  9,  9,  9,  9,  10, 10, 10, 10, 11, 11, 11, 11,
+    12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15};
+static const int32_t d_base_value[LZFSE_ENCODE_D_SYMBOLS] = {
+    0,      1,      2,      3,     4,     6,     8,     10,    12,    16,
+    20,     24,     28,     36,    44,    52,    60,    76,    92,    108,
+    124,    156,    188,    220,   252,   316,   380,   444,   508,   636,
+    764,    892,    1020,   1276,  1532,  1788,  2044,  2556,  3068,  3580,
+    4092,   5116,   6140,   7164,  8188,  10236, 12284, 14332, 16380, 20476,
+    24572,  28668,  32764,  40956, 49148, 57340, 65532, 81916, 98300, 114684,
+    131068, 163836, 196604, 229372};
+
+/*! @abstract Load bytes from memory location SRC. */
+LZFSE_INLINE uint32_t load4(const void *ptr) {
+  uint32_t data;
+  memcpy(&data, ptr, sizeof data);
+  return data;
+}
+
+LZFSE_INLINE uint64_t load8(const void *ptr) {
+  uint64_t data;
+  memcpy(&data, ptr, sizeof data);
+  return data;
+}
+
+/*! @abstract Store bytes to memory location DST. */
+LZFSE_INLINE void store8(void *ptr, uint64_t data) {
+  memcpy(ptr, &data, sizeof data);
+}
+
+/*! @abstract Copy \p length bytes in 8-byte chunks. May write up to 7 bytes
+ *  past \p dst + \p length and read up to 7 bytes past \p src + \p length. */
+LZFSE_INLINE void copy(uint8_t *dst, const uint8_t *src, size_t length) {
+  uint8_t *dst_end = dst + length;
+  do {
+    store8(dst, load8(src));
+    dst += 8;
+    src += 8;
+  } while (dst < dst_end);
+}
+
+/*! @abstract Extract \p width bits of \p container starting with \p lsb. */
+LZFSE_INLINE uint32_t get_field(uint64_t container, unsigned lsb,
+                                unsigned width) {
+  return (uint32_t)((container >> lsb) & (((uint64_t)1 << width) - 1));
+}
+
+/*! @abstract Index of the highest set bit of non-zero \p x. */
+LZFSE_INLINE int high_bit(uint32_t x) {
+  int n = 0;
+  while (x >>= 1)
+    n++;
+  return n;
+}
+
+/*! @abstract Mask the \p nbits low bits of \p x, \p nbits in [0, 63]. */
+LZFSE_INLINE uint64_t fse_mask_lsb64(uint64_t x, int32_t nbits) {
+  return x & (((uint64_t)1 << nbits) - 1);
+}
+
+/*! @abstract Initialize bit stream ending at \p *pbuf. \p n in [-8, 0] is
+ *  the number of padding bits in the last byte (negated).
+ *  @return 0 if OK, -1 on failure. */
+LZFSE_INLINE int fse_in_checked_init(fse_in_stream *s, int32_t n,
+                                     const uint8_t **pbuf,
+                                     const uint8_t *buf_start) {
+  if (n < -8 || n > 0)
+    return -1;
+
+  if (n != 0) {
+    if (*pbuf < buf_start + 8)
+      return -1;
+    *pbuf -= 8;
+    s->accum = load8(*pbuf);
+    s->accum_nbits = n + 64;
+  } else {
+    if (*pbuf < buf_start + 7)
+      return -1;
+    *pbuf -= 7;
+    // Stream may end right at the buffer end, do not load the 8th byte.
+    s->accum = 0;
+    memcpy(&s->accum, *pbuf, 7);
+    s->accum_nbits = n + 56;
+  }
+
+  if (s->accum_nbits < 56 || s->accum_nbits >= 64 ||
+      (s->accum >> s->accum_nbits) != 0)
+    return -1;
+
+  return 0;
+}
+
+/*! @abstract Read in new bytes from \p *pbuf to refill the accumulator
+ *  to at least 56 bits.
+ *  @return 0 if OK, -1 on failure. */
+LZFSE_INLINE int fse_in_checked_flush(fse_in_stream *s, const uint8_t **pbuf,
+                                      const uint8_t *buf_start) {
+  int32_t nbits = (63 - s->accum_nbits) & -8;
+  const uint8_t *buf;
+  uint64_t incoming;
+
+  // Nothing to refill, do not touch the bytes right past the stream.
+  if (nbits == 0)
+    return 0;
+
+  buf = *pbuf - (nbits >> 3);
+  if (buf < buf_start)
+    return -1;
+
+  *pbuf = buf;
+  incoming = load8(buf);
+  s->accum = (s->accum << nbits) | fse_mask_lsb64(incoming, nbits);
+  s->accum_nbits += nbits;
+  return 0;
+}
+
+/*! @abstract Pull \p n bits out of the accumulator. */
+LZFSE_INLINE uint64_t fse_in_pull(fse_in_stream *s, int32_t n) {
+  uint64_t result;
+  s->accum_nbits -= n;
+  result = s->accum >> s->accum_nbits;
+  s->accum = fse_mask_lsb64(s->accum, s->accum_nbits);
+  return result;
+}
+
+/*! @abstract Decode and return symbol, update \p *pstate. */
+LZFSE_INLINE uint8_t fse_decode(uint16_t *pstate,
+                                const fse_decoder_entry *decoder_table,
+                                fse_in_stream *in) {
+  fse_decoder_entry e = decoder_table[*pstate];
+  *pstate = (uint16_t)(e.delta + fse_in_pull(in, e.k));
+  return e.symbol;
+}
+
+/*! @abstract Decode and return value, update \p *pstate. */
+LZFSE_INLINE int32_t fse_value_decode(uint16_t *pstate,
+                                      const fse_value_decoder_entry *table,
+                                      fse_in_stream *in) {
+  fse_value_decoder_entry entry = table[*pstate];
+  uint32_t state_and_value_bits = (uint32_t)fse_in_pull(in, entry.total_bits);
+  *pstate = (uint16_t)(entry.delta + (state_and_value_bits >> entry.value_bits));
+  return (int32_t)(entry.vbase +
+                   fse_mask_lsb64(state_and_value_bits, entry.value_bits));
+}
+
+/*! @abstract Check that frequencies sum to at most \p number_of_states.
+ *  @return 0 if OK, -1 on failure. */
+static int fse_check_freq(const uint16_t *freq_table, size_t table_size,
+                          size_t number_of_states) {
+  size_t sum_of_freq = 0;
+  size_t i;
+  for (i = 0; i < table_size; i++)
+    sum_of_freq += freq_table[i];
+  return (sum_of_freq > number_of_states) ? -1 : 0;
+}
+
+/*! @abstract Initialize literal decoder table \p t[nstates] from \p freq. */
+static void fse_init_decoder_table(int nstates, int nsymbols,
+                                   const uint16_t *freq,
+                                   fse_decoder_entry *t) {
+  int n_bits = high_bit((uint32_t)nstates);
+  int i, j;
+  for (i = 0; i < nsymbols; i++) {
+    int f = freq[i];
+    if (f == 0)
+      continue;
+    int k = n_bits - high_bit((uint32_t)f);
+    int j0 = ((2 * nstates) >> k) - f;
+    for (j = 0; j < f; j++, t++) {
+      t->symbol = (uint8_t)i;
+      if (j < j0) {
+        t->k = (uint8_t)k;
+        t->delta = (uint16_t)(((f + j) << k) - nstates);
+      } else {
+        t->k = (uint8_t)(k - 1);
+        t->delta = (uint16_t)((j - j0) << (k - 1));
+      }
+    }
+  }
+}
+
+/*! @abstract Initialize value decoder table \p t[nstates] from \p freq. */
+static void fse_init_value_decoder_table(int nstates, int nsymbols,
+                                         const uint16_t *freq,
+                                         const uint8_t *symbol_vbits,
+                                         const int32_t *symbol_vbase,
+                                         fse_value_decoder_entry *t) {
+  int n_bits = high_bit((uint32_t)nstates);
+  int i, j;
+  for (i = 0; i < nsymbols; i++) {
+    int f = freq[i];
+    if (f == 0)
+      continue;
+    int k = n_bits - high_bit((uint32_t)f);
+    int j0 = ((2 * nstates) >> k) - f;
+    for (j = 0; j < f; j++, t++) {
+      t->value_bits = symbol_vbits[i];
+      t->vbase = symbol_vbase[i];
+      if (j < j0) {
+        t->total_bits = (uint8_t)(k + symbol_vbits[i]);
+        t->delta = (int16_t)(((f + j) << k) - nstates);
+      } else {
+        t->total_bits = (uint8_t)(k - 1 + symbol_vbits[i]);
+        t->delta = (int16_t)((j - j0) << (k - 1));
+      }
+    }
+  }
+}
+
+/*! @abstract Decode an entry of the v2 frequency tables from \p bits,
+ *  storing the number of consumed bits in \p *nbits. */
+LZFSE_INLINE uint16_t lzfse_decode_v1_freq_value(uint32_t bits, int *nbits) {
+  static const int8_t lzfse_freq_nbits_table[32] = {
+      2, 3, 2, 5, 2, 3, 2, 8, 2, 3, 2, 5, 2, 3, 2, 14,
+      2, 3, 2, 5, 2, 3, 2, 8, 2, 3, 2, 5, 2, 3, 2, 14};
+  static const int8_t lzfse_freq_value_table[32] = {
+      0, 2, 1, 4, 0, 3, 1, -1, 0, 2, 1, 5, 0, 3, 1, -1,
+      0, 2, 1, 6, 0, 3, 1, -1, 0, 2, 1, 7, 0, 3, 1, -1};
+
+  uint32_t b = bits & 31;
+  int n = lzfse_freq_nbits_table[b];
+  *nbits = n;
+
+  if (n == 8)
+    return (uint16_t)(8 + ((bits >> 4) & 0xf));
+  if (n == 14)
+    return (uint16_t)(24 + ((bits >> 4) & 0x3ff));
+  return (uint16_t)lzfse_freq_value_table[b];
+}
+
+/*! @abstract Expand v2 block header \p in of \p header_size bytes into \p out.
+ *  @return 0 if OK, -1 on failure. */
+static int lzfse_decode_v2_header(lzfse_compressed_block_header_v1 *out,
+                                  const uint8_t *in, size_t header_size) {
+  uint64_t v0 = load8(in + 8);
+  uint64_t v1 = load8(in + 16);
+  uint64_t v2 = load8(in + 24);
+  uint16_t freq[LZFSE_ENCODE_L_SYMBOLS + LZFSE_ENCODE_M_SYMBOLS +
+                LZFSE_ENCODE_D_SYMBOLS + LZFSE_ENCODE_LITERAL_SYMBOLS];
+  const uint8_t *src = in + LZFSE_COMPRESSEDV2_HEADER_SIZE;
+  const uint8_t *src_end = in + header_size;
+  uint32_t accum = 0;
+  int accum_nbits = 0;
+  int nbits;
+  size_t i;
+
+  memset(out, 0x00, sizeof(*out));
+  memset(freq, 0x00, sizeof(freq));
+
+  out->magic = LZFSE_COMPRESSEDV1_BLOCK_MAGIC;
+  out->n_raw_bytes = load4(in + 4);
+
+  out->n_literals = get_field(v0, 0, 20);
+  out->n_literal_payload_bytes = get_field(v0, 20, 20);
+  out->n_matches = get_field(v0, 40, 20);
+  out->literal_bits = (int32_t)get_field(v0, 60, 3) - 7;
+
+  out->literal_state[0] = (uint16_t)get_field(v1, 0, 10);
+  out->literal_state[1] = (uint16_t)get_field(v1, 10, 10);
+  out->literal_state[2] = (uint16_t)get_field(v1, 20, 10);
+  out->literal_state[3] = (uint16_t)get_field(v1, 30, 10);
+  out->n_lmd_payload_bytes = get_field(v1, 40, 20);
+  out->lmd_bits = (int32_t)get_field(v1, 60, 3) - 7;
+
+  out->l_state = (uint16_t)get_field(v2, 32, 10);
+  out->m_state = (uint16_t)get_field(v2, 42, 10);
+  out->d_state = (uint16_t)get_field(v2, 52, 10);
+
+  out->n_payload_bytes =
+      out->n_literal_payload_bytes + out->n_lmd_payload_bytes;
+
+  // Header without frequency tables leaves all of them zero.
+  if (header_size != LZFSE_COMPRESSEDV2_HEADER_SIZE) {
+    for (i = 0; i < sizeof(freq) / sizeof(freq[0]); i++) {
+      // Refill accum, one byte at a time, until we reach the end of the
+      // header, or accum is full.
+      while (src < src_end && accum_nbits + 8 <= 32) {
+        accum |= (uint32_t)(*src) << accum_nbits;
+        accum_nbits += 8;
+        src++;
+      }
+
+      freq[i] = lzfse_decode_v1_freq_value(accum, &nbits);
+      if (nbits > accum_nbits)
+        return -1; // failed
+
+      accum >>= nbits;
+      accum_nbits -= nbits;
+    }
+
+    // We must have consumed all bytes of the header.
+    if (accum_nbits >= 8 || src != src_end)
+      return -1;
+  }
+
+  memcpy(out->l_freq, freq, sizeof(out->l_freq));
+  memcpy(out->m_freq, freq + LZFSE_ENCODE_L_SYMBOLS, sizeof(out->m_freq));
+  memcpy(out->d_freq, freq + LZFSE_ENCODE_L_SYMBOLS + LZFSE_ENCODE_M_SYMBOLS,
+         sizeof(out->d_freq));
+  memcpy(out->literal_freq,
+         freq + LZFSE_ENCODE_L_SYMBOLS + LZFSE_ENCODE_M_SYMBOLS +
+             LZFSE_ENCODE_D_SYMBOLS,
+         sizeof(out->literal_freq));
+
+  return 0;
+}
+
+/*! @abstract Check block header \p header for consistency.
+ *  @return 0 if OK, -1 on failure. */
+static int lzfse_check_block_header_v1(
+    const lzfse_compressed_block_header_v1 *header) {
+  int i;
+
+  if (header->n_literals > LZFSE_LITERALS_PER_BLOCK ||
+      header->n_matches > LZFSE_MATCHES_PER_BLOCK)
+    return -1;
+
+  for (i = 0; i < 4; i++)
+    if (header->literal_state[i] >= LZFSE_ENCODE_LITERAL_STATES)
+      return -1;
+
+  if (header->l_state >= LZFSE_ENCODE_L_STATES ||
+      header->m_state >= LZFSE_ENCODE_M_STATES ||
+      header->d_state >= LZFSE_ENCODE_D_STATES)
+    return -1;
+
+  if (fse_check_freq(header->l_freq, LZFSE_ENCODE_L_SYMBOLS,
+                     LZFSE_ENCODE_L_STATES) ||
+      fse_check_freq(header->m_freq, LZFSE_ENCODE_M_SYMBOLS,
+                     LZFSE_ENCODE_M_STATES) ||
+      fse_check_freq(header->d_freq, LZFSE_ENCODE_D_SYMBOLS,
+                     LZFSE_ENCODE_D_STATES) ||
+      fse_check_freq(header->literal_freq, LZFSE_ENCODE_LITERAL_SYMBOLS,
+                     LZFSE_ENCODE_LITERAL_STATES))
+    return -1;
+
+  return 0;
+}
+
+/*! @abstract Decode literals of the current block into \p s->literals.
+ *  @return 0 if OK, -1 on failure. */
+static int lzfse_decode_literals(lzfse_decoder_state *s,
+                                 const lzfse_compressed_block_header_v1 *header,
+                                 const uint8_t *payload) {
+  const uint8_t *buf = payload + header->n_literal_payload_bytes;
+  uint16_t state0 = header->literal_state[0];
+  uint16_t state1 = header->literal_state[1];
+  uint16_t state2 = header->literal_state[2];
+  uint16_t state3 = header->literal_state[3];
+  uint8_t *lit = s->literals;
+  fse_in_stream in;
+  uint32_t i;
+
+  if (fse_in_checked_init(&in, header->literal_bits, &buf, s->src_begin))
+    return -1;
+
+  // Literal count is padded to a multiple of 4 by the encoder, 4 decodes
+  // consume at most 40 bits and always fit into the refilled accumulator.
+  for (i = 0; i < header->n_literals; i += 4) {
+    if (fse_in_checked_flush(&in, &buf, s->src_begin))
+      return -1;
+    lit[i + 0] = fse_decode(&state0, s->literal_decoder, &in);
+    lit[i + 1] = fse_decode(&state1, s->literal_decoder, &in);
+    lit[i + 2] = fse_decode(&state2, s->literal_decoder, &in);
+    lit[i + 3] = fse_decode(&state3, s->literal_decoder, &in);
+  }
+
+  return 0;
+}
+
+/*! @abstract Decode L, M, D triples of the current block and expand them
+ *  into the destination buffer.
+ *  @return 0 if OK, -1 on failure. */
+static int lzfse_decode_lmd(lzfse_decoder_state *s,
+                            const lzfse_compressed_block_header_v1 *header,
+                            const uint8_t *payload) {
+  const uint8_t *buf = payload + header->n_literal_payload_bytes +
+                       header->n_lmd_payload_bytes;
+  const uint8_t *lit = s->literals;
+  const uint8_t *lit_end = s->literals + header->n_literals;
+  uint16_t l_state = header->l_state;
+  uint16_t m_state = header->m_state;
+  uint16_t d_state = header->d_state;
+  uint8_t *dst = s->dst;
+  size_t remaining;
+  size_t L, M, D;
+  size_t j;
+  int32_t new_d;
+  fse_in_stream in;
+  uint32_t i;
+
+  if (fse_in_checked_init(&in, header->lmd_bits, &buf, s->src_begin))
+    return -1;
+
+  // Distance of the first match must be coded explicitly.
+  D = (size_t)-1;
+
+  for (i = 0; i < header->n_matches; i++) {
+    // Decode the next L, M, D symbol from the input stream. A single refill
+    // covers the worst case of 14 + 17 + 23 bits.
+    if (fse_in_checked_flush(&in, &buf, s->src_begin))
+      return -1;
+    L = (size_t)fse_value_decode(&l_state, s->l_decoder, &in);
+    if ((size_t)(lit_end - lit) < L)
+      return -1;
+    M = (size_t)fse_value_decode(&m_state, s->m_decoder, &in);
+    new_d = fse_value_decode(&d_state, s->d_decoder, &in);
+    D = new_d ? (size_t)new_d : D;
+
+    // Match source must lie within the output produced so far.
+    if (D > (size_t)(dst + L - s->dst_begin))
+      return -1;
+
+    remaining = (size_t)(s->dst_end - dst);
+    if (L + M > remaining)
+      return -1;
+
+    if (__builtin_expect(remaining >= 32 && L + M <= remaining - 32, 1)) {
+      // Far from the end of the buffer, wide copies may overshoot safely.
+      copy(dst, lit, L);
+      dst += L;
+      lit += L;
+      if (D >= 8 || D >= M) {
+        copy(dst, dst - D, M);
+      } else {
+        for (j = 0; j < M; j++)
+          dst[j] = (dst - D)[j];
+      }
+      dst += M;
+    } else {
+      // Close to the end of the buffer, copy exact byte counts.
+      for (j = 0; j < L; j++)
+        dst[j] = lit[j];
+      dst += L;
+      lit += L;
+      for (j = 0; j < M; j++)
+        dst[j] = (dst - D)[j];
+      dst += M;
+    }
+  }
+
+  s->dst = dst;
+  return 0;
+}
+
+/*! @abstract Decode a block compressed with LZFSE.
+ *  @return 0 if OK, -1 on failure. */
+static int lzfse_decode_compressed_block(lzfse_decoder_state *s,
+                                         uint32_t magic) {
+  lzfse_compressed_block_header_v1 header;
+  size_t header_size;
+  size_t available = (size_t)(s->src_end - s->src);
+
+  if (magic == LZFSE_COMPRESSEDV1_BLOCK_MAGIC) {
+    header_size = sizeof(header);
+    if (available < header_size)
+      return -1;
+    memcpy(&header, s->src, header_size);
+  } else {
+    if (available < LZFSE_COMPRESSEDV2_HEADER_SIZE)
+      return -1;
+    header_size = get_field(load8(s->src + 24), 0, 32);
+    if (header_size < LZFSE_COMPRESSEDV2_HEADER_SIZE ||
+        header_size > available)
+      return -1;
+    if (lzfse_decode_v2_header(&header, s->src, header_size))
+      return -1;
+  }
+
+  if (lzfse_check_block_header_v1(&header))
+    return -1;
+
+  available -= header_size;
+  if ((uint64_t)header.n_literal_payload_bytes + header.n_lmd_payload_bytes >
+      available)
+    return -1;
+
+  // Unused states must stay zero for malformed frequency tables.
+  memset(s->l_decoder, 0x00, sizeof(s->l_decoder));
+  memset(s->m_decoder, 0x00, sizeof(s->m_decoder));
+  memset(s->d_decoder, 0x00, sizeof(s->d_decoder));
+  memset(s->literal_decoder, 0x00, sizeof(s->literal_decoder));
+
+  fse_init_value_decoder_table(LZFSE_ENCODE_L_STATES, LZFSE_ENCODE_L_SYMBOLS,
+                               header.l_freq, l_extra_bits, l_base_value,
+                               s->l_decoder);
+  fse_init_value_decoder_table(LZFSE_ENCODE_M_STATES, LZFSE_ENCODE_M_SYMBOLS,
+                               header.m_freq, m_extra_bits, m_base_value,
+                               s->m_decoder);
+  fse_init_value_decoder_table(LZFSE_ENCODE_D_STATES, LZFSE_ENCODE_D_SYMBOLS,
+                               header.d_freq, d_extra_bits, d_base_value,
+                               s->d_decoder);
+  fse_init_decoder_table(LZFSE_ENCODE_LITERAL_STATES,
+                         LZFSE_ENCODE_LITERAL_SYMBOLS, header.literal_freq,
+                         s->literal_decoder);
+
+  s->src += header_size;
+
+  if (lzfse_decode_literals(s, &header, s->src))
+    return -1;
+
+  if (lzfse_decode_lmd(s, &header, s->src))
+    return -1;
+
+  s->src += header.n_literal_payload_bytes + header.n_lmd_payload_bytes;
+  return 0;
+}
+
+/*! @abstract Decode a block compressed with LZVN.
+ *  @return 0 if OK, -1 on failure. */
+static int lzfse_decode_lzvn_block(lzfse_decoder_state *s) {
+  lzvn_decoder_state dstate;
+  uint32_t n_raw_bytes;
+  uint32_t n_payload_bytes;
+
+  if (s->src_end - s->src < 12)
+    return -1;
+
+  n_raw_bytes = load4(s->src + 4);
+  n_payload_bytes = load4(s->src + 8);
+  s->src += 12;
+
+  if (n_payload_bytes > (size_t)(s->src_end - s->src) ||
+      n_raw_bytes > (size_t)(s->dst_end - s->dst))
+    return -1;
+
+  memset(&dstate, 0x00, sizeof(dstate));
+  dstate.src = s->src;
+  dstate.src_end = s->src + n_payload_bytes;
+
+  // Matches may reference data produced by the previous blocks.
+  dstate.dst_begin = s->dst_begin;
+  dstate.dst = s->dst;
+  dstate.dst_end = s->dst + n_raw_bytes;
+
+  dstate.d_prev = 0;
+  dstate.end_of_stream = 0;
+
+  lzvn_decode(&dstate);
+
+  // The block must be fully expanded and terminated.
+  if (!dstate.end_of_stream || dstate.src != dstate.src_end ||
+      dstate.dst != dstate.dst_end)
+    return -1;
+
+  s->src = dstate.src;
+  s->dst = dstate.dst;
+  return 0;
+}
+
+/*! @abstract Decode all blocks of the stream.
+ *  @return LZFSE_STATUS_OK if OK, LZFSE_STATUS_ERROR on failure. */
+static int lzfse_decode(lzfse_decoder_state *s) {
+  uint32_t magic;
+  uint32_t n_raw_bytes;
+
+  for (;;) {
+    if (s->src_end - s->src < 4)
+      return LZFSE_STATUS_ERROR; // truncated stream
+
+    magic = load4(s->src);
+
+    switch (magic) {
+    case LZFSE_ENDOFSTREAM_BLOCK_MAGIC:
+      s->src += 4;
+      return LZFSE_STATUS_OK;
+
+    case LZFSE_UNCOMPRESSED_BLOCK_MAGIC:
+      if (s->src_end - s->src < 8)
+        return LZFSE_STATUS_ERROR;
+      n_raw_bytes = load4(s->src + 4);
+      s->src += 8;
+      if (n_raw_bytes > (size_t)(s->src_end - s->src) ||
+          n_raw_bytes > (size_t)(s->dst_end - s->dst))
+        return LZFSE_STATUS_ERROR;
+      memcpy(s->dst, s->src, n_raw_bytes);
+      s->src += n_raw_bytes;
+      s->dst += n_raw_bytes;
+      break;
+
+    case LZFSE_COMPRESSEDV1_BLOCK_MAGIC:
+    case LZFSE_COMPRESSEDV2_BLOCK_MAGIC:
+      if (lzfse_decode_compressed_block(s, magic))
+        return LZFSE_STATUS_ERROR;
+      break;
+
+    case LZFSE_COMPRESSEDLZVN_BLOCK_MAGIC:
+      if (lzfse_decode_lzvn_block(s))
+        return LZFSE_STATUS_ERROR;
+      break;
+
+    default:
+      return LZFSE_STATUS_ERROR; // bad magic
+    }
+  }
+}
+
+size_t lzfse_decode_buffer_with_scratch(uint8_t *dst, size_t dst_size,
+                                        const uint8_t *src, size_t src_size,
+                                        void *scratch) {
+  lzfse_decoder_state *s;
+
+  STATIC_ASSERT (sizeof(lzfse_decoder_state) <= OC_DECOMPRESS_SCRATCH_SIZE,
+                 "Insufficient scratch buffer size");
+
+  if (dst_size > OC_COMPRESSION_MAX_LENGTH || src_size > OC_COMPRESSION_MAX_LENGTH) {
+    return 0;
+  }
+
+  s = scratch;
+  ZeroMem(s, sizeof(*s));
+
+  s->src_begin = src;
+  s->src = src;
+  s->src_end = src + src_size;
+
+  s->dst_begin = dst;
+  s->dst = dst;
+  s->dst_end = dst + dst_size;
+
+  if (lzfse_decode(s) != LZFSE_STATUS_OK) {
+    return 0;
+  }
+
+  return (size_t)(s->dst - dst);
+}
+
+size_t lzfse_decode_buffer(uint8_t *dst, size_t dst_size,
+                           const uint8_t *src, size_t src_size) {
+  lzfse_decoder_state *s;
+  size_t result;
+
+  // Decoder tables and literals take around 47 KB, keep them off the stack.
+  s = AllocatePool(sizeof(*s));
+  if (s == NULL) {
+    return 0;
+  }
+
+  result = lzfse_decode_buffer_with_scratch(dst, dst_size, src, src_size, s);
+
+  FreePool(s);
+  return result;
+}
@@ -0,0 +1,28 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#ifndef LZFSE_H
+#define LZFSE_H
+
+#include <Library/MemoryAllocationLib.h>
+
+//
+// LZFSE streams may embed LZVN blocks, share the decoder and its typedefs.
+//
+#include "../lzvn/lzvn.h"
+
+#define lzfse_decode_buffer DecompressLZFSE
+#define lzfse_decode_buffer_with_scratch DecompressLZFSEWithScratch
+
+#endif /* LZFSE_H */
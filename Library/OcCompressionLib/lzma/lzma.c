@@ -0,0 +1,924 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcCompressionLib.h>
+
+//
+// XZ container format, see The .xz File Format 1.1.0.
+//
+#define XZ_STREAM_HEADER_SIZE             12U
+#define XZ_STREAM_FOOTER_SIZE             12U
+#define XZ_BLOCK_HEADER_MIN_SIZE          8U
+#define XZ_CHECK_NONE                     0x00U
+#define XZ_CHECK_CRC32                    0x01U
+#define XZ_CHECK_MAX                      0x0FU
+#define XZ_BLOCK_FLAGS_RESERVED           0x3CU
+#define XZ_BLOCK_FLAGS_FILTERS            0x03U
+#define XZ_BLOCK_FLAGS_COMPRESSED_SIZE    BIT6
+#define XZ_BLOCK_FLAGS_UNCOMPRESSED_SIZE  BIT7
+#define XZ_FILTER_LZMA2                   0x21U
+#define XZ_VLI_MAX_BYTES                  9U
+
+//
+// LZMA2 chunk control values.
+//
+#define LZMA2_CONTROL_END               0x00U
+#define LZMA2_CONTROL_COPY_RESET_DICT   0x01U
+#define LZMA2_CONTROL_COPY              0x02U
+#define LZMA2_CONTROL_LZMA              0x80U
+#define LZMA2_CONTROL_LZMA_RESET_STATE  0xA0U
+#define LZMA2_CONTROL_LZMA_SET_PROPS    0xC0U
+#define LZMA2_CONTROL_LZMA_RESET_DICT   0xE0U
+#define LZMA2_MAX_DICT_PROPS            40U
+
+//
+// LZMA model parameters.
+//
+#define LZMA_STATES              12U
+#define LZMA_LITERAL_STATES      7U
+#define LZMA_POS_STATES_MAX      16U
+#define LZMA_PROPS_MAX           (9U * 5U * 5U)
+#define LZMA_LITERAL_CODERS_MAX  16U
+#define LZMA_LITERAL_CODER_SIZE  0x300U
+#define LZMA_MATCH_LEN_MIN       2U
+#define LZMA_LEN_LOW_SYMBOLS     8U
+#define LZMA_LEN_MID_SYMBOLS     8U
+#define LZMA_LEN_HIGH_SYMBOLS    256U
+#define LZMA_DIST_STATES         4U
+#define LZMA_DIST_SLOTS          64U
+#define LZMA_DIST_MODEL_START    4U
+#define LZMA_DIST_MODEL_END      14U
+#define LZMA_FULL_DISTANCES      128U
+#define LZMA_ALIGN_BITS          4U
+#define LZMA_ALIGN_SIZE          (1U << LZMA_ALIGN_BITS)
+
+//
+// Range coder parameters.
+//
+#define LZMA_RC_INIT_BYTES   5U
+#define LZMA_RC_TOP_VALUE    (1U << 24U)
+#define LZMA_RC_MODEL_BITS   11U
+#define LZMA_RC_MODEL_TOTAL  (1U << LZMA_RC_MODEL_BITS)
+#define LZMA_RC_MOVE_BITS    5U
+
+typedef struct {
+  UINT16    Choice;
+  UINT16    Choice2;
+  UINT16    Low[LZMA_POS_STATES_MAX][LZMA_LEN_LOW_SYMBOLS];
+  UINT16    Mid[LZMA_POS_STATES_MAX][LZMA_LEN_MID_SYMBOLS];
+  UINT16    High[LZMA_LEN_HIGH_SYMBOLS];
+} LZMA_LENGTH_PROBS;
+
+//
+// All members must be UINT16 probabilities, they are reset in bulk.
+//
+typedef struct {
+  UINT16               IsMatch[LZMA_STATES][LZMA_POS_STATES_MAX];
+  UINT16               IsRep[LZMA_STATES];
+  UINT16               IsRep0[LZMA_STATES];
+  UINT16               IsRep1[LZMA_STATES];
+  UINT16               IsRep2[LZMA_STATES];
+  UINT16               IsRep0Long[LZMA_STATES][LZMA_POS_STATES_MAX];
+  UINT16               DistSlot[LZMA_DIST_STATES][LZMA_DIST_SLOTS];
+  UINT16               DistSpecial[LZMA_FULL_DISTANCES - LZMA_DIST_MODEL_END];
+  UINT16               DistAlign[LZMA_ALIGN_SIZE];
+  LZMA_LENGTH_PROBS    MatchLength;
+  LZMA_LENGTH_PROBS    RepLength;
+  UINT16               Literal[LZMA_LITERAL_CODERS_MAX][LZMA_LITERAL_CODER_SIZE];
+} LZMA_PROBS;
+
+typedef struct {
+  //
+  // Range decoder, reading past the chunk end sets Overrun.
+  //
+  CONST UINT8    *In;
+  CONST UINT8    *InEnd;
+  UINT32         Range;
+  UINT32         Code;
+  BOOLEAN        Overrun;
+  //
+  // Output buffer doubles as the dictionary.
+  //
+  UINT8          *DictStart;
+  UINT8          *Out;
+  UINT8          *OutEnd;
+  //
+  // Model state.
+  //
+  UINT32         State;
+  UINT32         Rep0;
+  UINT32         Rep1;
+  UINT32         Rep2;
+  UINT32         Rep3;
+  UINT32         LiteralContextBits;
+  UINT32         LiteralPosMask;
+  UINT32         PosMask;
+  LZMA_PROBS     Probs;
+} LZMA_DECODER;
+
+/**
+  Reset LZMA state and probabilities.
+
+  @param[in,out]  Decoder  Decoder context.
+**/
+STATIC
+VOID
+InternalLzmaReset (
+  IN OUT LZMA_DECODER  *Decoder
+  )
+{
+  UINT16  *Probs;
+  UINTN   Index;
+
+  Decoder->State = 0;
+  Decoder->Rep0  = 0;
+  Decoder->Rep1  = 0;
+  Decoder->Rep2  = 0;
+  Decoder->Rep3  = 0;
+
+  Probs = (UINT16 *)&Decoder->Probs;
+  for (Index = 0; Index < sizeof (Decoder->Probs) / sizeof (UINT16); ++Index) {
+    Probs[Index] = LZMA_RC_MODEL_TOTAL / 2;
+  }
+}
+
+/**
+  Read next range decoder input byte when the range gets too small.
+
+  @param[in,out]  Decoder  Decoder context.
+**/
+STATIC
+VOID
+InternalLzmaNormalize (
+  IN OUT LZMA_DECODER  *Decoder
+  )
+{
+  if (Decoder->Range < LZMA_RC_TOP_VALUE) {
+    Decoder->Range <<= 8U;
+    Decoder->Code  <<= 8U;
+    if (Decoder->In < Decoder->InEnd) {
+      Decoder->Code |= *Decoder->In++;
+    } else {
+      Decoder->Overrun = TRUE;
+    }
+  }
+}
+
+/**
+  Decode one adaptively modelled bit.
+
+  @param[in,out]  Decoder  Decoder context.
+  @param[in,out]  Prob     Bit probability.
+
+  @return  Decoded bit.
+**/
+STATIC
+UINT32
+InternalLzmaBit (
+  IN OUT LZMA_DECODER  *Decoder,
+  IN OUT UINT16        *Prob
+  )
+{
+  UINT32  Bound;
+
+  InternalLzmaNormalize (Decoder);
+
+  Bound = (Decoder->Range >> LZMA_RC_MODEL_BITS) * *Prob;
+  if (Decoder->Code < Bound) {
+    Decoder->Range = Bound;
+    *Prob         += (LZMA_RC_MODEL_TOTAL - *Prob) >> LZMA_RC_MOVE_BITS;
+    return 0;
+  }
+
+  Decoder->Range -= Bound;
+  Decoder->Code  -= Bound;
+  *Prob          -= *Prob >> LZMA_RC_MOVE_BITS;
+  return 1;
+}
+
+/**
+  Decode a bit tree symbol, most significant bit first.
+
+  @param[in,out]  Decoder  Decoder context.
+  @param[in,out]  Probs    Bit tree probabilities.
+  @param[in]      Limit    Number of symbols, power of two.
+
+  @return  Decoded symbol plus Limit.
+**/
+STATIC
+UINT32
+InternalLzmaBitTree (
+  IN OUT LZMA_DECODER  *Decoder,
+  IN OUT UINT16        *Probs,
+  IN     UINT32        Limit
+  )
+{
+  UINT32  Symbol;
+
+  Symbol = 1;
+  do {
+    Symbol = (Symbol << 1U) | InternalLzmaBit (Decoder, &Probs[Symbol]);
+  } while (Symbol < Limit);
+
+  return Symbol;
+}
+
+/**
+  Decode a bit tree symbol, least significant bit first, and add it to Dest.
+
+  @param[in,out]  Decoder  Decoder context.
+  @param[in,out]  Probs    Bit tree probabilities.
+  @param[in]      Offset   Offset added to probability index, may wrap.
+  @param[in,out]  Dest     Destination value.
+  @param[in]      Bits     Number of bits to decode.
+**/
+STATIC
+VOID
+InternalLzmaBitTreeReverse (
+  IN OUT LZMA_DECODER  *Decoder,
+  IN OUT UINT16        *Probs,
+  IN     UINT32        Offset,
+  IN OUT UINT32        *Dest,
+  IN     UINT32        Bits
+  )
+{
+  UINT32  Symbol;
+  UINT32  Index;
+  UINT32  Bit;
+
+  Symbol = 1;
+  for (Index = 0; Index < Bits; ++Index) {
+    Bit     = InternalLzmaBit (Decoder, &Probs[Offset + Symbol]);
+    Symbol  = (Symbol << 1U) | Bit;
+    *Dest  += Bit << Index;
+  }
+}
+
+/**
+  Decode bits with fixed probability and append them to Dest.
+
+  @param[in,out]  Decoder  Decoder context.
+  @param[in,out]  Dest     Destination value.
+  @param[in]      Bits     Number of bits to decode.
+**/
+STATIC
+VOID
+InternalLzmaDirect (
+  IN OUT LZMA_DECODER  *Decoder,
+  IN OUT UINT32        *Dest,
+  IN     UINT32        Bits
+  )
+{
+  UINT32  Mask;
+
+  do {
+    InternalLzmaNormalize (Decoder);
+    Decoder->Range >>= 1U;
+    Decoder->Code   -= Decoder->Range;
+    Mask             = 0U - (Decoder->Code >> 31U);
+    Decoder->Code   += Decoder->Range & Mask;
+    *Dest            = (*Dest << 1U) + (Mask + 1U);
+  } while (--Bits > 0);
+}
+
+/**
+  Decode match length.
+
+  @param[in,out]  Decoder   Decoder context.
+  @param[in,out]  Probs     Length probabilities.
+  @param[in]      PosState  Position state.
+
+  @return  Match length.
+**/
+STATIC
+UINT32
+InternalLzmaLength (
+  IN OUT LZMA_DECODER       *Decoder,
+  IN OUT LZMA_LENGTH_PROBS  *Probs,
+  IN     UINT32             PosState
+  )
+{
+  if (InternalLzmaBit (Decoder, &Probs->Choice) == 0) {
+    return InternalLzmaBitTree (Decoder, Probs->Low[PosState], LZMA_LEN_LOW_SYMBOLS)
+           - LZMA_LEN_LOW_SYMBOLS + LZMA_MATCH_LEN_MIN;
+  }
+
+  if (InternalLzmaBit (Decoder, &Probs->Choice2) == 0) {
+    return InternalLzmaBitTree (Decoder, Probs->Mid[PosState], LZMA_LEN_MID_SYMBOLS)
+           - LZMA_LEN_MID_SYMBOLS + LZMA_MATCH_LEN_MIN + LZMA_LEN_LOW_SYMBOLS;
+  }
+
+  return InternalLzmaBitTree (Decoder, Probs->High, LZMA_LEN_HIGH_SYMBOLS)
+         - LZMA_LEN_HIGH_SYMBOLS + LZMA_MATCH_LEN_MIN + LZMA_LEN_LOW_SYMBOLS + LZMA_LEN_MID_SYMBOLS;
+}
+
+/**
+  Decode literal byte.
+
+  @param[in,out]  Decoder  Decoder context.
+**/
+STATIC
+VOID
+InternalLzmaLiteral (
+  IN OUT LZMA_DECODER  *Decoder
+  )
+{
+  UINT16  *Probs;
+  UINT32  Position;
+  UINT32  PrevByte;
+  UINT32  Symbol;
+  UINT32  MatchByte;
+  UINT32  MatchBit;
+  UINT32  Offset;
+
+  Position = (UINT32)(Decoder->Out - Decoder->DictStart);
+  PrevByte = Position > 0 ? Decoder->Out[-1] : 0;
+  Probs    = Decoder->Probs.Literal[
+    ((Position & Decoder->LiteralPosMask) << Decoder->LiteralContextBits)
+    + (PrevByte >> (8U - Decoder->LiteralContextBits))
+  ];
+
+  if (Decoder->State < LZMA_LITERAL_STATES) {
+    Symbol = InternalLzmaBitTree (Decoder, Probs, 0x100);
+  } else {
+    //
+    // Literal right after a match is coded relative to the byte at rep0.
+    //
+    MatchByte = (UINT32)Decoder->Out[-(INTN)Decoder->Rep0 - 1] << 1U;
+    Offset    = 0x100;
+    Symbol    = 1;
+    do {
+      MatchBit    = MatchByte & Offset;
+      MatchByte <<= 1U;
+      if (InternalLzmaBit (Decoder, &Probs[Offset + MatchBit + Symbol]) != 0) {
+        Symbol = (Symbol << 1U) | 1U;
+        Offset = MatchBit;
+      } else {
+        Symbol <<= 1U;
+        Offset  &= ~MatchBit;
+      }
+    } while (Symbol < 0x100);
+  }
+
+  *Decoder->Out++ = (UINT8)Symbol;
+
+  if (Decoder->State < 4) {
+    Decoder->State = 0;
+  } else if (Decoder->State < 10) {
+    Decoder->State -= 3;
+  } else {
+    Decoder->State -= 6;
+  }
+}
+
+/**
+  Decode LZMA chunk, which must fill the output up to OutEnd exactly
+  and consume all input up to InEnd.
+
+  @param[in,out]  Decoder  Decoder context.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalLzmaDecodeChunk (
+  IN OUT LZMA_DECODER  *Decoder
+  )
+{
+  UINT32  PosState;
+  UINT32  Length;
+  UINT32  DistState;
+  UINT32  DistSlot;
+  UINT32  Bits;
+  UINT32  Temp;
+  UINTN   Position;
+  UINT8   *Copy;
+
+  if (((UINTN)(Decoder->InEnd - Decoder->In) < LZMA_RC_INIT_BYTES) || (Decoder->In[0] != 0)) {
+    return FALSE;
+  }
+
+  Decoder->Range   = MAX_UINT32;
+  Decoder->Code    = SwapBytes32 (ReadUnaligned32 ((CONST UINT32 *)(Decoder->In + 1)));
+  Decoder->In     += LZMA_RC_INIT_BYTES;
+  Decoder->Overrun = FALSE;
+
+  while (Decoder->Out < Decoder->OutEnd) {
+    if (Decoder->Overrun) {
+      return FALSE;
+    }
+
+    Position = (UINTN)(Decoder->Out - Decoder->DictStart);
+    PosState = (UINT32)Position & Decoder->PosMask;
+
+    if (InternalLzmaBit (Decoder, &Decoder->Probs.IsMatch[Decoder->State][PosState]) == 0) {
+      if ((Decoder->State >= LZMA_LITERAL_STATES) && (Decoder->Rep0 >= Position)) {
+        return FALSE;
+      }
+
+      InternalLzmaLiteral (Decoder);
+      continue;
+    }
+
+    if (InternalLzmaBit (Decoder, &Decoder->Probs.IsRep[Decoder->State]) == 0) {
+      //
+      // Simple match with new distance.
+      //
+      Decoder->Rep3  = Decoder->Rep2;
+      Decoder->Rep2  = Decoder->Rep1;
+      Decoder->Rep1  = Decoder->Rep0;
+      Decoder->State = Decoder->State < LZMA_LITERAL_STATES ? 7 : 10;
+      Length         = InternalLzmaLength (Decoder, &Decoder->Probs.MatchLength, PosState);
+
+      DistState = MIN (Length - LZMA_MATCH_LEN_MIN, LZMA_DIST_STATES - 1);
+      DistSlot  = InternalLzmaBitTree (Decoder, Decoder->Probs.DistSlot[DistState], LZMA_DIST_SLOTS)
+                  - LZMA_DIST_SLOTS;
+
+      if (DistSlot < LZMA_DIST_MODEL_START) {
+        Decoder->Rep0 = DistSlot;
+      } else {
+        Bits          = (DistSlot >> 1U) - 1;
+        Decoder->Rep0 = 2U | (DistSlot & 1U);
+        if (DistSlot < LZMA_DIST_MODEL_END) {
+          Decoder->Rep0 <<= Bits;
+          InternalLzmaBitTreeReverse (
+            Decoder,
+            Decoder->Probs.DistSpecial,
+            Decoder->Rep0 - DistSlot - 1,
+            &Decoder->Rep0,
+            Bits
+            );
+        } else {
+          InternalLzmaDirect (Decoder, &Decoder->Rep0, Bits - LZMA_ALIGN_BITS);
+          Decoder->Rep0 <<= LZMA_ALIGN_BITS;
+          InternalLzmaBitTreeReverse (
+            Decoder,
+            Decoder->Probs.DistAlign,
+            0,
+            &Decoder->Rep0,
+            LZMA_ALIGN_BITS
+            );
+        }
+      }
+    } else if (InternalLzmaBit (Decoder, &Decoder->Probs.IsRep0[Decoder->State]) == 0) {
+      if (InternalLzmaBit (Decoder, &Decoder->Probs.IsRep0Long[Decoder->State][PosState]) == 0) {
+        //
+        // Short repeat of a single byte.
+        //
+        Decoder->State = Decoder->State < LZMA_LITERAL_STATES ? 9 : 11;
+        Length         = 1;
+      } else {
+        Decoder->State = Decoder->State < LZMA_LITERAL_STATES ? 8 : 11;
+        Length         = InternalLzmaLength (Decoder, &Decoder->Probs.RepLength, PosState);
+      }
+    } else {
+      if (InternalLzmaBit (Decoder, &Decoder->Probs.IsRep1[Decoder->State]) == 0) {
+        Temp = Decoder->Rep1;
+      } else {
+        if (InternalLzmaBit (Decoder, &Decoder->Probs.IsRep2[Decoder->State]) == 0) {
+          Temp = Decoder->Rep2;
+        } else {
+          Temp          = Decoder->Rep3;
+          Decoder->Rep3 = Decoder->Rep2;
+        }
+
+        Decoder->Rep2 = Decoder->Rep1;
+      }
+
+      Decoder->Rep1  = Decoder->Rep0;
+      Decoder->Rep0  = Temp;
+      Decoder->State = Decoder->State < LZMA_LITERAL_STATES ? 8 : 11;
+      Length         = InternalLzmaLength (Decoder, &Decoder->Probs.RepLength, PosState);
+    }
+
+    //
+    // LZMA2 forbids end markers and matches crossing chunk boundaries.
+    // An end marker has distance of MAX_UINT32 and fails here as well.
+    //
+    if (  (Decoder->Rep0 >= Position)
+       || ((UINTN)(Decoder->OutEnd - Decoder->Out) < Length))
+    {
+      return FALSE;
+    }
+
+    Copy = Decoder->Out - Decoder->Rep0 - 1;
+    while (Length > 0) {
+      *Decoder->Out++ = *Copy++;
+      --Length;
+    }
+  }
+
+  InternalLzmaNormalize (Decoder);
+
+  return !Decoder->Overrun && Decoder->In == Decoder->InEnd && Decoder->Code == 0;
+}
+
+/**
+  Decode LZMA2 data of a single XZ block.
+
+  @param[in,out]  Decoder  Decoder context.
+  @param[in]      DstEnd   Output buffer end.
+  @param[in]      SrcEnd   Input buffer end.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalLzma2Decode (
+  IN OUT LZMA_DECODER  *Decoder,
+  IN     UINT8         *DstEnd,
+  IN     CONST UINT8   *SrcEnd
+  )
+{
+  CONST UINT8  *Src;
+  UINT32       Control;
+  UINT32       Props;
+  UINTN        UncompressedSize;
+  UINTN        CompressedSize;
+  BOOLEAN      NeedDictReset;
+  BOOLEAN      NeedProps;
+
+  Src           = Decoder->In;
+  NeedDictReset = TRUE;
+  NeedProps     = TRUE;
+
+  while (TRUE) {
+    if (Src >= SrcEnd) {
+      return FALSE;
+    }
+
+    Control = *Src++;
+    if (Control == LZMA2_CONTROL_END) {
+      break;
+    }
+
+    if ((Control >= LZMA2_CONTROL_LZMA_RESET_DICT) || (Control == LZMA2_CONTROL_COPY_RESET_DICT)) {
+      Decoder->DictStart = Decoder->Out;
+      NeedDictReset      = FALSE;
+      NeedProps          = TRUE;
+    } else if (NeedDictReset) {
+      return FALSE;
+    }
+
+    if (Control < LZMA2_CONTROL_LZMA) {
+      if ((Control > LZMA2_CONTROL_COPY) || ((SrcEnd - Src) < 2)) {
+        return FALSE;
+      }
+
+      UncompressedSize = (((UINTN)Src[0] << 8U) | Src[1]) + 1;
+      Src             += 2;
+
+      if (  ((UINTN)(SrcEnd - Src) < UncompressedSize)
+         || ((UINTN)(DstEnd - Decoder->Out) < UncompressedSize))
+      {
+        return FALSE;
+      }
+
+      CopyMem (Decoder->Out, Src, UncompressedSize);
+      Decoder->Out += UncompressedSize;
+      Src          += UncompressedSize;
+      continue;
+    }
+
+    if ((SrcEnd - Src) < 4) {
+      return FALSE;
+    }
+
+    UncompressedSize = (((UINTN)(Control & 0x1FU) << 16U) | ((UINTN)Src[0] << 8U) | Src[1]) + 1;
+    CompressedSize   = (((UINTN)Src[2] << 8U) | Src[3]) + 1;
+    Src             += 4;
+
+    if (Control >= LZMA2_CONTROL_LZMA_SET_PROPS) {
+      if (Src >= SrcEnd) {
+        return FALSE;
+      }
+
+      //
+      // Properties are encoded as (PosBits * 5 + LiteralPosBits) * 9 + LiteralContextBits.
+      //
+      Props = *Src++;
+      if (Props >= LZMA_PROPS_MAX) {
+        return FALSE;
+      }
+
+      Decoder->PosMask            = (1U << (Props / (9 * 5))) - 1;
+      Props                      %= 9 * 5;
+      Decoder->LiteralPosMask     = (1U << (Props / 9)) - 1;
+      Decoder->LiteralContextBits = Props % 9;
+
+      if (Decoder->LiteralContextBits + Props / 9 > 4) {
+        return FALSE;
+      }
+
+      NeedProps = FALSE;
+      InternalLzmaReset (Decoder);
+    } else if (NeedProps) {
+      return FALSE;
+    } else if (Control >= LZMA2_CONTROL_LZMA_RESET_STATE) {
+      InternalLzmaReset (Decoder);
+    }
+
+    if (  ((UINTN)(SrcEnd - Src) < CompressedSize)
+       || ((UINTN)(DstEnd - Decoder->Out) < UncompressedSize))
+    {
+      return FALSE;
+    }
+
+    Decoder->In     = Src;
+    Decoder->InEnd  = Src + CompressedSize;
+    Decoder->OutEnd = Decoder->Out + UncompressedSize;
+
+    if (!InternalLzmaDecodeChunk (Decoder)) {
+      return FALSE;
+    }
+
+    Src = Decoder->InEnd;
+  }
+
+  Decoder->In = Src;
+  return TRUE;
+}
+
+/**
+  Read XZ variable-length integer.
+
+  @param[in,out]  Src     Current input pointer.
+  @param[in]      SrcEnd  Input buffer end.
+  @param[out]     Value   Decoded value.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalXzReadVli (
+  IN OUT CONST UINT8  **Src,
+  IN     CONST UINT8  *SrcEnd,
+  OUT    UINT64       *Value
+  )
+{
+  UINT32  Index;
+  UINT8   Byte;
+
+  *Value = 0;
+  for (Index = 0; Index < XZ_VLI_MAX_BYTES && *Src < SrcEnd; ++Index) {
+    Byte    = *(*Src)++;
+    *Value |= LShiftU64 (Byte & 0x7FU, Index * 7);
+    if ((Byte & BIT7) == 0) {
+      //
+      // Reject non-minimal encodings.
+      //
+      return Byte != 0 || Index == 0;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Check that padding bytes are zero up to 4-byte alignment.
+
+  @param[in,out]  Src      Current input pointer.
+  @param[in]      SrcEnd   Input buffer end.
+  @param[in]      Base     Start of the aligned region.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalXzSkipPadding (
+  IN OUT CONST UINT8  **Src,
+  IN     CONST UINT8  *SrcEnd,
+  IN     CONST UINT8  *Base
+  )
+{
+  while (((UINTN)(*Src - Base) & 3U) != 0) {
+    if ((*Src >= SrcEnd) || (**Src != 0)) {
+      return FALSE;
+    }
+
+    ++(*Src);
+  }
+
+  return TRUE;
+}
+
+/**
+  Decode single XZ block.
+
+  @param[in,out]  Decoder    Decoder context.
+  @param[in,out]  Src        Current input pointer, pointing to block header.
+  @param[in]      SrcEnd     Input buffer end.
+  @param[in]      DstEnd     Output buffer end.
+  @param[in]      CheckType  Stream check type.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalXzDecodeBlock (
+  IN OUT LZMA_DECODER  *Decoder,
+  IN OUT CONST UINT8   **Src,
+  IN     CONST UINT8   *SrcEnd,
+  IN     UINT8         *DstEnd,
+  IN     UINT32        CheckType
+  )
+{
+  STATIC CONST UINT8  mCheckSizes[XZ_CHECK_MAX + 1] = {
+    0, 4, 4, 4, 8, 8, 8, 16, 16, 16, 32, 32, 32, 64, 64, 64
+  };
+
+  CONST UINT8  *Header;
+  CONST UINT8  *HeaderEnd;
+  CONST UINT8  *Data;
+  CONST UINT8  *Cursor;
+  UINT8        *BlockOut;
+  UINTN        HeaderSize;
+  UINT64       CompressedSize;
+  UINT64       UncompressedSize;
+  UINT64       FilterId;
+  UINT64       PropsSize;
+  UINT8        Flags;
+
+  Header     = *Src;
+  HeaderSize = ((UINTN)Header[0] + 1) * 4;
+  if (  (HeaderSize < XZ_BLOCK_HEADER_MIN_SIZE)
+     || ((UINTN)(SrcEnd - Header) < HeaderSize)
+     || (CalculateCrc32 ((VOID *)Header, HeaderSize - 4) != ReadUnaligned32 ((CONST UINT32 *)(Header + HeaderSize - 4))))
+  {
+    return FALSE;
+  }
+
+  //
+  // Only a single LZMA2 filter is supported, as used by Apple.
+  //
+  Flags = Header[1];
+  if (((Flags & XZ_BLOCK_FLAGS_RESERVED) != 0) || ((Flags & XZ_BLOCK_FLAGS_FILTERS) != 0)) {
+    return FALSE;
+  }
+
+  Cursor           = Header + 2;
+  HeaderEnd        = Header + HeaderSize - 4;
+  CompressedSize   = 0;
+  UncompressedSize = 0;
+
+  if (  (((Flags & XZ_BLOCK_FLAGS_COMPRESSED_SIZE) != 0) && !InternalXzReadVli (&Cursor, HeaderEnd, &CompressedSize))
+     || (((Flags & XZ_BLOCK_FLAGS_UNCOMPRESSED_SIZE) != 0) && !InternalXzReadVli (&Cursor, HeaderEnd, &UncompressedSize))
+     || !InternalXzReadVli (&Cursor, HeaderEnd, &FilterId)
+     || !InternalXzReadVli (&Cursor, HeaderEnd, &PropsSize)
+     || (FilterId != XZ_FILTER_LZMA2)
+     || (PropsSize != 1)
+     || (Cursor >= HeaderEnd)
+     || (*Cursor++ > LZMA2_MAX_DICT_PROPS))
+  {
+    return FALSE;
+  }
+
+  while (Cursor < HeaderEnd) {
+    if (*Cursor++ != 0) {
+      return FALSE;
+    }
+  }
+
+  Data        = Header + HeaderSize;
+  BlockOut    = Decoder->Out;
+  Decoder->In = Data;
+  if (!InternalLzma2Decode (Decoder, DstEnd, SrcEnd)) {
+    return FALSE;
+  }
+
+  if (  (((Flags & XZ_BLOCK_FLAGS_COMPRESSED_SIZE) != 0) && (CompressedSize != (UINT64)(Decoder->In - Data)))
+     || (((Flags & XZ_BLOCK_FLAGS_UNCOMPRESSED_SIZE) != 0) && (UncompressedSize != (UINT64)(Decoder->Out - BlockOut))))
+  {
+    return FALSE;
+  }
+
+  Cursor = Decoder->In;
+  if (  !InternalXzSkipPadding (&Cursor, SrcEnd, Data)
+     || ((UINTN)(SrcEnd - Cursor) < mCheckSizes[CheckType]))
+  {
+    return FALSE;
+  }
+
+  //
+  // Only CRC32 checks are verified, disk images have their own checksums.
+  // Block data goes through the vector zlib implementation.
+  //
+  if (  (CheckType == XZ_CHECK_CRC32)
+     && (Crc32 (BlockOut, (UINTN)(Decoder->Out - BlockOut)) != ReadUnaligned32 ((CONST UINT32 *)Cursor)))
+  {
+    return FALSE;
+  }
+
+  *Src = Cursor + mCheckSizes[CheckType];
+  return TRUE;
+}
+
+UINTN
+DecompressLZMA (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  )
+{
+  STATIC CONST UINT8  mXzHeaderMagic[] = { 0xFD, '7', 'z', 'X', 'Z', 0x00 };
+  STATIC CONST UINT8  mXzFooterMagic[] = { 'Y', 'Z' };
+
+  LZMA_DECODER  *Decoder;
+  CONST UINT8   *SrcEnd;
+  CONST UINT8   *Index;
+  CONST UINT8   *Footer;
+  UINT64        BlockCount;
+  UINT64        RecordCount;
+  UINT64        Value;
+  UINT32        CheckType;
+  UINTN         Result;
+
+  if (  (SrcLen > OC_COMPRESSION_MAX_LENGTH) || (DstLen > OC_COMPRESSION_MAX_LENGTH)
+     || (SrcLen < XZ_STREAM_HEADER_SIZE + XZ_STREAM_FOOTER_SIZE)
+     || (CompareMem (Src, mXzHeaderMagic, sizeof (mXzHeaderMagic)) != 0)
+     || (Src[6] != 0) || (Src[7] > XZ_CHECK_MAX)
+     || (CalculateCrc32 ((VOID *)(Src + 6), 2) != ReadUnaligned32 ((CONST UINT32 *)(Src + 8))))
+  {
+    return 0;
+  }
+
+  Decoder = AllocatePool (sizeof (*Decoder));
+  if (Decoder == NULL) {
+    return 0;
+  }
+
+  CheckType    = Src[7];
+  SrcEnd       = Src + SrcLen;
+  Src         += XZ_STREAM_HEADER_SIZE;
+  Decoder->Out = Dst;
+  BlockCount   = 0;
+
+  //
+  // Blocks are followed by the index starting with a zero indicator.
+  //
+  while (Src < SrcEnd && *Src != 0) {
+    if (!InternalXzDecodeBlock (Decoder, &Src, SrcEnd, Dst + DstLen, CheckType)) {
+      FreePool (Decoder);
+      return 0;
+    }
+
+    ++BlockCount;
+  }
+
+  Result = (UINTN)(Decoder->Out - Dst);
+  FreePool (Decoder);
+
+  //
+  // Validate index record count and CRC, record contents are not needed.
+  //
+  Index = Src++;
+  if (  (Index >= SrcEnd)
+     || !InternalXzReadVli (&Src, SrcEnd, &RecordCount)
+     || (RecordCount != BlockCount))
+  {
+    return 0;
+  }
+
+  while (RecordCount > 0) {
+    if (  !InternalXzReadVli (&Src, SrcEnd, &Value)
+       || !InternalXzReadVli (&Src, SrcEnd, &Value))
+    {
+      return 0;
+    }
+
+    --RecordCount;
+  }
+
+  if (  !InternalXzSkipPadding (&Src, SrcEnd, Index)
+     || ((UINTN)(SrcEnd - Src) < sizeof (UINT32) + XZ_STREAM_FOOTER_SIZE)
+     || (CalculateCrc32 ((VOID *)Index, (UINTN)(Src - Index)) != ReadUnaligned32 ((CONST UINT32 *)Src)))
+  {
+    return 0;
+  }
+
+  Footer = Src + sizeof (UINT32);
+  if (  (CalculateCrc32 ((VOID *)(Footer + 4), 6) != ReadUnaligned32 ((CONST UINT32 *)Footer))
+     || (ReadUnaligned32 ((CONST UINT32 *)(Footer + 4)) != (UINT32)((Footer - Index) / 4 - 1))
+     || (Footer[8] != 0) || (Footer[9] != CheckType)
+     || (CompareMem (Footer + 10, mXzFooterMagic, sizeof (mXzFooterMagic)) != 0))
+  {
+    return 0;
+  }
+
+  return Result;
+}
@@ -137,6 +137,140 @@ u_int32_t decompress_lzss(
     return (u_int32_t)(dst - dststart);
 }
 
+/*
+ * Streaming decoder producing the same output as decompress_lzss while
+ * source is supplied in blocks of arbitrary size. The destination buffer
+ * must fit the whole output.
+ */
+enum {
+    LZSS_PHASE_TOKEN,     /* next token starts */
+    LZSS_PHASE_FLAGS,     /* next byte is a flags byte */
+    LZSS_PHASE_LITERAL,   /* next byte is a literal */
+    LZSS_PHASE_MATCH_LO,  /* next byte is low byte of match position */
+    LZSS_PHASE_MATCH_HI,  /* next byte is high nibble and match length */
+    LZSS_PHASE_DONE       /* destination is full */
+};
+
+struct decode_stream {
+    u_int8_t       * dst;
+    u_int8_t       * dststart;
+    const u_int8_t * dstend;
+    unsigned int     flags;
+    int              phase;
+    int              i, r;
+    /* ring buffer of size N, with extra F-1 bytes to aid string comparison */
+    u_int8_t         text_buf[N + F - 1];
+};
+
+/*******************************************************************************
+*******************************************************************************/
+void * decompress_lzss_stream_init(
+    u_int8_t       * dst,
+    u_int32_t        dstlen)
+{
+    struct decode_stream * sp;
+
+    if (dstlen > OC_COMPRESSION_MAX_LENGTH) {
+        return NULL;
+    }
+
+    sp = malloc(sizeof(*sp));
+    if (sp == NULL) {
+        return NULL;
+    }
+
+    sp->dst = sp->dststart = dst;
+    sp->dstend = dst + dstlen;
+    memset(sp->text_buf, ' ', N - F);
+    sp->r = N - F;
+    sp->i = 0;
+    sp->flags = 0;
+    sp->phase = dstlen > 0 ? LZSS_PHASE_TOKEN : LZSS_PHASE_DONE;
+
+    return sp;
+}
+
+/*******************************************************************************
+*******************************************************************************/
+u_int8_t decompress_lzss_stream_feed(
+    void           * stream,
+    const u_int8_t * src,
+    u_int32_t        srclen)
+{
+    struct decode_stream * sp = stream;
+    const u_int8_t * srcend = src + srclen;
+    u_int8_t * dst = sp->dst;
+    const u_int8_t * dstend = sp->dstend;
+    unsigned int flags = sp->flags;
+    int  phase = sp->phase;
+    int  i = sp->i;
+    int  r = sp->r;
+    int  j, k;
+    u_int8_t c;
+
+    while (phase != LZSS_PHASE_DONE) {
+        if (phase == LZSS_PHASE_TOKEN) {
+            if (((flags >>= 1) & 0x100) == 0)
+                phase = LZSS_PHASE_FLAGS;
+            else
+                phase = (flags & 1) ? LZSS_PHASE_LITERAL : LZSS_PHASE_MATCH_LO;
+        }
+
+        if (src < srcend) c = *src++; else break;
+
+        switch (phase) {
+        case LZSS_PHASE_FLAGS:
+            flags = c | 0xFF00;  /* uses higher byte cleverly */
+            phase = (flags & 1) ? LZSS_PHASE_LITERAL : LZSS_PHASE_MATCH_LO;
+            break;
+        case LZSS_PHASE_LITERAL:
+            *dst++ = c;
+            sp->text_buf[r++] = c;
+            r &= (N - 1);
+            phase = dst < dstend ? LZSS_PHASE_TOKEN : LZSS_PHASE_DONE;
+            break;
+        case LZSS_PHASE_MATCH_LO:
+            i = c;
+            phase = LZSS_PHASE_MATCH_HI;
+            break;
+        default:
+            j = c;
+            i |= ((j & 0xF0) << 4);
+            j  =  (j & 0x0F) + THRESHOLD;
+            for (k = 0; k <= j && dst < dstend; k++) {
+                c = sp->text_buf[(i + k) & (N - 1)];
+                *dst++ = c;
+                sp->text_buf[r++] = c;
+                r &= (N - 1);
+            }
+            phase = dst < dstend ? LZSS_PHASE_TOKEN : LZSS_PHASE_DONE;
+            break;
+        }
+    }
+
+    sp->dst = dst;
+    sp->flags = flags;
+    sp->phase = phase;
+    sp->i = i;
+    sp->r = r;
+
+    return phase != LZSS_PHASE_DONE;
+}
+
+/*******************************************************************************
+*******************************************************************************/
+u_int32_t decompress_lzss_stream_free(
+    void           * stream)
+{
+    struct decode_stream * sp = stream;
+    u_int32_t length;
+
+    length = (u_int32_t)(sp->dst - sp->dststart);
+    free(sp);
+
+    return length;
+}
+
 /*
  * initialize state, mostly the trees
  *
@@ -21,6 +21,9 @@
 
 #define compress_lzss CompressLZSS
 #define decompress_lzss DecompressLZSS
+#define decompress_lzss_stream_init DecompressLZSSStreamInit
+#define decompress_lzss_stream_feed DecompressLZSSStreamFeed
+#define decompress_lzss_stream_free DecompressLZSSStreamFree
 
 #ifdef EFIUSER
 #include <stdint.h>
@@ -36,72 +36,56 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #  define LZFSE_INLINE static inline __attribute__((__always_inline__))
 #endif
 
-/*! @abstract Signed offset in buffers, stored on either 32 or 64 bits. */
-#if defined(_M_AMD64) || defined(__x86_64__) || defined(__arm64__)
-typedef int64_t lzvn_offset;
+//  Fixed-size unaligned accesses must compile to plain loads and stores.
+//  In firmware memcpy is CopyMem, which is never inlined, so use the builtin
+//  where the compiler provides it.
+#if defined(__GNUC__) || defined(__clang__)
+#  define LZVN_MEMCPY(Dst, Src, Size) __builtin_memcpy ((Dst), (Src), (Size))
 #else
-typedef int32_t lzvn_offset;
+#  define LZVN_MEMCPY(Dst, Src, Size) memcpy ((Dst), (Src), (Size))
 #endif
 
-/*! @abstract Base decoder state. */
-typedef struct {
-
-  // Decoder I/O
-
-  // Next byte to read in source buffer
-  const unsigned char *src;
-  // Next byte after source buffer
-  const unsigned char *src_end;
-
-  // Next byte to write in destination buffer (by decoder)
-  unsigned char *dst;
-  // Valid range for destination buffer is [dst_begin, dst_end - 1]
-  unsigned char *dst_begin;
-  unsigned char *dst_end;
-  // Next byte to read in destination buffer (modified by caller)
-  unsigned char *dst_current;
-
-  // Decoder state
-
-  // Partially expanded match, or 0,0,0.
-  // In that case, src points to the next literal to copy, or the next op-code
-  // if L==0.
-  size_t L, M, D;
-
-  // Distance for last emitted match, or 0
-  lzvn_offset d_prev;
-
-  // Did we decode end-of-stream?
-  int end_of_stream;
-
-} lzvn_decoder_state;
-
 /*! @abstract Load bytes from memory location SRC. */
 LZFSE_INLINE uint16_t load2(const void *ptr) {
   uint16_t data;
-  memcpy(&data, ptr, sizeof data);
+  LZVN_MEMCPY(&data, ptr, sizeof data);
   return data;
 }
 
 LZFSE_INLINE uint32_t load4(const void *ptr) {
   uint32_t data;
-  memcpy(&data, ptr, sizeof data);
+  LZVN_MEMCPY(&data, ptr, sizeof data);
   return data;
 }
 
 LZFSE_INLINE uint64_t load8(const void *ptr) {
   uint64_t data;
-  memcpy(&data, ptr, sizeof data);
+  LZVN_MEMCPY(&data, ptr, sizeof data);
   return data;
 }
 
 /*! @abstract Store bytes to memory location DST. */
 LZFSE_INLINE void store4(void *ptr, uint32_t data) {
-  memcpy(ptr, &data, sizeof data);
+  LZVN_MEMCPY(ptr, &data, sizeof data);
 }
 
 LZFSE_INLINE void store8(void *ptr, uint64_t data) {
-  memcpy(ptr, &data, sizeof data);
+  LZVN_MEMCPY(ptr, &data, sizeof data);
+}
+
+/*! @abstract Copy 16 bytes from SRC to DST. Both loads happen before the
+ * stores, so SRC may be at most 8 bytes before DST. */
+LZFSE_INLINE void copy16(unsigned char *dst, const unsigned char *src) {
+  uint64_t lo = load8(src);
+  uint64_t hi = load8(src + 8);
+  store8(dst, lo);
+  store8(dst + 8, hi);
+}
+
+/*! @abstract Copy 32 bytes from SRC to DST, which must not overlap. */
+LZFSE_INLINE void copy32(unsigned char *dst, const unsigned char *src) {
+  copy16(dst, src);
+  copy16(dst + 16, src + 16);
 }
 
 /*! @abstract Extracts \p width bits from \p container, starting with \p lsb; if
@@ -542,14 +526,35 @@ copy_match:
   //
   //  i.e. it splats the previous byte. This means that we need to be very
   //  careful about using wide loads or stores to perform the copy operation.
-  if (__builtin_expect(dst_len >= M + 7 && D >= 8, 1)) {
+  if (__builtin_expect(dst_len >= M + 31 && D >= 32, 1)) {
     //  We are not near the end of the buffer, and the match distance
-    //  is at least eight. Thus, we can safely loop using eight byte
-    //  copies. The last of these may slop over the intended end of
-    //  the match, but this is OK because we know we have a safety bound
-    //  away from the end of the destination buffer.
+    //  is at least 32. Thus, we can safely loop using 32 byte copies.
+    //  The last of these may slop over the intended end of the match,
+    //  but this is OK because we know we have a safety bound away from
+    //  the end of the destination buffer. Most matches fit in one copy.
+    for (size_t i = 0; i < M; i += 32)
+      copy32(&dst_ptr[i], dst_ptr + i - D);
+  } else if (__builtin_expect(dst_len >= M + 15 && D >= 16, 1)) {
+    //  Same as above with 16 byte copies for shorter distances.
+    for (size_t i = 0; i < M; i += 16)
+      copy16(&dst_ptr[i], dst_ptr + i - D);
+  } else if (__builtin_expect(dst_len >= M + 7 && D >= 8, 1)) {
+    //  Same as above with 8 byte copies for shorter distances.
     for (size_t i = 0; i < M; i += 8)
       store8(&dst_ptr[i], load8(dst_ptr + i - D));
+  } else if (dst_len >= M + 7) {
+    //  The match distance is below eight, so the copy overlaps its own
+    //  output. Only the first D bytes of each eight byte copy are read
+    //  from final output, so advance by D. A distance of one is a byte
+    //  fill, which is written directly.
+    if (D == 1) {
+      uint64_t fill = dst_ptr[-1] * 0x0101010101010101ULL;
+      for (size_t i = 0; i < M; i += 8)
+        store8(&dst_ptr[i], fill);
+    } else {
+      for (size_t i = 0; i < M; i += D)
+        store8(&dst_ptr[i], load8(dst_ptr + i - D));
+    }
   } else if (M <= dst_len) {
     //  Either the match distance is too small, or we are too close to
     //  the end of the buffer to safely use eight byte copies. Fall back
@@ -615,6 +620,10 @@ sml_m:
   if (src_len <= opc_len)
     return; // source truncated
   M = (size_t)extract(opc, 0, 4);
+  //  A match-only opcode needs a previous match distance. Without one the
+  //  copy would expose stale destination bytes.
+  if (D == 0)
+    goto invalid_match_distance;
   PTR_LEN_INC(src_ptr, src_len, opc_len);
   goto copy_match;
 
@@ -633,6 +642,8 @@ lrg_m:
   if (src_len <= opc_len)
     return; // source truncated
   M = src_ptr[1] + 16;
+  if (D == 0)
+    goto invalid_match_distance;
   PTR_LEN_INC(src_ptr, src_len, opc_len);
   goto copy_match;
 
@@ -693,10 +704,19 @@ copy_literal:
     return; // source truncated
   PTR_LEN_INC(src_ptr, src_len, opc_len);
   //  Now we copy the literal from the source pointer to the destination.
-  if (dst_len >= L + 7 && src_len >= L + 7) {
+  if (dst_len >= L + 15 && src_len >= L + 15) {
     //  We are not near the end of the source or destination buffers; thus
     //  we can safely copy the literal using wide copies, without worrying
-    //  about reading or writing past the end of either buffer.
+    //  about reading or writing past the end of either buffer. Large
+    //  literals are copied 32 bytes at a time and the tail is completed
+    //  with 16 byte copies.
+    size_t i = 0;
+    for (; i + 16 < L; i += 32)
+      copy32(&dst_ptr[i], &src_ptr[i]);
+    for (; i < L; i += 16)
+      copy16(&dst_ptr[i], &src_ptr[i]);
+  } else if (dst_len >= L + 7 && src_len >= L + 7) {
+    //  Same as above with 8 byte copies closer to the buffer end.
     for (size_t i = 0; i < L; i += 8)
       store8(&dst_ptr[i], load8(&src_ptr[i]));
   } else if (L <= dst_len) {
@@ -843,3 +863,110 @@ size_t lzvn_decode_buffer(unsigned char *dst, size_t dst_size,
   // This is how much we decompressed
   return dstate.dst - dst;
 }
+
+//  Streaming decoder. Source blocks are decoded in place, while an incomplete
+//  instruction at block end is carried over to the next block. The longest
+//  instruction is a large literal of 2 + 271 bytes, and the decoder needs one
+//  more byte after it to see the next opcode.
+#define LZVN_STREAM_CARRY_SIZE 512
+
+typedef struct {
+  lzvn_decoder_state state;
+  // Bytes of an incomplete instruction from previous blocks
+  size_t carry_len;
+  unsigned char carry[LZVN_STREAM_CARRY_SIZE];
+  // Decoder reached end-of-stream, full destination, or invalid data
+  int done;
+} lzvn_stream;
+
+void *lzvn_decode_stream_init(unsigned char *dst, size_t dst_size) {
+  lzvn_stream *stream;
+
+  if (dst_size > OC_COMPRESSION_MAX_LENGTH) {
+    return NULL;
+  }
+
+  stream = AllocateZeroPool(sizeof(*stream));
+  if (stream == NULL) {
+    return NULL;
+  }
+
+  stream->state.dst_begin = dst;
+  stream->state.dst = dst;
+  stream->state.dst_end = dst + dst_size;
+
+  return stream;
+}
+
+//  Decode [src, src + src_size) and return the amount of consumed bytes.
+static size_t lzvn_decode_stream_block(lzvn_stream *stream,
+                                       const unsigned char *src,
+                                       size_t src_size) {
+  stream->state.src = src;
+  stream->state.src_end = src + src_size;
+  lzvn_decode(&stream->state);
+
+  if (stream->state.end_of_stream || stream->state.dst == stream->state.dst_end)
+    stream->done = 1;
+
+  return stream->state.src - src;
+}
+
+uint8_t lzvn_decode_stream_feed(void *opaque, const unsigned char *src,
+                            size_t src_size) {
+  lzvn_stream *stream = opaque;
+  size_t copy_len;
+  size_t used;
+
+  while (!stream->done && src_size > 0) {
+    if (stream->carry_len > 0) {
+      // Complete carried instruction with new bytes and decode it.
+      copy_len = LZVN_STREAM_CARRY_SIZE - stream->carry_len;
+      if (copy_len > src_size)
+        copy_len = src_size;
+      memcpy(stream->carry + stream->carry_len, src, copy_len);
+      used = lzvn_decode_stream_block(stream, stream->carry,
+                                      stream->carry_len + copy_len);
+      if (used >= stream->carry_len) {
+        // Continue right in the new block.
+        src += used - stream->carry_len;
+        src_size -= used - stream->carry_len;
+        stream->carry_len = 0;
+        continue;
+      }
+
+      // Still not enough bytes for the carried instruction.
+      stream->carry_len += copy_len - used;
+      memmove(stream->carry, stream->carry + used, stream->carry_len);
+      src += copy_len;
+      src_size -= copy_len;
+      if (stream->carry_len == LZVN_STREAM_CARRY_SIZE)
+        stream->done = 1; // invalid data
+      continue;
+    }
+
+    used = lzvn_decode_stream_block(stream, src, src_size);
+    src += used;
+    src_size -= used;
+    if (src_size >= LZVN_STREAM_CARRY_SIZE) {
+      stream->done = 1; // invalid data
+      break;
+    }
+
+    memcpy(stream->carry, src, src_size);
+    stream->carry_len = src_size;
+    src_size = 0;
+  }
+
+  return !stream->done;
+}
+
+size_t lzvn_decode_stream_free(void *opaque) {
+  lzvn_stream *stream = opaque;
+  size_t length;
+
+  length = stream->state.dst - stream->state.dst_begin;
+  FreePool(stream);
+
+  return length;
+}
@@ -16,9 +16,14 @@
 #define LZVN_H
 
 #include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/OcCompressionLib.h>
 
 #define lzvn_decode_buffer DecompressLZVN
+#define lzvn_encode_buffer CompressLZVN
+#define lzvn_decode_stream_init DecompressLZVNStreamInit
+#define lzvn_decode_stream_feed DecompressLZVNStreamFeed
+#define lzvn_decode_stream_free DecompressLZVNStreamFree
 
 #ifdef EFIUSER
 #include <stdint.h>
@@ -34,10 +39,12 @@
 #define size_t UINTN
 
 #else
+typedef UINT8 uint8_t;
 typedef UINT16 uint16_t;
 typedef UINT32 uint32_t;
 typedef UINT64 uint64_t;
 
+typedef INT8 int8_t;
 typedef INT16 int16_t;
 typedef INT32 int32_t;
 typedef INT64 int64_t;
@@ -53,9 +60,58 @@ typedef UINTN uintmax_t;
 #undef memcpy
 #endif
 
+#ifdef memmove
+#undef memmove
+#endif
+
 #define memset(Dst, Value, Size) SetMem ((Dst), (Size), (UINT8)(Value))
 #define memcpy(Dst, Src, Size) CopyMem ((Dst), (Src), (Size))
+#define memmove(Dst, Src, Size) CopyMem ((Dst), (Src), (Size))
+
+#endif
 
+/*! @abstract Signed offset in buffers, stored on either 32 or 64 bits. */
+#if defined(_M_AMD64) || defined(__x86_64__) || defined(__arm64__)
+typedef int64_t lzvn_offset;
+#else
+typedef int32_t lzvn_offset;
 #endif
 
+/*! @abstract Base decoder state. */
+typedef struct {
+
+  // Decoder I/O
+
+  // Next byte to read in source buffer
+  const unsigned char *src;
+  // Next byte after source buffer
+  const unsigned char *src_end;
+
+  // Next byte to write in destination buffer (by decoder)
+  unsigned char *dst;
+  // Valid range for destination buffer is [dst_begin, dst_end - 1]
+  unsigned char *dst_begin;
+  unsigned char *dst_end;
+  // Next byte to read in destination buffer (modified by caller)
+  unsigned char *dst_current;
+
+  // Decoder state
+
+  // Partially expanded match, or 0,0,0.
+  // In that case, src points to the next literal to copy, or the next op-code
+  // if L==0.
+  size_t L, M, D;
+
+  // Distance for last emitted match, or 0
+  lzvn_offset d_prev;
+
+  // Did we decode end-of-stream?
+  int end_of_stream;
+
+} lzvn_decoder_state;
+
+/*! @abstract Decode source to destination.
+ *  Updates \p state (src,dst,d_prev). */
+void lzvn_decode(lzvn_decoder_state *state);
+
 #endif /* LZVN_H */
@@ -0,0 +1,299 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+// LZVN encoder
+
+#include "lzvn.h"
+
+//  Matches are found through hash chains of 4-byte prefixes. Heads are kept
+//  per hash value and each position links to the previous one with the same
+//  hash within the window, which is bounded by the largest distance that
+//  lrg_d can encode.
+#define LZVN_HASH_BITS 16
+#define LZVN_HASH_SIZE (1U << LZVN_HASH_BITS)
+#define LZVN_WINDOW_SIZE 0x10000U
+#define LZVN_MAX_DISTANCE (LZVN_WINDOW_SIZE - 1)
+#define LZVN_MIN_MATCH 4
+#define LZVN_NO_POS 0xFFFFFFFFU
+
+//  Longest literal and match encoded by a single lrg_l and lrg_m opcode.
+#define LZVN_MAX_LITERAL 271
+#define LZVN_MAX_MATCH 271
+
+//  Size of the end-of-stream opcode.
+#define LZVN_EOS_SIZE 8
+
+typedef struct {
+  unsigned char *dst;
+  unsigned char *dst_end;
+  const unsigned char *src;
+  const unsigned char *src_end;
+  // Last match distance, reused by pre_d and match-only opcodes
+  size_t d_prev;
+  // Hash chain heads and links
+  uint32_t *head;
+  uint32_t *chain;
+} lzvn_encoder_state;
+
+static inline uint32_t lzvn_hash(const unsigned char *ptr) {
+  uint32_t data = (uint32_t)ptr[0] | (uint32_t)ptr[1] << 8 |
+                  (uint32_t)ptr[2] << 16 | (uint32_t)ptr[3] << 24;
+  return (data * 2654435761U) >> (32 - LZVN_HASH_BITS);
+}
+
+static inline void lzvn_insert(lzvn_encoder_state *state, uint32_t pos) {
+  uint32_t hash = lzvn_hash(state->src + pos);
+  state->chain[pos & (LZVN_WINDOW_SIZE - 1)] = state->head[hash];
+  state->head[hash] = pos;
+}
+
+//  Find the longest match for pos among at most effort candidates.
+//  Returns match length, or 0 when there is none of at least LZVN_MIN_MATCH.
+static size_t lzvn_find_match(lzvn_encoder_state *state, uint32_t pos,
+                              uint32_t effort, size_t *distance) {
+  const unsigned char *cur = state->src + pos;
+  size_t avail = state->src_end - cur;
+  size_t best = 0;
+  uint32_t cand = state->head[lzvn_hash(cur)];
+
+  while (cand != LZVN_NO_POS && effort-- > 0) {
+    size_t d = pos - cand;
+    if (d > LZVN_MAX_DISTANCE)
+      break;
+
+    const unsigned char *ref = state->src + cand;
+    if (ref[best] == cur[best]) {
+      size_t len = 0;
+      while (len < avail && ref[len] == cur[len])
+        ++len;
+      if (len > best) {
+        best = len;
+        *distance = d;
+        if (len == avail)
+          break;
+      }
+    }
+
+    uint32_t next = state->chain[cand & (LZVN_WINDOW_SIZE - 1)];
+    if (next == LZVN_NO_POS || next >= cand)
+      break;
+    cand = next;
+  }
+
+  return best >= LZVN_MIN_MATCH ? best : 0;
+}
+
+static inline int lzvn_put(lzvn_encoder_state *state, const unsigned char *data,
+                           size_t size) {
+  if ((size_t)(state->dst_end - state->dst) < size)
+    return 0;
+  memcpy(state->dst, data, size);
+  state->dst += size;
+  return 1;
+}
+
+//  Emit literal-only opcodes for size bytes: sml_l 1110LLLL or
+//  lrg_l 11100000 LLLLLLLL with a bias of 16.
+static int lzvn_emit_literal(lzvn_encoder_state *state,
+                             const unsigned char *lit, size_t size) {
+  unsigned char opc[2];
+
+  while (size > 0) {
+    size_t len = size > LZVN_MAX_LITERAL ? LZVN_MAX_LITERAL : size;
+    if (len < 16) {
+      opc[0] = (unsigned char)(0xE0 | len);
+      if (!lzvn_put(state, opc, 1))
+        return 0;
+    } else {
+      opc[0] = 0xE0;
+      opc[1] = (unsigned char)(len - 16);
+      if (!lzvn_put(state, opc, 2))
+        return 0;
+    }
+    if (!lzvn_put(state, lit, len))
+      return 0;
+    lit += len;
+    size -= len;
+  }
+
+  return 1;
+}
+
+//  Emit match-only opcodes reusing the previous distance: sml_m 1111MMMM or
+//  lrg_m 11110000 MMMMMMMM with a bias of 16.
+static int lzvn_emit_match_only(lzvn_encoder_state *state, size_t size) {
+  unsigned char opc[2];
+
+  while (size > 0) {
+    size_t len = size > LZVN_MAX_MATCH ? LZVN_MAX_MATCH : size;
+    if (len < 16) {
+      opc[0] = (unsigned char)(0xF0 | len);
+      if (!lzvn_put(state, opc, 1))
+        return 0;
+    } else {
+      opc[0] = 0xF0;
+      opc[1] = (unsigned char)(len - 16);
+      if (!lzvn_put(state, opc, 2))
+        return 0;
+    }
+    size -= len;
+  }
+
+  return 1;
+}
+
+//  Emit a literal of up to 3 bytes followed by a match. Opcodes with a
+//  literal leave fewer match length values defined, so the longest match
+//  carried by LLMMMxxx depends on the literal length; the rest of the match
+//  is emitted with match-only opcodes.
+static int lzvn_emit_match(lzvn_encoder_state *state, const unsigned char *lit,
+                           size_t L, size_t M, size_t D) {
+  static const size_t max_sml_match[4] = {10, 8, 6, 4};
+  unsigned char opc[3];
+  size_t opc_len;
+  size_t M1;
+
+  if (L == 0 && D == state->d_prev)
+    return lzvn_emit_match_only(state, M);
+
+  M1 = M > max_sml_match[L] ? max_sml_match[L] : M;
+  if (D == state->d_prev) {
+    // pre_d: LLMMM110
+    opc[0] = (unsigned char)(L << 6 | (M1 - 3) << 3 | 6);
+    opc_len = 1;
+  } else if (D < 0x600) {
+    // sml_d: LLMMMDDD DDDDDDDD
+    opc[0] = (unsigned char)(L << 6 | (M1 - 3) << 3 | D >> 8);
+    opc[1] = (unsigned char)D;
+    opc_len = 2;
+  } else if (D < 0x4000) {
+    // med_d: 101LLMMM DDDDDDMM DDDDDDDD
+    M1 = M > 34 ? 34 : M;
+    opc[0] = (unsigned char)(0xA0 | L << 3 | (M1 - 3) >> 2);
+    opc[1] = (unsigned char)(D << 2 | ((M1 - 3) & 3));
+    opc[2] = (unsigned char)(D >> 6);
+    opc_len = 3;
+  } else {
+    // lrg_d: LLMMM111 DDDDDDDD DDDDDDDD
+    opc[0] = (unsigned char)(L << 6 | (M1 - 3) << 3 | 7);
+    opc[1] = (unsigned char)D;
+    opc[2] = (unsigned char)(D >> 8);
+    opc_len = 3;
+  }
+
+  if (!lzvn_put(state, opc, opc_len) || !lzvn_put(state, lit, L))
+    return 0;
+  state->d_prev = D;
+
+  return lzvn_emit_match_only(state, M - M1);
+}
+
+unsigned char *lzvn_encode_buffer(unsigned char *dst, size_t dst_size,
+                                  const unsigned char *src, size_t src_size,
+                                  uint32_t effort) {
+  static const unsigned char eos[LZVN_EOS_SIZE] = {0x06};
+  lzvn_encoder_state state;
+  uint32_t pos;
+  uint32_t lit_start;
+  uint32_t hash_end;
+  uint32_t hashed;
+  size_t len;
+  size_t dist;
+  size_t next_len;
+  size_t next_dist;
+  size_t lit_len;
+  int success;
+
+  if (dst_size > OC_COMPRESSION_MAX_LENGTH ||
+      src_size > OC_COMPRESSION_MAX_LENGTH) {
+    return NULL;
+  }
+
+  if (effort == 0)
+    effort = OC_LZVN_DEFAULT_EFFORT;
+
+  memset(&state, 0, sizeof(state));
+  state.dst = dst;
+  state.dst_end = dst + dst_size;
+  state.src = src;
+  state.src_end = src + src_size;
+  state.head = AllocatePool(LZVN_HASH_SIZE * sizeof(uint32_t));
+  state.chain = AllocatePool(LZVN_WINDOW_SIZE * sizeof(uint32_t));
+  if (state.head == NULL || state.chain == NULL) {
+    if (state.head != NULL)
+      FreePool(state.head);
+    if (state.chain != NULL)
+      FreePool(state.chain);
+    return NULL;
+  }
+  memset(state.head, 0xFF, LZVN_HASH_SIZE * sizeof(uint32_t));
+
+  //  Positions starting fewer than LZVN_MIN_MATCH bytes before the end
+  //  cannot be hashed and are always emitted as literals.
+  hash_end = src_size >= LZVN_MIN_MATCH
+                 ? (uint32_t)(src_size - LZVN_MIN_MATCH + 1)
+                 : 0;
+  pos = 0;
+  lit_start = 0;
+  hashed = 0;
+  success = 1;
+
+  while (pos < hash_end) {
+    //  Candidates are all earlier positions.
+    for (; hashed < pos; ++hashed)
+      lzvn_insert(&state, hashed);
+
+    len = lzvn_find_match(&state, pos, effort, &dist);
+    if (len == 0) {
+      ++pos;
+      continue;
+    }
+
+    //  Lazy evaluation: prefer a longer match starting at the next byte.
+    if (pos + 1 < hash_end) {
+      lzvn_insert(&state, hashed++);
+      next_len = lzvn_find_match(&state, pos + 1, effort, &next_dist);
+      if (next_len > len + 1) {
+        ++pos;
+        len = next_len;
+        dist = next_dist;
+      }
+    }
+
+    //  Up to 3 pending literal bytes fit into the match opcode.
+    lit_len = pos - lit_start;
+    if (lit_len > 3) {
+      success = lzvn_emit_literal(&state, src + lit_start, lit_len & ~(size_t)3);
+      lit_start += (uint32_t)(lit_len & ~(size_t)3);
+      lit_len &= 3;
+    }
+    if (success)
+      success = lzvn_emit_match(&state, src + lit_start, lit_len, len, dist);
+    if (!success)
+      break;
+
+    pos += (uint32_t)len;
+    lit_start = pos;
+  }
+
+  if (success)
+    success = lzvn_emit_literal(&state, src + lit_start, src_size - lit_start);
+  if (success)
+    success = lzvn_put(&state, eos, sizeof(eos));
+
+  FreePool(state.head);
+  FreePool(state.chain);
+
+  return success ? state.dst : NULL;
+}
@@ -67,6 +67,14 @@ uLong ZEXPORT adler32_z(adler, buf, len)
 {
     unsigned long sum2;
     unsigned n;
+    z_size_t done;
+
+    /* process the bulk of long buffers with vector code when supported */
+    if (buf != Z_NULL) {
+        done = adler32_simd_(&adler, buf, len);
+        buf += done;
+        len -= done;
+    }
 
     /* split Adler-32 into component sums */
     sum2 = (adler >> 16) & 0xffff;
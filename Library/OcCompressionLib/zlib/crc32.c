@@ -760,6 +760,15 @@ unsigned long ZEXPORT crc32_z(crc, buf, len)
     /* Pre-condition the CRC */
     crc = (~crc) & 0xffffffff;
 
+    /* Process the bulk of long buffers with vector code when supported. */
+    {
+        z_size_t done;
+
+        done = crc32_simd_(&crc, buf, len);
+        buf += done;
+        len -= done;
+    }
+
 #ifdef W
 
     /* If provided enough bytes, do a braided CRC calculation. */
@@ -0,0 +1,500 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include "zutil.h"
+
+#include <Library/BaseLib.h>
+#include <Library/OcCompressionLib.h>
+
+#if defined (MDE_CPU_X64) && (defined (__GNUC__) || defined (__clang__))
+  #include <Register/Intel/Cpuid.h>
+
+//
+// Vector checksums rely on GCC vector extensions, x86 builtins and
+// per-function targets.
+//
+  #define OC_CHECKSUM_VECTOR
+#endif
+
+//
+// Minimal buffer size for vector checksums, shorter buffers are left to zlib.
+//
+#define OC_CHECKSUM_VECTOR_MIN  64U
+
+//
+// Adler-32 modulo and the largest amount of bytes summed before reduction,
+// see adler32.c.
+//
+#define OC_ADLER32_BASE  65521U
+#define OC_ADLER32_NMAX  5552U
+
+//
+// Bytes consumed by a single vector Adler-32 iteration.
+//
+#define OC_ADLER32_BLOCK  32U
+
+//
+// Amount of vector Adler-32 iterations before reduction.
+//
+#define OC_ADLER32_MAX_BLOCKS  (OC_ADLER32_NMAX / OC_ADLER32_BLOCK)
+
+//
+// Selected checksum implementation.
+//
+STATIC OC_CHECKSUM_MODE  mChecksumMode;
+STATIC BOOLEAN           mChecksumModeReady;
+
+//
+// CRC-32 folding is available, used in vector modes.
+//
+STATIC BOOLEAN  mChecksumPclmul;
+
+#ifdef OC_CHECKSUM_VECTOR
+
+typedef CHAR8 OC_CHECKSUM_B16 __attribute__ ((vector_size (16)));
+typedef INT16 OC_CHECKSUM_W16 __attribute__ ((vector_size (16)));
+typedef UINT32 OC_CHECKSUM_D16 __attribute__ ((vector_size (16)));
+typedef INT64 OC_CHECKSUM_Q16 __attribute__ ((vector_size (16)));
+typedef CHAR8 OC_CHECKSUM_B32 __attribute__ ((vector_size (32)));
+typedef INT16 OC_CHECKSUM_W32 __attribute__ ((vector_size (32)));
+typedef UINT32 OC_CHECKSUM_D32 __attribute__ ((vector_size (32)));
+
+/**
+  Update Adler-32 with SSSE3.
+
+  Every iteration sums 32 bytes into S1 with PSADBW and their positional
+  weights 32..1 into S2 with PMADDUBSW. S2 also receives 32 times S1 of
+  all the preceding iterations, which is accumulated separately.
+
+  @param[in] Adler   Current Adler-32 value.
+  @param[in] Buffer  Source buffer.
+  @param[in] Blocks  Amount of OC_ADLER32_BLOCK byte blocks to process.
+
+  @return  Updated Adler-32 value.
+**/
+STATIC
+__attribute__ ((target ("ssse3")))
+UINT32
+InternalAdler32Ssse3 (
+  IN UINT32       Adler,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Blocks
+  )
+{
+  CONST OC_CHECKSUM_B16  Tap1 = { 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17 };
+  CONST OC_CHECKSUM_B16  Tap2 = { 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+  CONST OC_CHECKSUM_W16  Ones = { 1, 1, 1, 1, 1, 1, 1, 1 };
+  CONST OC_CHECKSUM_B16  Zero = { 0 };
+  OC_CHECKSUM_B16        Bytes1;
+  OC_CHECKSUM_B16        Bytes2;
+  OC_CHECKSUM_D16        VecS1;
+  OC_CHECKSUM_D16        VecS2;
+  OC_CHECKSUM_D16        VecPs;
+  UINT64                 Sum1;
+  UINT64                 Sum2;
+  UINTN                  Count;
+  UINTN                  Index;
+
+  Sum1 = Adler & 0xFFFFU;
+  Sum2 = Adler >> 16U;
+
+  while (Blocks > 0) {
+    Count   = Blocks < OC_ADLER32_MAX_BLOCKS ? Blocks : OC_ADLER32_MAX_BLOCKS;
+    Blocks -= Count;
+
+    Sum2 += Sum1 * OC_ADLER32_BLOCK * Count;
+
+    VecS1 = (OC_CHECKSUM_D16) { 0 };
+    VecS2 = (OC_CHECKSUM_D16) { 0 };
+    VecPs = (OC_CHECKSUM_D16) { 0 };
+
+    do {
+      __builtin_memcpy (&Bytes1, Buffer, sizeof (Bytes1));
+      __builtin_memcpy (&Bytes2, Buffer + sizeof (Bytes1), sizeof (Bytes2));
+
+      VecPs += VecS1;
+
+      VecS1 += (OC_CHECKSUM_D16)__builtin_ia32_psadbw128 (Bytes1, Zero);
+      VecS1 += (OC_CHECKSUM_D16)__builtin_ia32_psadbw128 (Bytes2, Zero);
+
+      VecS2 += (OC_CHECKSUM_D16)__builtin_ia32_pmaddwd128 (
+                                  __builtin_ia32_pmaddubsw128 (Bytes1, Tap1),
+                                  Ones
+                                  );
+      VecS2 += (OC_CHECKSUM_D16)__builtin_ia32_pmaddwd128 (
+                                  __builtin_ia32_pmaddubsw128 (Bytes2, Tap2),
+                                  Ones
+                                  );
+
+      Buffer += OC_ADLER32_BLOCK;
+    } while (--Count > 0);
+
+    for (Index = 0; Index < sizeof (VecS1) / sizeof (VecS1[0]); ++Index) {
+      Sum1 += VecS1[Index];
+      Sum2 += VecS2[Index] + (UINT64)VecPs[Index] * OC_ADLER32_BLOCK;
+    }
+
+    Sum1 %= OC_ADLER32_BASE;
+    Sum2 %= OC_ADLER32_BASE;
+  }
+
+  return (UINT32)(Sum1 | (Sum2 << 16U));
+}
+
+/**
+  Update Adler-32 with AVX2.
+
+  Same as InternalAdler32Ssse3, but all 32 bytes of an iteration
+  are processed at once.
+
+  @param[in] Adler   Current Adler-32 value.
+  @param[in] Buffer  Source buffer.
+  @param[in] Blocks  Amount of OC_ADLER32_BLOCK byte blocks to process.
+
+  @return  Updated Adler-32 value.
+**/
+STATIC
+__attribute__ ((target ("avx2")))
+UINT32
+InternalAdler32Avx2 (
+  IN UINT32       Adler,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Blocks
+  )
+{
+  CONST OC_CHECKSUM_B32  Tap  = {
+    32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+    16, 15, 14, 13, 12, 11, 10, 9,  8,  7,  6,  5,  4,  3,  2,  1
+  };
+  CONST OC_CHECKSUM_W32  Ones = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+  CONST OC_CHECKSUM_B32  Zero = { 0 };
+  OC_CHECKSUM_B32        Bytes;
+  OC_CHECKSUM_D32        VecS1;
+  OC_CHECKSUM_D32        VecS2;
+  OC_CHECKSUM_D32        VecPs;
+  UINT64                 Sum1;
+  UINT64                 Sum2;
+  UINTN                  Count;
+  UINTN                  Index;
+
+  Sum1 = Adler & 0xFFFFU;
+  Sum2 = Adler >> 16U;
+
+  while (Blocks > 0) {
+    Count   = Blocks < OC_ADLER32_MAX_BLOCKS ? Blocks : OC_ADLER32_MAX_BLOCKS;
+    Blocks -= Count;
+
+    Sum2 += Sum1 * OC_ADLER32_BLOCK * Count;
+
+    VecS1 = (OC_CHECKSUM_D32) { 0 };
+    VecS2 = (OC_CHECKSUM_D32) { 0 };
+    VecPs = (OC_CHECKSUM_D32) { 0 };
+
+    do {
+      __builtin_memcpy (&Bytes, Buffer, sizeof (Bytes));
+
+      VecPs += VecS1;
+      VecS1 += (OC_CHECKSUM_D32)__builtin_ia32_psadbw256 (Bytes, Zero);
+      VecS2 += (OC_CHECKSUM_D32)__builtin_ia32_pmaddwd256 (
+                                  __builtin_ia32_pmaddubsw256 (Bytes, Tap),
+                                  Ones
+                                  );
+
+      Buffer += OC_ADLER32_BLOCK;
+    } while (--Count > 0);
+
+    for (Index = 0; Index < sizeof (VecS1) / sizeof (VecS1[0]); ++Index) {
+      Sum1 += VecS1[Index];
+      Sum2 += VecS2[Index] + (UINT64)VecPs[Index] * OC_ADLER32_BLOCK;
+    }
+
+    Sum1 %= OC_ADLER32_BASE;
+    Sum2 %= OC_ADLER32_BASE;
+  }
+
+  return (UINT32)(Sum1 | (Sum2 << 16U));
+}
+
+/**
+  Update CRC-32 with PCLMULQDQ folding.
+
+  Based on "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+  Instruction" by V. Gopal, E. Ozturk, et al., 2009. Four 128-bit lanes are
+  folded by 64 bytes at a time, then into a single lane, which is reduced
+  to 32 bits with Barrett reduction. Constants are for the reflected
+  polynomial 0xEDB88320.
+
+  @param[in] Crc     Current pre-conditioned (inverted) CRC-32 value.
+  @param[in] Buffer  Source buffer.
+  @param[in] Length  Buffer length, at least 64 and a multiple of 16.
+
+  @return  Updated pre-conditioned CRC-32 value.
+**/
+STATIC
+__attribute__ ((target ("pclmul,sse2")))
+UINT32
+InternalCrc32Pclmul (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  CONST OC_CHECKSUM_Q16  K1K2 = { 0x0154442BD4, 0x01C6E41596 };
+  CONST OC_CHECKSUM_Q16  K3K4 = { 0x01751997D0, 0x00CCAA009E };
+  CONST OC_CHECKSUM_Q16  K5K0 = { 0x0163CD6124, 0x0000000000 };
+  CONST OC_CHECKSUM_Q16  Poly = { 0x01DB710641, 0x01F7011641 };
+  CONST OC_CHECKSUM_D16  Low  = { MAX_UINT32, 0, MAX_UINT32, 0 };
+  OC_CHECKSUM_Q16        X1;
+  OC_CHECKSUM_Q16        X2;
+  OC_CHECKSUM_Q16        X3;
+  OC_CHECKSUM_Q16        X4;
+  OC_CHECKSUM_Q16        Y1;
+  OC_CHECKSUM_Q16        Y2;
+  OC_CHECKSUM_Q16        Y3;
+  OC_CHECKSUM_Q16        Y4;
+  OC_CHECKSUM_D16        Dwords;
+
+  __builtin_memcpy (&X1, Buffer, sizeof (X1));
+  __builtin_memcpy (&X2, Buffer + 0x10, sizeof (X2));
+  __builtin_memcpy (&X3, Buffer + 0x20, sizeof (X3));
+  __builtin_memcpy (&X4, Buffer + 0x30, sizeof (X4));
+
+  X1[0] ^= Crc;
+
+  Buffer += 64;
+  Length -= 64;
+
+  //
+  // Fold by 4 lanes.
+  //
+  while (Length >= 64) {
+    Y1 = __builtin_ia32_pclmulqdq128 (X1, K1K2, 0x00);
+    Y2 = __builtin_ia32_pclmulqdq128 (X2, K1K2, 0x00);
+    Y3 = __builtin_ia32_pclmulqdq128 (X3, K1K2, 0x00);
+    Y4 = __builtin_ia32_pclmulqdq128 (X4, K1K2, 0x00);
+
+    X1 = __builtin_ia32_pclmulqdq128 (X1, K1K2, 0x11) ^ Y1;
+    X2 = __builtin_ia32_pclmulqdq128 (X2, K1K2, 0x11) ^ Y2;
+    X3 = __builtin_ia32_pclmulqdq128 (X3, K1K2, 0x11) ^ Y3;
+    X4 = __builtin_ia32_pclmulqdq128 (X4, K1K2, 0x11) ^ Y4;
+
+    __builtin_memcpy (&Y1, Buffer, sizeof (Y1));
+    __builtin_memcpy (&Y2, Buffer + 0x10, sizeof (Y2));
+    __builtin_memcpy (&Y3, Buffer + 0x20, sizeof (Y3));
+    __builtin_memcpy (&Y4, Buffer + 0x30, sizeof (Y4));
+
+    X1 ^= Y1;
+    X2 ^= Y2;
+    X3 ^= Y3;
+    X4 ^= Y4;
+
+    Buffer += 64;
+    Length -= 64;
+  }
+
+  //
+  // Fold into a single lane.
+  //
+  X1 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x00) ^ __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x11) ^ X2;
+  X1 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x00) ^ __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x11) ^ X3;
+  X1 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x00) ^ __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x11) ^ X4;
+
+  while (Length >= 16) {
+    __builtin_memcpy (&Y1, Buffer, sizeof (Y1));
+    X1 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x00) ^ __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x11) ^ Y1;
+
+    Buffer += 16;
+    Length -= 16;
+  }
+
+  //
+  // Fold 128 bits to 64 bits.
+  //
+  X2     = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x10);
+  X1     = (OC_CHECKSUM_Q16) { X1[1], 0 } ^ X2;
+  Dwords = (OC_CHECKSUM_D16)X1;
+  X2     = (OC_CHECKSUM_Q16)(OC_CHECKSUM_D16) { Dwords[1], Dwords[2], Dwords[3], 0 };
+  X1     = (OC_CHECKSUM_Q16)(Dwords & Low);
+  X1     = __builtin_ia32_pclmulqdq128 (X1, K5K0, 0x00) ^ X2;
+
+  //
+  // Barrett reduce to 32 bits.
+  //
+  X2 = (OC_CHECKSUM_Q16)((OC_CHECKSUM_D16)X1 & Low);
+  X2 = __builtin_ia32_pclmulqdq128 (X2, Poly, 0x10);
+  X2 = (OC_CHECKSUM_Q16)((OC_CHECKSUM_D16)X2 & Low);
+  X2 = __builtin_ia32_pclmulqdq128 (X2, Poly, 0x00);
+  X1 ^= X2;
+
+  return ((OC_CHECKSUM_D16)X1)[1];
+}
+
+/**
+  Detect the best supported checksum implementation.
+
+  @param[out] Pclmul  Set to TRUE when CRC-32 folding is supported.
+
+  @return  Checksum mode.
+**/
+STATIC
+OC_CHECKSUM_MODE
+InternalDetectChecksumMode (
+  OUT BOOLEAN  *Pclmul
+  )
+{
+  UINT32                                       MaxLeaf;
+  CPUID_VERSION_INFO_ECX                       VersionEcx;
+  CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_EBX  ExtendedEbx;
+  UINT32                                       Xcr0;
+  UINT32                                       Xcr0High;
+
+  AsmCpuid (CPUID_SIGNATURE, &MaxLeaf, NULL, NULL, NULL);
+  AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &VersionEcx.Uint32, NULL);
+
+  *Pclmul = VersionEcx.Bits.PCLMULQDQ != 0;
+
+  if (VersionEcx.Bits.SSSE3 == 0) {
+    return OcChecksumScalar;
+  }
+
+  //
+  // AVX2 also requires the OS (or TryEnableAccel) to enable YMM state
+  // saving in XCR0.
+  //
+  if (  (MaxLeaf < CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS)
+     || (VersionEcx.Bits.OSXSAVE == 0)
+     || (VersionEcx.Bits.AVX == 0))
+  {
+    return OcChecksumSsse3;
+  }
+
+  AsmCpuidEx (
+    CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS,
+    CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_SUB_LEAF_INFO,
+    NULL,
+    &ExtendedEbx.Uint32,
+    NULL,
+    NULL
+    );
+  if (ExtendedEbx.Bits.AVX2 == 0) {
+    return OcChecksumSsse3;
+  }
+
+  __asm__ __volatile__ ("xgetbv" : "=a" (Xcr0), "=d" (Xcr0High) : "c" (0));
+  if ((Xcr0 & (BIT1 | BIT2)) != (BIT1 | BIT2)) {
+    return OcChecksumSsse3;
+  }
+
+  return OcChecksumAvx2;
+}
+
+#else
+
+STATIC
+OC_CHECKSUM_MODE
+InternalDetectChecksumMode (
+  OUT BOOLEAN  *Pclmul
+  )
+{
+  *Pclmul = FALSE;
+  return OcChecksumScalar;
+}
+
+#endif
+
+OC_CHECKSUM_MODE
+OcSetChecksumMode (
+  IN OC_CHECKSUM_MODE  Mode
+  )
+{
+  OC_CHECKSUM_MODE  Supported;
+
+  Supported = InternalDetectChecksumMode (&mChecksumPclmul);
+
+  mChecksumMode      = Mode < Supported ? Mode : Supported;
+  mChecksumModeReady = TRUE;
+
+  return mChecksumMode;
+}
+
+OC_CHECKSUM_MODE
+OcGetChecksumMode (
+  VOID
+  )
+{
+  if (!mChecksumModeReady) {
+    mChecksumMode      = InternalDetectChecksumMode (&mChecksumPclmul);
+    mChecksumModeReady = TRUE;
+  }
+
+  return mChecksumMode;
+}
+
+z_size_t
+ZLIB_INTERNAL
+adler32_simd_ (
+  IN OUT uLong        *Adler,
+  IN     const Bytef  *Buffer,
+  IN     z_size_t     Length
+  )
+{
+ #ifdef OC_CHECKSUM_VECTOR
+  OC_CHECKSUM_MODE  Mode;
+  UINTN             Blocks;
+
+  if (Length < OC_CHECKSUM_VECTOR_MIN) {
+    return 0;
+  }
+
+  Mode   = OcGetChecksumMode ();
+  Blocks = Length / OC_ADLER32_BLOCK;
+
+  if (Mode == OcChecksumAvx2) {
+    *Adler = InternalAdler32Avx2 ((UINT32)*Adler, Buffer, Blocks);
+  } else if (Mode == OcChecksumSsse3) {
+    *Adler = InternalAdler32Ssse3 ((UINT32)*Adler, Buffer, Blocks);
+  } else {
+    return 0;
+  }
+
+  return Blocks * OC_ADLER32_BLOCK;
+ #else
+  return 0;
+ #endif
+}
+
+z_size_t
+ZLIB_INTERNAL
+crc32_simd_ (
+  IN OUT unsigned long        *Crc,
+  IN     const unsigned char  *Buffer,
+  IN     z_size_t             Length
+  )
+{
+ #ifdef OC_CHECKSUM_VECTOR
+  if (  (Length < OC_CHECKSUM_VECTOR_MIN)
+     || (OcGetChecksumMode () == OcChecksumScalar)
+     || !mChecksumPclmul)
+  {
+    return 0;
+  }
+
+  Length &= ~(z_size_t)15U;
+  *Crc    = InternalCrc32Pclmul ((UINT32)*Crc, Buffer, Length);
+
+  return Length;
+ #else
+  return 0;
+ #endif
+}
@@ -14,6 +14,7 @@
 
 #include "zutil.h"
 
+#include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/OcCompressionLib.h>
 
@@ -76,6 +77,88 @@ DecompressZLIB (
   return 0;
 }
 
+//
+// Bump allocator over the caller scratch buffer, nothing is ever freed.
+//
+typedef struct {
+  UINT8  *Next;
+  UINTN  Left;
+} ZLIB_SCRATCH;
+
+STATIC
+voidpf
+InternalScratchAlloc (
+  voidpf    Opaque,
+  unsigned  Items,
+  unsigned  Size
+  )
+{
+  ZLIB_SCRATCH  *Scratch;
+  UINTN         Length;
+  VOID          *Result;
+
+  Scratch = (ZLIB_SCRATCH *)Opaque;
+  Length  = ALIGN_VALUE ((UINTN)Items * Size, sizeof (UINT64));
+  if (Length > Scratch->Left) {
+    return NULL;
+  }
+
+  Result         = Scratch->Next;
+  Scratch->Next += Length;
+  Scratch->Left -= Length;
+  return Result;
+}
+
+STATIC
+VOID
+InternalScratchFree (
+  voidpf  Opaque,
+  voidpf  Ptr
+  )
+{
+}
+
+UINTN
+DecompressZLIBWithScratch (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen,
+  IN  VOID         *Scratch
+  )
+{
+  z_stream      Stream;
+  ZLIB_SCRATCH  Allocator;
+  int           Status;
+  UINTN         Result;
+
+  if (SrcLen > OC_COMPRESSION_MAX_LENGTH || DstLen > OC_COMPRESSION_MAX_LENGTH) {
+    return 0;
+  }
+
+  Allocator.Next = Scratch;
+  Allocator.Left = OC_DECOMPRESS_SCRATCH_SIZE;
+
+  ZeroMem (&Stream, sizeof (Stream));
+  Stream.next_in   = (Bytef *)Src;
+  Stream.avail_in  = (uInt)SrcLen;
+  Stream.next_out  = Dst;
+  Stream.avail_out = (uInt)DstLen;
+  Stream.zalloc    = InternalScratchAlloc;
+  Stream.zfree     = InternalScratchFree;
+  Stream.opaque    = &Allocator;
+
+  if (inflateInit (&Stream) != Z_OK) {
+    return 0;
+  }
+
+  Status = inflate (&Stream, Z_FINISH);
+  Result = Status == Z_STREAM_END ? Stream.total_out : 0;
+  inflateEnd (&Stream);
+
+  return Result;
+}
+
 UINT32
 Adler32 (
   IN CONST UINT8  *Buffer,
@@ -84,3 +167,12 @@ Adler32 (
 {
   return adler32 (1, Buffer, BufferLen);
 }
+
+UINT32
+Crc32 (
+  IN CONST UINT8  *Buffer,
+  IN UINTN        BufferLen
+  )
+{
+  return (UINT32)crc32_z (0, Buffer, BufferLen);
+}
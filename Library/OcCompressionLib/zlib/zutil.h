@@ -241,6 +241,10 @@ extern z_const char * const z_errmsg[10]; /* indexed by 2-zlib_error */
 #define zmemcmp(Ptr1, Ptr2, Size) CompareMem ((Ptr1), (Ptr2), (Size))
 #define zmemzero(Dst, Size) ZeroMem ((Dst), (Size))
 
+/* vector checksum kernels from zlib_simd.c, return the amount of bytes processed */
+z_size_t ZLIB_INTERNAL adler32_simd_ OF((uLong *adler, const Bytef *buf, z_size_t len));
+z_size_t ZLIB_INTERNAL crc32_simd_ OF((unsigned long *crc, const unsigned char *buf, z_size_t len));
+
 /* Diagnostic functions */
 #ifdef ZLIB_DEBUG
 #  include <stdio.h>
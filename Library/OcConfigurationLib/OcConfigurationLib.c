@@ -381,6 +381,7 @@ OC_SCHEMA
   OC_SCHEMA_BOOLEAN_IN ("FuzzyMatch",   OC_GLOBAL_CONFIG, Kernel.Scheme.FuzzyMatch),
   OC_SCHEMA_STRING_IN ("KernelArch",    OC_GLOBAL_CONFIG, Kernel.Scheme.KernelArch),
   OC_SCHEMA_STRING_IN ("KernelCache",   OC_GLOBAL_CONFIG, Kernel.Scheme.KernelCache),
+  OC_SCHEMA_BOOLEAN_IN ("KextLinkCache", OC_GLOBAL_CONFIG, Kernel.Scheme.KextLinkCache),
 };
 
 STATIC
@@ -64,6 +64,14 @@ NOTE:   String length must be evenly divisible by 16byte (str_len % 16 == 0)
 
 #include "CryptoInternal.h"
 
+#if defined (MDE_CPU_X64) && (defined (__GNUC__) || defined (__clang__))
+//
+// AES-NI relies on GCC vector extensions, x86 builtins and per-function
+// targets.
+//
+  #define OC_AES_NI
+#endif
+
 //
 // The number of columns comprising a state in AES (Nb). This is a CONSTant in AES. Value=4
 // The number of 32 bit words in a key (Nk).
@@ -578,10 +586,372 @@ XorWithIv (
   }
 }
 
+//
+// CPU features required by each OC_AES_MODE.
+//
+STATIC CONST UINT32  mAesModeFeatures[] = {
+  0,
+  OC_CPU_FEATURE_SSE2 | OC_CPU_FEATURE_AESNI
+};
+
+STATIC OC_CRYPTO_MODE  mAesMode = {
+  mAesModeFeatures,
+  ARRAY_SIZE (mAesModeFeatures),
+  OcAesNi
+};
+
+#ifdef OC_AES_NI
+
+typedef INT64 OC_AES_Q16 __attribute__ ((vector_size (16)));
+
+//
+// Amount of independent blocks processed together by CBC decryption and CTR.
+// AESENC and AESDEC latency is several times their throughput.
+//
+  #define OC_AES_NI_LANES  4
+
+STATIC
+OC_AES_Q16
+InternalAesLoad (
+  IN CONST UINT8  *Data
+  )
+{
+  OC_AES_Q16  Value;
+
+  __builtin_memcpy (&Value, Data, sizeof (Value));
+  return Value;
+}
+
+STATIC
+VOID
+InternalAesStore (
+  OUT UINT8       *Data,
+  IN  OC_AES_Q16  Value
+  )
+{
+  __builtin_memcpy (Data, &Value, sizeof (Value));
+}
+
+/**
+  Load expanded encryption key.
+
+  @param[out] Keys      Nr + 1 round keys.
+  @param[in]  RoundKey  Expanded key from KeyExpansion.
+**/
+STATIC
+VOID
+InternalAesLoadKeys (
+  OUT OC_AES_Q16   *Keys,
+  IN  CONST UINT8  *RoundKey
+  )
+{
+  UINT32  Round;
+
+  for (Round = 0; Round <= Nr; ++Round) {
+    Keys[Round] = InternalAesLoad (&RoundKey[Round * AES_BLOCK_SIZE]);
+  }
+}
+
+/**
+  Encrypt single block with AES-NI.
+
+  @param[in] Keys   Nr + 1 round keys.
+  @param[in] Block  Block to encrypt.
+
+  @return  Encrypted block.
+**/
+STATIC
+__attribute__ ((target ("aes,sse2")))
+OC_AES_Q16
+InternalAesEncryptBlockNi (
+  IN CONST OC_AES_Q16  *Keys,
+  IN OC_AES_Q16        Block
+  )
+{
+  UINT32  Round;
+
+  Block ^= Keys[0];
+  for (Round = 1; Round < Nr; ++Round) {
+    Block = __builtin_ia32_aesenc128 (Block, Keys[Round]);
+  }
+
+  return __builtin_ia32_aesenclast128 (Block, Keys[Nr]);
+}
+
+/**
+  Encrypt CBC blocks with AES-NI. Each block depends on the previous one,
+  so blocks are encrypted one after another.
+
+  @param[in,out] Context  AES context.
+  @param[in,out] Data     Blocks to encrypt in place.
+  @param[in]     BlockNb  Amount of AES_BLOCK_SIZE blocks.
+**/
+STATIC
+__attribute__ ((target ("aes,sse2")))
+VOID
+InternalAesCbcEncryptNi (
+  IN OUT AES_CONTEXT  *Context,
+  IN OUT UINT8        *Data,
+  IN     UINT32       BlockNb
+  )
+{
+  OC_AES_Q16  Keys[Nr + 1];
+  OC_AES_Q16  Iv;
+
+  InternalAesLoadKeys (Keys, Context->RoundKey);
+  Iv = InternalAesLoad (Context->Iv);
+
+  while (BlockNb > 0) {
+    Iv = InternalAesEncryptBlockNi (Keys, InternalAesLoad (Data) ^ Iv);
+    InternalAesStore (Data, Iv);
+    Data += AES_BLOCK_SIZE;
+    --BlockNb;
+  }
+
+  InternalAesStore (Context->Iv, Iv);
+}
+
+/**
+  Decrypt single block with AES-NI.
+
+  @param[in] Keys   Nr + 1 inverse cipher round keys.
+  @param[in] Block  Block to decrypt.
+
+  @return  Decrypted block.
+**/
+STATIC
+__attribute__ ((target ("aes,sse2")))
+OC_AES_Q16
+InternalAesDecryptBlockNi (
+  IN CONST OC_AES_Q16  *Keys,
+  IN OC_AES_Q16        Block
+  )
+{
+  UINT32  Round;
+
+  Block ^= Keys[0];
+  for (Round = 1; Round < Nr; ++Round) {
+    Block = __builtin_ia32_aesdec128 (Block, Keys[Round]);
+  }
+
+  return __builtin_ia32_aesdeclast128 (Block, Keys[Nr]);
+}
+
+/**
+  Decrypt CBC blocks with AES-NI. Decryption of different blocks is
+  independent, so OC_AES_NI_LANES blocks are decrypted at once.
+
+  @param[in,out] Context  AES context.
+  @param[in,out] Data     Blocks to decrypt in place.
+  @param[in]     BlockNb  Amount of AES_BLOCK_SIZE blocks.
+**/
+STATIC
+__attribute__ ((target ("aes,sse2")))
+VOID
+InternalAesCbcDecryptNi (
+  IN OUT AES_CONTEXT  *Context,
+  IN OUT UINT8        *Data,
+  IN     UINT32       BlockNb
+  )
+{
+  OC_AES_Q16  Keys[Nr + 1];
+  OC_AES_Q16  Iv;
+  OC_AES_Q16  Cipher[OC_AES_NI_LANES];
+  OC_AES_Q16  Block0;
+  OC_AES_Q16  Block1;
+  OC_AES_Q16  Block2;
+  OC_AES_Q16  Block3;
+  UINT32      Round;
+
+  //
+  // AESDEC expects the equivalent inverse cipher key schedule, which is
+  // the encryption schedule in reverse order with InvMixColumns applied
+  // to the inner round keys.
+  //
+  Keys[0] = InternalAesLoad (&Context->RoundKey[Nr * AES_BLOCK_SIZE]);
+  for (Round = 1; Round < Nr; ++Round) {
+    Keys[Round] = __builtin_ia32_aesimc128 (
+                    InternalAesLoad (&Context->RoundKey[(Nr - Round) * AES_BLOCK_SIZE])
+                    );
+  }
+
+  Keys[Nr] = InternalAesLoad (&Context->RoundKey[0]);
+
+  Iv = InternalAesLoad (Context->Iv);
+
+  while (BlockNb >= OC_AES_NI_LANES) {
+    Cipher[0] = InternalAesLoad (&Data[0 * AES_BLOCK_SIZE]);
+    Cipher[1] = InternalAesLoad (&Data[1 * AES_BLOCK_SIZE]);
+    Cipher[2] = InternalAesLoad (&Data[2 * AES_BLOCK_SIZE]);
+    Cipher[3] = InternalAesLoad (&Data[3 * AES_BLOCK_SIZE]);
+    Block0    = Cipher[0] ^ Keys[0];
+    Block1    = Cipher[1] ^ Keys[0];
+    Block2    = Cipher[2] ^ Keys[0];
+    Block3    = Cipher[3] ^ Keys[0];
+
+    for (Round = 1; Round < Nr; ++Round) {
+      Block0 = __builtin_ia32_aesdec128 (Block0, Keys[Round]);
+      Block1 = __builtin_ia32_aesdec128 (Block1, Keys[Round]);
+      Block2 = __builtin_ia32_aesdec128 (Block2, Keys[Round]);
+      Block3 = __builtin_ia32_aesdec128 (Block3, Keys[Round]);
+    }
+
+    Block0 = __builtin_ia32_aesdeclast128 (Block0, Keys[Nr]) ^ Iv;
+    Block1 = __builtin_ia32_aesdeclast128 (Block1, Keys[Nr]) ^ Cipher[0];
+    Block2 = __builtin_ia32_aesdeclast128 (Block2, Keys[Nr]) ^ Cipher[1];
+    Block3 = __builtin_ia32_aesdeclast128 (Block3, Keys[Nr]) ^ Cipher[2];
+    Iv     = Cipher[3];
+
+    InternalAesStore (&Data[0 * AES_BLOCK_SIZE], Block0);
+    InternalAesStore (&Data[1 * AES_BLOCK_SIZE], Block1);
+    InternalAesStore (&Data[2 * AES_BLOCK_SIZE], Block2);
+    InternalAesStore (&Data[3 * AES_BLOCK_SIZE], Block3);
+
+    Data    += OC_AES_NI_LANES * AES_BLOCK_SIZE;
+    BlockNb -= OC_AES_NI_LANES;
+  }
+
+  while (BlockNb > 0) {
+    Cipher[0] = InternalAesLoad (Data);
+    InternalAesStore (Data, InternalAesDecryptBlockNi (Keys, Cipher[0]) ^ Iv);
+    Iv = Cipher[0];
+
+    Data += AES_BLOCK_SIZE;
+    --BlockNb;
+  }
+
+  InternalAesStore (Context->Iv, Iv);
+}
+
+/**
+  Get next counter block.
+
+  @param[in,out] CounterHi  High half of big endian counter in host order.
+  @param[in,out] CounterLo  Low half of big endian counter in host order.
+
+  @return  Counter block before increment.
+**/
+STATIC
+OC_AES_Q16
+InternalAesNextCounter (
+  IN OUT UINT64  *CounterHi,
+  IN OUT UINT64  *CounterLo
+  )
+{
+  OC_AES_Q16  Block;
+
+  Block = (OC_AES_Q16) {
+    (INT64)__builtin_bswap64 (*CounterHi),
+    (INT64)__builtin_bswap64 (*CounterLo)
+  };
+
+  ++*CounterLo;
+  if (*CounterLo == 0) {
+    ++*CounterHi;
+  }
+
+  return Block;
+}
+
+/**
+  Encrypt or decrypt CTR blocks with AES-NI. Counter blocks are independent,
+  so OC_AES_NI_LANES blocks are processed at once.
+
+  @param[in,out] Context  AES context.
+  @param[in,out] Data     Blocks to process in place.
+  @param[in]     BlockNb  Amount of AES_BLOCK_SIZE blocks.
+**/
+STATIC
+__attribute__ ((target ("aes,sse2")))
+VOID
+InternalAesCtrXcryptNi (
+  IN OUT AES_CONTEXT  *Context,
+  IN OUT UINT8        *Data,
+  IN     UINT32       BlockNb
+  )
+{
+  OC_AES_Q16  Keys[Nr + 1];
+  OC_AES_Q16  Block0;
+  OC_AES_Q16  Block1;
+  OC_AES_Q16  Block2;
+  OC_AES_Q16  Block3;
+  UINT64      CounterHi;
+  UINT64      CounterLo;
+  UINT32      Round;
+
+  InternalAesLoadKeys (Keys, Context->RoundKey);
+
+  //
+  // The whole Iv is a 128-bit big endian counter.
+  //
+  __builtin_memcpy (&CounterHi, &Context->Iv[0], sizeof (CounterHi));
+  __builtin_memcpy (&CounterLo, &Context->Iv[8], sizeof (CounterLo));
+  CounterHi = __builtin_bswap64 (CounterHi);
+  CounterLo = __builtin_bswap64 (CounterLo);
+
+  while (BlockNb >= OC_AES_NI_LANES) {
+    Block0 = InternalAesNextCounter (&CounterHi, &CounterLo) ^ Keys[0];
+    Block1 = InternalAesNextCounter (&CounterHi, &CounterLo) ^ Keys[0];
+    Block2 = InternalAesNextCounter (&CounterHi, &CounterLo) ^ Keys[0];
+    Block3 = InternalAesNextCounter (&CounterHi, &CounterLo) ^ Keys[0];
+
+    for (Round = 1; Round < Nr; ++Round) {
+      Block0 = __builtin_ia32_aesenc128 (Block0, Keys[Round]);
+      Block1 = __builtin_ia32_aesenc128 (Block1, Keys[Round]);
+      Block2 = __builtin_ia32_aesenc128 (Block2, Keys[Round]);
+      Block3 = __builtin_ia32_aesenc128 (Block3, Keys[Round]);
+    }
+
+    Block0 = __builtin_ia32_aesenclast128 (Block0, Keys[Nr]);
+    Block1 = __builtin_ia32_aesenclast128 (Block1, Keys[Nr]);
+    Block2 = __builtin_ia32_aesenclast128 (Block2, Keys[Nr]);
+    Block3 = __builtin_ia32_aesenclast128 (Block3, Keys[Nr]);
+
+    Block0 ^= InternalAesLoad (&Data[0 * AES_BLOCK_SIZE]);
+    Block1 ^= InternalAesLoad (&Data[1 * AES_BLOCK_SIZE]);
+    Block2 ^= InternalAesLoad (&Data[2 * AES_BLOCK_SIZE]);
+    Block3 ^= InternalAesLoad (&Data[3 * AES_BLOCK_SIZE]);
+
+    InternalAesStore (&Data[0 * AES_BLOCK_SIZE], Block0);
+    InternalAesStore (&Data[1 * AES_BLOCK_SIZE], Block1);
+    InternalAesStore (&Data[2 * AES_BLOCK_SIZE], Block2);
+    InternalAesStore (&Data[3 * AES_BLOCK_SIZE], Block3);
+
+    Data    += OC_AES_NI_LANES * AES_BLOCK_SIZE;
+    BlockNb -= OC_AES_NI_LANES;
+  }
+
+  while (BlockNb > 0) {
+    Block0 = InternalAesEncryptBlockNi (
+               Keys,
+               InternalAesNextCounter (&CounterHi, &CounterLo)
+               );
+    InternalAesStore (Data, InternalAesLoad (Data) ^ Block0);
+
+    Data += AES_BLOCK_SIZE;
+    --BlockNb;
+  }
+
+  CounterHi = __builtin_bswap64 (CounterHi);
+  CounterLo = __builtin_bswap64 (CounterLo);
+  __builtin_memcpy (&Context->Iv[0], &CounterHi, sizeof (CounterHi));
+  __builtin_memcpy (&Context->Iv[8], &CounterLo, sizeof (CounterLo));
+}
+
+#endif
+
 //
 // Public functions
 //
 
+OC_AES_MODE
+OcSetAesMode (
+  IN OC_AES_MODE  Mode
+  )
+{
+  return (OC_AES_MODE)InternalSetCryptoMode (&mAesMode, Mode);
+}
+
 VOID
 AesCbcEncryptBuffer (
   IN OUT AES_CONTEXT  *Context,
@@ -592,6 +962,16 @@ AesCbcEncryptBuffer (
   UINT32  I;
   UINT8   *Iv;
 
+ #ifdef OC_AES_NI
+  if (InternalGetCryptoMode (&mAesMode) == OcAesNi) {
+    I = Len / AES_BLOCK_SIZE;
+    InternalAesCbcEncryptNi (Context, Data, I);
+    Data += I * AES_BLOCK_SIZE;
+    Len  -= I * AES_BLOCK_SIZE;
+  }
+
+ #endif
+
   Iv = Context->Iv;
 
   for (I = 0; I < Len; I += AES_BLOCK_SIZE) {
@@ -617,6 +997,16 @@ AesCbcDecryptBuffer (
   UINT32  I;
   UINT8   StoreNextIv[AES_BLOCK_SIZE];
 
+ #ifdef OC_AES_NI
+  if (InternalGetCryptoMode (&mAesMode) == OcAesNi) {
+    I = Len / AES_BLOCK_SIZE;
+    InternalAesCbcDecryptNi (Context, Data, I);
+    Data += I * AES_BLOCK_SIZE;
+    Len  -= I * AES_BLOCK_SIZE;
+  }
+
+ #endif
+
   for (I = 0; I < Len; I += AES_BLOCK_SIZE) {
     CopyMem (StoreNextIv, Data, AES_BLOCK_SIZE);
     InvCipher ((AES_INTERNAL_STATE *)Data, Context->RoundKey);
@@ -641,6 +1031,20 @@ AesCtrXcryptBuffer (
   UINT32  I;
   INT32   Bi;
 
+ #ifdef OC_AES_NI
+  //
+  // Full blocks are processed with AES-NI, the remaining bytes below
+  // start a new counter block as usual.
+  //
+  if (InternalGetCryptoMode (&mAesMode) == OcAesNi) {
+    I = Len / AES_BLOCK_SIZE;
+    InternalAesCtrXcryptNi (Context, Data, I);
+    Data += I * AES_BLOCK_SIZE;
+    Len  -= I * AES_BLOCK_SIZE;
+  }
+
+ #endif
+
   for (I = 0, Bi = AES_BLOCK_SIZE; I < Len; ++I, ++Bi) {
     //
     // We need to regen xor compliment in buffer
@@ -31,6 +31,27 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "BigNumLibInternal.h"
 
+#if defined (MDE_CPU_X64) && (defined (__GNUC__) || defined (__clang__))
+//
+// MULX and ADX Montgomery rows rely on GCC inline assembly.
+//
+  #define OC_BN_MONT_ADX
+#endif
+
+//
+// CPU features required by each OC_RSA_MODE.
+//
+STATIC CONST UINT32  mRsaModeFeatures[] = {
+  0,
+  OC_CPU_FEATURE_BMI2 | OC_CPU_FEATURE_ADX
+};
+
+STATIC OC_CRYPTO_MODE  mRsaMode = {
+  mRsaModeFeatures,
+  ARRAY_SIZE (mRsaModeFeatures),
+  OcRsaAdx
+};
+
 /**
   Calculates the Montgomery Inverse -1 / A mod 2^#Bits(Word).
   This algorithm is based on the Extended Euclidean Algorithm, which returns
@@ -384,142 +405,219 @@ BigNumMontMulRow (
   }
 }
 
-/**
-  Calculates the Montgomery product of A and B mod N.
+#ifdef OC_BN_MONT_ADX
 
-  @param[in,out] Result    The result buffer.
-  @param[in]     NumWords  The number of Words of Result, A, B and N.
-  @param[in]     A         The multiplicant.
+/**
+  Calculates the sum of Result and the product of AWord and B.
+  The products are accumulated with two independent carry chains, ADCX adds
+  the low Words and ADOX adds the high Words of the previous products.
+
+  @param[in,out] Result    The addend and the buffer to return the low
+                           NumWords Words of the result into.
+  @param[in]     NumWords  The number of Words of Result and B.
+  @param[in]     AWord     The multiplicant.
   @param[in]     B         The multiplier.
-  @param[in]     N         The modulus.
-  @param[in]     N0Inv     The Montgomery Inverse of N.
+
+  @returns  The most significant Word of the result.
 
 **/
 STATIC
-VOID
-BigNumMontMul (
+OC_BN_WORD
+BigNumMulAddRowAdx (
   IN OUT OC_BN_WORD        *Result,
   IN     OC_BN_NUM_WORDS   NumWords,
-  IN     CONST OC_BN_WORD  *A,
-  IN     CONST OC_BN_WORD  *B,
-  IN     CONST OC_BN_WORD  *N,
-  IN     OC_BN_WORD        N0Inv
+  IN     OC_BN_WORD        AWord,
+  IN     CONST OC_BN_WORD  *B
   )
 {
-  UINTN  RowIndex;
+  OC_BN_WORD  Lo;
+  OC_BN_WORD  Hi;
+  OC_BN_WORD  Carry;
+  OC_BN_WORD  Tmp;
+  UINTN       Count;
+
+  Count = NumWords;
+
+  //
+  // LEA and JRCXZ preserve both carry flags across the loop iterations.
+  //
+  __asm__ __volatile__ (
+    "xorl   %k[Carry], %k[Carry]\n\t"
+    "1:\n\t"
+    "mulxq  (%[B]), %[Lo], %[Hi]\n\t"
+    "movq   (%[Result]), %[Tmp]\n\t"
+    "adcxq  %[Lo], %[Tmp]\n\t"
+    "adoxq  %[Carry], %[Tmp]\n\t"
+    "movq   %[Tmp], (%[Result])\n\t"
+    "movq   %[Hi], %[Carry]\n\t"
+    "leaq   8(%[B]), %[B]\n\t"
+    "leaq   8(%[Result]), %[Result]\n\t"
+    "leaq   -1(%[Count]), %[Count]\n\t"
+    "jrcxz  2f\n\t"
+    "jmp    1b\n\t"
+    "2:\n\t"
+    "movl   $0, %k[Tmp]\n\t"
+    "adcxq  %[Tmp], %[Carry]\n\t"
+    "adoxq  %[Tmp], %[Carry]\n\t"
+    : [Result] "+r" (Result),
+    [B] "+r" (B),
+    [Count] "+c" (Count),
+    [Lo] "=&r" (Lo),
+    [Hi] "=&r" (Hi),
+    [Carry] "=&r" (Carry),
+    [Tmp] "=&r" (Tmp)
+    : "d" (AWord)
+    : "cc", "memory"
+    );
+
+  return Carry;
+}
 
-  ASSERT (Result != NULL);
-  ASSERT (NumWords > 0);
-  ASSERT (A != NULL);
-  ASSERT (B != NULL);
-  ASSERT (N != NULL);
-  ASSERT (N0Inv != 0);
+/**
+  Calculates the sum of Result and the product of TFirst and N, divided by
+  R = 2^#Bits (word). TFirst must be chosen so that the least significant
+  Word of the sum is 0.
 
-  ZeroMem (Result, OC_BN_SIZE (NumWords));
-  //
-  // RowIndex is used as an index into the words of A. Because this domain
-  // operates in mod 2^#Bits (word), 'row results' do not require multiplication
-  // as the positional factor is stripped by the word-size modulus.
-  //
-  for (RowIndex = 0; RowIndex < NumWords; ++RowIndex) {
-    BigNumMontMulRow (Result, NumWords, A[RowIndex], B, N, N0Inv);
-  }
+  @param[in,out] Result    The addend and the buffer to return the low
+                           NumWords - 1 Words of the result into.
+  @param[in]     NumWords  The number of Words of Result and N.
+  @param[in]     TFirst    The Montgomery Reduction factor.
+  @param[in]     N         The modulus.
 
-  //
-  // As this implementation only reduces mod N on overflow and not for every
-  // yes-instance of C >= N, any sequence of Montgomery Multiplications must be
-  // completed with a final reduction step.
-  //
+  @returns  The most significant Word of the result.
+
+**/
+STATIC
+OC_BN_WORD
+BigNumMontReduceRowAdx (
+  IN OUT OC_BN_WORD        *Result,
+  IN     OC_BN_NUM_WORDS   NumWords,
+  IN     OC_BN_WORD        TFirst,
+  IN     CONST OC_BN_WORD  *N
+  )
+{
+  OC_BN_WORD  Lo;
+  OC_BN_WORD  Hi;
+  OC_BN_WORD  Carry;
+  OC_BN_WORD  Tmp;
+  UINTN       Count;
+
+  Count = NumWords - 1U;
+
+  //
+  // The least significant Word is discarded, only its carry is used. The
+  // index shift of the stores divides the result by R.
+  //
+  __asm__ __volatile__ (
+    "xorl   %k[Tmp], %k[Tmp]\n\t"
+    "mulxq  (%[N]), %[Lo], %[Carry]\n\t"
+    "adcxq  (%[Result]), %[Lo]\n\t"
+    "jrcxz  2f\n\t"
+    "1:\n\t"
+    "mulxq  8(%[N]), %[Lo], %[Hi]\n\t"
+    "movq   8(%[Result]), %[Tmp]\n\t"
+    "adcxq  %[Lo], %[Tmp]\n\t"
+    "adoxq  %[Carry], %[Tmp]\n\t"
+    "movq   %[Tmp], (%[Result])\n\t"
+    "movq   %[Hi], %[Carry]\n\t"
+    "leaq   8(%[N]), %[N]\n\t"
+    "leaq   8(%[Result]), %[Result]\n\t"
+    "leaq   -1(%[Count]), %[Count]\n\t"
+    "jrcxz  2f\n\t"
+    "jmp    1b\n\t"
+    "2:\n\t"
+    "movl   $0, %k[Tmp]\n\t"
+    "adcxq  %[Tmp], %[Carry]\n\t"
+    "adoxq  %[Tmp], %[Carry]\n\t"
+    : [Result] "+r" (Result),
+    [N] "+r" (N),
+    [Count] "+c" (Count),
+    [Lo] "=&r" (Lo),
+    [Hi] "=&r" (Hi),
+    [Carry] "=&r" (Carry),
+    [Tmp] "=&r" (Tmp)
+    : "d" (TFirst)
+    : "cc", "memory"
+    );
+
+  return Carry;
 }
 
 /**
-  This is an optimized version of the call
-  BigNumMontMulRow (C, 0, A, N, N0Inv)
+  Calculates a row of the product of A and B mod N with MULX and ADX.
+  Matches BigNumMontMulRow, but performs the multiplication and the
+  Montgomery Reduction in two passes.
 
-  Calculates a row of the product of 0 and A mod N.
-
-  @param[in,out] Result  The result buffer.
-  @param[in]     NumWords  The number of Words of Result and N.
-  @param[in]     N       The modulus.
-  @param[in]     N0Inv   The Montgomery Inverse of N.
+  @param[in,out] Result    The result buffer.
+  @param[in]     NumWords  The number of Words of Result, B and N.
+  @param[in]     AWord     The current row's Word of the multiplicant.
+  @param[in]     B         The multiplier.
+  @param[in]     N         The modulus.
+  @param[in]     N0Inv     The Montgomery Inverse of N.
 
 **/
 STATIC
 VOID
-BigNumMontMulRow0 (
+BigNumMontMulRowAdx (
   IN OUT OC_BN_WORD        *Result,
   IN     OC_BN_NUM_WORDS   NumWords,
+  IN     OC_BN_WORD        AWord,
+  IN     CONST OC_BN_WORD  *B,
   IN     CONST OC_BN_WORD  *N,
   IN     OC_BN_WORD        N0Inv
   )
 {
-  UINTN  CompIndex;
-
+  OC_BN_WORD  CCurMulHi;
   OC_BN_WORD  CCurMontHi;
-  OC_BN_WORD  CCurMontLo;
   OC_BN_WORD  TFirst;
 
-  ASSERT (Result != NULL);
-  ASSERT (NumWords > 0);
-  ASSERT (N != NULL);
-  ASSERT (N0Inv != 0);
   //
-  // Montgomery Reduction preparation
-  // As N_first is reduced mod 2^#Bits (word), we reduce C as well.
-  // Due to the reduction, the high bits are discarded safely.
-  // t_first = C * N_first
+  // C = C + A*B
   //
-  TFirst = Result[0] * N0Inv;
+  CCurMulHi = BigNumMulAddRowAdx (Result, NumWords, AWord, B);
   //
-  // Montgomery Reduction
-  // 1. C = C + t_first * N
-  // 2. In the first step, only the carries are actually used, so the
-  //    division by R can be omited.
+  // C = (C + t_first * N) / R
   //
-  CCurMontLo = BigNumWordAddMul (&CCurMontHi, Result[0], TFirst, N[0]);
-  for (CompIndex = 1; CompIndex < NumWords; ++CompIndex) {
-    //
-    // Montgomery Reduction
-    // 1. C = C + t_first * N + carry
-    //
-    CCurMontLo = BigNumWordAddMulCarry (
-                   &CCurMontHi,
-                   Result[CompIndex],
-                   TFirst,
-                   N[CompIndex],
-                   CCurMontHi
-                   );
-    //
-    // 2. The index shift translates to a bitshift equivalent to the division
-    //    by R = 2^#Bits (word).
-    //    C = C / R
-    //
-    Result[CompIndex - 1] = CCurMontLo;
-  }
+  TFirst     = Result[0] * N0Inv;
+  CCurMontHi = BigNumMontReduceRowAdx (Result, NumWords, TFirst, N);
 
+  Result[NumWords - 1] = CCurMulHi + CCurMontHi;
   //
-  // Assign the most significant byte the remaining carry.
+  // If the result has wrapped around, C >= N is true and we reduce mod N.
   //
-  Result[CompIndex - 1] = CCurMontHi;
+  if (Result[NumWords - 1] < CCurMulHi) {
+    BigNumSub (Result, NumWords, Result, N);
+  }
+}
+
+#endif
+
+OC_RSA_MODE
+OcSetRsaMode (
+  IN OC_RSA_MODE  Mode
+  )
+{
+  return (OC_RSA_MODE)InternalSetCryptoMode (&mRsaMode, Mode);
 }
 
 /**
-  This is an optimized version of the call
-  BigNumMontMul (C, 1, A, N, N0Inv)
+  Calculates the Montgomery product of A and B mod N.
 
   @param[in,out] Result    The result buffer.
-  @param[in]     NumWords  The number of Words of Result, A and N.
+  @param[in]     NumWords  The number of Words of Result, A, B and N.
   @param[in]     A         The multiplicant.
+  @param[in]     B         The multiplier.
   @param[in]     N         The modulus.
   @param[in]     N0Inv     The Montgomery Inverse of N.
 
 **/
 STATIC
 VOID
-BigNumMontMul1 (
+BigNumMontMul (
   IN OUT OC_BN_WORD        *Result,
   IN     OC_BN_NUM_WORDS   NumWords,
   IN     CONST OC_BN_WORD  *A,
+  IN     CONST OC_BN_WORD  *B,
   IN     CONST OC_BN_WORD  *N,
   IN     OC_BN_WORD        N0Inv
   )
@@ -529,19 +627,30 @@ BigNumMontMul1 (
   ASSERT (Result != NULL);
   ASSERT (NumWords > 0);
   ASSERT (A != NULL);
+  ASSERT (B != NULL);
   ASSERT (N != NULL);
   ASSERT (N0Inv != 0);
 
   ZeroMem (Result, OC_BN_SIZE (NumWords));
+
+ #ifdef OC_BN_MONT_ADX
+  if (InternalGetCryptoMode (&mRsaMode) == OcRsaAdx) {
+    for (RowIndex = 0; RowIndex < NumWords; ++RowIndex) {
+      BigNumMontMulRowAdx (Result, NumWords, A[RowIndex], B, N, N0Inv);
+    }
+
+    return;
+  }
+
+ #endif
+
   //
-  // Perform the entire standard multiplication and one Montgomery Reduction.
-  //
-  BigNumMontMulRow (Result, NumWords, 1, A, N, N0Inv);
-  //
-  // Perform the remaining Montgomery Reductions.
+  // RowIndex is used as an index into the words of A. Because this domain
+  // operates in mod 2^#Bits (word), 'row results' do not require multiplication
+  // as the positional factor is stripped by the word-size modulus.
   //
-  for (RowIndex = 1; RowIndex < NumWords; ++RowIndex) {
-    BigNumMontMulRow0 (Result, NumWords, N, N0Inv);
+  for (RowIndex = 0; RowIndex < NumWords; ++RowIndex) {
+    BigNumMontMulRow (Result, NumWords, A[RowIndex], B, N, N0Inv);
   }
 
   //
@@ -612,16 +721,13 @@ BigNumPowMod (
     //
     BigNumMontMul (Result, NumWords, ATmp, ATmp, N, N0Inv);
     //
-    // ATmp = MM (Result, ATmp)
-    //
-    BigNumMontMul (ATmp, NumWords, Result, ATmp, N, N0Inv);
-    //
-    // Perform a Montgomery Multiplication with 1, which effectively is a
-    // division by R, taking the result out of the Montgomery Domain.
-    // C = MM (ATmp, 1)
-    // TODO: Is this needed or can we just multiply with A above?
+    // As above, multiplying with A takes the result out of the Montgomery
+    // Domain. The product cannot be written to Result directly, as
+    // BigNumMontMul clears its result buffer before reading the operands.
+    // ATmp = MM (Result, A)
     //
-    BigNumMontMul1 (Result, NumWords, ATmp, N, N0Inv);
+    BigNumMontMul (ATmp, NumWords, Result, A, N, N0Inv);
+    CopyMem (Result, ATmp, OC_BN_SIZE (NumWords));
   }
 
   //
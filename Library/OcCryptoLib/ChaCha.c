@@ -22,9 +22,14 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
  Public domain.
  */
 
-#include <Library/BaseLib.h>
-#include <Library/BaseMemoryLib.h>
-#include <Library/OcCryptoLib.h>
+#include "CryptoInternal.h"
+
+#if defined (MDE_CPU_X64) && (defined (__GNUC__) || defined (__clang__))
+//
+// Vectorized ChaCha relies on GCC vector extensions and per-function targets.
+//
+  #define OC_CHACHA_VECTOR
+#endif
 
 #define U32V(v)           ((UINT32)(v) & 0xFFFFFFFFU)
 #define ROTATE(v, c)      (LRotU32 ((v), (c)))
@@ -44,6 +49,242 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
   c = PLUS(c, d);                \
   b = ROTATE(XOR(b, c), 7);
 
+//
+// CPU features required by each OC_CHACHA_MODE.
+//
+STATIC CONST UINT32  mChaChaModeFeatures[] = {
+  0,
+  OC_CPU_FEATURE_SSE2,
+  OC_CPU_FEATURE_SSE2 | OC_CPU_FEATURE_AVX2
+};
+
+STATIC OC_CRYPTO_MODE  mChaChaMode = {
+  mChaChaModeFeatures,
+  ARRAY_SIZE (mChaChaModeFeatures),
+  OcChaChaAvx2
+};
+
+#ifdef OC_CHACHA_VECTOR
+
+typedef UINT32 OC_CHACHA_D16 __attribute__ ((vector_size (16)));
+typedef UINT32 OC_CHACHA_D32 __attribute__ ((vector_size (32)));
+typedef CHAR8 OC_CHACHA_B32 __attribute__ ((vector_size (32)));
+
+  #define OC_CHACHA_ROTATEV(v, c)  (((v) << (c)) | ((v) >> (32 - (c))))
+
+//
+// Byte granular rotations with PSHUFB, Rot16 and Rot8 are shuffle masks.
+//
+  #define OC_CHACHA_ROTATE16_AVX2(v) \
+  ((OC_CHACHA_D32)__builtin_ia32_pshufb256 ((OC_CHACHA_B32)(v), Rot16))
+  #define OC_CHACHA_ROTATE8_AVX2(v) \
+  ((OC_CHACHA_D32)__builtin_ia32_pshufb256 ((OC_CHACHA_B32)(v), Rot8))
+  #define OC_CHACHA_ROTATE16_SSE2(v)  OC_CHACHA_ROTATEV (v, 16)
+  #define OC_CHACHA_ROTATE8_SSE2(v)   OC_CHACHA_ROTATEV (v, 8)
+
+//
+// Quarter round over lanes of the same state word, suitable for any vector
+// type. Rotate16 and Rotate8 implement rotations by 16 and 8 bits.
+//
+  #define OC_CHACHA_QUARTERROUNDV(a, b, c, d, Rotate16, Rotate8) \
+  a += b;                                                      \
+  d  = Rotate16 (d ^ a);                                       \
+  c += d;                                                      \
+  b  = OC_CHACHA_ROTATEV (b ^ c, 12);                          \
+  a += b;                                                      \
+  d  = Rotate8 (d ^ a);                                        \
+  c += d;                                                      \
+  b  = OC_CHACHA_ROTATEV (b ^ c, 7);
+
+//
+// Column and diagonal rounds over state X of any vector type.
+//
+  #define OC_CHACHA_DOUBLEROUNDV(X, Rotate16, Rotate8)                     \
+  OC_CHACHA_QUARTERROUNDV (X[0], X[4], X[8], X[12], Rotate16, Rotate8)  \
+  OC_CHACHA_QUARTERROUNDV (X[1], X[5], X[9], X[13], Rotate16, Rotate8)  \
+  OC_CHACHA_QUARTERROUNDV (X[2], X[6], X[10], X[14], Rotate16, Rotate8) \
+  OC_CHACHA_QUARTERROUNDV (X[3], X[7], X[11], X[15], Rotate16, Rotate8) \
+  OC_CHACHA_QUARTERROUNDV (X[0], X[5], X[10], X[15], Rotate16, Rotate8) \
+  OC_CHACHA_QUARTERROUNDV (X[1], X[6], X[11], X[12], Rotate16, Rotate8) \
+  OC_CHACHA_QUARTERROUNDV (X[2], X[7], X[8], X[13], Rotate16, Rotate8)  \
+  OC_CHACHA_QUARTERROUNDV (X[3], X[4], X[9], X[14], Rotate16, Rotate8)
+
+/**
+  Prepare block counters for consecutive blocks.
+
+  @param[in]  Input      ChaCha state.
+  @param[in]  Lanes      Amount of blocks.
+  @param[out] Counter    Low counter words, Lanes entries.
+  @param[out] CounterHi  High counter words, Lanes entries.
+**/
+STATIC
+VOID
+InternalChaChaLaneCounters (
+  IN  CONST UINT32  *Input,
+  IN  UINT32        Lanes,
+  OUT UINT32        *Counter,
+  OUT UINT32        *CounterHi
+  )
+{
+  UINT32  Lane;
+
+  for (Lane = 0; Lane < Lanes; ++Lane) {
+    Counter[Lane]   = Input[12] + Lane;
+    CounterHi[Lane] = Input[13] + (Counter[Lane] < Input[12] ? 1 : 0);
+  }
+}
+
+/**
+  Combine keystream words with data. Keystream holds word Index of
+  block Lane at Keystream[Index * Lanes + Lane].
+
+  @param[in]  Keystream    Keystream words.
+  @param[in]  Lanes        Amount of blocks.
+  @param[in]  Source       Data for transformation.
+  @param[out] Destination  Resulting data.
+**/
+STATIC
+VOID
+InternalChaChaXorKeystream (
+  IN  CONST UINT32  *Keystream,
+  IN  UINT32        Lanes,
+  IN  CONST UINT8   *Source,
+  OUT UINT8         *Destination
+  )
+{
+  UINT32  Lane;
+  UINT32  Index;
+  UINT32  Word;
+
+  for (Lane = 0; Lane < Lanes; ++Lane) {
+    for (Index = 0; Index < 16; ++Index) {
+      __builtin_memcpy (&Word, Source, sizeof (Word));
+      Word ^= Keystream[Index * Lanes + Lane];
+      __builtin_memcpy (Destination, &Word, sizeof (Word));
+      Source      += sizeof (Word);
+      Destination += sizeof (Word);
+    }
+  }
+}
+
+/**
+  Process 4 ChaCha blocks with SSE2. Each vector holds the same state word
+  of 4 consecutive blocks, so rounds need no shuffles.
+
+  @param[in]  Input        ChaCha state.
+  @param[in]  Source       Data for transformation, 256 bytes.
+  @param[out] Destination  Resulting data, 256 bytes.
+**/
+STATIC
+VOID
+InternalChaChaBlocksSse2 (
+  IN  CONST UINT32  *Input,
+  IN  CONST UINT8   *Source,
+  OUT UINT8         *Destination
+  )
+{
+  OC_CHACHA_D16  J[16];
+  OC_CHACHA_D16  X[16];
+  UINT32         Counter[4];
+  UINT32         CounterHi[4];
+  UINT32         Keystream[16 * 4];
+  UINT32         Index;
+
+  for (Index = 0; Index < 16; ++Index) {
+    J[Index] = (OC_CHACHA_D16) {
+      Input[Index], Input[Index], Input[Index], Input[Index]
+    };
+  }
+
+  InternalChaChaLaneCounters (Input, 4, Counter, CounterHi);
+  __builtin_memcpy (&J[12], Counter, sizeof (J[12]));
+  __builtin_memcpy (&J[13], CounterHi, sizeof (J[13]));
+
+  for (Index = 0; Index < 16; ++Index) {
+    X[Index] = J[Index];
+  }
+
+  for (Index = 20; Index > 0; Index -= 2) {
+    OC_CHACHA_DOUBLEROUNDV (X, OC_CHACHA_ROTATE16_SSE2, OC_CHACHA_ROTATE8_SSE2)
+  }
+
+  for (Index = 0; Index < 16; ++Index) {
+    X[Index] += J[Index];
+    __builtin_memcpy (&Keystream[Index * 4], &X[Index], sizeof (X[Index]));
+  }
+
+  InternalChaChaXorKeystream (Keystream, 4, Source, Destination);
+}
+
+/**
+  Process 8 ChaCha blocks with AVX2. Each vector holds the same state word
+  of 8 consecutive blocks, so rounds need no shuffles between words.
+
+  @param[in]  Input        ChaCha state.
+  @param[in]  Source       Data for transformation, 512 bytes.
+  @param[out] Destination  Resulting data, 512 bytes.
+**/
+STATIC
+__attribute__ ((target ("avx2")))
+VOID
+InternalChaChaBlocksAvx2 (
+  IN  CONST UINT32  *Input,
+  IN  CONST UINT8   *Source,
+  OUT UINT8         *Destination
+  )
+{
+  CONST OC_CHACHA_B32  Rot16 = {
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13
+  };
+  CONST OC_CHACHA_B32  Rot8 = {
+    3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+    3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14
+  };
+  OC_CHACHA_D32        J[16];
+  OC_CHACHA_D32        X[16];
+  UINT32               Counter[8];
+  UINT32               CounterHi[8];
+  UINT32               Keystream[16 * 8];
+  UINT32               Index;
+
+  for (Index = 0; Index < 16; ++Index) {
+    J[Index] = (OC_CHACHA_D32) {
+      Input[Index], Input[Index], Input[Index], Input[Index],
+      Input[Index], Input[Index], Input[Index], Input[Index]
+    };
+  }
+
+  InternalChaChaLaneCounters (Input, 8, Counter, CounterHi);
+  __builtin_memcpy (&J[12], Counter, sizeof (J[12]));
+  __builtin_memcpy (&J[13], CounterHi, sizeof (J[13]));
+
+  for (Index = 0; Index < 16; ++Index) {
+    X[Index] = J[Index];
+  }
+
+  for (Index = 20; Index > 0; Index -= 2) {
+    OC_CHACHA_DOUBLEROUNDV (X, OC_CHACHA_ROTATE16_AVX2, OC_CHACHA_ROTATE8_AVX2)
+  }
+
+  for (Index = 0; Index < 16; ++Index) {
+    X[Index] += J[Index];
+    __builtin_memcpy (&Keystream[Index * 8], &X[Index], sizeof (X[Index]));
+  }
+
+  InternalChaChaXorKeystream (Keystream, 8, Source, Destination);
+}
+
+#endif
+
+OC_CHACHA_MODE
+OcSetChaChaMode (
+  IN OC_CHACHA_MODE  Mode
+  )
+{
+  return (OC_CHACHA_MODE)InternalSetCryptoMode (&mChaChaMode, Mode);
+}
+
 VOID
 ChaChaInitCtx (
   OUT CHACHA_CONTEXT  *Context,
@@ -114,6 +355,37 @@ ChaChaCryptBuffer (
   UINT8   Tmp[64];
   UINT32  Index;
 
+ #ifdef OC_CHACHA_VECTOR
+  UINT32          Lanes;
+  OC_CHACHA_MODE  Mode;
+
+  Mode = (OC_CHACHA_MODE)InternalGetCryptoMode (&mChaChaMode);
+
+  //
+  // Full batches of blocks are processed with vector code, the rest
+  // continues with the updated counter below.
+  //
+  while (Mode != OcChaChaPortable && Length >= 4 * sizeof (Tmp)) {
+    if ((Mode == OcChaChaAvx2) && (Length >= 8 * sizeof (Tmp))) {
+      InternalChaChaBlocksAvx2 (Context->Input, Source, Destination);
+      Lanes = 8;
+    } else {
+      InternalChaChaBlocksSse2 (Context->Input, Source, Destination);
+      Lanes = 4;
+    }
+
+    Context->Input[12] += Lanes;
+    if (Context->Input[12] < Lanes) {
+      ++Context->Input[13];
+    }
+
+    Length      -= Lanes * sizeof (Tmp);
+    Source      += Lanes * sizeof (Tmp);
+    Destination += Lanes * sizeof (Tmp);
+  }
+
+ #endif
+
   Ctarget = NULL;
 
   if (Length == 0) {
@@ -0,0 +1,143 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include "CryptoInternal.h"
+
+//
+// Accelerated implementations rely on GCC vector extensions, x86 builtins
+// and inline assembly, only available for X64 with GCC and clang.
+//
+#if defined (MDE_CPU_X64) && (defined (__GNUC__) || defined (__clang__))
+  #include <Register/Intel/Cpuid.h>
+
+UINT32
+InternalGetCpuFeatures (
+  VOID
+  )
+{
+  UINT32                                       Features;
+  UINT32                                       MaxLeaf;
+  CPUID_VERSION_INFO_ECX                       VersionEcx;
+  CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_EBX  ExtendedEbx;
+  UINT32                                       Xcr0;
+  UINT32                                       Xcr0High;
+
+  //
+  // SSE2 is architectural on X64.
+  //
+  Features = OC_CPU_FEATURE_SSE2;
+
+  AsmCpuid (CPUID_SIGNATURE, &MaxLeaf, NULL, NULL, NULL);
+  AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &VersionEcx.Uint32, NULL);
+
+  if (VersionEcx.Bits.SSSE3 != 0) {
+    Features |= OC_CPU_FEATURE_SSSE3;
+  }
+
+  if (VersionEcx.Bits.AESNI != 0) {
+    Features |= OC_CPU_FEATURE_AESNI;
+  }
+
+  if (MaxLeaf < CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS) {
+    return Features;
+  }
+
+  AsmCpuidEx (
+    CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS,
+    CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_SUB_LEAF_INFO,
+    NULL,
+    &ExtendedEbx.Uint32,
+    NULL,
+    NULL
+    );
+
+  if (ExtendedEbx.Bits.SHA != 0) {
+    Features |= OC_CPU_FEATURE_SHA;
+  }
+
+  if (ExtendedEbx.Bits.BMI2 != 0) {
+    Features |= OC_CPU_FEATURE_BMI2;
+  }
+
+  if (ExtendedEbx.Bits.ADX != 0) {
+    Features |= OC_CPU_FEATURE_ADX;
+  }
+
+  //
+  // YMM registers are only usable once XCR0 enables saving of SSE and AVX
+  // state. The OS does it in userspace, in firmware it is done by
+  // TryEnableAccel, so AVX2 may become available after the first check.
+  // InternalGetCryptoMode repeats the selection when mIsAccelEnabled changes.
+  //
+  if (  (VersionEcx.Bits.OSXSAVE != 0)
+     && (VersionEcx.Bits.AVX != 0)
+     && (ExtendedEbx.Bits.AVX2 != 0))
+  {
+    __asm__ __volatile__ ("xgetbv" : "=a" (Xcr0), "=d" (Xcr0High) : "c" (0));
+    if ((Xcr0 & (BIT1 | BIT2)) == (BIT1 | BIT2)) {
+      Features |= OC_CPU_FEATURE_AVX2;
+    }
+  }
+
+  return Features;
+}
+
+#else
+
+UINT32
+InternalGetCpuFeatures (
+  VOID
+  )
+{
+  return 0;
+}
+
+#endif
+
+UINT32
+InternalGetCryptoMode (
+  IN OUT OC_CRYPTO_MODE  *Mode
+  )
+{
+  UINT32  Features;
+  UINT32  Selected;
+
+  if (Mode->Ready && (Mode->Accel == mIsAccelEnabled)) {
+    return Mode->Selected;
+  }
+
+  Features = InternalGetCpuFeatures ();
+
+  Selected = MIN (Mode->Requested, Mode->Count - 1);
+  while (Selected > 0 && (Mode->Features[Selected] & ~Features) != 0) {
+    --Selected;
+  }
+
+  Mode->Selected = Selected;
+  Mode->Accel    = mIsAccelEnabled;
+  Mode->Ready    = TRUE;
+
+  return Selected;
+}
+
+UINT32
+InternalSetCryptoMode (
+  IN OUT OC_CRYPTO_MODE  *Mode,
+  IN     UINT32          Requested
+  )
+{
+  Mode->Requested = Requested;
+  Mode->Ready     = FALSE;
+  return InternalGetCryptoMode (Mode);
+}
@@ -30,4 +30,87 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/PcdLib.h>
 #include <Library/OcMiscLib.h>
 
+//
+// Set by TryEnableAccel when AVX state saving is enabled.
+//
+extern BOOLEAN  mIsAccelEnabled;
+
+//
+// CPU features usable by accelerated implementations, see
+// InternalGetCpuFeatures.
+//
+#define OC_CPU_FEATURE_SSE2   BIT0
+#define OC_CPU_FEATURE_SSSE3  BIT1
+#define OC_CPU_FEATURE_AESNI  BIT2
+#define OC_CPU_FEATURE_SHA    BIT3
+#define OC_CPU_FEATURE_AVX2   BIT4
+#define OC_CPU_FEATURE_BMI2   BIT5
+#define OC_CPU_FEATURE_ADX    BIT6
+
+/**
+  Implementation selection of an algorithm with CPU specific code.
+  Implementations are numbered from portable code at 0 to the preferred one.
+**/
+typedef struct OC_CRYPTO_MODE_ {
+  ///
+  /// CPU features required by each implementation.
+  ///
+  CONST UINT32    *Features;
+  ///
+  /// Amount of implementations.
+  ///
+  UINT32          Count;
+  ///
+  /// Requested implementation, a lower one is selected when unsupported.
+  ///
+  UINT32          Requested;
+  ///
+  /// Implementation in use, valid when Ready is set.
+  ///
+  UINT32          Selected;
+  BOOLEAN         Ready;
+  ///
+  /// Value of mIsAccelEnabled during selection.
+  ///
+  BOOLEAN         Accel;
+} OC_CRYPTO_MODE;
+
+/**
+  Get CPU features usable by accelerated implementations in this build.
+  No features are reported when the compiler or architecture has none.
+
+  @return  Bitmask of OC_CPU_FEATURE values.
+**/
+UINT32
+InternalGetCpuFeatures (
+  VOID
+  );
+
+/**
+  Get implementation in use, selecting the best supported one up to
+  the requested one when necessary.
+
+  @param[in,out] Mode  Implementation selection.
+
+  @return  Implementation in use.
+**/
+UINT32
+InternalGetCryptoMode (
+  IN OUT OC_CRYPTO_MODE  *Mode
+  );
+
+/**
+  Request implementation and select it, or the best supported one below it.
+
+  @param[in,out] Mode       Implementation selection.
+  @param[in]     Requested  Requested implementation.
+
+  @return  Implementation in use.
+**/
+UINT32
+InternalSetCryptoMode (
+  IN OUT OC_CRYPTO_MODE  *Mode,
+  IN     UINT32          Requested
+  );
+
 #endif // CRYPTO_INTERNAL_H
@@ -11,7 +11,20 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 **/
 
-#include "CryptoInternal.h"
+#include "Sha2Internal.h"
+
+//
+// The hash function is applied iteratively to slow down bruteforce attacks.
+// The iteration count has been chosen to take roughly three seconds on
+// modern hardware.
+//
+#define PASSWORD_HASH_ITERATIONS  5000000
+
+//
+// Padded message size limit for the fixed-layout iteration path, longer
+// passwords and salts go through regular SHA-512 context operations.
+//
+#define PASSWORD_HASH_MAX_BLOCKS  4
 
 VOID
 OcHashPasswordSha512 (
@@ -23,6 +36,13 @@ OcHashPasswordSha512 (
   )
 {
   UINT32          Index;
+  UINT32          Index2;
+  UINT64          MessageSize;
+  UINTN           BlockNb;
+  UINT64          State[8];
+  UINT8           Block[PASSWORD_HASH_MAX_BLOCKS * SHA512_BLOCK_SIZE];
+  UINT64          Words[PASSWORD_HASH_MAX_BLOCKS * 16];
+  UINT64          Schedule[80];
   SHA512_CONTEXT  ShaContext;
 
   ASSERT (Password != NULL);
@@ -32,23 +52,85 @@ OcHashPasswordSha512 (
   Sha512Update (&ShaContext, Password, PasswordSize);
   Sha512Update (&ShaContext, Salt, SaltSize);
   Sha512Final (&ShaContext, Hash);
+
+  //
+  // Message and padding must fit together with the 128-bit length.
+  //
+  MessageSize = SHA512_DIGEST_SIZE + (UINT64)PasswordSize + SaltSize;
+  if (MessageSize + 17 > sizeof (Block)) {
+    for (Index = 0; Index < PASSWORD_HASH_ITERATIONS; ++Index) {
+      Sha512Init (&ShaContext);
+      Sha512Update (&ShaContext, Hash, SHA512_DIGEST_SIZE);
+      //
+      // Password and Salt are re-added into hashing to, in case of a hash
+      // collision, again yield a unique hash in the subsequent iteration.
+      //
+      Sha512Update (&ShaContext, Password, PasswordSize);
+      Sha512Update (&ShaContext, Salt, SaltSize);
+      Sha512Final (&ShaContext, Hash);
+    }
+
+    SecureZeroMem (&ShaContext, sizeof (ShaContext));
+    return;
+  }
+
   //
-  // The hash function is applied iteratively to slow down bruteforce attacks.
-  // The iteration count has been chosen to take roughly three seconds on
-  // modern hardware.
+  // Every iteration hashes the previous digest followed by Password and Salt,
+  // so only the first SHA512_DIGEST_SIZE bytes of the padded message change.
+  // Lay out the message once and run the compression function on it directly.
   //
-  for (Index = 0; Index < 5000000; ++Index) {
-    Sha512Init (&ShaContext);
-    Sha512Update (&ShaContext, Hash, SHA512_DIGEST_SIZE);
+  BlockNb = (UINTN)(MessageSize + 17 + SHA512_BLOCK_SIZE - 1) / SHA512_BLOCK_SIZE;
+
+  ZeroMem (Block, sizeof (Block));
+  CopyMem (Block, Hash, SHA512_DIGEST_SIZE);
+  CopyMem (&Block[SHA512_DIGEST_SIZE], Password, PasswordSize);
+  CopyMem (&Block[SHA512_DIGEST_SIZE + PasswordSize], Salt, SaltSize);
+  Block[MessageSize] = 0x80;
+  UNPACK64 (LShiftU64 (MessageSize, 3), &Block[BlockNb * SHA512_BLOCK_SIZE - 8]);
+
+  Sha512Init (&ShaContext);
+
+  if (mIsAccelEnabled) {
+    for (Index = 0; Index < PASSWORD_HASH_ITERATIONS; ++Index) {
+      CopyMem (State, ShaContext.State, sizeof (State));
+      Sha512TransformAccel (State, Block, BlockNb);
+
+      for (Index2 = 0; Index2 < 8; ++Index2) {
+        UNPACK64 (State[Index2], &Block[Index2 << 3]);
+      }
+    }
+  } else {
     //
-    // Password and Salt are re-added into hashing to, in case of a hash
-    // collision, again yield a unique hash in the subsequent iteration.
+    // The digest words are the state words, thus with the message kept in
+    // host byte order no conversion is needed between the iterations.
     //
-    Sha512Update (&ShaContext, Password, PasswordSize);
-    Sha512Update (&ShaContext, Salt, SaltSize);
-    Sha512Final (&ShaContext, Hash);
+    for (Index2 = 0; Index2 < BlockNb * 16; ++Index2) {
+      PACK64 (&Block[Index2 << 3], &Words[Index2]);
+    }
+
+    for (Index = 0; Index < PASSWORD_HASH_ITERATIONS; ++Index) {
+      CopyMem (State, ShaContext.State, sizeof (State));
+
+      for (Index2 = 0; Index2 < BlockNb; ++Index2) {
+        CopyMem (Schedule, &Words[Index2 * 16], 16 * sizeof (UINT64));
+        Sha512TransformWords (State, Schedule);
+      }
+
+      CopyMem (Words, State, sizeof (State));
+    }
+
+    for (Index2 = 0; Index2 < 8; ++Index2) {
+      UNPACK64 (Words[Index2], &Block[Index2 << 3]);
+    }
+
+    SecureZeroMem (Words, sizeof (Words));
+    SecureZeroMem (Schedule, sizeof (Schedule));
   }
 
+  CopyMem (Hash, Block, SHA512_DIGEST_SIZE);
+
+  SecureZeroMem (Block, sizeof (Block));
+  SecureZeroMem (State, sizeof (State));
   SecureZeroMem (&ShaContext, sizeof (ShaContext));
 }
 
@@ -32,44 +32,6 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "Sha2Internal.h"
 
-#define UNPACK64(x, str)                         \
-  do {                                           \
-    *((str) + 7) = (UINT8) (x);                  \
-    *((str) + 6) = (UINT8) RShiftU64 ((x),  8);  \
-    *((str) + 5) = (UINT8) RShiftU64 ((x), 16);  \
-    *((str) + 4) = (UINT8) RShiftU64 ((x), 24);  \
-    *((str) + 3) = (UINT8) RShiftU64 ((x), 32);  \
-    *((str) + 2) = (UINT8) RShiftU64 ((x), 40);  \
-    *((str) + 1) = (UINT8) RShiftU64 ((x), 48);  \
-    *((str) + 0) = (UINT8) RShiftU64 ((x), 56);  \
-  } while(0)
-
-#define PACK64(str, x)                           \
-  do {                                           \
-    *(x) =    ((UINT64) *((str) + 7))            \
-           | LShiftU64 (*((str) + 6),  8)        \
-           | LShiftU64 (*((str) + 5), 16)        \
-           | LShiftU64 (*((str) + 4), 24)        \
-           | LShiftU64 (*((str) + 3), 32)        \
-           | LShiftU64 (*((str) + 2), 40)        \
-           | LShiftU64 (*((str) + 1), 48)        \
-           | LShiftU64 (*((str) + 0), 56);       \
-  } while (0)
-
-#define SHFR(a, b)      (a >> b)
-#define ROTLEFT(a, b)   ((a << b) | (a >> ((sizeof(a) << 3) - b)))
-#define ROTRIGHT(a, b)  ((a >> b) | (a << ((sizeof(a) << 3) - b)))
-#define CH(x, y, z)     (((x) & (y)) ^ (~(x) & (z)))
-#define MAJ(x, y, z)    (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
-
-//
-// Sha 256
-//
-#define SHA256_EP0(x)   (ROTRIGHT(x, 2)  ^ ROTRIGHT(x, 13) ^ ROTRIGHT(x, 22))
-#define SHA256_EP1(x)   (ROTRIGHT(x, 6)  ^ ROTRIGHT(x, 11) ^ ROTRIGHT(x, 25))
-#define SHA256_SIG0(x)  (ROTRIGHT(x, 7)  ^ ROTRIGHT(x, 18) ^ SHFR(x, 3))
-#define SHA256_SIG1(x)  (ROTRIGHT(x, 17) ^ ROTRIGHT(x, 19) ^ SHFR(x, 10))
-
 //
 // Sha 512
 //
@@ -87,7 +49,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 GLOBAL_REMOVE_IF_UNREFERENCED BOOLEAN  mIsAccelEnabled;
 
 #ifdef OC_CRYPTO_SUPPORTS_SHA256
-STATIC CONST UINT32  SHA256_K[64] = {
+CONST UINT32  SHA256_K[64] = {
   0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
   0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
   0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
@@ -171,55 +133,58 @@ STATIC CONST UINT64  SHA512_H0[8] = {
 //
 VOID
 Sha256Transform (
-  SHA256_CONTEXT  *Context,
-  CONST UINT8     *Data
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
   )
 {
   UINT32  A, B, C, D, E, F, G, H, Index1, Index2, T1, T2;
   UINT32  M[64];
 
-  for (Index1 = 0, Index2 = 0; Index1 < 16; Index1++, Index2 += 4) {
-    M[Index1] = ((UINT32)Data[Index2] << 24)
-                | ((UINT32)Data[Index2 + 1] << 16)
-                | ((UINT32)Data[Index2 + 2] << 8)
-                | ((UINT32)Data[Index2 + 3]);
-  }
+  for ( ; BlockNb > 0; --BlockNb, Data += SHA256_BLOCK_SIZE) {
+    for (Index1 = 0, Index2 = 0; Index1 < 16; Index1++, Index2 += 4) {
+      M[Index1] = ((UINT32)Data[Index2] << 24)
+                  | ((UINT32)Data[Index2 + 1] << 16)
+                  | ((UINT32)Data[Index2 + 2] << 8)
+                  | ((UINT32)Data[Index2 + 3]);
+    }
 
-  for ( ; Index1 < 64; ++Index1) {
-    M[Index1] = SHA256_SIG1 (M[Index1 - 2]) + M[Index1 - 7]
-                + SHA256_SIG0 (M[Index1 - 15]) + M[Index1 - 16];
-  }
+    for ( ; Index1 < 64; ++Index1) {
+      M[Index1] = SHA256_SIG1 (M[Index1 - 2]) + M[Index1 - 7]
+                  + SHA256_SIG0 (M[Index1 - 15]) + M[Index1 - 16];
+    }
 
-  A = Context->State[0];
-  B = Context->State[1];
-  C = Context->State[2];
-  D = Context->State[3];
-  E = Context->State[4];
-  F = Context->State[5];
-  G = Context->State[6];
-  H = Context->State[7];
-
-  for (Index1 = 0; Index1 < 64; ++Index1) {
-    T1 = H + SHA256_EP1 (E) + CH (E, F, G) + SHA256_K[Index1] + M[Index1];
-    T2 = SHA256_EP0 (A) + MAJ (A, B, C);
-    H  = G;
-    G  = F;
-    F  = E;
-    E  = D + T1;
-    D  = C;
-    C  = B;
-    B  = A;
-    A  = T1 + T2;
-  }
+    A = State[0];
+    B = State[1];
+    C = State[2];
+    D = State[3];
+    E = State[4];
+    F = State[5];
+    G = State[6];
+    H = State[7];
+
+    for (Index1 = 0; Index1 < 64; ++Index1) {
+      T1 = H + SHA256_EP1 (E) + CH (E, F, G) + SHA256_K[Index1] + M[Index1];
+      T2 = SHA256_EP0 (A) + MAJ (A, B, C);
+      H  = G;
+      G  = F;
+      F  = E;
+      E  = D + T1;
+      D  = C;
+      C  = B;
+      B  = A;
+      A  = T1 + T2;
+    }
 
-  Context->State[0] += A;
-  Context->State[1] += B;
-  Context->State[2] += C;
-  Context->State[3] += D;
-  Context->State[4] += E;
-  Context->State[5] += F;
-  Context->State[6] += G;
-  Context->State[7] += H;
+    State[0] += A;
+    State[1] += B;
+    State[2] += C;
+    State[3] += D;
+    State[4] += E;
+    State[5] += F;
+    State[6] += G;
+    State[7] += H;
+  }
 }
 
 VOID
@@ -244,17 +209,43 @@ Sha256Update (
   UINTN           Len
   )
 {
-  UINT32  Index;
-
-  for (Index = 0; Index < Len; ++Index) {
-    Context->Data[Context->DataLen] = Data[Index];
-    Context->DataLen++;
-    if (Context->DataLen == 64) {
-      Sha256Transform (Context, Context->Data);
-      Context->BitLen += 512;
-      Context->DataLen = 0;
+  UINTN  Fill;
+  UINTN  BlockNb;
+
+  //
+  // Complete the buffered block first.
+  //
+  if (Context->DataLen > 0) {
+    Fill = SHA256_BLOCK_SIZE - Context->DataLen;
+    if (Len < Fill) {
+      CopyMem (&Context->Data[Context->DataLen], Data, Len);
+      Context->DataLen += (UINT32)Len;
+      return;
     }
+
+    CopyMem (&Context->Data[Context->DataLen], Data, Fill);
+    Sha256TransformBlocks (Context->State, Context->Data, 1);
+    Context->BitLen += SHA256_BLOCK_SIZE * 8;
+    Context->DataLen = 0;
+
+    Data += Fill;
+    Len  -= Fill;
+  }
+
+  //
+  // Hash whole blocks in place and buffer the rest.
+  //
+  BlockNb = Len / SHA256_BLOCK_SIZE;
+  if (BlockNb > 0) {
+    Sha256TransformBlocks (Context->State, Data, BlockNb);
+    Context->BitLen += (UINT64)BlockNb * SHA256_BLOCK_SIZE * 8;
+
+    Data += BlockNb * SHA256_BLOCK_SIZE;
+    Len  -= BlockNb * SHA256_BLOCK_SIZE;
   }
+
+  CopyMem (Context->Data, Data, Len);
+  Context->DataLen = (UINT32)Len;
 }
 
 VOID
@@ -276,7 +267,7 @@ Sha256Final (
   } else {
     Context->Data[Index++] = 0x80;
     ZeroMem (Context->Data + Index, 64-Index);
-    Sha256Transform (Context, Context->Data);
+    Sha256TransformBlocks (Context->State, Context->Data, 1);
     ZeroMem (Context->Data, 56);
   }
 
@@ -292,7 +283,7 @@ Sha256Final (
   Context->Data[58] = (UINT8)(Context->BitLen >> 40);
   Context->Data[57] = (UINT8)(Context->BitLen >> 48);
   Context->Data[56] = (UINT8)(Context->BitLen >> 56);
-  Sha256Transform (Context, Context->Data);
+  Sha256TransformBlocks (Context->State, Context->Data, 1);
 
   //
   // Since this implementation uses little endian byte ordering and SHA uses big endian,
@@ -331,6 +322,62 @@ Sha256 (
 //
 // Sha 384 & 512 common functions
 //
+VOID
+Sha512TransformWords (
+  IN OUT UINT64  *State,
+  IN OUT UINT64  *W
+  )
+{
+  UINT64  Wv[8];
+  UINT64  T1;
+  UINT64  T2;
+  UINTN   Index;
+
+  //
+  // Initialize the 8 working registers
+  //
+  for (Index = 0; Index < 8; ++Index) {
+    Wv[Index] = State[Index];
+  }
+
+  for (Index = 0; Index < 80; ++Index) {
+    //
+    // Prepare the message schedule
+    //
+    if (Index >= 16) {
+      SHA512_SCR (Index);
+    }
+
+    //
+    // Calculate T1 and T2
+    //
+    T1 = Wv[7] + SHA512_EP1 (Wv[4])
+         + CH (Wv[4], Wv[5], Wv[6]) + SHA512_K[Index]
+         + W[Index];
+
+    T2 = SHA512_EP0 (Wv[0]) + MAJ (Wv[0], Wv[1], Wv[2]);
+
+    //
+    // Update the working registers
+    //
+    Wv[7] = Wv[6];
+    Wv[6] = Wv[5];
+    Wv[5] = Wv[4];
+    Wv[4] = Wv[3] + T1;
+    Wv[3] = Wv[2];
+    Wv[2] = Wv[1];
+    Wv[1] = Wv[0];
+    Wv[0] = T1 + T2;
+  }
+
+  //
+  // Update the hash value
+  //
+  for (Index = 0; Index < 8; ++Index) {
+    State[Index] += Wv[Index];
+  }
+}
+
 VOID
 Sha512Transform (
   IN OUT UINT64       *State,
@@ -339,9 +386,6 @@ Sha512Transform (
   )
 {
   UINT64       W[80];
-  UINT64       Wv[8];
-  UINT64       T1;
-  UINT64       T2;
   CONST UINT8  *SubBlock;
   UINTN        Index1;
   UINTN        Index2;
@@ -356,49 +400,7 @@ Sha512Transform (
       PACK64 (&SubBlock[Index2 << 3], &W[Index2]);
     }
 
-    //
-    // Initialize the 8 working registers
-    //
-    for (Index2 = 0; Index2 < 8; ++Index2) {
-      Wv[Index2] = State[Index2];
-    }
-
-    for (Index2 = 0; Index2 < 80; ++Index2) {
-      //
-      // Prepare the message schedule
-      //
-      if (Index2 >= 16) {
-        SHA512_SCR (Index2);
-      }
-
-      //
-      // Calculate T1 and T2
-      //
-      T1 = Wv[7] + SHA512_EP1 (Wv[4])
-           + CH (Wv[4], Wv[5], Wv[6]) + SHA512_K[Index2]
-           + W[Index2];
-
-      T2 = SHA512_EP0 (Wv[0]) + MAJ (Wv[0], Wv[1], Wv[2]);
-
-      //
-      // Update the working registers
-      //
-      Wv[7] = Wv[6];
-      Wv[6] = Wv[5];
-      Wv[5] = Wv[4];
-      Wv[4] = Wv[3] + T1;
-      Wv[3] = Wv[2];
-      Wv[2] = Wv[1];
-      Wv[1] = Wv[0];
-      Wv[0] = T1 + T2;
-    }
-
-    //
-    // Update the hash value
-    //
-    for (Index2 = 0; Index2 < 8; ++Index2) {
-      State[Index2] += Wv[Index2];
-    }
+    Sha512TransformWords (State, W);
   }
 }
 
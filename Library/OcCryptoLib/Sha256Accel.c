@@ -0,0 +1,351 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include "Sha2Internal.h"
+
+#if defined (MDE_CPU_X64) && (defined (__GNUC__) || defined (__clang__))
+//
+// Accelerated SHA-256 relies on GCC vector extensions, x86 builtins and
+// per-function targets.
+//
+  #define OC_SHA256_VECTOR
+#endif
+
+#ifdef OC_CRYPTO_SUPPORTS_SHA256
+
+//
+// CPU features required by each OC_SHA256_MODE.
+//
+STATIC CONST UINT32  mSha256ModeFeatures[] = {
+  0,
+  OC_CPU_FEATURE_SSE2,
+  OC_CPU_FEATURE_SSE2 | OC_CPU_FEATURE_AVX2 | OC_CPU_FEATURE_BMI2,
+  OC_CPU_FEATURE_SSE2 | OC_CPU_FEATURE_SSSE3 | OC_CPU_FEATURE_SHA
+};
+
+STATIC OC_CRYPTO_MODE  mSha256Mode = {
+  mSha256ModeFeatures,
+  ARRAY_SIZE (mSha256ModeFeatures),
+  OcSha256ShaNi
+};
+
+  #ifdef OC_SHA256_VECTOR
+
+typedef CHAR8 OC_SHA256_B16 __attribute__ ((vector_size (16)));
+typedef INT32 OC_SHA256_I16 __attribute__ ((vector_size (16)));
+typedef UINT32 OC_SHA256_D16 __attribute__ ((vector_size (16)));
+typedef INT64 OC_SHA256_Q16 __attribute__ ((vector_size (16)));
+typedef CHAR8 OC_SHA256_B32 __attribute__ ((vector_size (32)));
+typedef UINT32 OC_SHA256_D32 __attribute__ ((vector_size (32)));
+typedef INT64 OC_SHA256_Q32 __attribute__ ((vector_size (32)));
+
+//
+// PSHUFB mask converting big endian message dwords to host byte order.
+//
+    #define OC_SHA256_BSWAP_MASK  3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+
+//
+// Dwords 1 to 3 of Lo followed by dword 0 of Hi (PALIGNR), also within
+// each 128-bit lane for 256-bit vectors (VPALIGNR). The shift is in bytes
+// for clang builtins and in bits for GCC builtins.
+//
+    #ifdef __clang__
+      #define OC_SHA256_ALIGN(Hi, Lo) \
+  ((OC_SHA256_D16)__builtin_ia32_palignr128 ((OC_SHA256_B16)(Hi), (OC_SHA256_B16)(Lo), 4))
+      #define OC_SHA256_ALIGN2(Hi, Lo) \
+  ((OC_SHA256_D32)__builtin_ia32_palignr256 ((OC_SHA256_B32)(Hi), (OC_SHA256_B32)(Lo), 4))
+    #else
+      #define OC_SHA256_ALIGN(Hi, Lo) \
+  ((OC_SHA256_D16)__builtin_ia32_palignr128 ((OC_SHA256_Q16)(Hi), (OC_SHA256_Q16)(Lo), 32))
+      #define OC_SHA256_ALIGN2(Hi, Lo) \
+  ((OC_SHA256_D32)__builtin_ia32_palignr256 ((OC_SHA256_Q32)(Hi), (OC_SHA256_Q32)(Lo), 32))
+    #endif
+
+/**
+  Process SHA-256 blocks with SHA extensions.
+
+  SHA256RNDS2 keeps the state as ABEF and CDGH halves and performs two rounds
+  per instruction, SHA256MSG1 and SHA256MSG2 calculate the message schedule
+  four dwords at a time.
+
+  @param[in,out] State    SHA-256 state.
+  @param[in]     Data     Message blocks.
+  @param[in]     BlockNb  Amount of SHA256_BLOCK_SIZE blocks.
+**/
+STATIC
+__attribute__ ((target ("sha,ssse3")))
+VOID
+InternalSha256TransformShaNi (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  )
+{
+  CONST OC_SHA256_B16  Swap = { OC_SHA256_BSWAP_MASK };
+  OC_SHA256_D16        Abef;
+  OC_SHA256_D16        Cdgh;
+  OC_SHA256_D16        SavedAbef;
+  OC_SHA256_D16        SavedCdgh;
+  OC_SHA256_D16        Msg;
+  OC_SHA256_D16        Key;
+  OC_SHA256_D16        W[16];
+  UINTN                Index;
+
+  Abef = (OC_SHA256_D16) { State[5], State[4], State[1], State[0] };
+  Cdgh = (OC_SHA256_D16) { State[7], State[6], State[3], State[2] };
+
+  for ( ; BlockNb > 0; --BlockNb, Data += SHA256_BLOCK_SIZE) {
+    SavedAbef = Abef;
+    SavedCdgh = Cdgh;
+
+    for (Index = 0; Index < 4; ++Index) {
+      __builtin_memcpy (&Msg, &Data[Index * sizeof (Msg)], sizeof (Msg));
+      W[Index] = (OC_SHA256_D16)__builtin_ia32_pshufb128 ((OC_SHA256_B16)Msg, Swap);
+    }
+
+    //
+    // W[t..t+3] = SIG1 (W[t-2..t+1]) + W[t-7..t-4] + SIG0 (W[t-15..t-12]) + W[t-16..t-13]
+    //
+    for (Index = 4; Index < 16; ++Index) {
+      Msg      = (OC_SHA256_D16)__builtin_ia32_sha256msg1 ((OC_SHA256_I16)W[Index - 4], (OC_SHA256_I16)W[Index - 3]);
+      Msg     += OC_SHA256_ALIGN (W[Index - 1], W[Index - 2]);
+      W[Index] = (OC_SHA256_D16)__builtin_ia32_sha256msg2 ((OC_SHA256_I16)Msg, (OC_SHA256_I16)W[Index - 1]);
+    }
+
+    for (Index = 0; Index < 16; ++Index) {
+      __builtin_memcpy (&Key, &SHA256_K[Index * 4], sizeof (Key));
+      Msg  = W[Index] + Key;
+      Cdgh = (OC_SHA256_D16)__builtin_ia32_sha256rnds2 ((OC_SHA256_I16)Cdgh, (OC_SHA256_I16)Abef, (OC_SHA256_I16)Msg);
+      Msg  = (OC_SHA256_D16) { Msg[2], Msg[3], Msg[2], Msg[3] };
+      Abef = (OC_SHA256_D16)__builtin_ia32_sha256rnds2 ((OC_SHA256_I16)Abef, (OC_SHA256_I16)Cdgh, (OC_SHA256_I16)Msg);
+    }
+
+    Abef += SavedAbef;
+    Cdgh += SavedCdgh;
+  }
+
+  State[0] = Abef[3];
+  State[1] = Abef[2];
+  State[2] = Cdgh[3];
+  State[3] = Cdgh[2];
+  State[4] = Abef[1];
+  State[5] = Abef[0];
+  State[6] = Cdgh[1];
+  State[7] = Cdgh[0];
+}
+
+/**
+  Rotate every dword of a vector right.
+**/
+    #define OC_SHA256_VROTR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+  Perform one SHA-256 round with precalculated W + K value. Variables are
+  renamed by the caller instead of moved, the new A ends up in H.
+**/
+    #define OC_SHA256_ROUND(A, B, C, D, E, F, G, H, Wk)  \
+  do {                                                \
+    T1 = H + SHA256_EP1 (E) + CH (E, F, G) + (Wk);    \
+    D += T1;                                          \
+    H  = T1 + SHA256_EP0 (A) + MAJ (A, B, C);         \
+  } while (0)
+
+/**
+  Perform 64 SHA-256 rounds with BMI2 RORX over precalculated W + K values.
+
+  @param[in,out] State   SHA-256 state.
+  @param[in]     Wk      W + K values of the block, interleaved with other
+                         blocks by 4 dwords.
+  @param[in]     Stride  Amount of interleaved blocks in Wk.
+**/
+STATIC
+__attribute__ ((target ("avx2,bmi2")))
+VOID
+InternalSha256RoundsAvx2 (
+  IN OUT UINT32        *State,
+  IN     CONST UINT32  *Wk,
+  IN     UINTN         Stride
+  )
+{
+  UINT32  A;
+  UINT32  B;
+  UINT32  C;
+  UINT32  D;
+  UINT32  E;
+  UINT32  F;
+  UINT32  G;
+  UINT32  H;
+  UINT32  T1;
+  UINTN   Index;
+
+  A = State[0];
+  B = State[1];
+  C = State[2];
+  D = State[3];
+  E = State[4];
+  F = State[5];
+  G = State[6];
+  H = State[7];
+
+  for (Index = 0; Index < 64; Index += 8, Wk += 8 * Stride) {
+    OC_SHA256_ROUND (A, B, C, D, E, F, G, H, Wk[0]);
+    OC_SHA256_ROUND (H, A, B, C, D, E, F, G, Wk[1]);
+    OC_SHA256_ROUND (G, H, A, B, C, D, E, F, Wk[2]);
+    OC_SHA256_ROUND (F, G, H, A, B, C, D, E, Wk[3]);
+    OC_SHA256_ROUND (E, F, G, H, A, B, C, D, Wk[4 * Stride]);
+    OC_SHA256_ROUND (D, E, F, G, H, A, B, C, Wk[4 * Stride + 1]);
+    OC_SHA256_ROUND (C, D, E, F, G, H, A, B, Wk[4 * Stride + 2]);
+    OC_SHA256_ROUND (B, C, D, E, F, G, H, A, Wk[4 * Stride + 3]);
+  }
+
+  State[0] += A;
+  State[1] += B;
+  State[2] += C;
+  State[3] += D;
+  State[4] += E;
+  State[5] += F;
+  State[6] += G;
+  State[7] += H;
+}
+
+/**
+  Process SHA-256 blocks with AVX2 and BMI2.
+
+  The message schedule of two consecutive blocks is calculated at once,
+  one block per 128-bit lane, four dwords at a time. The rounds of both
+  blocks then use RORX with the state kept in registers.
+
+  @param[in,out] State    SHA-256 state.
+  @param[in]     Data     Message blocks.
+  @param[in]     BlockNb  Amount of SHA256_BLOCK_SIZE blocks.
+**/
+STATIC
+__attribute__ ((target ("avx2,bmi2")))
+VOID
+InternalSha256TransformAvx2 (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  )
+{
+  CONST OC_SHA256_B32  Swap = { OC_SHA256_BSWAP_MASK, OC_SHA256_BSWAP_MASK };
+  CONST UINT8          *Next;
+  OC_SHA256_D32        W[16];
+  OC_SHA256_D32        Msg;
+  OC_SHA256_D32        Sig;
+  OC_SHA256_D16        Lo;
+  OC_SHA256_D16        Hi;
+  UINT32               Wk[16 * 8];
+  UINTN                Index;
+
+  while (BlockNb > 0) {
+    //
+    // The last odd block is scheduled twice, its copy is not used.
+    //
+    Next = BlockNb > 1 ? Data + SHA256_BLOCK_SIZE : Data;
+
+    for (Index = 0; Index < 4; ++Index) {
+      __builtin_memcpy (&Lo, &Data[Index * sizeof (Lo)], sizeof (Lo));
+      __builtin_memcpy (&Hi, &Next[Index * sizeof (Hi)], sizeof (Hi));
+      Msg      = (OC_SHA256_D32) { Lo[0], Lo[1], Lo[2], Lo[3], Hi[0], Hi[1], Hi[2], Hi[3] };
+      W[Index] = (OC_SHA256_D32)__builtin_ia32_pshufb256 ((OC_SHA256_B32)Msg, Swap);
+    }
+
+    for (Index = 4; Index < 16; ++Index) {
+      //
+      // W[t-16..t-13] + SIG0 (W[t-15..t-12]) + W[t-7..t-4]
+      //
+      Msg  = OC_SHA256_ALIGN2 (W[Index - 3], W[Index - 4]);
+      Msg  = OC_SHA256_VROTR (Msg, 7) ^ OC_SHA256_VROTR (Msg, 18) ^ (Msg >> 3);
+      Msg += W[Index - 4];
+      Msg += OC_SHA256_ALIGN2 (W[Index - 1], W[Index - 2]);
+
+      //
+      // SIG1 (W[t-2..t-1]) completes the lower half, which then feeds
+      // SIG1 for the upper half.
+      //
+      Sig = (OC_SHA256_D32) {
+        W[Index - 1][2], W[Index - 1][3], 0, 0, W[Index - 1][6], W[Index - 1][7], 0, 0
+      };
+      Msg += OC_SHA256_VROTR (Sig, 17) ^ OC_SHA256_VROTR (Sig, 19) ^ (Sig >> 10);
+      Sig  = (OC_SHA256_D32) { 0, 0, Msg[0], Msg[1], 0, 0, Msg[4], Msg[5] };
+      Msg += OC_SHA256_VROTR (Sig, 17) ^ OC_SHA256_VROTR (Sig, 19) ^ (Sig >> 10);
+
+      W[Index] = Msg;
+    }
+
+    for (Index = 0; Index < 16; ++Index) {
+      __builtin_memcpy (&Lo, &SHA256_K[Index * 4], sizeof (Lo));
+      Msg = W[Index] + (OC_SHA256_D32) { Lo[0], Lo[1], Lo[2], Lo[3], Lo[0], Lo[1], Lo[2], Lo[3] };
+      __builtin_memcpy (&Wk[Index * 8], &Msg, sizeof (Msg));
+    }
+
+    InternalSha256RoundsAvx2 (State, Wk, 2);
+    if (BlockNb == 1) {
+      break;
+    }
+
+    InternalSha256RoundsAvx2 (State, &Wk[4], 2);
+
+    BlockNb -= 2;
+    Data    += 2 * SHA256_BLOCK_SIZE;
+  }
+}
+
+  #endif
+
+OC_SHA256_MODE
+OcSetSha256Mode (
+  IN OC_SHA256_MODE  Mode
+  )
+{
+  return (OC_SHA256_MODE)InternalSetCryptoMode (&mSha256Mode, Mode);
+}
+
+OC_SHA256_MODE
+Sha256GetMode (
+  VOID
+  )
+{
+  return (OC_SHA256_MODE)InternalGetCryptoMode (&mSha256Mode);
+}
+
+VOID
+Sha256TransformBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  )
+{
+  OC_SHA256_MODE  Mode;
+
+  Mode = Sha256GetMode ();
+
+ #ifdef OC_SHA256_VECTOR
+  if (Mode == OcSha256ShaNi) {
+    InternalSha256TransformShaNi (State, Data, BlockNb);
+    return;
+  }
+
+  if (Mode == OcSha256Avx2) {
+    InternalSha256TransformAvx2 (State, Data, BlockNb);
+    return;
+  }
+
+ #endif
+
+  Sha256Transform (State, Data, BlockNb);
+}
+
+#endif
@@ -0,0 +1,414 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include "Sha2Internal.h"
+
+#if defined (MDE_CPU_X64) && (defined (__GNUC__) || defined (__clang__))
+//
+// Multi-buffer SHA-256 relies on GCC vector extensions and per-function
+// targets.
+//
+  #define OC_SHA256_MULTI_VECTOR
+#endif
+
+#ifdef OC_CRYPTO_SUPPORTS_SHA256
+
+  #ifdef OC_SHA256_MULTI_VECTOR
+
+typedef UINT32 OC_SHA256_X4 __attribute__ ((vector_size (16)));
+typedef UINT32 OC_SHA256_X8 __attribute__ ((vector_size (32)));
+
+//
+// SHA-256 functions on vectors of independent messages.
+//
+    #define OC_SHA256_MROTR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+    #define OC_SHA256_MEP0(x)      (OC_SHA256_MROTR (x, 2) ^ OC_SHA256_MROTR (x, 13) ^ OC_SHA256_MROTR (x, 22))
+    #define OC_SHA256_MEP1(x)      (OC_SHA256_MROTR (x, 6) ^ OC_SHA256_MROTR (x, 11) ^ OC_SHA256_MROTR (x, 25))
+    #define OC_SHA256_MSIG0(x)     (OC_SHA256_MROTR (x, 7) ^ OC_SHA256_MROTR (x, 18) ^ ((x) >> 3))
+    #define OC_SHA256_MSIG1(x)     (OC_SHA256_MROTR (x, 17) ^ OC_SHA256_MROTR (x, 19) ^ ((x) >> 10))
+
+//
+// One round with the message schedule kept in the last 16 words of W.
+//
+    #define OC_SHA256_MULTI_ROUND(Index)                                      \
+  do {                                                                        \
+    if ((Index) >= 16) {                                                      \
+      W[(Index) & 15U] += OC_SHA256_MSIG1 (W[((Index) - 2) & 15U])            \
+                          + W[((Index) - 7) & 15U]                            \
+                          + OC_SHA256_MSIG0 (W[((Index) - 15) & 15U]);        \
+    }                                                                         \
+    T1 = H + OC_SHA256_MEP1 (E) + CH (E, F, G) + SHA256_K[Index] + W[(Index) & 15U]; \
+    T2 = OC_SHA256_MEP0 (A) + MAJ (A, B, C);                                  \
+    H  = G;                                                                   \
+    G  = F;                                                                   \
+    F  = E;                                                                   \
+    E  = D + T1;                                                              \
+    D  = C;                                                                   \
+    C  = B;                                                                   \
+    B  = A;                                                                   \
+    A  = T1 + T2;                                                             \
+  } while (0)
+
+//
+// Multi-buffer lane, a message with whole blocks left to hash.
+//
+typedef struct {
+  SHA256_CONTEXT    *Context;
+  CONST UINT8       *Data;
+  UINTN             BlockNb;
+  UINTN             Tail;
+} OC_SHA256_LANE;
+
+STATIC
+UINT32
+InternalLoadBe32 (
+  IN CONST UINT8  *Data
+  )
+{
+  UINT32  Value;
+
+  __builtin_memcpy (&Value, Data, sizeof (Value));
+  return __builtin_bswap32 (Value);
+}
+
+/**
+  Process SHA-256 blocks of 4 independent messages with SSE2.
+
+  @param[in,out] State    SHA-256 states, word-major, 8 * 4 words.
+  @param[in]     Data     4 message pointers.
+  @param[in]     BlockNb  Amount of SHA256_BLOCK_SIZE blocks of every message.
+**/
+STATIC
+VOID
+InternalSha256TransformX4 (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  **Data,
+  IN     UINTN        BlockNb
+  )
+{
+  OC_SHA256_X4  S[8];
+  OC_SHA256_X4  W[16];
+  OC_SHA256_X4  A, B, C, D, E, F, G, H, T1, T2;
+  UINTN         Offset;
+  UINTN         Index;
+
+  __builtin_memcpy (S, State, sizeof (S));
+
+  for (Offset = 0; BlockNb > 0; --BlockNb, Offset += SHA256_BLOCK_SIZE) {
+    for (Index = 0; Index < 16; ++Index) {
+      W[Index] = (OC_SHA256_X4) {
+        InternalLoadBe32 (&Data[0][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[1][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[2][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[3][Offset + Index * 4])
+      };
+    }
+
+    A = S[0];
+    B = S[1];
+    C = S[2];
+    D = S[3];
+    E = S[4];
+    F = S[5];
+    G = S[6];
+    H = S[7];
+
+    for (Index = 0; Index < 64; ++Index) {
+      OC_SHA256_MULTI_ROUND (Index);
+    }
+
+    S[0] += A;
+    S[1] += B;
+    S[2] += C;
+    S[3] += D;
+    S[4] += E;
+    S[5] += F;
+    S[6] += G;
+    S[7] += H;
+  }
+
+  __builtin_memcpy (State, S, sizeof (S));
+}
+
+/**
+  Process SHA-256 blocks of 8 independent messages with AVX2.
+
+  @param[in,out] State    SHA-256 states, word-major, 8 * 8 words.
+  @param[in]     Data     8 message pointers.
+  @param[in]     BlockNb  Amount of SHA256_BLOCK_SIZE blocks of every message.
+**/
+STATIC
+__attribute__ ((target ("avx2")))
+VOID
+InternalSha256TransformX8 (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  **Data,
+  IN     UINTN        BlockNb
+  )
+{
+  OC_SHA256_X8  S[8];
+  OC_SHA256_X8  W[16];
+  OC_SHA256_X8  A, B, C, D, E, F, G, H, T1, T2;
+  UINTN         Offset;
+  UINTN         Index;
+
+  __builtin_memcpy (S, State, sizeof (S));
+
+  for (Offset = 0; BlockNb > 0; --BlockNb, Offset += SHA256_BLOCK_SIZE) {
+    for (Index = 0; Index < 16; ++Index) {
+      W[Index] = (OC_SHA256_X8) {
+        InternalLoadBe32 (&Data[0][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[1][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[2][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[3][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[4][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[5][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[6][Offset + Index * 4]),
+        InternalLoadBe32 (&Data[7][Offset + Index * 4])
+      };
+    }
+
+    A = S[0];
+    B = S[1];
+    C = S[2];
+    D = S[3];
+    E = S[4];
+    F = S[5];
+    G = S[6];
+    H = S[7];
+
+    for (Index = 0; Index < 64; ++Index) {
+      OC_SHA256_MULTI_ROUND (Index);
+    }
+
+    S[0] += A;
+    S[1] += B;
+    S[2] += C;
+    S[3] += D;
+    S[4] += E;
+    S[5] += F;
+    S[6] += G;
+    S[7] += H;
+  }
+
+  __builtin_memcpy (State, S, sizeof (S));
+}
+
+/**
+  Update SHA-256 contexts in lanes of Width messages. Free lanes are
+  refilled with the next messages as soon as a message runs out of whole
+  blocks, buffered and trailing partial blocks go through Sha256Update.
+
+  @param[in,out] Contexts  Array of Count contexts.
+  @param[in]     Data      Array of Count message parts.
+  @param[in]     Len       Array of Count message part lengths.
+  @param[in]     Count     Amount of contexts.
+  @param[in]     Width     Amount of lanes, 4 or 8.
+**/
+STATIC
+VOID
+InternalSha256UpdateLanes (
+  IN OUT SHA256_CONTEXT  *Contexts,
+  IN     CONST UINT8     **Data,
+  IN     CONST UINTN     *Len,
+  IN     UINTN           Count,
+  IN     UINTN           Width
+  )
+{
+  OC_SHA256_LANE  Lanes[OC_SHA256_MULTI_LANES];
+  CONST UINT8     *LaneData[OC_SHA256_MULTI_LANES];
+  UINT32          State[8 * OC_SHA256_MULTI_LANES];
+  SHA256_CONTEXT  *Context;
+  CONST UINT8     *Message;
+  UINTN           Length;
+  UINTN           Fill;
+  UINTN           LaneNb;
+  UINTN           Next;
+  UINTN           BlockNb;
+  UINTN           Index;
+  UINTN           Word;
+  OC_SHA256_LANE  *Lane;
+
+  LaneNb = 0;
+  Next   = 0;
+
+  while (TRUE) {
+    while (LaneNb < Width && Next < Count) {
+      Context = &Contexts[Next];
+      Message = Data[Next];
+      Length  = Len[Next];
+      ++Next;
+
+      if (Context->DataLen > 0) {
+        Fill = SHA256_BLOCK_SIZE - Context->DataLen;
+        if (Fill > Length) {
+          Fill = Length;
+        }
+
+        Sha256Update (Context, Message, Fill);
+        Message += Fill;
+        Length  -= Fill;
+      }
+
+      if (Length < SHA256_BLOCK_SIZE) {
+        Sha256Update (Context, Message, Length);
+        continue;
+      }
+
+      Lanes[LaneNb].Context = Context;
+      Lanes[LaneNb].Data    = Message;
+      Lanes[LaneNb].BlockNb = Length / SHA256_BLOCK_SIZE;
+      Lanes[LaneNb].Tail    = Length % SHA256_BLOCK_SIZE;
+      ++LaneNb;
+    }
+
+    if (LaneNb == 0) {
+      break;
+    }
+
+    //
+    // The last message gains nothing from lanes.
+    //
+    if (LaneNb == 1) {
+      Sha256Update (
+        Lanes[0].Context,
+        Lanes[0].Data,
+        Lanes[0].BlockNb * SHA256_BLOCK_SIZE + Lanes[0].Tail
+        );
+      break;
+    }
+
+    BlockNb = Lanes[0].BlockNb;
+    for (Index = 1; Index < LaneNb; ++Index) {
+      if (BlockNb > Lanes[Index].BlockNb) {
+        BlockNb = Lanes[Index].BlockNb;
+      }
+    }
+
+    //
+    // Unused lanes repeat the first message, their results are dropped.
+    //
+    for (Index = 0; Index < Width; ++Index) {
+      Lane            = &Lanes[Index < LaneNb ? Index : 0];
+      LaneData[Index] = Lane->Data;
+      for (Word = 0; Word < 8; ++Word) {
+        State[Word * Width + Index] = Lane->Context->State[Word];
+      }
+    }
+
+    if (Width == 8) {
+      InternalSha256TransformX8 (State, LaneData, BlockNb);
+    } else {
+      InternalSha256TransformX4 (State, LaneData, BlockNb);
+    }
+
+    for (Index = 0; Index < LaneNb; ++Index) {
+      Lane = &Lanes[Index];
+      for (Word = 0; Word < 8; ++Word) {
+        Lane->Context->State[Word] = State[Word * Width + Index];
+      }
+
+      Lane->Context->BitLen += (UINT64)BlockNb * SHA256_BLOCK_SIZE * 8;
+      Lane->Data            += BlockNb * SHA256_BLOCK_SIZE;
+      Lane->BlockNb         -= BlockNb;
+    }
+
+    Index = 0;
+    while (Index < LaneNb) {
+      Lane = &Lanes[Index];
+      if (Lane->BlockNb > 0) {
+        ++Index;
+        continue;
+      }
+
+      Sha256Update (Lane->Context, Lane->Data, Lane->Tail);
+      --LaneNb;
+      CopyMem (Lane, &Lanes[LaneNb], sizeof (*Lane));
+    }
+  }
+
+  ZeroMem (State, sizeof (State));
+}
+
+  #endif
+
+VOID
+Sha256UpdateMulti (
+  IN OUT SHA256_CONTEXT  *Contexts,
+  IN     CONST UINT8     **Data,
+  IN     CONST UINTN     *Len,
+  IN     UINTN           Count
+  )
+{
+  UINTN  Index;
+
+  #ifdef OC_SHA256_MULTI_VECTOR
+  OC_SHA256_MODE  Mode;
+
+  Mode = Sha256GetMode ();
+  if (Mode == OcSha256Avx2) {
+    InternalSha256UpdateLanes (Contexts, Data, Len, Count, 8);
+    return;
+  }
+
+  if (Mode == OcSha256Sse2) {
+    InternalSha256UpdateLanes (Contexts, Data, Len, Count, 4);
+    return;
+  }
+
+  #endif
+
+  //
+  // SHA-NI and portable code hash one message at a time.
+  //
+  for (Index = 0; Index < Count; ++Index) {
+    Sha256Update (&Contexts[Index], Data[Index], Len[Index]);
+  }
+}
+
+VOID
+Sha256Multi (
+  OUT UINT8        *Hashes,
+  IN  CONST UINT8  **Data,
+  IN  CONST UINTN  *Len,
+  IN  UINTN        Count
+  )
+{
+  SHA256_CONTEXT  Contexts[OC_SHA256_MULTI_LANES];
+  UINTN           Batch;
+  UINTN           Index;
+
+  while (Count > 0) {
+    Batch = MIN (Count, OC_SHA256_MULTI_LANES);
+
+    for (Index = 0; Index < Batch; ++Index) {
+      Sha256Init (&Contexts[Index]);
+    }
+
+    Sha256UpdateMulti (Contexts, Data, Len, Batch);
+
+    for (Index = 0; Index < Batch; ++Index) {
+      Sha256Final (&Contexts[Index], &Hashes[Index * SHA256_DIGEST_SIZE]);
+    }
+
+    Hashes += Batch * SHA256_DIGEST_SIZE;
+    Data   += Batch;
+    Len    += Batch;
+    Count  -= Batch;
+  }
+
+  ZeroMem (Contexts, sizeof (Contexts));
+}
+
+#endif
@@ -21,7 +21,111 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "CryptoInternal.h"
 
-extern BOOLEAN  mIsAccelEnabled;
+#define SHFR(a, b)      (a >> b)
+#define ROTLEFT(a, b)   ((a << b) | (a >> ((sizeof(a) << 3) - b)))
+#define ROTRIGHT(a, b)  ((a >> b) | (a << ((sizeof(a) << 3) - b)))
+#define CH(x, y, z)     (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z)    (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+
+#define UNPACK64(x, str)                         \
+  do {                                           \
+    *((str) + 7) = (UINT8) (x);                  \
+    *((str) + 6) = (UINT8) RShiftU64 ((x),  8);  \
+    *((str) + 5) = (UINT8) RShiftU64 ((x), 16);  \
+    *((str) + 4) = (UINT8) RShiftU64 ((x), 24);  \
+    *((str) + 3) = (UINT8) RShiftU64 ((x), 32);  \
+    *((str) + 2) = (UINT8) RShiftU64 ((x), 40);  \
+    *((str) + 1) = (UINT8) RShiftU64 ((x), 48);  \
+    *((str) + 0) = (UINT8) RShiftU64 ((x), 56);  \
+  } while(0)
+
+#define PACK64(str, x)                           \
+  do {                                           \
+    *(x) =    ((UINT64) *((str) + 7))            \
+           | LShiftU64 (*((str) + 6),  8)        \
+           | LShiftU64 (*((str) + 5), 16)        \
+           | LShiftU64 (*((str) + 4), 24)        \
+           | LShiftU64 (*((str) + 3), 32)        \
+           | LShiftU64 (*((str) + 2), 40)        \
+           | LShiftU64 (*((str) + 1), 48)        \
+           | LShiftU64 (*((str) + 0), 56);       \
+  } while (0)
+
+//
+// Sha 256
+//
+#define SHA256_EP0(x)   (ROTRIGHT(x, 2)  ^ ROTRIGHT(x, 13) ^ ROTRIGHT(x, 22))
+#define SHA256_EP1(x)   (ROTRIGHT(x, 6)  ^ ROTRIGHT(x, 11) ^ ROTRIGHT(x, 25))
+#define SHA256_SIG0(x)  (ROTRIGHT(x, 7)  ^ ROTRIGHT(x, 18) ^ SHFR(x, 3))
+#define SHA256_SIG1(x)  (ROTRIGHT(x, 17) ^ ROTRIGHT(x, 19) ^ SHFR(x, 10))
+
+extern CONST UINT32  SHA256_K[64];
+
+/**
+  Process SHA-256 blocks with portable code.
+
+  @param[in,out] State    SHA-256 state.
+  @param[in]     Data     Message blocks.
+  @param[in]     BlockNb  Amount of SHA256_BLOCK_SIZE blocks.
+**/
+VOID
+Sha256Transform (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  );
+
+/**
+  Get SHA-256 implementation in use, selecting it when necessary.
+
+  @return  SHA-256 implementation.
+**/
+OC_SHA256_MODE
+Sha256GetMode (
+  VOID
+  );
+
+/**
+  Process SHA-256 blocks with the best supported implementation,
+  see OcSetSha256Mode.
+
+  @param[in,out] State    SHA-256 state.
+  @param[in]     Data     Message blocks.
+  @param[in]     BlockNb  Amount of SHA256_BLOCK_SIZE blocks.
+**/
+VOID
+Sha256TransformBlocks (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  );
+
+/**
+  Process a single SHA-512 block already converted to host byte order.
+
+  @param[in,out] State  SHA-512 state.
+  @param[in,out] W      Message schedule of 80 words, the first 16 of which
+                        contain the message block. The rest is overwritten.
+**/
+VOID
+Sha512TransformWords (
+  IN OUT UINT64  *State,
+  IN OUT UINT64  *W
+  );
+
+/**
+  Process SHA-512 blocks with portable code.
+
+  @param[in,out] State    SHA-512 state.
+  @param[in]     Data     Message blocks.
+  @param[in]     BlockNb  Amount of SHA512_BLOCK_SIZE blocks.
+**/
+VOID
+Sha512Transform (
+  IN OUT UINT64       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  );
 
 VOID
 EFIAPI
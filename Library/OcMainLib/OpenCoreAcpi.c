@@ -32,55 +32,72 @@ OcAcpiAddTables (
   )
 {
   EFI_STATUS         Status;
-  UINT8              *TableData;
-  UINT32             TableDataLength;
+  VOID               *TableData[OC_SHA256_MULTI_LANES];
+  UINT32             TableDataLength[OC_SHA256_MULTI_LANES];
+  CONST CHAR8        *TablePaths[OC_SHA256_MULTI_LANES];
+  CONST CHAR16       *FullPaths[OC_SHA256_MULTI_LANES];
+  CHAR16             FullPathData[OC_SHA256_MULTI_LANES][OC_STORAGE_SAFE_PATH_MAX];
   UINT32             Index;
+  UINTN              Count;
+  UINTN              Batch;
   OC_ACPI_ADD_ENTRY  *Table;
   CONST CHAR8        *TablePath;
-  CHAR16             FullPath[OC_STORAGE_SAFE_PATH_MAX];
 
-  for (Index = 0; Index < Config->Acpi.Add.Count; ++Index) {
-    Table     = Config->Acpi.Add.Values[Index];
-    TablePath = OC_BLOB_GET (&Table->Path);
-
-    if (!Table->Enabled || (TablePath[0] == '\0')) {
-      DEBUG ((DEBUG_INFO, "OC: Skipping add ACPI %a (%d)\n", TablePath, Table->Enabled));
-      continue;
-    }
-
-    Status = OcUnicodeSafeSPrint (FullPath, sizeof (FullPath), OPEN_CORE_ACPI_PATH "%a", TablePath);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((
-        DEBUG_WARN,
-        "OC: Failed to fit ACPI path %s%a",
-        OPEN_CORE_ACPI_PATH,
-        TablePath
-        ));
-      continue;
-    }
-
-    UnicodeUefiSlashes (FullPath);
-
-    TableData = OcStorageReadFileUnicode (Storage, FullPath, &TableDataLength);
-
-    if (TableData == NULL) {
-      DEBUG ((
-        DEBUG_WARN,
-        "OC: Failed to find ACPI %a\n",
-        TablePath
-        ));
-      continue;
+  //
+  // Tables are read in batches to verify them against the vault together,
+  // and are inserted in the original order.
+  //
+  Index = 0;
+  while (Index < Config->Acpi.Add.Count) {
+    for (Count = 0; Index < Config->Acpi.Add.Count && Count < OC_SHA256_MULTI_LANES; ++Index) {
+      Table     = Config->Acpi.Add.Values[Index];
+      TablePath = OC_BLOB_GET (&Table->Path);
+
+      if (!Table->Enabled || (TablePath[0] == '\0')) {
+        DEBUG ((DEBUG_INFO, "OC: Skipping add ACPI %a (%d)\n", TablePath, Table->Enabled));
+        continue;
+      }
+
+      Status = OcUnicodeSafeSPrint (FullPathData[Count], sizeof (FullPathData[Count]), OPEN_CORE_ACPI_PATH "%a", TablePath);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((
+          DEBUG_WARN,
+          "OC: Failed to fit ACPI path %s%a",
+          OPEN_CORE_ACPI_PATH,
+          TablePath
+          ));
+        continue;
+      }
+
+      UnicodeUefiSlashes (FullPathData[Count]);
+
+      TablePaths[Count] = TablePath;
+      FullPaths[Count]  = FullPathData[Count];
+      ++Count;
     }
 
-    Status = AcpiInsertTable (Context, TableData, TableDataLength);
-
-    if (EFI_ERROR (Status)) {
-      DEBUG ((
-        DEBUG_WARN,
-        "OC: Failed to add ACPI %a - %r\n",
-        TablePath,
-        Status
-        ));
+    OcStorageReadFilesUnicode (Storage, FullPaths, Count, TableData, TableDataLength);
+
+    for (Batch = 0; Batch < Count; ++Batch) {
+      if (TableData[Batch] == NULL) {
+        DEBUG ((
+          DEBUG_WARN,
+          "OC: Failed to find ACPI %a\n",
+          TablePaths[Batch]
+          ));
+        continue;
+      }
+
+      Status = AcpiInsertTable (Context, TableData[Batch], TableDataLength[Batch]);
+
+      if (EFI_ERROR (Status)) {
+        DEBUG ((
+          DEBUG_WARN,
+          "OC: Failed to add ACPI %a - %r\n",
+          TablePaths[Batch],
+          Status
+          ));
+      }
     }
   }
 }
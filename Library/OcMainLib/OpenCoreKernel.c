@@ -21,6 +21,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/MemoryAllocationLib.h>
 #include <Library/OcAfterBootCompatLib.h>
 #include <Library/OcAppleKernelLib.h>
+#include <Library/OcCpuLib.h>
 #include <Library/OcMiscLib.h>
 #include <Library/OcAppleImg4Lib.h>
 #include <Library/OcStringLib.h>
@@ -681,6 +682,65 @@ OcKernelInjectKext (
   DEBUG_CODE_END ();
 }
 
+STATIC
+VOID
+OcKernelLoadLinkCache (
+  IN OC_GLOBAL_CONFIG   *Config,
+  IN PRELINKED_CONTEXT  *Context
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Cache;
+  UINT32      CacheSize;
+
+  if (!Config->Kernel.Scheme.KextLinkCache || (mOcStorage == NULL)) {
+    return;
+  }
+
+  //
+  // Cache file cannot be covered by vault, so it must not bypass vault checks.
+  //
+  if (mOcStorage->HasVault) {
+    DEBUG ((DEBUG_INFO, "OC: Linked kext cache is unavailable with vault\n"));
+    return;
+  }
+
+  CacheSize = 0;
+  Cache     = OcStorageReadFileUnicode (mOcStorage, OPEN_CORE_KEXT_LINK_CACHE_PATH, &CacheSize);
+
+  Status = PrelinkedLinkCacheInit (Context, mKernelDigest, OcMiscGetVersionString (), Cache, CacheSize);
+  DEBUG ((DEBUG_INFO, "OC: Linked kext cache init from %u bytes - %r\n", CacheSize, Status));
+}
+
+STATIC
+VOID
+OcKernelSaveLinkCache (
+  IN PRELINKED_CONTEXT  *Context
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Cache;
+  UINT32      CacheSize;
+
+  Cache = PrelinkedLinkCacheExport (Context, &CacheSize);
+  if (Cache == NULL) {
+    return;
+  }
+
+  if (mOcStorage->Storage != NULL) {
+    //
+    // Existing file is not truncated on write.
+    //
+    OcDeleteFile (mOcStorage->Storage, OPEN_CORE_KEXT_LINK_CACHE_PATH);
+    Status = OcSetFileData (mOcStorage->Storage, OPEN_CORE_KEXT_LINK_CACHE_PATH, Cache, CacheSize);
+  } else {
+    Status = EFI_UNSUPPORTED;
+  }
+
+  DEBUG ((DEBUG_INFO, "OC: Saving %u byte linked kext cache - %r\n", CacheSize, Status));
+  FreePool (Cache);
+}
+
 VOID
 OcKernelInjectKexts (
   IN OC_GLOBAL_CONFIG   *Config,
@@ -705,6 +765,8 @@ OcKernelInjectKexts (
       DEBUG ((DEBUG_WARN, "OC: Prelink inject prepare error - %r\n", Status));
       return;
     }
+
+    OcKernelLoadLinkCache (Config, Context);
   }
 
   //
@@ -754,6 +816,9 @@ OcKernelInjectKexts (
       );
 
     Status = PrelinkedInjectComplete (Context);
+    if (!EFI_ERROR (Status)) {
+      OcKernelSaveLinkCache (Context);
+    }
   } else {
     Status = EFI_UNSUPPORTED;
   }
@@ -1107,6 +1172,7 @@ OcKernelFileOpen (
   CONST CHAR8        *SecureBootModel;
   KERNEL_CACHE_TYPE  MaxCacheTypeAllowed;
   BOOLEAN            UseSecureBoot;
+  BOOLEAN            UseDigest;
 
   UINT8              *Kernel;
   UINT32             KernelSize;
@@ -1142,10 +1208,11 @@ OcKernelFileOpen (
   }
 
   //
-  // We only want to calculate kernel hashes if secure boot is enabled.
+  // We only want to calculate kernel hashes if secure boot or linked kext cache is enabled.
   //
   SecureBootModel = OC_BLOB_GET (&mOcConfiguration->Misc.Security.SecureBootModel);
   UseSecureBoot   = AsciiStrCmp (SecureBootModel, OC_SB_MODEL_DISABLED) != 0;
+  UseDigest       = UseSecureBoot || mOcConfiguration->Kernel.Scheme.KextLinkCache;
 
   //
   // Hook injected OcXXXXXXXX.kext reads from /S/L/E.
@@ -1217,7 +1284,7 @@ OcKernelFileOpen (
                &AllocatedSize,
                &ReservedExeSize,
                &LinkedExpansion,
-               UseSecureBoot ? mKernelDigest : NULL
+               UseDigest ? mKernelDigest : NULL
                );
   }
 
@@ -1276,7 +1343,7 @@ OcKernelFileOpen (
                  &AllocatedSize,
                  &ReservedExeSize,
                  &LinkedExpansion,
-                 UseSecureBoot ? mKernelDigest : NULL
+                 UseDigest ? mKernelDigest : NULL
                  );
 
       if (Status == EFI_NOT_FOUND) {
@@ -1333,6 +1400,9 @@ OcKernelFileOpen (
 
       DEBUG ((DEBUG_INFO, "OC: Prelinked status - %r\n", PrelinkedStatus));
 
+      OcKernelPhaseReport (OcGetTSCFrequency ());
+      OcKernelPhaseReset ();
+
       Status = OcGetFileModificationTime (*NewHandle, &ModificationTime);
       if (EFI_ERROR (Status)) {
         ZeroMem (&ModificationTime, sizeof (ModificationTime));
@@ -1421,6 +1491,9 @@ OcKernelFileOpen (
                  AllocatedSize
                  );
       DEBUG ((DEBUG_INFO, "OC: Mkext status - %r\n", Status));
+
+      OcKernelPhaseReport (OcGetTSCFrequency ());
+      OcKernelPhaseReset ();
       if (!EFI_ERROR (Status)) {
         Status = OcGetFileModificationTime (*NewHandle, &ModificationTime);
         if (EFI_ERROR (Status)) {
@@ -72,6 +72,37 @@ GetSerialRegisterBase (
   VOID
   );
 
+/**
+  Free kernel patch batch buffers.
+
+  @param[in,out] Patches  Collected patches.
+  @param[in,out] Indices  Configuration indices of collected patches.
+  @param[in,out] Results  Results of collected patches.
+**/
+STATIC
+VOID
+OcKernelFreeBatchedPatches (
+  IN OUT PATCHER_GENERIC_PATCH  **Patches,
+  IN OUT UINT32                 **Indices,
+  IN OUT EFI_STATUS             **Results
+  )
+{
+  if (*Patches != NULL) {
+    FreePool (*Patches);
+    *Patches = NULL;
+  }
+
+  if (*Indices != NULL) {
+    FreePool (*Indices);
+    *Indices = NULL;
+  }
+
+  if (*Results != NULL) {
+    FreePool (*Results);
+    *Results = NULL;
+  }
+}
+
 VOID
 OcKernelApplyPatches (
   IN     OC_GLOBAL_CONFIG   *Config,
@@ -97,8 +128,18 @@ OcKernelApplyPatches (
   BOOLEAN                IsKernelPatch;
   UINTN                  RegisterBase;
   UINT32                 RegisterStride;
-
-  IsKernelPatch = Context == NULL;
+  PATCHER_GENERIC_PATCH  *KernelPatches;
+  UINT32                 *KernelPatchIndices;
+  EFI_STATUS             *KernelPatchResults;
+  UINT32                 NumKernelPatches;
+  UINT64                 Start;
+
+  Start              = OcKernelPhaseStart ();
+  IsKernelPatch      = Context == NULL;
+  KernelPatches      = NULL;
+  KernelPatchIndices = NULL;
+  KernelPatchResults = NULL;
+  NumKernelPatches   = 0;
 
   if (IsKernelPatch) {
     ASSERT (Kernel != NULL);
@@ -276,6 +317,19 @@ OcKernelApplyPatches (
     }
   }
 
+  //
+  // Kernel patches are collected and applied with a single scan over the kernel.
+  //
+  if (IsKernelPatch && (Config->Kernel.Patch.Count > 0)) {
+    KernelPatches      = AllocatePool (Config->Kernel.Patch.Count * sizeof (*KernelPatches));
+    KernelPatchIndices = AllocatePool (Config->Kernel.Patch.Count * sizeof (*KernelPatchIndices));
+    KernelPatchResults = AllocatePool (Config->Kernel.Patch.Count * sizeof (*KernelPatchResults));
+    if ((KernelPatches == NULL) || (KernelPatchIndices == NULL) || (KernelPatchResults == NULL)) {
+      DEBUG ((DEBUG_INFO, "OC: Kernel patches will be applied one by one\n"));
+      OcKernelFreeBatchedPatches (&KernelPatches, &KernelPatchIndices, &KernelPatchResults);
+    }
+  }
+
   for (Index = 0; Index < Config->Kernel.Patch.Count; ++Index) {
     UserPatch = Config->Kernel.Patch.Values[Index];
     Target    = OC_BLOB_GET (&UserPatch->Identifier);
@@ -364,6 +418,13 @@ OcKernelApplyPatches (
     Patch.Limit = UserPatch->Limit;
 
     if (IsKernelPatch) {
+      if (KernelPatches != NULL) {
+        CopyMem (&KernelPatches[NumKernelPatches], &Patch, sizeof (Patch));
+        KernelPatchIndices[NumKernelPatches] = Index;
+        ++NumKernelPatches;
+        continue;
+      }
+
       Status = PatcherApplyGenericPatch (&KernelPatcher, &Patch);
     } else {
       if (CacheType == CacheTypeCacheless) {
@@ -387,6 +448,31 @@ OcKernelApplyPatches (
       Status
       ));
   }
+
+  if (KernelPatches != NULL) {
+    PatcherApplyGenericPatches (&KernelPatcher, KernelPatches, NumKernelPatches, KernelPatchResults);
+
+    for (Index = 0; Index < NumKernelPatches; ++Index) {
+      UserPatch = Config->Kernel.Patch.Values[KernelPatchIndices[Index]];
+      DEBUG ((
+        EFI_ERROR (KernelPatchResults[Index]) ? DEBUG_WARN : DEBUG_INFO,
+        "OC: %a patcher result %u for %a (%a) - %r\n",
+        PRINT_KERNEL_CACHE_TYPE (CacheType),
+        KernelPatchIndices[Index],
+        OC_BLOB_GET (&UserPatch->Identifier),
+        OC_BLOB_GET (&UserPatch->Comment),
+        KernelPatchResults[Index]
+        ));
+    }
+
+    OcKernelFreeBatchedPatches (&KernelPatches, &KernelPatchIndices, &KernelPatchResults);
+  }
+
+  if (IsKernelPatch) {
+    PatcherFreeContext (&KernelPatcher);
+  }
+
+  OcKernelPhaseStop (KernelPhasePatch, Start);
 }
 
 VOID
@@ -16,8 +16,391 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/BaseOverflowLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/OcMiscLib.h>
 
+#if defined (MDE_CPU_X64) && (defined (__GNUC__) || defined (__clang__))
+  #include <Register/Intel/Cpuid.h>
+
+//
+// Vector pattern search relies on GCC vector extensions and per-function targets.
+//
+  #define OC_PATTERN_SEARCH_VECTOR
+
+//
+// Minimal amount of candidate offsets for vector pattern search.
+//
+  #define OC_PATTERN_SEARCH_VECTOR_MIN  64U
+#endif
+
+/**
+  Check whether pattern matches data.
+
+  @param[in] Pattern      Pattern to match.
+  @param[in] PatternMask  Pattern mask, optional.
+  @param[in] PatternSize  Pattern size.
+  @param[in] Data         Data at least PatternSize long.
+
+  @return  TRUE on match.
+**/
+STATIC
+BOOLEAN
+InternalMatchPattern (
+  IN CONST UINT8  *Pattern,
+  IN CONST UINT8  *PatternMask OPTIONAL,
+  IN UINT32       PatternSize,
+  IN CONST UINT8  *Data
+  )
+{
+  UINT32  Index;
+
+  if (PatternMask == NULL) {
+    return CompareMem (Data, Pattern, PatternSize) == 0;
+  }
+
+  for (Index = 0; Index < PatternSize; ++Index) {
+    if ((Data[Index] & PatternMask[Index]) != Pattern[Index]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+//
+// Selected pattern search implementation.
+//
+STATIC OC_PATTERN_SEARCH_MODE  mPatternSearchMode;
+STATIC BOOLEAN                 mPatternSearchModeReady;
+
+#ifdef OC_PATTERN_SEARCH_VECTOR
+
+typedef UINT8 OC_PATTERN_V16 __attribute__ ((vector_size (16)));
+typedef UINT64 OC_PATTERN_Q16 __attribute__ ((vector_size (16)));
+typedef UINT8 OC_PATTERN_V32 __attribute__ ((vector_size (32)));
+typedef UINT64 OC_PATTERN_Q32 __attribute__ ((vector_size (32)));
+
+/**
+  Find the first offset where both pattern byte pairs match with SSE2.
+
+  @param[in] Data       Data starting at the first compared pattern byte.
+  @param[in] Offset     Offset to start at.
+  @param[in] EndOffset  Offset to stop at, all bytes till EndOffset - 1 + Delta are valid.
+  @param[in] Delta      Distance between first and last compared bytes.
+  @param[in] First      First byte value.
+  @param[in] FirstMask  First byte mask.
+  @param[in] Last       Last byte value.
+  @param[in] LastMask   Last byte mask.
+
+  @return  Matching offset or EndOffset.
+**/
+STATIC
+__attribute__ ((target ("sse2")))
+UINT32
+InternalFindPatternPairSse2 (
+  IN CONST UINT8  *Data,
+  IN UINT32       Offset,
+  IN UINT32       EndOffset,
+  IN UINT32       Delta,
+  IN UINT8        First,
+  IN UINT8        FirstMask,
+  IN UINT8        Last,
+  IN UINT8        LastMask
+  )
+{
+  OC_PATTERN_V16  VecFirst;
+  OC_PATTERN_V16  VecFirstMask;
+  OC_PATTERN_V16  VecLast;
+  OC_PATTERN_V16  VecLastMask;
+  OC_PATTERN_V16  Head;
+  OC_PATTERN_V16  Tail;
+  OC_PATTERN_Q16  Hits;
+  UINT32          Index;
+
+  for (Index = 0; Index < sizeof (VecFirst); ++Index) {
+    VecFirst[Index]     = First;
+    VecFirstMask[Index] = FirstMask;
+    VecLast[Index]      = Last;
+    VecLastMask[Index]  = LastMask;
+  }
+
+  while (EndOffset - Offset >= sizeof (Head)) {
+    __builtin_memcpy (&Head, &Data[Offset], sizeof (Head));
+    __builtin_memcpy (&Tail, &Data[Offset + Delta], sizeof (Tail));
+    Hits = (OC_PATTERN_Q16)(((Head & VecFirstMask) == VecFirst) & ((Tail & VecLastMask) == VecLast));
+
+    for (Index = 0; Index < sizeof (Hits) / sizeof (Hits[0]); ++Index) {
+      if (Hits[Index] != 0) {
+        return Offset + Index * sizeof (Hits[0]) + __builtin_ctzll (Hits[Index]) / OC_CHAR_BIT;
+      }
+    }
+
+    Offset += sizeof (Head);
+  }
+
+  while (  Offset < EndOffset
+        && (  ((Data[Offset] & FirstMask) != First)
+           || ((Data[Offset + Delta] & LastMask) != Last)))
+  {
+    ++Offset;
+  }
+
+  return Offset;
+}
+
+/**
+  Find the first offset where both pattern byte pairs match with AVX2.
+
+  @param[in] Data       Data starting at the first compared pattern byte.
+  @param[in] Offset     Offset to start at.
+  @param[in] EndOffset  Offset to stop at, all bytes till EndOffset - 1 + Delta are valid.
+  @param[in] Delta      Distance between first and last compared bytes.
+  @param[in] First      First byte value.
+  @param[in] FirstMask  First byte mask.
+  @param[in] Last       Last byte value.
+  @param[in] LastMask   Last byte mask.
+
+  @return  Matching offset or EndOffset.
+**/
+STATIC
+__attribute__ ((target ("avx2")))
+UINT32
+InternalFindPatternPairAvx2 (
+  IN CONST UINT8  *Data,
+  IN UINT32       Offset,
+  IN UINT32       EndOffset,
+  IN UINT32       Delta,
+  IN UINT8        First,
+  IN UINT8        FirstMask,
+  IN UINT8        Last,
+  IN UINT8        LastMask
+  )
+{
+  OC_PATTERN_V32  VecFirst;
+  OC_PATTERN_V32  VecFirstMask;
+  OC_PATTERN_V32  VecLast;
+  OC_PATTERN_V32  VecLastMask;
+  OC_PATTERN_V32  Head;
+  OC_PATTERN_V32  Tail;
+  OC_PATTERN_Q32  Hits;
+  UINT32          Index;
+
+  for (Index = 0; Index < sizeof (VecFirst); ++Index) {
+    VecFirst[Index]     = First;
+    VecFirstMask[Index] = FirstMask;
+    VecLast[Index]      = Last;
+    VecLastMask[Index]  = LastMask;
+  }
+
+  while (EndOffset - Offset >= sizeof (Head)) {
+    __builtin_memcpy (&Head, &Data[Offset], sizeof (Head));
+    __builtin_memcpy (&Tail, &Data[Offset + Delta], sizeof (Tail));
+    Hits = (OC_PATTERN_Q32)(((Head & VecFirstMask) == VecFirst) & ((Tail & VecLastMask) == VecLast));
+
+    for (Index = 0; Index < sizeof (Hits) / sizeof (Hits[0]); ++Index) {
+      if (Hits[Index] != 0) {
+        return Offset + Index * sizeof (Hits[0]) + __builtin_ctzll (Hits[Index]) / OC_CHAR_BIT;
+      }
+    }
+
+    Offset += sizeof (Head);
+  }
+
+  //
+  // Leave the tail to SSE2 to avoid scalar processing of up to 31 bytes.
+  //
+  return InternalFindPatternPairSse2 (Data, Offset, EndOffset, Delta, First, FirstMask, Last, LastMask);
+}
+
+/**
+  Detect the best supported pattern search implementation.
+
+  @return  Pattern search mode.
+**/
+STATIC
+OC_PATTERN_SEARCH_MODE
+InternalDetectPatternSearchMode (
+  VOID
+  )
+{
+  UINT32                                       MaxLeaf;
+  CPUID_VERSION_INFO_ECX                       VersionEcx;
+  CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_EBX  ExtendedEbx;
+  UINT32                                       Xcr0;
+  UINT32                                       Xcr0High;
+
+  //
+  // SSE2 is architectural on X64. AVX2 also requires the OS (or TryEnableAccel)
+  // to enable YMM state saving in XCR0.
+  //
+  AsmCpuid (CPUID_SIGNATURE, &MaxLeaf, NULL, NULL, NULL);
+  AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &VersionEcx.Uint32, NULL);
+  if (  (MaxLeaf < CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS)
+     || (VersionEcx.Bits.OSXSAVE == 0)
+     || (VersionEcx.Bits.AVX == 0))
+  {
+    return OcPatternSearchSse2;
+  }
+
+  AsmCpuidEx (
+    CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS,
+    CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_SUB_LEAF_INFO,
+    NULL,
+    &ExtendedEbx.Uint32,
+    NULL,
+    NULL
+    );
+  if (ExtendedEbx.Bits.AVX2 == 0) {
+    return OcPatternSearchSse2;
+  }
+
+  __asm__ __volatile__ ("xgetbv" : "=a" (Xcr0), "=d" (Xcr0High) : "c" (0));
+  if ((Xcr0 & (BIT1 | BIT2)) != (BIT1 | BIT2)) {
+    return OcPatternSearchSse2;
+  }
+
+  return OcPatternSearchAvx2;
+}
+
+#else
+
+STATIC
+OC_PATTERN_SEARCH_MODE
+InternalDetectPatternSearchMode (
+  VOID
+  )
+{
+  return OcPatternSearchScalar;
+}
+
+#endif
+
+OC_PATTERN_SEARCH_MODE
+OcSetPatternSearchMode (
+  IN OC_PATTERN_SEARCH_MODE  Mode
+  )
+{
+  OC_PATTERN_SEARCH_MODE  Supported;
+
+  Supported = InternalDetectPatternSearchMode ();
+
+  mPatternSearchMode      = MIN (Mode, Supported);
+  mPatternSearchModeReady = TRUE;
+
+  return mPatternSearchMode;
+}
+
+#ifdef OC_PATTERN_SEARCH_VECTOR
+
+/**
+  Find pattern with vector candidate filtering. Candidates are filtered by
+  the first and the last significant pattern bytes and then fully compared.
+
+  @param[in]     Pattern      Pattern to find.
+  @param[in]     PatternMask  Pattern mask, optional.
+  @param[in]     PatternSize  Pattern size, not 0.
+  @param[in]     Data         Data to search in.
+  @param[in]     LastOffset   Last offset the pattern may start at.
+  @param[in]     Mode         Vector pattern search mode.
+  @param[in,out] DataOff      Offset to start at, returned match offset.
+
+  @return  TRUE when found.
+**/
+STATIC
+BOOLEAN
+InternalFindPatternVector (
+  IN CONST UINT8             *Pattern,
+  IN CONST UINT8             *PatternMask OPTIONAL,
+  IN UINT32                  PatternSize,
+  IN CONST UINT8             *Data,
+  IN UINT32                  LastOffset,
+  IN OC_PATTERN_SEARCH_MODE  Mode,
+  IN OUT UINT32              *DataOff
+  )
+{
+  UINT32  CurrentOffset;
+  UINT32  FirstIndex;
+  UINT32  LastIndex;
+  UINT8   FirstMask;
+  UINT8   LastMask;
+
+  FirstIndex = 0;
+  LastIndex  = PatternSize - 1;
+
+  if (PatternMask != NULL) {
+    while (FirstIndex < PatternSize && PatternMask[FirstIndex] == 0) {
+      ++FirstIndex;
+    }
+
+    //
+    // A fully masked out pattern matches every position when all its
+    // bytes are zero and no position otherwise, as in the scalar search.
+    //
+    if (FirstIndex == PatternSize) {
+      for (FirstIndex = 0; FirstIndex < PatternSize; ++FirstIndex) {
+        if (Pattern[FirstIndex] != 0) {
+          return FALSE;
+        }
+      }
+
+      return TRUE;
+    }
+
+    while (PatternMask[LastIndex] == 0) {
+      --LastIndex;
+    }
+
+    FirstMask = PatternMask[FirstIndex];
+    LastMask  = PatternMask[LastIndex];
+  } else {
+    FirstMask = 0xFF;
+    LastMask  = 0xFF;
+  }
+
+  CurrentOffset = *DataOff;
+
+  while (CurrentOffset <= LastOffset) {
+    if (Mode == OcPatternSearchAvx2) {
+      CurrentOffset = InternalFindPatternPairAvx2 (
+                        &Data[FirstIndex],
+                        CurrentOffset,
+                        LastOffset + 1,
+                        LastIndex - FirstIndex,
+                        Pattern[FirstIndex],
+                        FirstMask,
+                        Pattern[LastIndex],
+                        LastMask
+                        );
+    } else {
+      CurrentOffset = InternalFindPatternPairSse2 (
+                        &Data[FirstIndex],
+                        CurrentOffset,
+                        LastOffset + 1,
+                        LastIndex - FirstIndex,
+                        Pattern[FirstIndex],
+                        FirstMask,
+                        Pattern[LastIndex],
+                        LastMask
+                        );
+    }
+
+    if (CurrentOffset > LastOffset) {
+      break;
+    }
+
+    if (InternalMatchPattern (Pattern, PatternMask, PatternSize, &Data[CurrentOffset])) {
+      *DataOff = CurrentOffset;
+      return TRUE;
+    }
+
+    ++CurrentOffset;
+  }
+
+  return FALSE;
+}
+
+#endif
+
 STATIC
 BOOLEAN
 InternalFindPattern (
@@ -43,6 +426,29 @@ InternalFindPattern (
   CurrentOffset = *DataOff;
   LastOffset    = DataSize - PatternSize;
 
+  if (!mPatternSearchModeReady) {
+    mPatternSearchMode      = InternalDetectPatternSearchMode ();
+    mPatternSearchModeReady = TRUE;
+  }
+
+ #ifdef OC_PATTERN_SEARCH_VECTOR
+  if (  (mPatternSearchMode != OcPatternSearchScalar)
+     && (CurrentOffset <= LastOffset)
+     && (LastOffset - CurrentOffset >= OC_PATTERN_SEARCH_VECTOR_MIN))
+  {
+    return InternalFindPatternVector (
+             Pattern,
+             PatternMask,
+             PatternSize,
+             Data,
+             LastOffset,
+             mPatternSearchMode,
+             DataOff
+             );
+  }
+
+ #endif
+
   if (PatternMask == NULL) {
     while (CurrentOffset <= LastOffset) {
       for (Index = 0; Index < PatternSize; ++Index) {
@@ -102,8 +508,160 @@ FindPattern (
            );
 }
 
+//
+// Minimal and maximal size of exact byte sequence used to locate patch set entries.
+// Entries with shorter sequences are applied with a dedicated scan.
+//
+#define OC_PATCH_SET_MIN_ANCHOR  4U
+#define OC_PATCH_SET_MAX_ANCHOR  16U
+
+//
+// Data modification tracking granularity for patch sets, log2.
+//
+#define OC_PATCH_SET_DIRTY_SHIFT  6U
+
+//
+// Initial amount of matches allocated per patch set entry.
+//
+#define OC_PATCH_SET_MATCHES_MIN  16U
+
+//
+// Terminator of patch set entry lists.
+//
+#define OC_PATCH_SET_NO_ENTRY  MAX_UINT32
+
+//
+// Patch set entry state.
+//
+typedef struct {
+  //
+  // Ascending match offsets.
+  //
+  UINT32    *Offsets;
+  UINT32    Count;
+  UINT32    Capacity;
+  //
+  // Exact byte sequence within the pattern used for lookup, 0 size when unindexed.
+  //
+  UINT32    AnchorOffset;
+  UINT32    AnchorSize;
+  //
+  // Next entry with the same anchor.
+  //
+  UINT32    NextOutput;
+} OC_PATCH_SET_STATE;
+
+//
+// Aho-Corasick automaton over patch set entry anchors.
+//
+typedef struct {
+  //
+  // Complete state transition table.
+  //
+  UINT16    (*Next)[256];
+  //
+  // Closest suffix state with output or 0.
+  //
+  UINT16    *DictLink;
+  //
+  // First entry with anchor ending at this state or OC_PATCH_SET_NO_ENTRY.
+  //
+  UINT32    *Output;
+  UINT32    NumStates;
+} OC_PATCH_SET_AUTOMATON;
+
+/**
+  Mark data area as modified.
+
+  @param[in,out] DirtyMap  Modification bitmap.
+  @param[in]     Offset    Area offset.
+  @param[in]     Size      Area size, not 0.
+**/
+STATIC
+VOID
+InternalMarkDirty (
+  IN OUT UINT8   *DirtyMap,
+  IN     UINT32  Offset,
+  IN     UINT32  Size
+  )
+{
+  UINT32  Chunk;
+  UINT32  LastChunk;
+
+  LastChunk = (Offset + Size - 1) >> OC_PATCH_SET_DIRTY_SHIFT;
+  for (Chunk = Offset >> OC_PATCH_SET_DIRTY_SHIFT; Chunk <= LastChunk; ++Chunk) {
+    DirtyMap[Chunk / OC_CHAR_BIT] |= (UINT8)(1U << (Chunk % OC_CHAR_BIT));
+  }
+}
+
+/**
+  Check whether data chunk was modified.
+
+  @param[in] DirtyMap  Modification bitmap.
+  @param[in] Chunk     Chunk index.
+
+  @return  TRUE when modified.
+**/
+STATIC
+BOOLEAN
+InternalIsChunkDirty (
+  IN CONST UINT8  *DirtyMap,
+  IN UINT32       Chunk
+  )
+{
+  return (DirtyMap[Chunk / OC_CHAR_BIT] & (1U << (Chunk % OC_CHAR_BIT))) != 0;
+}
+
+/**
+  Check whether data area was modified.
+
+  @param[in] DirtyMap  Modification bitmap.
+  @param[in] Offset    Area offset.
+  @param[in] Size      Area size, not 0.
+
+  @return  TRUE when any chunk of the area was modified.
+**/
+STATIC
+BOOLEAN
+InternalIsDirty (
+  IN CONST UINT8  *DirtyMap,
+  IN UINT32       Offset,
+  IN UINT32       Size
+  )
+{
+  UINT32  Chunk;
+  UINT32  LastChunk;
+
+  LastChunk = (Offset + Size - 1) >> OC_PATCH_SET_DIRTY_SHIFT;
+  for (Chunk = Offset >> OC_PATCH_SET_DIRTY_SHIFT; Chunk <= LastChunk; ++Chunk) {
+    if (InternalIsChunkDirty (DirtyMap, Chunk)) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Find, replace, and optionally track replaced areas.
+
+  @param[in]     Pattern      Pattern to find.
+  @param[in]     PatternMask  Pattern mask, optional.
+  @param[in]     PatternSize  Pattern size.
+  @param[in]     Replace      Replacement.
+  @param[in]     ReplaceMask  Replacement mask, optional.
+  @param[in,out] Data         Data to patch.
+  @param[in]     DataSize     Data size.
+  @param[in]     Count        Replacement count or 0 for all.
+  @param[in]     Skip         Amount of matches to skip.
+  @param[in,out] DirtyMap     Modification bitmap, optional.
+  @param[in]     DirtyOffset  Offset of Data in modification bitmap.
+
+  @return  Amount of replacements.
+**/
+STATIC
 UINT32
-ApplyPatch (
+InternalApplyPatch (
   IN CONST UINT8   *Pattern,
   IN CONST UINT8   *PatternMask OPTIONAL,
   IN CONST UINT32  PatternSize,
@@ -112,7 +670,9 @@ ApplyPatch (
   IN UINT8         *Data,
   IN UINT32        DataSize,
   IN UINT32        Count,
-  IN UINT32        Skip
+  IN UINT32        Skip,
+  IN OUT UINT8     *DirtyMap OPTIONAL,
+  IN UINT32        DirtyOffset
   )
 {
   UINT32   ReplaceCount;
@@ -166,6 +726,10 @@ ApplyPatch (
       }
     }
 
+    if (DirtyMap != NULL) {
+      InternalMarkDirty (DirtyMap, DirtyOffset + DataOff, PatternSize);
+    }
+
     ++ReplaceCount;
     DataOff += PatternSize;
 
@@ -182,3 +746,665 @@ ApplyPatch (
 
   return ReplaceCount;
 }
+
+UINT32
+ApplyPatch (
+  IN CONST UINT8   *Pattern,
+  IN CONST UINT8   *PatternMask OPTIONAL,
+  IN CONST UINT32  PatternSize,
+  IN CONST UINT8   *Replace,
+  IN CONST UINT8   *ReplaceMask OPTIONAL,
+  IN UINT8         *Data,
+  IN UINT32        DataSize,
+  IN UINT32        Count,
+  IN UINT32        Skip
+  )
+{
+  return InternalApplyPatch (
+           Pattern,
+           PatternMask,
+           PatternSize,
+           Replace,
+           ReplaceMask,
+           Data,
+           DataSize,
+           Count,
+           Skip,
+           NULL,
+           0
+           );
+}
+
+/**
+  Append match offset to patch set entry state.
+
+  @param[in,out] State   Patch set entry state.
+  @param[in]     Offset  Match offset.
+
+  @return  FALSE when out of resources.
+**/
+STATIC
+BOOLEAN
+InternalAddPatchSetMatch (
+  IN OUT OC_PATCH_SET_STATE  *State,
+  IN     UINT32              Offset
+  )
+{
+  UINT32  *Offsets;
+  UINT32  Capacity;
+
+  if (State->Count == State->Capacity) {
+    Capacity = State->Capacity == 0 ? OC_PATCH_SET_MATCHES_MIN : State->Capacity * 2;
+    if (Capacity > MAX_UINT32 / sizeof (*Offsets)) {
+      return FALSE;
+    }
+
+    Offsets = ReallocatePool (
+                State->Capacity * sizeof (*Offsets),
+                Capacity * sizeof (*Offsets),
+                State->Offsets
+                );
+    if (Offsets == NULL) {
+      return FALSE;
+    }
+
+    State->Offsets  = Offsets;
+    State->Capacity = Capacity;
+  }
+
+  State->Offsets[State->Count++] = Offset;
+  return TRUE;
+}
+
+/**
+  Choose the longest exact byte sequence of a patch set entry pattern.
+
+  @param[in]  Entry         Patch set entry.
+  @param[out] AnchorOffset  Sequence offset within pattern.
+  @param[out] AnchorSize    Sequence size, 0 when too short for lookup.
+**/
+STATIC
+VOID
+InternalChoosePatchSetAnchor (
+  IN  CONST OC_PATCH_SET_ENTRY  *Entry,
+  OUT UINT32                    *AnchorOffset,
+  OUT UINT32                    *AnchorSize
+  )
+{
+  UINT32  Index;
+  UINT32  RunOffset;
+  UINT32  RunSize;
+
+  *AnchorOffset = 0;
+  *AnchorSize   = 0;
+
+  if (Entry->PatternMask == NULL) {
+    *AnchorSize = MIN (Entry->PatternSize, OC_PATCH_SET_MAX_ANCHOR);
+  } else {
+    RunOffset = 0;
+    RunSize   = 0;
+    for (Index = 0; Index < Entry->PatternSize; ++Index) {
+      if (Entry->PatternMask[Index] != 0xFF) {
+        RunSize = 0;
+        continue;
+      }
+
+      if (RunSize == 0) {
+        RunOffset = Index;
+      }
+
+      ++RunSize;
+      if (RunSize > *AnchorSize) {
+        *AnchorOffset = RunOffset;
+        *AnchorSize   = RunSize;
+        if (RunSize == OC_PATCH_SET_MAX_ANCHOR) {
+          break;
+        }
+      }
+    }
+  }
+
+  if (*AnchorSize < OC_PATCH_SET_MIN_ANCHOR) {
+    *AnchorSize = 0;
+  }
+}
+
+/**
+  Build Aho-Corasick automaton over indexed patch set entries.
+
+  @param[in]     Entries     Patch set entries.
+  @param[in,out] States      Patch set entry states with chosen anchors.
+  @param[in]     NumEntries  Number of patch set entries.
+  @param[out]    Automaton   Resulting automaton.
+
+  @return  FALSE when out of resources.
+**/
+STATIC
+BOOLEAN
+InternalBuildPatchSetAutomaton (
+  IN     CONST OC_PATCH_SET_ENTRY  *Entries,
+  IN OUT OC_PATCH_SET_STATE        *States,
+  IN     UINT32                    NumEntries,
+  OUT    OC_PATCH_SET_AUTOMATON    *Automaton
+  )
+{
+  UINT32       MaxStates;
+  UINT32       EntryIndex;
+  UINT32       Index;
+  UINT32       State;
+  UINT32       Child;
+  UINT16       *Queue;
+  UINT16       *Fail;
+  UINT32       QueueHead;
+  UINT32       QueueTail;
+  CONST UINT8  *Anchor;
+
+  ZeroMem (Automaton, sizeof (*Automaton));
+
+  //
+  // Drop entries from the index when the automaton no longer fits UINT16 states.
+  //
+  MaxStates = 1;
+  for (EntryIndex = 0; EntryIndex < NumEntries; ++EntryIndex) {
+    if (MaxStates + States[EntryIndex].AnchorSize > MAX_UINT16) {
+      States[EntryIndex].AnchorSize = 0;
+    }
+
+    MaxStates += States[EntryIndex].AnchorSize;
+  }
+
+  Automaton->Next     = AllocateZeroPool (MaxStates * sizeof (*Automaton->Next));
+  Automaton->DictLink = AllocateZeroPool (MaxStates * sizeof (*Automaton->DictLink));
+  Automaton->Output   = AllocatePool (MaxStates * sizeof (*Automaton->Output));
+  Queue               = AllocatePool (MaxStates * sizeof (*Queue));
+  Fail                = AllocateZeroPool (MaxStates * sizeof (*Fail));
+
+  if (  (Automaton->Next == NULL) || (Automaton->DictLink == NULL) || (Automaton->Output == NULL)
+     || (Queue == NULL) || (Fail == NULL))
+  {
+    if (Queue != NULL) {
+      FreePool (Queue);
+    }
+
+    if (Fail != NULL) {
+      FreePool (Fail);
+    }
+
+    return FALSE;
+  }
+
+  SetMem32 (Automaton->Output, MaxStates * sizeof (*Automaton->Output), OC_PATCH_SET_NO_ENTRY);
+
+  //
+  // Build the trie, 0 transitions are missing edges at this point as no edge leads to root.
+  //
+  Automaton->NumStates = 1;
+  for (EntryIndex = 0; EntryIndex < NumEntries; ++EntryIndex) {
+    if (States[EntryIndex].AnchorSize == 0) {
+      continue;
+    }
+
+    Anchor = &Entries[EntryIndex].Pattern[States[EntryIndex].AnchorOffset];
+    State  = 0;
+    for (Index = 0; Index < States[EntryIndex].AnchorSize; ++Index) {
+      Child = Automaton->Next[State][Anchor[Index]];
+      if (Child == 0) {
+        Child                                 = Automaton->NumStates++;
+        Automaton->Next[State][Anchor[Index]] = (UINT16)Child;
+      }
+
+      State = Child;
+    }
+
+    States[EntryIndex].NextOutput = Automaton->Output[State];
+    Automaton->Output[State]      = EntryIndex;
+  }
+
+  //
+  // Compute failure and dictionary links in BFS order and complete transitions.
+  //
+  QueueHead = 0;
+  QueueTail = 0;
+  for (Index = 0; Index < 256; ++Index) {
+    Child = Automaton->Next[0][Index];
+    if (Child != 0) {
+      Fail[Child]        = 0;
+      Queue[QueueTail++] = (UINT16)Child;
+    }
+  }
+
+  while (QueueHead < QueueTail) {
+    State = Queue[QueueHead++];
+    for (Index = 0; Index < 256; ++Index) {
+      Child = Automaton->Next[State][Index];
+      if (Child != 0) {
+        Fail[Child] = Automaton->Next[Fail[State]][Index];
+        if (Automaton->Output[Fail[Child]] != OC_PATCH_SET_NO_ENTRY) {
+          Automaton->DictLink[Child] = Fail[Child];
+        } else {
+          Automaton->DictLink[Child] = Automaton->DictLink[Fail[Child]];
+        }
+
+        Queue[QueueTail++] = (UINT16)Child;
+      } else {
+        Automaton->Next[State][Index] = Automaton->Next[Fail[State]][Index];
+      }
+    }
+  }
+
+  FreePool (Queue);
+  FreePool (Fail);
+  return TRUE;
+}
+
+/**
+  Free Aho-Corasick automaton resources.
+
+  @param[in,out] Automaton  Automaton to free.
+**/
+STATIC
+VOID
+InternalFreePatchSetAutomaton (
+  IN OUT OC_PATCH_SET_AUTOMATON  *Automaton
+  )
+{
+  if (Automaton->Next != NULL) {
+    FreePool (Automaton->Next);
+  }
+
+  if (Automaton->DictLink != NULL) {
+    FreePool (Automaton->DictLink);
+  }
+
+  if (Automaton->Output != NULL) {
+    FreePool (Automaton->Output);
+  }
+
+  ZeroMem (Automaton, sizeof (*Automaton));
+}
+
+/**
+  Collect matches of indexed patch set entries in unmodified data with one scan.
+
+  @param[in]     Entries    Patch set entries.
+  @param[in,out] States     Patch set entry states.
+  @param[in]     Automaton  Aho-Corasick automaton.
+  @param[in]     Data       Data to scan.
+  @param[in]     ScanStart  First offset to scan.
+  @param[in]     ScanEnd    Offset to stop scanning at.
+
+  @return  FALSE when out of resources.
+**/
+STATIC
+BOOLEAN
+InternalScanPatchSet (
+  IN     CONST OC_PATCH_SET_ENTRY      *Entries,
+  IN OUT OC_PATCH_SET_STATE            *States,
+  IN     CONST OC_PATCH_SET_AUTOMATON  *Automaton,
+  IN     CONST UINT8                   *Data,
+  IN     UINT32                        ScanStart,
+  IN     UINT32                        ScanEnd
+  )
+{
+  UINT32                    Offset;
+  UINT32                    State;
+  UINT32                    Output;
+  UINT32                    EntryIndex;
+  UINT32                    Lead;
+  UINT32                    Match;
+  CONST OC_PATCH_SET_ENTRY  *Entry;
+
+  State = 0;
+  for (Offset = ScanStart; Offset < ScanEnd; ++Offset) {
+    State  = Automaton->Next[State][Data[Offset]];
+    Output = Automaton->Output[State] != OC_PATCH_SET_NO_ENTRY ? State : Automaton->DictLink[State];
+
+    while (Output != 0) {
+      for (
+           EntryIndex = Automaton->Output[Output];
+           EntryIndex != OC_PATCH_SET_NO_ENTRY;
+           EntryIndex = States[EntryIndex].NextOutput
+           )
+      {
+        Entry = &Entries[EntryIndex];
+        Lead  = States[EntryIndex].AnchorOffset + States[EntryIndex].AnchorSize - 1;
+        if (Offset < Entry->DataOffset + Lead) {
+          continue;
+        }
+
+        Match = Offset - Lead;
+        if (  (Match - Entry->DataOffset > Entry->DataSize - Entry->PatternSize)
+           || !InternalMatchPattern (Entry->Pattern, Entry->PatternMask, Entry->PatternSize, &Data[Match]))
+        {
+          continue;
+        }
+
+        if (!InternalAddPatchSetMatch (&States[EntryIndex], Match)) {
+          return FALSE;
+        }
+      }
+
+      Output = Automaton->DictLink[Output];
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Apply indexed patch set entry, taking earlier modifications into account.
+
+  @param[in,out] Entry     Patch set entry.
+  @param[in,out] State     Patch set entry state with matches in unmodified data.
+  @param[in,out] Rescan    Scratch state for matches in modified data.
+  @param[in,out] Data      Data to patch.
+  @param[in,out] DirtyMap  Modification bitmap.
+
+  @return  FALSE when out of resources.
+**/
+STATIC
+BOOLEAN
+InternalApplyPatchSetEntry (
+  IN OUT OC_PATCH_SET_ENTRY        *Entry,
+  IN OUT OC_PATCH_SET_STATE        *State,
+  IN OUT OC_PATCH_SET_STATE        *Rescan,
+  IN OUT UINT8                     *Data,
+  IN OUT UINT8                     *DirtyMap
+  )
+{
+  UINT32  Index;
+  UINT32  Kept;
+  UINT32  Chunk;
+  UINT32  LastChunk;
+  UINT32  RunEnd;
+  UINT32  First;
+  UINT32  Last;
+  UINT32  LastMatch;
+  UINT32  Offset;
+  UINT32  OriginalIndex;
+  UINT32  RescanIndex;
+  UINT32  NextAllowed;
+  UINT32  Skip;
+  UINT32  Count;
+
+  LastMatch     = Entry->DataOffset + Entry->DataSize - Entry->PatternSize;
+  Rescan->Count = 0;
+
+  //
+  // Matches touching modified chunks are no longer reliable, drop them.
+  //
+  Kept = 0;
+  for (Index = 0; Index < State->Count; ++Index) {
+    if (!InternalIsDirty (DirtyMap, State->Offsets[Index], Entry->PatternSize)) {
+      State->Offsets[Kept++] = State->Offsets[Index];
+    }
+  }
+
+  State->Count = Kept;
+
+  //
+  // Rescan every position whose window touches modified chunks.
+  //
+  Chunk     = Entry->DataOffset >> OC_PATCH_SET_DIRTY_SHIFT;
+  LastChunk = (Entry->DataOffset + Entry->DataSize - 1) >> OC_PATCH_SET_DIRTY_SHIFT;
+  First     = Entry->DataOffset;
+  while (Chunk <= LastChunk) {
+    if (!InternalIsChunkDirty (DirtyMap, Chunk)) {
+      ++Chunk;
+      continue;
+    }
+
+    RunEnd = Chunk;
+    while (RunEnd <= LastChunk && InternalIsChunkDirty (DirtyMap, RunEnd)) {
+      ++RunEnd;
+    }
+
+    //
+    // Windows starting in [Chunk start - PatternSize + 1, RunEnd start - 1].
+    //
+    Offset = Chunk << OC_PATCH_SET_DIRTY_SHIFT;
+    Offset = Offset >= Entry->PatternSize - 1 ? Offset - (Entry->PatternSize - 1) : 0;
+    First  = MAX (First, MAX (Offset, Entry->DataOffset));
+    Last   = MIN ((RunEnd << OC_PATCH_SET_DIRTY_SHIFT) - 1, LastMatch);
+
+    while (  First <= Last
+          && InternalFindPattern (
+               Entry->Pattern,
+               Entry->PatternMask,
+               Entry->PatternSize,
+               Data,
+               Last + Entry->PatternSize,
+               &First
+               ))
+    {
+      if (!InternalAddPatchSetMatch (Rescan, First)) {
+        return FALSE;
+      }
+
+      ++First;
+    }
+
+    First = MAX (First, Last + 1);
+    Chunk = RunEnd;
+  }
+
+  //
+  // Merge both ascending match lists and apply them like ApplyPatch does.
+  //
+  OriginalIndex = 0;
+  RescanIndex   = 0;
+  NextAllowed   = 0;
+  Skip          = Entry->Skip;
+  Count         = Entry->Count;
+
+  while (OriginalIndex < State->Count || RescanIndex < Rescan->Count) {
+    if (  (RescanIndex == Rescan->Count)
+       || ((OriginalIndex < State->Count) && (State->Offsets[OriginalIndex] < Rescan->Offsets[RescanIndex])))
+    {
+      Offset = State->Offsets[OriginalIndex++];
+    } else {
+      Offset = Rescan->Offsets[RescanIndex++];
+    }
+
+    if (Offset < NextAllowed) {
+      continue;
+    }
+
+    NextAllowed = Offset + Entry->PatternSize;
+
+    if (Skip > 0) {
+      --Skip;
+      continue;
+    }
+
+    if (Entry->ReplaceMask == NULL) {
+      CopyMem (&Data[Offset], Entry->Replace, Entry->PatternSize);
+    } else {
+      for (Index = 0; Index < Entry->PatternSize; ++Index) {
+        Data[Offset + Index] = (Data[Offset + Index] & ~Entry->ReplaceMask[Index])
+                               | (Entry->Replace[Index] & Entry->ReplaceMask[Index]);
+      }
+    }
+
+    InternalMarkDirty (DirtyMap, Offset, Entry->PatternSize);
+    ++Entry->ReplaceCount;
+
+    if (Count > 0) {
+      --Count;
+      if (Count == 0) {
+        break;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Apply patch set entries one by one without indexing.
+
+  @param[in,out] Entries     Patch set entries.
+  @param[in]     NumEntries  Number of patch set entries.
+  @param[in,out] Data        Data to patch.
+**/
+STATIC
+VOID
+InternalApplyPatchSetSequential (
+  IN OUT OC_PATCH_SET_ENTRY  *Entries,
+  IN     UINT32              NumEntries,
+  IN OUT UINT8               *Data
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < NumEntries; ++Index) {
+    Entries[Index].ReplaceCount = ApplyPatch (
+                                    Entries[Index].Pattern,
+                                    Entries[Index].PatternMask,
+                                    Entries[Index].PatternSize,
+                                    Entries[Index].Replace,
+                                    Entries[Index].ReplaceMask,
+                                    &Data[Entries[Index].DataOffset],
+                                    Entries[Index].DataSize,
+                                    Entries[Index].Count,
+                                    Entries[Index].Skip
+                                    );
+  }
+}
+
+VOID
+ApplyPatchSet (
+  IN OUT OC_PATCH_SET_ENTRY  *Entries,
+  IN     UINT32              NumEntries,
+  IN OUT UINT8               *Data,
+  IN     UINT32              DataSize
+  )
+{
+  OC_PATCH_SET_STATE      *States;
+  OC_PATCH_SET_STATE      Rescan;
+  OC_PATCH_SET_AUTOMATON  Automaton;
+  UINT8                   *DirtyMap;
+  UINT32                  Index;
+  UINT32                  End;
+  UINT32                  ScanStart;
+  UINT32                  ScanEnd;
+  BOOLEAN                 Success;
+
+  ASSERT (Entries != NULL || NumEntries == 0);
+  ASSERT (Data != NULL || DataSize == 0);
+
+  //
+  // Entries with invalid regions never match, exclude them early.
+  //
+  for (Index = 0; Index < NumEntries; ++Index) {
+    Entries[Index].ReplaceCount = 0;
+    if (  BaseOverflowAddU32 (Entries[Index].DataOffset, Entries[Index].DataSize, &End)
+       || (End > DataSize))
+    {
+      ASSERT (FALSE);
+      Entries[Index].DataOffset = 0;
+      Entries[Index].DataSize   = 0;
+    }
+  }
+
+  if ((NumEntries == 0) || (DataSize == 0)) {
+    return;
+  }
+
+  //
+  // A single entry cannot benefit from the shared scan.
+  //
+  if ((NumEntries == 1) || (NumEntries > MAX_UINT32 / sizeof (*States))) {
+    InternalApplyPatchSetSequential (Entries, NumEntries, Data);
+    return;
+  }
+
+  States   = AllocateZeroPool (NumEntries * sizeof (*States));
+  DirtyMap = AllocateZeroPool ((DataSize >> OC_PATCH_SET_DIRTY_SHIFT) / OC_CHAR_BIT + 1);
+  ZeroMem (&Automaton, sizeof (Automaton));
+  ZeroMem (&Rescan, sizeof (Rescan));
+
+  Success = States != NULL && DirtyMap != NULL;
+
+  if (Success) {
+    ScanStart = MAX_UINT32;
+    ScanEnd   = 0;
+    for (Index = 0; Index < NumEntries; ++Index) {
+      if (Entries[Index].DataSize >= Entries[Index].PatternSize) {
+        InternalChoosePatchSetAnchor (
+          &Entries[Index],
+          &States[Index].AnchorOffset,
+          &States[Index].AnchorSize
+          );
+      }
+
+      States[Index].NextOutput = OC_PATCH_SET_NO_ENTRY;
+    }
+
+    Success = InternalBuildPatchSetAutomaton (Entries, States, NumEntries, &Automaton);
+
+    for (Index = 0; Success && Index < NumEntries; ++Index) {
+      if (States[Index].AnchorSize > 0) {
+        ScanStart = MIN (ScanStart, Entries[Index].DataOffset);
+        ScanEnd   = MAX (ScanEnd, Entries[Index].DataOffset + Entries[Index].DataSize);
+      }
+    }
+
+    if (Success && (ScanStart < ScanEnd)) {
+      Success = InternalScanPatchSet (Entries, States, &Automaton, Data, ScanStart, ScanEnd);
+    }
+
+    InternalFreePatchSetAutomaton (&Automaton);
+  }
+
+  //
+  // Nothing is modified until all matches are collected, so we can still fall back safely.
+  //
+  if (!Success) {
+    DEBUG ((DEBUG_INFO, "OCMP: Patch set fallback for %u entries\n", NumEntries));
+    InternalApplyPatchSetSequential (Entries, NumEntries, Data);
+  }
+
+  for (Index = 0; Success && Index < NumEntries; ++Index) {
+    if (States[Index].AnchorSize == 0) {
+      Entries[Index].ReplaceCount = InternalApplyPatch (
+                                      Entries[Index].Pattern,
+                                      Entries[Index].PatternMask,
+                                      Entries[Index].PatternSize,
+                                      Entries[Index].Replace,
+                                      Entries[Index].ReplaceMask,
+                                      &Data[Entries[Index].DataOffset],
+                                      Entries[Index].DataSize,
+                                      Entries[Index].Count,
+                                      Entries[Index].Skip,
+                                      DirtyMap,
+                                      Entries[Index].DataOffset
+                                      );
+    } else if (!InternalApplyPatchSetEntry (&Entries[Index], &States[Index], &Rescan, Data, DirtyMap)) {
+      //
+      // Out of resources while rescanning modified areas, earlier entries are already
+      // applied, so continue with plain scans preserving the order.
+      //
+      InternalApplyPatchSetSequential (&Entries[Index], NumEntries - Index, Data);
+      break;
+    }
+  }
+
+  if (States != NULL) {
+    for (Index = 0; Index < NumEntries; ++Index) {
+      if (States[Index].Offsets != NULL) {
+        FreePool (States[Index].Offsets);
+      }
+    }
+
+    FreePool (States);
+  }
+
+  if (Rescan.Offsets != NULL) {
+    FreePool (Rescan.Offsets);
+  }
+
+  if (DirtyMap != NULL) {
+    FreePool (DirtyMap);
+  }
+}
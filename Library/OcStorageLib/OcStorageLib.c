@@ -379,19 +379,29 @@ OcStorageExistsFileUnicode (
   return FALSE;
 }
 
-VOID *
-OcStorageReadFileUnicode (
+/**
+  Read file from storage without verifying it against the vault.
+
+  @param[in]  Context      Storage context.
+  @param[in]  FilePath     The full path to the file on the device.
+  @param[out] FileSize     The size of the file read.
+  @param[out] VaultDigest  The vault digest of the file, NULL without vault.
+
+  @retval A pointer to a buffer containing file read or NULL.
+**/
+STATIC
+UINT8 *
+InternalStorageReadFile (
   IN  OC_STORAGE_CONTEXT  *Context,
   IN  CONST CHAR16        *FilePath,
-  OUT UINT32              *FileSize OPTIONAL
+  OUT UINT32              *FileSize,
+  OUT UINT8               **VaultDigest
   )
 {
   EFI_STATUS         Status;
   EFI_FILE_PROTOCOL  *File;
   UINT32             Size;
   UINT8              *FileBuffer;
-  UINT8              *VaultDigest;
-  UINT8              FileDigest[SHA256_DIGEST_SIZE];
 
   //
   // Using this API with empty filename is also not allowed.
@@ -400,9 +410,9 @@ OcStorageReadFileUnicode (
   ASSERT (FilePath != NULL);
   ASSERT (StrLen (FilePath) > 0);
 
-  VaultDigest = OcStorageGetDigest (Context, FilePath);
+  *VaultDigest = OcStorageGetDigest (Context, FilePath);
 
-  if (Context->HasVault && (VaultDigest == NULL)) {
+  if (Context->HasVault && (*VaultDigest == NULL)) {
     DEBUG ((DEBUG_ERROR, "OCST: Aborting %s file access not present in vault\n", FilePath));
     return NULL;
   }
@@ -445,25 +455,93 @@ OcStorageReadFileUnicode (
     return NULL;
   }
 
-  if (VaultDigest != 0) {
-    Sha256 (FileDigest, FileBuffer, Size);
-    if (CompareMem (FileDigest, VaultDigest, SHA256_DIGEST_SIZE) != 0) {
-      DEBUG ((DEBUG_ERROR, "OCST: Aborting corrupted %s file access\n", FilePath));
-      FreePool (FileBuffer);
-      return NULL;
-    }
-  }
-
   FileBuffer[Size]     = 0;
   FileBuffer[Size + 1] = 0;
 
-  if (FileSize != NULL) {
+  *FileSize = Size;
+
+  return FileBuffer;
+}
+
+VOID *
+OcStorageReadFileUnicode (
+  IN  OC_STORAGE_CONTEXT  *Context,
+  IN  CONST CHAR16        *FilePath,
+  OUT UINT32              *FileSize OPTIONAL
+  )
+{
+  VOID    *FileBuffer;
+  UINT32  Size;
+
+  OcStorageReadFilesUnicode (Context, &FilePath, 1, &FileBuffer, &Size);
+
+  if ((FileBuffer != NULL) && (FileSize != NULL)) {
     *FileSize = Size;
   }
 
   return FileBuffer;
 }
 
+VOID
+OcStorageReadFilesUnicode (
+  IN  OC_STORAGE_CONTEXT  *Context,
+  IN  CONST CHAR16        **FilePaths,
+  IN  UINTN               Count,
+  OUT VOID                **Buffers,
+  OUT UINT32              *FileSizes OPTIONAL
+  )
+{
+  UINTN        Batch;
+  UINTN        Index;
+  UINTN        HashCount;
+  UINTN        HashIndices[OC_SHA256_MULTI_LANES];
+  CONST UINT8  *HashData[OC_SHA256_MULTI_LANES];
+  UINTN        HashSizes[OC_SHA256_MULTI_LANES];
+  UINT8        *VaultDigests[OC_SHA256_MULTI_LANES];
+  UINT8        FileDigests[OC_SHA256_MULTI_LANES * SHA256_DIGEST_SIZE];
+  UINT8        *VaultDigest;
+  UINT32       Size;
+
+  ASSERT (FilePaths != NULL);
+  ASSERT (Buffers != NULL);
+
+  for (Batch = 0; Batch < Count; Batch += OC_SHA256_MULTI_LANES) {
+    HashCount = 0;
+
+    for (Index = Batch; Index < Count && Index < Batch + OC_SHA256_MULTI_LANES; ++Index) {
+      Size           = 0;
+      Buffers[Index] = InternalStorageReadFile (Context, FilePaths[Index], &Size, &VaultDigest);
+      if (FileSizes != NULL) {
+        FileSizes[Index] = Size;
+      }
+
+      if ((Buffers[Index] != NULL) && (VaultDigest != NULL)) {
+        HashIndices[HashCount]  = Index;
+        HashData[HashCount]     = Buffers[Index];
+        HashSizes[HashCount]    = Size;
+        VaultDigests[HashCount] = VaultDigest;
+        ++HashCount;
+      }
+    }
+
+    //
+    // Verify the whole batch in a single multi-buffer pass.
+    //
+    Sha256Multi (FileDigests, HashData, HashSizes, HashCount);
+
+    for (Index = 0; Index < HashCount; ++Index) {
+      if (CompareMem (&FileDigests[Index * SHA256_DIGEST_SIZE], VaultDigests[Index], SHA256_DIGEST_SIZE) != 0) {
+        DEBUG ((DEBUG_ERROR, "OCST: Aborting corrupted %s file access\n", FilePaths[HashIndices[Index]]));
+        FreePool (Buffers[HashIndices[Index]]);
+        Buffers[HashIndices[Index]] = NULL;
+        if (FileSizes != NULL) {
+          FileSizes[HashIndices[Index]] = 0;
+        }
+      }
+    }
+  }
+}
+
 EFI_STATUS
 OcStorageGetInfo (
   IN  OC_STORAGE_CONTEXT        *Context,
@@ -1012,9 +1012,11 @@ XmlParseContent (
   @param[in,out]  CurrentSize  Current size of Buffer before appending.
   @param[in]      Data         Data to be appended.
   @param[in]      DataLength   Length of Data.
+
+  @return  FALSE when Data could not be appended.
 **/
 STATIC
-VOID
+BOOLEAN
 XmlBufferAppend (
   IN OUT  CHAR8        **Buffer,
   IN OUT  UINT32       *AllocSize,
@@ -1034,16 +1036,24 @@ XmlBufferAppend (
   NewSize = *AllocSize;
 
   if (NewSize - *CurrentSize <= DataLength) {
-    if (DataLength + 1 <= XML_EXPORT_MIN_ALLOCATION_SIZE) {
-      NewSize += XML_EXPORT_MIN_ALLOCATION_SIZE;
+    //
+    // Grow geometrically, large raw nodes are appended when exporting prelinked info.
+    //
+    if (DataLength + 1 <= MAX (NewSize, XML_EXPORT_MIN_ALLOCATION_SIZE)) {
+      NewSize = MAX (NewSize, XML_EXPORT_MIN_ALLOCATION_SIZE);
     } else {
-      NewSize += DataLength + 1;
+      NewSize = DataLength + 1;
+    }
+
+    if (BaseOverflowAddU32 (*AllocSize, NewSize, &NewSize)) {
+      XML_USAGE_ERROR ("XmlBufferAppend::size overflow");
+      return FALSE;
     }
 
     NewBuffer = AllocatePool (NewSize);
     if (NewBuffer == NULL) {
       XML_USAGE_ERROR ("XmlBufferAppend::failed to allocate");
-      return;
+      return FALSE;
     }
 
     CopyMem (NewBuffer, *Buffer, *CurrentSize);
@@ -1054,6 +1064,7 @@ XmlBufferAppend (
 
   CopyMem (&(*Buffer)[*CurrentSize], Data, DataLength);
   *CurrentSize += DataLength;
+  return TRUE;
 }
 
 /**
@@ -2168,3 +2179,756 @@ PlistMultiDataSize (
 
   return FALSE;
 }
+
+//
+// Plist array offset index.
+//
+
+#define XML_INDEX_ARRAY_OPEN   "<array>"
+#define XML_INDEX_ARRAY_CLOSE  "</array>"
+#define XML_INDEX_DICT_OPEN    "<dict>"
+#define XML_INDEX_DICT_CLOSE   "</dict>"
+#define XML_INDEX_KEY_OPEN     "<key>"
+#define XML_INDEX_KEY_CLOSE    "</key>"
+
+/**
+  Minimum amount of entries allocated for growing index arrays.
+**/
+#define XML_INDEX_MIN_ALLOC_COUNT  64U
+
+/**
+  Definition with ID attribute, which is not closed yet.
+**/
+typedef struct {
+  UINT32    Reference;
+  UINT32    Offset;
+  UINT32    Depth;
+} XML_INDEX_PENDING;
+
+/**
+  Find character in buffer range.
+
+  @param[in]  Buffer     XML buffer.
+  @param[in]  Start      Range start.
+  @param[in]  End        Range end.
+  @param[in]  Character  Character to find.
+  @param[out] Offset     Character offset.
+
+  @return  TRUE when found.
+**/
+STATIC
+BOOLEAN
+XmlIndexFind (
+  IN  CONST CHAR8  *Buffer,
+  IN  UINT32       Start,
+  IN  UINT32       End,
+  IN  CHAR8        Character,
+  OUT UINT32       *Offset
+  )
+{
+  CONST CHAR8  *Found;
+
+  if (Start >= End) {
+    return FALSE;
+  }
+
+  Found = ScanMem8 (&Buffer[Start], End - Start, (UINT8)Character);
+  if (Found == NULL) {
+    return FALSE;
+  }
+
+  *Offset = (UINT32)(Found - Buffer);
+  return TRUE;
+}
+
+/**
+  Check whether buffer range starts with the string.
+
+  @param[in] Buffer  XML buffer.
+  @param[in] Start   Range start.
+  @param[in] End     Range end.
+  @param[in] String  String to compare with.
+  @param[in] Length  String length.
+
+  @return  TRUE on match.
+**/
+STATIC
+BOOLEAN
+XmlIndexMatch (
+  IN CONST CHAR8  *Buffer,
+  IN UINT32       Start,
+  IN UINT32       End,
+  IN CONST CHAR8  *String,
+  IN UINT32       Length
+  )
+{
+  return Start <= End && End - Start >= Length && CompareMem (&Buffer[Start], String, Length) == 0;
+}
+
+/**
+  Get numeric attribute value within the tag.
+
+  @param[in]  Buffer           XML buffer.
+  @param[in]  Start            Tag attributes start.
+  @param[in]  End              Tag end.
+  @param[in]  Attribute        Attribute prefix, e.g. ID=".
+  @param[in]  AttributeLength  Attribute prefix length.
+  @param[out] Number           Attribute value.
+
+  @return  TRUE when attribute is present and valid.
+**/
+STATIC
+BOOLEAN
+XmlIndexTagNumber (
+  IN  CONST CHAR8  *Buffer,
+  IN  UINT32       Start,
+  IN  UINT32       End,
+  IN  CONST CHAR8  *Attribute,
+  IN  UINT32       AttributeLength,
+  OUT UINT32       *Number
+  )
+{
+  UINT32  Offset;
+  UINT64  Value;
+
+  while (XmlIndexFind (Buffer, Start, End, Attribute[0], &Offset)) {
+    if (  IsAsciiSpace (Buffer[Offset - 1])
+       && XmlIndexMatch (Buffer, Offset, End, Attribute, AttributeLength))
+    {
+      Offset += AttributeLength;
+      Value   = 0;
+      while (Offset < End && Buffer[Offset] >= '0' && Buffer[Offset] <= '9') {
+        Value = Value * 10 + (Buffer[Offset] - '0');
+        if (Value >= XML_PARSER_MAX_REFERENCE_COUNT) {
+          return FALSE;
+        }
+
+        ++Offset;
+      }
+
+      if ((Offset >= End) || (Buffer[Offset] != '"')) {
+        return FALSE;
+      }
+
+      *Number = (UINT32)Value;
+      return TRUE;
+    }
+
+    Start = Offset + 1;
+  }
+
+  return FALSE;
+}
+
+/**
+  Get node text content span with whitespace trimmed like XmlParseContent does.
+
+  @param[in]  Buffer  XML buffer.
+  @param[in]  Start   Content start after opening tag.
+  @param[in]  End     Range end.
+  @param[out] Span    Content span.
+
+  @return  TRUE when non-empty content is present.
+**/
+STATIC
+BOOLEAN
+XmlIndexContent (
+  IN  CONST CHAR8  *Buffer,
+  IN  UINT32       Start,
+  IN  UINT32       End,
+  OUT XML_SPAN     *Span
+  )
+{
+  UINT32  ContentEnd;
+
+  while (Start < End && IsAsciiSpace (Buffer[Start])) {
+    ++Start;
+  }
+
+  if (!XmlIndexFind (Buffer, Start, End, '<', &ContentEnd)) {
+    return FALSE;
+  }
+
+  while (ContentEnd > Start && IsAsciiSpace (Buffer[ContentEnd - 1])) {
+    --ContentEnd;
+  }
+
+  Span->Offset = Start;
+  Span->Size   = ContentEnd - Start;
+  return Span->Size > 0;
+}
+
+/**
+  Get content span of the node referenced by IDREF attribute.
+
+  @param[in]  Index   Offset index.
+  @param[in]  Buffer  XML buffer.
+  @param[in]  Start   Tag attributes start.
+  @param[in]  End     Tag end.
+  @param[out] Span    Content span.
+
+  @return  TRUE when non-empty content is present.
+**/
+STATIC
+BOOLEAN
+XmlIndexReferenceContent (
+  IN  CONST XML_INDEX  *Index,
+  IN  CONST CHAR8      *Buffer,
+  IN  UINT32           Start,
+  IN  UINT32           End,
+  OUT XML_SPAN         *Span
+  )
+{
+  UINT32  Reference;
+  UINT32  DefinitionEnd;
+  UINT32  TagEnd;
+
+  if (  !XmlIndexTagNumber (Buffer, Start, End, "IDREF=\"", L_STR_LEN ("IDREF=\""), &Reference)
+     || (Reference >= Index->ReferenceCount)
+     || (Index->References[Reference].Size == 0))
+  {
+    return FALSE;
+  }
+
+  DefinitionEnd = Index->References[Reference].Offset + Index->References[Reference].Size;
+  if (  !XmlIndexFind (Buffer, Index->References[Reference].Offset, DefinitionEnd, '>', &TagEnd)
+     || (Buffer[TagEnd - 1] == '/'))
+  {
+    return FALSE;
+  }
+
+  return XmlIndexContent (Buffer, TagEnd + 1, DefinitionEnd, Span);
+}
+
+/**
+  Record reference definition.
+
+  @param[in,out] Index      Offset index.
+  @param[in]     Reference  Reference number.
+  @param[in]     Offset     Definition offset.
+  @param[in]     Size       Definition size.
+
+  @return  FALSE when out of resources.
+**/
+STATIC
+BOOLEAN
+XmlIndexAddReference (
+  IN OUT XML_INDEX  *Index,
+  IN     UINT32     Reference,
+  IN     UINT32     Offset,
+  IN     UINT32     Size
+  )
+{
+  XML_SPAN  *NewReferences;
+  UINT32    NewCount;
+
+  ASSERT (Reference < XML_PARSER_MAX_REFERENCE_COUNT);
+
+  if (Reference >= Index->ReferenceCount) {
+    NewCount = MAX (Index->ReferenceCount * 2, XML_INDEX_MIN_ALLOC_COUNT);
+    while (NewCount <= Reference) {
+      NewCount *= 2;
+    }
+
+    NewReferences = ReallocatePool (
+                      Index->ReferenceCount * sizeof (*Index->References),
+                      NewCount * sizeof (*Index->References),
+                      Index->References
+                      );
+    if (NewReferences == NULL) {
+      return FALSE;
+    }
+
+    ZeroMem (
+      &NewReferences[Index->ReferenceCount],
+      (NewCount - Index->ReferenceCount) * sizeof (*NewReferences)
+      );
+    Index->References     = NewReferences;
+    Index->ReferenceCount = NewCount;
+  }
+
+  Index->References[Reference].Offset = Offset;
+  Index->References[Reference].Size   = Size;
+  return TRUE;
+}
+
+/**
+  Add dictionary entry.
+
+  @param[in,out] Index   Offset index.
+  @param[in]     Offset  Dictionary contents offset.
+
+  @return  FALSE when out of resources.
+**/
+STATIC
+BOOLEAN
+XmlIndexAddDict (
+  IN OUT XML_INDEX  *Index,
+  IN     UINT32     Offset
+  )
+{
+  XML_SPAN  *NewDicts;
+  XML_SPAN  *NewValues;
+  UINT32    NewCount;
+
+  if (Index->DictCount == Index->DictAllocCount) {
+    NewCount = MAX (Index->DictAllocCount * 2, XML_INDEX_MIN_ALLOC_COUNT);
+    NewDicts = ReallocatePool (
+                 Index->DictAllocCount * sizeof (*Index->Dicts),
+                 NewCount * sizeof (*Index->Dicts),
+                 Index->Dicts
+                 );
+    if (NewDicts == NULL) {
+      return FALSE;
+    }
+
+    Index->Dicts = NewDicts;
+
+    NewValues = ReallocatePool (
+                  Index->DictAllocCount * sizeof (*Index->Values),
+                  NewCount * sizeof (*Index->Values),
+                  Index->Values
+                  );
+    if (NewValues == NULL) {
+      return FALSE;
+    }
+
+    Index->Values         = NewValues;
+    Index->DictAllocCount = NewCount;
+  }
+
+  Index->Dicts[Index->DictCount].Offset  = Offset;
+  Index->Dicts[Index->DictCount].Size    = 0;
+  Index->Values[Index->DictCount].Offset = 0;
+  Index->Values[Index->DictCount].Size   = 0;
+  ++Index->DictCount;
+  return TRUE;
+}
+
+/**
+  Check whether the tag is a plist key with the given content.
+
+  @param[in] Buffer      XML buffer.
+  @param[in] BufferSize  XML buffer size.
+  @param[in] TagStart    Tag start.
+  @param[in] TagEnd      Tag end.
+  @param[in] Key         Key to compare with.
+  @param[in] KeyLength   Key length.
+
+  @return  TRUE on match.
+**/
+STATIC
+BOOLEAN
+XmlIndexMatchKey (
+  IN CONST CHAR8  *Buffer,
+  IN UINT32       BufferSize,
+  IN UINT32       TagStart,
+  IN UINT32       TagEnd,
+  IN CONST CHAR8  *Key,
+  IN UINT32       KeyLength
+  )
+{
+  XML_SPAN  KeySpan;
+
+  return XmlIndexMatch (Buffer, TagStart, TagEnd, XML_INDEX_KEY_OPEN, L_STR_LEN (XML_INDEX_KEY_OPEN))
+         && XmlIndexContent (Buffer, TagEnd, BufferSize, &KeySpan)
+         && KeySpan.Size == KeyLength
+         && XmlIndexMatch (Buffer, KeySpan.Offset, BufferSize, Key, KeyLength);
+}
+
+/**
+  Locate the array opening tag following the key.
+
+  @param[in]  Buffer       XML buffer.
+  @param[in]  BufferSize   XML buffer size.
+  @param[in]  ArrayKey     Key preceding the array.
+  @param[out] ArrayOffset  Array opening tag offset.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+XmlIndexFindArray (
+  IN  CONST CHAR8  *Buffer,
+  IN  UINT32       BufferSize,
+  IN  CONST CHAR8  *ArrayKey,
+  OUT UINT32       *ArrayOffset
+  )
+{
+  UINT32  KeyLength;
+  UINT32  Position;
+
+  KeyLength = (UINT32)AsciiStrLen (ArrayKey);
+
+  Position = 0;
+  while (XmlIndexFind (Buffer, Position, BufferSize, '<', &Position)) {
+    if (  XmlIndexMatch (Buffer, Position, BufferSize, XML_INDEX_KEY_OPEN, L_STR_LEN (XML_INDEX_KEY_OPEN))
+       && XmlIndexMatch (Buffer, Position + L_STR_LEN (XML_INDEX_KEY_OPEN), BufferSize, ArrayKey, KeyLength)
+       && XmlIndexMatch (
+            Buffer,
+            Position + L_STR_LEN (XML_INDEX_KEY_OPEN) + KeyLength,
+            BufferSize,
+            XML_INDEX_KEY_CLOSE,
+            L_STR_LEN (XML_INDEX_KEY_CLOSE)
+            ))
+    {
+      Position += L_STR_LEN (XML_INDEX_KEY_OPEN) + KeyLength + L_STR_LEN (XML_INDEX_KEY_CLOSE);
+      while (Position < BufferSize && IsAsciiSpace (Buffer[Position])) {
+        ++Position;
+      }
+
+      *ArrayOffset = Position;
+      return XmlIndexMatch (Buffer, Position, BufferSize, XML_INDEX_ARRAY_OPEN, L_STR_LEN (XML_INDEX_ARRAY_OPEN));
+    }
+
+    ++Position;
+  }
+
+  return FALSE;
+}
+
+/**
+  Index array dictionaries and reference definitions preceding them.
+
+  @param[in,out] Index        Offset index.
+  @param[in]     Buffer       XML buffer.
+  @param[in]     BufferSize   XML buffer size.
+  @param[in]     ArrayOffset  Array opening tag offset.
+  @param[in]     ValueKey     Key to look up string values for, optional.
+
+  @return  TRUE on success.
+**/
+STATIC
+BOOLEAN
+XmlIndexScan (
+  IN OUT XML_INDEX    *Index,
+  IN     CONST CHAR8  *Buffer,
+  IN     UINT32       BufferSize,
+  IN     UINT32       ArrayOffset,
+  IN     CONST CHAR8  *ValueKey  OPTIONAL
+  )
+{
+  XML_INDEX_PENDING  Pending[XML_PARSER_NEST_LEVEL];
+  UINT32             PendingCount;
+  UINT32             ValueKeyLength;
+  UINT32             Position;
+  UINT32             TagStart;
+  UINT32             TagEnd;
+  UINT32             NameEnd;
+  UINT32             Depth;
+  UINT32             ArrayDepth;
+  UINT32             Reference;
+  BOOLEAN            SelfClosing;
+  BOOLEAN            IsDefinition;
+  BOOLEAN            ValueSeen;
+  BOOLEAN            ValuePending;
+
+  ValueKeyLength = ValueKey != NULL ? (UINT32)AsciiStrLen (ValueKey) : 0;
+  PendingCount   = 0;
+  Position       = 0;
+  Depth          = 0;
+  ArrayDepth     = 0;
+  ValueSeen      = ValueKey == NULL;
+  ValuePending   = FALSE;
+
+  while (XmlIndexFind (Buffer, Position, BufferSize, '<', &TagStart)) {
+    if (!XmlIndexFind (Buffer, TagStart, BufferSize, '>', &TagEnd)) {
+      return FALSE;
+    }
+
+    ++TagEnd;
+    Position = TagEnd;
+
+    //
+    // Skip declarations and comments, comments may contain '>'.
+    //
+    if ((Buffer[TagStart + 1] == '?') || (Buffer[TagStart + 1] == '!')) {
+      if (XmlIndexMatch (Buffer, TagStart, BufferSize, "<!--", L_STR_LEN ("<!--"))) {
+        while (TagEnd < TagStart + L_STR_LEN ("<!---->") || Buffer[TagEnd - 2] != '-' || Buffer[TagEnd - 3] != '-') {
+          if (!XmlIndexFind (Buffer, TagEnd, BufferSize, '>', &TagEnd)) {
+            return FALSE;
+          }
+
+          ++TagEnd;
+        }
+
+        Position = TagEnd;
+      }
+
+      continue;
+    }
+
+    //
+    // Closing tag.
+    //
+    if (Buffer[TagStart + 1] == '/') {
+      if (Depth == 0) {
+        return FALSE;
+      }
+
+      --Depth;
+
+      if ((PendingCount > 0) && (Pending[PendingCount - 1].Depth == Depth)) {
+        --PendingCount;
+        if (!XmlIndexAddReference (
+               Index,
+               Pending[PendingCount].Reference,
+               Pending[PendingCount].Offset,
+               TagEnd - Pending[PendingCount].Offset
+               ))
+        {
+          return FALSE;
+        }
+      }
+
+      if (ArrayDepth != 0) {
+        if (Depth == ArrayDepth) {
+          if (!XmlIndexMatch (Buffer, TagStart, TagEnd, XML_INDEX_DICT_CLOSE, L_STR_LEN (XML_INDEX_DICT_CLOSE))) {
+            return FALSE;
+          }
+
+          Index->Dicts[Index->DictCount - 1].Size = TagStart - Index->Dicts[Index->DictCount - 1].Offset;
+        } else if (Depth + 1 == ArrayDepth) {
+          if (!XmlIndexMatch (Buffer, TagStart, TagEnd, XML_INDEX_ARRAY_CLOSE, L_STR_LEN (XML_INDEX_ARRAY_CLOSE))) {
+            return FALSE;
+          }
+
+          Index->ArrayStart = ArrayOffset + L_STR_LEN (XML_INDEX_ARRAY_OPEN);
+          Index->ArrayEnd   = TagStart;
+          return TRUE;
+        }
+      }
+
+      continue;
+    }
+
+    //
+    // Opening tag.
+    //
+    SelfClosing = Buffer[TagEnd - 2] == '/';
+    NameEnd     = TagStart + 1;
+    while (NameEnd < TagEnd - 1 && !IsAsciiSpace (Buffer[NameEnd]) && Buffer[NameEnd] != '/') {
+      ++NameEnd;
+    }
+
+    IsDefinition = XmlIndexTagNumber (Buffer, NameEnd, TagEnd, "ID=\"", L_STR_LEN ("ID=\""), &Reference);
+
+    if (TagStart == ArrayOffset) {
+      if (SelfClosing) {
+        return FALSE;
+      }
+
+      ArrayDepth = Depth + 1;
+    } else if ((ArrayDepth != 0) && (Depth == ArrayDepth)) {
+      //
+      // Dictionaries must have no attributes to be restored verbatim.
+      //
+      if (  !XmlIndexMatch (Buffer, TagStart, TagEnd, XML_INDEX_DICT_OPEN, L_STR_LEN (XML_INDEX_DICT_OPEN))
+         || !XmlIndexAddDict (Index, TagEnd))
+      {
+        return FALSE;
+      }
+
+      ValueSeen    = ValueKey == NULL;
+      ValuePending = FALSE;
+    } else if ((ArrayDepth != 0) && (Depth == ArrayDepth + 1) && !ValueSeen) {
+      //
+      // Only the first occurrence of the key is considered.
+      //
+      if (ValuePending) {
+        ValueSeen = TRUE;
+        if (  (NameEnd - TagStart - 1 == L_STR_LEN ("string"))
+           && XmlIndexMatch (Buffer, TagStart + 1, NameEnd, "string", L_STR_LEN ("string")))
+        {
+          if (!SelfClosing) {
+            XmlIndexContent (Buffer, TagEnd, BufferSize, &Index->Values[Index->DictCount - 1]);
+          } else {
+            XmlIndexReferenceContent (Index, Buffer, NameEnd, TagEnd, &Index->Values[Index->DictCount - 1]);
+          }
+        }
+      } else if (!SelfClosing && XmlIndexMatchKey (Buffer, BufferSize, TagStart, TagEnd, ValueKey, ValueKeyLength)) {
+        ValuePending = TRUE;
+      }
+    }
+
+    if (SelfClosing) {
+      if (IsDefinition && !XmlIndexAddReference (Index, Reference, TagStart, TagEnd - TagStart)) {
+        return FALSE;
+      }
+    } else {
+      if (Depth >= XML_PARSER_NEST_LEVEL) {
+        return FALSE;
+      }
+
+      if (IsDefinition) {
+        Pending[PendingCount].Reference = Reference;
+        Pending[PendingCount].Offset    = TagStart;
+        Pending[PendingCount].Depth     = Depth;
+        ++PendingCount;
+      }
+
+      ++Depth;
+    }
+  }
+
+  return FALSE;
+}
+
+BOOLEAN
+XmlIndexPlistArray (
+  IN  CONST CHAR8  *Buffer,
+  IN  UINT32       BufferSize,
+  IN  CONST CHAR8  *ArrayKey,
+  IN  CONST CHAR8  *ValueKey  OPTIONAL,
+  OUT XML_INDEX    *Index
+  )
+{
+  UINT32  ArrayOffset;
+
+  ASSERT (Buffer   != NULL);
+  ASSERT (ArrayKey != NULL);
+  ASSERT (Index    != NULL);
+
+  ZeroMem (Index, sizeof (*Index));
+
+  if (  (BufferSize > XML_PARSER_MAX_SIZE)
+     || !XmlIndexFindArray (Buffer, BufferSize, ArrayKey, &ArrayOffset))
+  {
+    return FALSE;
+  }
+
+  if (!XmlIndexScan (Index, Buffer, BufferSize, ArrayOffset, ValueKey)) {
+    XmlIndexFree (Index);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Append buffer range to growing buffer replacing references with
+  their definitions.
+
+  @param[in]     Index        Offset index.
+  @param[in]     Buffer       XML buffer.
+  @param[in]     Start        Range start.
+  @param[in]     End          Range end.
+  @param[in]     Level        Expansion nesting level.
+  @param[in,out] Result       Growing buffer.
+  @param[in,out] AllocSize    Growing buffer allocated size.
+  @param[in,out] CurrentSize  Growing buffer used size.
+
+  @return  FALSE when out of resources.
+**/
+STATIC
+BOOLEAN
+XmlIndexExpand (
+  IN     CONST XML_INDEX  *Index,
+  IN     CONST CHAR8      *Buffer,
+  IN     UINT32           Start,
+  IN     UINT32           End,
+  IN     UINT32           Level,
+  IN OUT CHAR8            **Result,
+  IN OUT UINT32           *AllocSize,
+  IN OUT UINT32           *CurrentSize
+  )
+{
+  UINT32  Position;
+  UINT32  TagStart;
+  UINT32  TagEnd;
+  UINT32  Reference;
+
+  Position = Start;
+
+  while (  XmlIndexFind (Buffer, Position, End, '<', &TagStart)
+        && XmlIndexFind (Buffer, TagStart, End, '>', &TagEnd))
+  {
+    Position = TagEnd + 1;
+
+    if (  (Buffer[TagEnd - 1] == '/')
+       && (Level < XML_PARSER_NEST_LEVEL)
+       && XmlIndexTagNumber (Buffer, TagStart, TagEnd, "IDREF=\"", L_STR_LEN ("IDREF=\""), &Reference)
+       && (Reference < Index->ReferenceCount)
+       && (Index->References[Reference].Size > 0))
+    {
+      if (  !XmlBufferAppend (Result, AllocSize, CurrentSize, &Buffer[Start], TagStart - Start)
+         || !XmlIndexExpand (
+               Index,
+               Buffer,
+               Index->References[Reference].Offset,
+               Index->References[Reference].Offset + Index->References[Reference].Size,
+               Level + 1,
+               Result,
+               AllocSize,
+               CurrentSize
+               ))
+      {
+        return FALSE;
+      }
+
+      Start = Position;
+    }
+  }
+
+  return XmlBufferAppend (Result, AllocSize, CurrentSize, &Buffer[Start], End - Start);
+}
+
+CHAR8 *
+XmlIndexExpandDict (
+  IN  CONST XML_INDEX  *Index,
+  IN  CONST CHAR8      *Buffer,
+  IN  CONST XML_SPAN   *Contents,
+  OUT UINT32           *ExpandedSize
+  )
+{
+  CHAR8   *Result;
+  UINT32  AllocSize;
+  UINT32  CurrentSize;
+
+  ASSERT (Index        != NULL);
+  ASSERT (Buffer       != NULL);
+  ASSERT (Contents     != NULL);
+  ASSERT (ExpandedSize != NULL);
+
+  AllocSize = L_STR_SIZE (XML_INDEX_DICT_OPEN XML_INDEX_DICT_CLOSE) + Contents->Size;
+  Result    = AllocatePool (AllocSize);
+  if (Result == NULL) {
+    return NULL;
+  }
+
+  CurrentSize = 0;
+  if (  !XmlBufferAppend (&Result, &AllocSize, &CurrentSize, XML_INDEX_DICT_OPEN, L_STR_LEN (XML_INDEX_DICT_OPEN))
+     || !XmlIndexExpand (Index, Buffer, Contents->Offset, Contents->Offset + Contents->Size, 0, &Result, &AllocSize, &CurrentSize)
+     || !XmlBufferAppend (&Result, &AllocSize, &CurrentSize, XML_INDEX_DICT_CLOSE, L_STR_LEN (XML_INDEX_DICT_CLOSE))
+     || (CurrentSize > XML_PARSER_MAX_SIZE))
+  {
+    FreePool (Result);
+    return NULL;
+  }
+
+  Result[CurrentSize] = '\0';
+  *ExpandedSize       = CurrentSize;
+  return Result;
+}
+
+VOID
+XmlIndexFree (
+  IN OUT XML_INDEX  *Index
+  )
+{
+  ASSERT (Index != NULL);
+
+  if (Index->Dicts != NULL) {
+    FreePool (Index->Dicts);
+  }
+
+  if (Index->Values != NULL) {
+    FreePool (Index->Values);
+  }
+
+  if (Index->References != NULL) {
+    FreePool (Index->References);
+  }
+
+  ZeroMem (Index, sizeof (*Index));
+}
@@ -627,4 +627,83 @@ STATIC UINT8 CONST  ChaChaCipherText[375] = {
   0xC4, 0xFD, 0x80, 0x6C, 0x22, 0xF2, 0x21
 };
 
+//
+// OcHashPasswordSha512 samples produced with the original iteration loop.
+// Password bytes are 'a' + Index % 26 and salt bytes are Index * 0x9D.
+// Together with the 64 byte digest the messages are 64, 88, 111 (padding
+// fills the block), 128 (block boundary), 495 (longest fixed-layout message)
+// and 496 (context fallback) bytes long.
+//
+#define PASSWORD_HASH_SAMPLES_NUM  6
+#define PASSWORD_HASH_MAX_SIZE     512
+
+typedef struct PASSWORD_HASH_SAMPLE_ {
+  UINT32    PasswordSize;
+  UINT32    SaltSize;
+  UINT8     Hash[SHA512_DIGEST_SIZE];
+} PASSWORD_HASH_SAMPLE;
+
+STATIC CONST PASSWORD_HASH_SAMPLE  PasswordHashSamples[PASSWORD_HASH_SAMPLES_NUM] = {
+  {
+    0,
+    0,
+    {
+      0xe3, 0x93, 0x93, 0xb4, 0xc7, 0x24, 0x9e, 0x94, 0x36, 0x4a, 0x2c, 0xb5, 0x22, 0xc9, 0x7b, 0xd4,
+      0x36, 0x64, 0x0d, 0x1e, 0xb0, 0x2c, 0xb7, 0x20, 0xd3, 0xa2, 0x47, 0x57, 0x3a, 0x29, 0x8b, 0x27,
+      0x88, 0xc9, 0xf2, 0xc5, 0xd9, 0xae, 0xc6, 0xae, 0x98, 0xef, 0x2d, 0xaa, 0xd0, 0x05, 0x8e, 0xf0,
+      0x7f, 0x7e, 0x09, 0xed, 0x85, 0x9d, 0xbe, 0x95, 0xbf, 0x0b, 0x2a, 0xe9, 0xed, 0x80, 0x79, 0x19
+    }
+  },
+  {
+    8,
+    16,
+    {
+      0xa7, 0xe3, 0x49, 0xcb, 0x5e, 0x44, 0x86, 0x8e, 0x24, 0x8a, 0x04, 0x71, 0x7b, 0xa6, 0x8c, 0x36,
+      0x54, 0x09, 0x66, 0xbf, 0x26, 0x6e, 0x00, 0x4e, 0x52, 0x3c, 0x0c, 0x54, 0xec, 0x08, 0xab, 0x60,
+      0x42, 0xad, 0xee, 0xea, 0xe0, 0x6f, 0x06, 0x93, 0x29, 0x42, 0xd5, 0x07, 0x27, 0x94, 0x4a, 0x98,
+      0x4e, 0x77, 0x53, 0x58, 0x4c, 0x58, 0x68, 0x53, 0x80, 0xf1, 0xa2, 0xd7, 0x1b, 0x15, 0xcf, 0xa0
+    }
+  },
+  {
+    31,
+    16,
+    {
+      0x82, 0xd8, 0xc0, 0x1c, 0xe2, 0x31, 0xe4, 0x90, 0x7a, 0x17, 0xc0, 0x60, 0x0f, 0xa7, 0x80, 0x3c,
+      0x62, 0x7a, 0x9a, 0x93, 0x29, 0x0c, 0x51, 0xf8, 0x38, 0xf1, 0x35, 0xd3, 0xd0, 0x80, 0x26, 0x3d,
+      0xca, 0x51, 0x25, 0xf7, 0x7e, 0xcc, 0x3f, 0xab, 0xaf, 0x97, 0x6c, 0xdb, 0xd0, 0xd7, 0x3f, 0x8c,
+      0xd5, 0xc5, 0xf2, 0xc5, 0x26, 0x41, 0x97, 0xaf, 0xcb, 0x91, 0x86, 0x4d, 0x01, 0xc0, 0x50, 0xf4
+    }
+  },
+  {
+    48,
+    16,
+    {
+      0xa6, 0x10, 0x9e, 0x8a, 0xc8, 0x95, 0xa6, 0xfd, 0x1c, 0x32, 0xed, 0xcc, 0x33, 0xdc, 0x46, 0x6d,
+      0x7a, 0xbb, 0x89, 0x92, 0x87, 0xb5, 0xcd, 0x82, 0x5a, 0xa6, 0x07, 0xdc, 0xfe, 0x46, 0xeb, 0x8a,
+      0xed, 0x65, 0x77, 0x09, 0xf2, 0xd8, 0x8a, 0x1f, 0xbd, 0x6f, 0x5d, 0xb0, 0x4d, 0x5f, 0x00, 0x83,
+      0x82, 0x1e, 0x9a, 0x16, 0xf4, 0xa3, 0xf6, 0xb1, 0x56, 0x1d, 0x1c, 0xb0, 0xf9, 0x5b, 0xce, 0x97
+    }
+  },
+  {
+    415,
+    16,
+    {
+      0x04, 0x38, 0x42, 0x4d, 0xee, 0x70, 0xfb, 0xea, 0x60, 0x48, 0xfc, 0x0b, 0xc1, 0x32, 0x3c, 0x4a,
+      0xd0, 0xd3, 0xd0, 0x82, 0x37, 0x41, 0xb4, 0xdd, 0xab, 0xe9, 0x51, 0x83, 0xd4, 0x5b, 0xa0, 0x2d,
+      0x4d, 0xd3, 0xd8, 0xc6, 0xff, 0x26, 0x0b, 0x4b, 0x5d, 0x87, 0xbe, 0x2a, 0x2b, 0x93, 0x41, 0x1a,
+      0xc1, 0xb2, 0x1f, 0x51, 0x0b, 0xb3, 0x35, 0xc9, 0xec, 0xb5, 0xeb, 0xcf, 0x16, 0x6e, 0x05, 0xd4
+    }
+  },
+  {
+    416,
+    16,
+    {
+      0x3b, 0x51, 0x9b, 0xbf, 0x5a, 0x52, 0x81, 0x52, 0x01, 0x09, 0xca, 0x12, 0xb6, 0xd4, 0x92, 0xca,
+      0x59, 0x47, 0x4e, 0x30, 0x11, 0x3a, 0x49, 0x89, 0xd8, 0xe7, 0x95, 0x60, 0x84, 0x42, 0xd4, 0x71,
+      0x4e, 0xf9, 0x79, 0x48, 0x18, 0x04, 0x95, 0x33, 0xf1, 0x6b, 0x07, 0x8c, 0x5e, 0x4c, 0x84, 0x21,
+      0xe3, 0x96, 0x88, 0xcc, 0xd4, 0xd5, 0xbd, 0xf4, 0x1a, 0x8c, 0x2f, 0x4e, 0x5a, 0x8c, 0x23, 0xa1
+    }
+  }
+};
+
 #endif // CRYPTO_SAMPLES_H
@@ -40,6 +40,7 @@ TestRsa2048Sha256Verify (
   EFI_STATUS  Status;
   UINT8       DataSha256Hash[SHA256_DIGEST_SIZE];
   BOOLEAN     SignatureVerified = FALSE;
+  UINT32      Mode;
 
   Sha256 (
     DataSha256Hash,
@@ -50,14 +51,28 @@ TestRsa2048Sha256Verify (
   CONST OC_RSA_PUBLIC_KEY  *PubKey =
     (CONST OC_RSA_PUBLIC_KEY *)Rsa2048Sha256Sample.PublicKey;
 
-  SignatureVerified = RsaVerifySigHashFromKeyDynalloc (
-                        PubKey,
-                        Rsa2048Sha256Sample.Signature,
-                        sizeof (Rsa2048Sha256Sample.Signature),
-                        DataSha256Hash,
-                        sizeof (DataSha256Hash),
-                        OcSigHashTypeSha256
-                        );
+  //
+  // Verify with every supported Montgomery multiplication implementation.
+  //
+  for (Mode = OcRsaPortable; Mode <= OcRsaAdx; ++Mode) {
+    if (OcSetRsaMode ((OC_RSA_MODE)Mode) != Mode) {
+      continue;
+    }
+
+    SignatureVerified = RsaVerifySigHashFromKeyDynalloc (
+                          PubKey,
+                          Rsa2048Sha256Sample.Signature,
+                          sizeof (Rsa2048Sha256Sample.Signature),
+                          DataSha256Hash,
+                          sizeof (DataSha256Hash),
+                          OcSigHashTypeSha256
+                          );
+    if (!SignatureVerified) {
+      break;
+    }
+  }
+
+  OcSetRsaMode (OcRsaAdx);
 
   if (SignatureVerified) {
     Status = EFI_SUCCESS;
@@ -401,6 +416,464 @@ TestHash (
   return Status;
 }
 
+//
+// FIPS 180-2 SHA-256 known answers.
+//
+STATIC CONST UINT8  mSha256AbcHash[SHA256_DIGEST_SIZE] = {
+  0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+  0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+};
+
+STATIC CONST UINT8  mSha256Abc448Hash[SHA256_DIGEST_SIZE] = {
+  0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+  0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1
+};
+
+STATIC CONST UINT8  mSha256MillionAHash[SHA256_DIGEST_SIZE] = {
+  0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+  0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0
+};
+
+STATIC CONST CHAR16  *mSha256ModeNames[] = {
+  L"scalar",
+  L"SSE2",
+  L"AVX2",
+  L"SHA-NI"
+};
+
+EFI_STATUS
+EFIAPI
+TestSha256Accel (
+  VOID
+  )
+{
+  BOOLEAN         TestPassed;
+  UINT32          Mode;
+  OC_SHA256_MODE  UsedMode;
+  UINT8           *Data;
+  UINTN           DataSize;
+  UINTN           Index;
+  UINTN           Offset;
+  SHA256_CONTEXT  Context;
+  UINT8           Expected[SHA256_DIGEST_SIZE];
+  UINT8           Sha256Hash[SHA256_DIGEST_SIZE];
+  CONST UINT8     *MultiData[OC_SHA256_MULTI_LANES + 3];
+  UINTN           MultiLen[OC_SHA256_MULTI_LANES + 3];
+  UINT8           MultiHashes[(OC_SHA256_MULTI_LANES + 3) * SHA256_DIGEST_SIZE];
+
+  //
+  // Lengths up to and above several blocks at unaligned offsets,
+  // the buffer is also used for the one million 'a' test in 1000 byte chunks.
+  //
+  DataSize = 1024 + 4;
+  Data     = AllocatePool (DataSize);
+  if (Data == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  TestPassed = TRUE;
+
+  for (Mode = OcSha256Scalar; Mode <= OcSha256ShaNi; ++Mode) {
+    UsedMode = OcSetSha256Mode ((OC_SHA256_MODE)Mode);
+    if (UsedMode != Mode) {
+      Print (L"Sha256 %s is unsupported\n", mSha256ModeNames[Mode]);
+      continue;
+    }
+
+    Sha256 (Sha256Hash, (CONST UINT8 *)"abc", sizeof ("abc") - 1);
+    if (CompareMem (Sha256Hash, mSha256AbcHash, SHA256_DIGEST_SIZE) != 0) {
+      Print (L"Sha256 %s abc test failed\n", mSha256ModeNames[Mode]);
+      TestPassed = FALSE;
+    }
+
+    Sha256 (
+      Sha256Hash,
+      (CONST UINT8 *)"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      sizeof ("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") - 1
+      );
+    if (CompareMem (Sha256Hash, mSha256Abc448Hash, SHA256_DIGEST_SIZE) != 0) {
+      Print (L"Sha256 %s 448-bit test failed\n", mSha256ModeNames[Mode]);
+      TestPassed = FALSE;
+    }
+
+    SetMem (Data, 1000, 'a');
+    Sha256Init (&Context);
+    for (Index = 0; Index < 1000; ++Index) {
+      Sha256Update (&Context, Data, 1000);
+    }
+
+    Sha256Final (&Context, Sha256Hash);
+    if (CompareMem (Sha256Hash, mSha256MillionAHash, SHA256_DIGEST_SIZE) != 0) {
+      Print (L"Sha256 %s million a test failed\n", mSha256ModeNames[Mode]);
+      TestPassed = FALSE;
+    }
+
+    //
+    // Compare with the portable implementation.
+    //
+    for (Index = 0; Index < DataSize; ++Index) {
+      Data[Index] = (UINT8)(Index * 0x9D + (Index >> 5));
+    }
+
+    for (Offset = 0; Offset < 4; ++Offset) {
+      for (Index = 0; Index <= DataSize - 4; Index += 31) {
+        OcSetSha256Mode (OcSha256Scalar);
+        Sha256 (Expected, &Data[Offset], Index);
+        OcSetSha256Mode (UsedMode);
+        Sha256 (Sha256Hash, &Data[Offset], Index);
+        if (CompareMem (Sha256Hash, Expected, SHA256_DIGEST_SIZE) != 0) {
+          Print (L"Sha256 %s mismatch at %lu of %lu bytes\n", mSha256ModeNames[Mode], Offset, Index);
+          TestPassed = FALSE;
+          break;
+        }
+      }
+    }
+
+    //
+    // Multi-buffer hashing of messages with different lengths and offsets.
+    //
+    for (Index = 0; Index < ARRAY_SIZE (MultiData); ++Index) {
+      MultiData[Index] = &Data[Index % 4];
+      MultiLen[Index]  = (Index * 97) % (DataSize - 4);
+    }
+
+    Sha256Multi (MultiHashes, MultiData, MultiLen, ARRAY_SIZE (MultiData));
+    OcSetSha256Mode (OcSha256Scalar);
+    for (Index = 0; Index < ARRAY_SIZE (MultiData); ++Index) {
+      Sha256 (Expected, MultiData[Index], MultiLen[Index]);
+      if (CompareMem (&MultiHashes[Index * SHA256_DIGEST_SIZE], Expected, SHA256_DIGEST_SIZE) != 0) {
+        Print (L"Sha256 %s multi-buffer mismatch at %lu\n", mSha256ModeNames[Mode], Index);
+        TestPassed = FALSE;
+        break;
+      }
+    }
+
+    if (TestPassed) {
+      Print (L"Sha256 %s tests passed\n", mSha256ModeNames[Mode]);
+    }
+  }
+
+  OcSetSha256Mode (OcSha256ShaNi);
+  FreePool (Data);
+
+  if (TestPassed) {
+    return EFI_SUCCESS;
+  }
+
+  return EFI_INVALID_PARAMETER;
+}
+
+//
+// Selects the SHA-512 transform used by OcHashPasswordSha512.
+//
+extern BOOLEAN  mIsAccelEnabled;
+
+/**
+  Check OcHashPasswordSha512 samples with the current SHA-512 transform.
+
+  @param[in] Transform  Transform name for the log.
+
+  @return  TRUE when all samples match.
+**/
+STATIC
+BOOLEAN
+CheckPasswordHash (
+  IN CONST CHAR16  *Transform
+  )
+{
+  BOOLEAN  TestPassed;
+  UINTN    Index;
+  UINT8    Password[PASSWORD_HASH_MAX_SIZE];
+  UINT8    Salt[PASSWORD_HASH_MAX_SIZE];
+  UINT8    Hash[SHA512_DIGEST_SIZE];
+
+  for (Index = 0; Index < PASSWORD_HASH_MAX_SIZE; ++Index) {
+    Password[Index] = (UINT8)('a' + Index % 26);
+    Salt[Index]     = (UINT8)(Index * 0x9D);
+  }
+
+  TestPassed = TRUE;
+
+  for (Index = 0; Index < PASSWORD_HASH_SAMPLES_NUM; ++Index) {
+    OcHashPasswordSha512 (
+      Password,
+      PasswordHashSamples[Index].PasswordSize,
+      Salt,
+      PasswordHashSamples[Index].SaltSize,
+      Hash
+      );
+
+    if (CompareMem (Hash, PasswordHashSamples[Index].Hash, SHA512_DIGEST_SIZE) != 0) {
+      Print (
+        L"Password hash %s mismatch for %u byte password and %u byte salt\n",
+        Transform,
+        PasswordHashSamples[Index].PasswordSize,
+        PasswordHashSamples[Index].SaltSize
+        );
+      TestPassed = FALSE;
+    }
+  }
+
+  return TestPassed;
+}
+
+EFI_STATUS
+EFIAPI
+TestPasswordHash (
+  VOID
+  )
+{
+  BOOLEAN  TestPassed;
+  BOOLEAN  AccelEnabled;
+
+  AccelEnabled = mIsAccelEnabled;
+
+  mIsAccelEnabled = FALSE;
+  TestPassed      = CheckPasswordHash (L"portable");
+
+  if (TryEnableAccel ()) {
+    if (!CheckPasswordHash (L"AVX")) {
+      TestPassed = FALSE;
+    }
+  } else {
+    Print (L"Password hash AVX is unsupported\n");
+  }
+
+  mIsAccelEnabled = AccelEnabled;
+
+  if (TestPassed) {
+    return EFI_SUCCESS;
+  }
+
+  return EFI_INVALID_PARAMETER;
+}
+
+STATIC CONST CHAR16  *mAesModeNames[] = {
+  L"portable",
+  L"AES-NI"
+};
+
+STATIC CONST CHAR16  *mChaChaModeNames[] = {
+  L"portable",
+  L"SSE2",
+  L"AVX2"
+};
+
+//
+// Cipher operations compared by TestCipherAccel.
+//
+typedef enum {
+  CipherAesCbcEncrypt,
+  CipherAesCbcDecrypt,
+  CipherAesCtr,
+  CipherChaCha,
+  CipherMax
+} CIPHER_OPERATION;
+
+STATIC CONST CHAR16  *mCipherNames[] = {
+  L"AES-CBC encryption",
+  L"AES-CBC decryption",
+  L"AES-CTR",
+  L"ChaCha"
+};
+
+/**
+  Process buffer in two calls with the current implementation.
+
+  @param[in]  Operation    Cipher operation.
+  @param[in]  Source       Data for transformation.
+  @param[out] Destination  Resulting data.
+  @param[in]  Size         Data size, a multiple of AES_BLOCK_SIZE for CBC.
+  @param[in]  Split        Size of the first call, a multiple of
+                           AES_BLOCK_SIZE for CBC.
+  @param[out] Context      Resulting context, AES_CONTEXT or CHACHA_CONTEXT.
+**/
+STATIC
+VOID
+CipherBuffer (
+  IN  CIPHER_OPERATION  Operation,
+  IN  CONST UINT8       *Source,
+  OUT UINT8             *Destination,
+  IN  UINT32            Size,
+  IN  UINT32            Split,
+  OUT VOID              *Context
+  )
+{
+  UINT8   Iv[AES_BLOCK_SIZE];
+  UINT32  Part;
+  UINT32  Offset;
+  UINT32  PartSize;
+
+  if (Operation == CipherChaCha) {
+    //
+    // Counter close to overflow also checks the carry to the next word.
+    //
+    ChaChaInitCtx (Context, ChaChaEncryptionKey, ChaChaInitVector, 0xFFFFFFF0U);
+    ChaChaCryptBuffer (Context, Source, Destination, Split);
+    ChaChaCryptBuffer (Context, &Source[Split], &Destination[Split], Size - Split);
+    return;
+  }
+
+  //
+  // Counter close to overflow also checks the carry to higher bytes.
+  //
+  CopyMem (Iv, AesCtrSample.IV, sizeof (Iv));
+  SetMem (&Iv[AES_BLOCK_SIZE - 3], 3, 0xFF);
+  AesInitCtxIv (Context, AesCtrSample.Key, Iv);
+  CopyMem (Destination, Source, Size);
+
+  for (Part = 0; Part < 2; ++Part) {
+    Offset   = Part == 0 ? 0 : Split;
+    PartSize = Part == 0 ? Split : Size - Split;
+
+    if (Operation == CipherAesCbcEncrypt) {
+      AesCbcEncryptBuffer (Context, &Destination[Offset], PartSize);
+    } else if (Operation == CipherAesCbcDecrypt) {
+      AesCbcDecryptBuffer (Context, &Destination[Offset], PartSize);
+    } else {
+      AesCtrXcryptBuffer (Context, &Destination[Offset], PartSize);
+    }
+  }
+}
+
+/**
+  Compare cipher operation with the portable implementation.
+
+  @param[in] Operation  Cipher operation.
+  @param[in] Mode       Implementation to compare, OC_AES_MODE for AES
+                        and OC_CHACHA_MODE for ChaCha.
+  @param[in] Data       Source data.
+  @param[in] DataSize   Source data size.
+  @param[in] Expected   Scratch buffer of DataSize bytes.
+  @param[in] Actual     Scratch buffer of DataSize bytes.
+
+  @return  TRUE when all results match.
+**/
+STATIC
+BOOLEAN
+CompareCipher (
+  IN CIPHER_OPERATION  Operation,
+  IN UINT32            Mode,
+  IN CONST UINT8       *Data,
+  IN UINT32            DataSize,
+  IN UINT8             *Expected,
+  IN UINT8             *Actual
+  )
+{
+  UINT32  Index;
+  UINT32  Size;
+  UINT32  Split;
+  UINTN   ContextSize;
+  UINT8   ExpectedContext[MAX (sizeof (AES_CONTEXT), sizeof (CHACHA_CONTEXT))];
+  UINT8   ActualContext[MAX (sizeof (AES_CONTEXT), sizeof (CHACHA_CONTEXT))];
+
+  ContextSize = Operation == CipherChaCha ? sizeof (CHACHA_CONTEXT) : sizeof (AES_CONTEXT);
+
+  for (Index = 0; Index <= DataSize; Index += 37) {
+    Size  = Index;
+    Split = Size / 3;
+    if ((Operation == CipherAesCbcEncrypt) || (Operation == CipherAesCbcDecrypt)) {
+      Size  &= ~(AES_BLOCK_SIZE - 1U);
+      Split &= ~(AES_BLOCK_SIZE - 1U);
+    }
+
+    if (Operation == CipherChaCha) {
+      OcSetChaChaMode (OcChaChaPortable);
+    } else {
+      OcSetAesMode (OcAesPortable);
+    }
+
+    CipherBuffer (Operation, Data, Expected, Size, Split, ExpectedContext);
+
+    if (Operation == CipherChaCha) {
+      OcSetChaChaMode ((OC_CHACHA_MODE)Mode);
+    } else {
+      OcSetAesMode ((OC_AES_MODE)Mode);
+    }
+
+    CipherBuffer (Operation, Data, Actual, Size, Split, ActualContext);
+
+    if (  (CompareMem (Actual, Expected, Size) != 0)
+       || (CompareMem (ActualContext, ExpectedContext, ContextSize) != 0))
+    {
+      Print (
+        L"%s %s mismatch at %u bytes\n",
+        mCipherNames[Operation],
+        Operation == CipherChaCha ? mChaChaModeNames[Mode] : mAesModeNames[Mode],
+        Size
+        );
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+EFI_STATUS
+EFIAPI
+TestCipherAccel (
+  VOID
+  )
+{
+  BOOLEAN  TestPassed;
+  UINT32   Operation;
+  UINT32   Mode;
+  UINT32   MaxMode;
+  UINT32   UsedMode;
+  UINT8    *Data;
+  UINT32   DataSize;
+  UINT32   Index;
+
+  //
+  // Several batches of vector blocks and all tail sizes.
+  //
+  DataSize = 2048 + 64;
+  Data     = AllocatePool (DataSize * 3);
+  if (Data == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < DataSize; ++Index) {
+    Data[Index] = (UINT8)(Index * 0x9D + (Index >> 5));
+  }
+
+  TestPassed = TRUE;
+
+  for (Operation = CipherAesCbcEncrypt; Operation < CipherMax; ++Operation) {
+    MaxMode = Operation == CipherChaCha ? OcChaChaAvx2 : OcAesNi;
+    for (Mode = 1; Mode <= MaxMode; ++Mode) {
+      if (Operation == CipherChaCha) {
+        UsedMode = OcSetChaChaMode ((OC_CHACHA_MODE)Mode);
+      } else {
+        UsedMode = OcSetAesMode ((OC_AES_MODE)Mode);
+      }
+
+      if (UsedMode != Mode) {
+        Print (
+          L"%s %s is unsupported\n",
+          mCipherNames[Operation],
+          Operation == CipherChaCha ? mChaChaModeNames[Mode] : mAesModeNames[Mode]
+          );
+        continue;
+      }
+
+      if (!CompareCipher ((CIPHER_OPERATION)Operation, Mode, Data, DataSize, &Data[DataSize], &Data[DataSize * 2])) {
+        TestPassed = FALSE;
+      }
+    }
+  }
+
+  OcSetAesMode (OcAesNi);
+  OcSetChaChaMode (OcChaChaAvx2);
+  FreePool (Data);
+
+  if (TestPassed) {
+    return EFI_SUCCESS;
+  }
+
+  return EFI_INVALID_PARAMETER;
+}
+
 EFI_STATUS
 EFIAPI
 UefiDriverMain (
@@ -424,6 +897,28 @@ UefiDriverMain (
     Print (L"All hash tests passed!\n");
   }
 
+  //
+  // Test accelerated SHA-256
+  //
+  Status = TestSha256Accel ();
+  if (EFI_ERROR (Status)) {
+    Print (L"Sha256 acceleration failed!\n");
+    Failure = TRUE;
+  } else {
+    Print (L"Sha256 acceleration passed!\n");
+  }
+
+  //
+  // Test password hashing
+  //
+  Status = TestPasswordHash ();
+  if (EFI_ERROR (Status)) {
+    Print (L"Password hash failed!\n");
+    Failure = TRUE;
+  } else {
+    Print (L"Password hash passed!\n");
+  }
+
   //
   // Test AES-128-CBC
   //
@@ -454,6 +949,17 @@ UefiDriverMain (
     Print (L"ChaCha passed!\n");
   }
 
+  //
+  // Test accelerated AES and ChaCha
+  //
+  Status = TestCipherAccel ();
+  if (EFI_ERROR (Status)) {
+    Print (L"Cipher acceleration failed!\n");
+    Failure = TRUE;
+  } else {
+    Print (L"Cipher acceleration passed!\n");
+  }
+
   //
   // Test Rsa2048Sha256 signature
   //
@@ -501,6 +1007,32 @@ UefiAppMain (
 
   WaitForKeyPress (L"Press any key...");
 
+  //
+  // Test accelerated SHA-256
+  //
+  Status = TestSha256Accel ();
+  if (EFI_ERROR (Status)) {
+    Print (L"Sha256 acceleration failed!\n");
+    Failure = TRUE;
+  } else {
+    Print (L"Sha256 acceleration passed!\n");
+  }
+
+  WaitForKeyPress (L"Press any key...");
+
+  //
+  // Test password hashing
+  //
+  Status = TestPasswordHash ();
+  if (EFI_ERROR (Status)) {
+    Print (L"Password hash failed!\n");
+    Failure = TRUE;
+  } else {
+    Print (L"Password hash passed!\n");
+  }
+
+  WaitForKeyPress (L"Press any key...");
+
   //
   // Test AES-128-CBC
   //
@@ -540,6 +1072,19 @@ UefiAppMain (
 
   WaitForKeyPress (L"Press any key...");
 
+  //
+  // Test accelerated AES and ChaCha
+  //
+  Status = TestCipherAccel ();
+  if (EFI_ERROR (Status)) {
+    Print (L"Cipher acceleration failed!\n");
+    Failure = TRUE;
+  } else {
+    Print (L"Cipher acceleration passed!\n");
+  }
+
+  WaitForKeyPress (L"Press any key...");
+
   //
   // Test Rsa2048Sha256 signature
   //
@@ -8,6 +8,8 @@
 #include <Library/UefiApplicationEntryPoint.h>
 #include <Library/DebugLib.h>
 
+#include <time.h>
+
 VOID
 EFIAPI
 CpuBreakpoint (
@@ -233,7 +235,28 @@ AsmReadTsc (
   VOID
   )
 {
-  return 0;
+ #if defined (__i386__) || defined (__x86_64__)
+  UINT32  Low;
+  UINT32  High;
+
+  asm volatile (
+    "rdtsc\n"
+    : "=a" (Low), "=d" (High)
+  );
+
+  return ((UINT64)High << 32U) | Low;
+ #else
+  struct timespec  Time;
+
+  //
+  // No TSC, provide monotonic nanoseconds instead.
+  //
+  if (clock_gettime (CLOCK_MONOTONIC, &Time) != 0) {
+    return 0;
+  }
+
+  return (UINT64)Time.tv_sec * 1000000000ULL + (UINT64)Time.tv_nsec;
+ #endif
 }
 
 UINTN
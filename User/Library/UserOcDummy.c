@@ -377,3 +377,27 @@ OcReadFile (
 
   return NULL;
 }
+
+EFI_STATUS
+OcDeleteFile (
+  IN EFI_FILE_PROTOCOL  *Directory,
+  IN CONST CHAR16       *FileName
+  )
+{
+  ASSERT (FALSE);
+
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+OcSetFileData (
+  IN EFI_FILE_PROTOCOL  *WritableFs OPTIONAL,
+  IN CONST CHAR16       *FileName,
+  IN CONST VOID         *Buffer,
+  IN UINT32             Size
+  )
+{
+  ASSERT (FALSE);
+
+  return EFI_UNSUPPORTED;
+}
@@ -0,0 +1,275 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcCompressionLib.h>
+
+#include <sys/time.h>
+
+//
+// Synthetic buffer size, close to a large DMG chunk batch.
+//
+#define CHECKSUM_DATA_SIZE  SIZE_64MB
+
+//
+// Amount of full buffer passes per measurement.
+//
+#define CHECKSUM_ITERATIONS  8
+
+//
+// Buffer lengths below this are compared with the scalar implementation
+// at every offset and length, covering vector setup and tail handling.
+//
+#define CHECKSUM_SHORT_SIZE  1024
+
+STATIC CONST CHAR8  *mModeNames[] = {
+  "scalar",
+  "ssse3",
+  "avx2"
+};
+
+STATIC
+UINT64
+GetCurrentTimestampUs (
+  VOID
+  )
+{
+  struct timeval  Time;
+
+  gettimeofday (&Time, NULL);
+  return Time.tv_sec * 1000000ULL + Time.tv_usec;
+}
+
+/**
+  Fill buffer with reproducible pseudo-random data.
+
+  @param[out] Data      Buffer to fill.
+  @param[in]  DataSize  Buffer size.
+**/
+STATIC
+VOID
+FillSyntheticData (
+  OUT UINT8   *Data,
+  IN  UINT32  DataSize
+  )
+{
+  UINT64  State;
+  UINT32  Index;
+
+  State = 0x9E3779B97F4A7C15ULL;
+  for (Index = 0; Index < DataSize; ++Index) {
+    State      ^= State << 13U;
+    State      ^= State >> 7U;
+    State      ^= State << 17U;
+    Data[Index] = (UINT8)State;
+  }
+}
+
+/**
+  Calculate checksum.
+
+  @param[in] Crc       TRUE to calculate CRC-32, FALSE for Adler-32.
+  @param[in] Data      Buffer to checksum.
+  @param[in] DataSize  Buffer size.
+
+  @return  Checksum.
+**/
+STATIC
+UINT32
+CalculateChecksum (
+  IN BOOLEAN      Crc,
+  IN CONST UINT8  *Data,
+  IN UINT32       DataSize
+  )
+{
+  if (Crc) {
+    return Crc32 (Data, DataSize);
+  }
+
+  return Adler32 (Data, DataSize);
+}
+
+/**
+  Measure checksum throughput.
+
+  @param[in]  Crc       TRUE to measure CRC-32, FALSE for Adler-32.
+  @param[in]  Data      Buffer to checksum.
+  @param[in]  DataSize  Buffer size.
+  @param[out] Checksum  Calculated checksum.
+
+  @return  Throughput in MB/s.
+**/
+STATIC
+UINT64
+MeasureChecksum (
+  IN  BOOLEAN      Crc,
+  IN  CONST UINT8  *Data,
+  IN  UINT32       DataSize,
+  OUT UINT32       *Checksum
+  )
+{
+  UINT32  Iteration;
+  UINT64  Start;
+  UINT64  Elapsed;
+
+  Start = GetCurrentTimestampUs ();
+  for (Iteration = 0; Iteration < CHECKSUM_ITERATIONS; ++Iteration) {
+    *Checksum = CalculateChecksum (Crc, Data, DataSize);
+  }
+
+  Elapsed = GetCurrentTimestampUs () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  //
+  // Bytes per microsecond equal megabytes per second.
+  //
+  return (UINT64)DataSize * CHECKSUM_ITERATIONS / Elapsed;
+}
+
+/**
+  Compare short buffer checksums with the scalar implementation.
+
+  @param[in] Crc   TRUE to check CRC-32, FALSE for Adler-32.
+  @param[in] Mode  Checksum implementation to check.
+  @param[in] Data  Buffer at least 2 * CHECKSUM_SHORT_SIZE long.
+
+  @return  TRUE when all checksums match.
+**/
+STATIC
+BOOLEAN
+CheckShortChecksums (
+  IN BOOLEAN           Crc,
+  IN OC_CHECKSUM_MODE  Mode,
+  IN CONST UINT8       *Data
+  )
+{
+  UINT32  Offset;
+  UINT32  Size;
+  UINT32  Expected;
+  UINT32  Checksum;
+
+  for (Offset = 0; Offset < 32; ++Offset) {
+    for (Size = 0; Size < CHECKSUM_SHORT_SIZE; ++Size) {
+      OcSetChecksumMode (OcChecksumScalar);
+      Expected = CalculateChecksum (Crc, &Data[Offset], Size);
+      OcSetChecksumMode (Mode);
+      Checksum = CalculateChecksum (Crc, &Data[Offset], Size);
+
+      if (Checksum != Expected) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "[FAIL] %a %a at %u of %u bytes - %08X vs %08X\n",
+          mModeNames[Mode],
+          Crc ? "crc32" : "adler32",
+          Offset,
+          Size,
+          Checksum,
+          Expected
+          ));
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+int
+ENTRY_POINT (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINT8             *Data;
+  UINT32            DataSize;
+  UINT32            Mode;
+  OC_CHECKSUM_MODE  UsedMode;
+  UINT32            Crc;
+  UINT32            Expected[2];
+  UINT32            Checksum;
+  UINT64            Speed;
+  int               RetVal;
+
+  DataSize = CHECKSUM_DATA_SIZE;
+  Data     = AllocatePool (DataSize);
+  if (Data == NULL) {
+    DEBUG ((DEBUG_ERROR, "Failed to allocate %u bytes\n", DataSize));
+    return -1;
+  }
+
+  FillSyntheticData (Data, DataSize);
+
+  //
+  // Known answers for the reference implementation.
+  //
+  OcSetChecksumMode (OcChecksumScalar);
+  if (  (Adler32 ((CONST UINT8 *)"Wikipedia", 9) != 0x11E60398)
+     || (Crc32 ((CONST UINT8 *)"123456789", 9) != 0xCBF43926))
+  {
+    DEBUG ((DEBUG_ERROR, "[FAIL] scalar known answer mismatch\n"));
+    FreePool (Data);
+    return -1;
+  }
+
+  Expected[0] = Adler32 (Data, DataSize);
+  Expected[1] = Crc32 (Data, DataSize);
+
+  RetVal = 0;
+
+  for (Crc = 0; Crc < 2; ++Crc) {
+    for (Mode = OcChecksumScalar; Mode <= OcChecksumAvx2; ++Mode) {
+      UsedMode = OcSetChecksumMode ((OC_CHECKSUM_MODE)Mode);
+      if (UsedMode != Mode) {
+        DEBUG ((DEBUG_ERROR, "[SKIP] %a checksum is unsupported\n", mModeNames[Mode]));
+        continue;
+      }
+
+      if (!CheckShortChecksums (Crc != 0, UsedMode, Data)) {
+        RetVal = -1;
+        continue;
+      }
+
+      OcSetChecksumMode (UsedMode);
+      Speed = MeasureChecksum (Crc != 0, Data, DataSize, &Checksum);
+
+      if (Checksum != Expected[Crc]) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "[FAIL] %a %a - %08X vs %08X\n",
+          mModeNames[Mode],
+          Crc != 0 ? "crc32" : "adler32",
+          Checksum,
+          Expected[Crc]
+          ));
+        RetVal = -1;
+        continue;
+      }
+
+      DEBUG ((
+        DEBUG_ERROR,
+        "[OK] %a %a - %Lu MB/s\n",
+        mModeNames[Mode],
+        Crc != 0 ? "crc32" : "adler32",
+        Speed
+        ));
+    }
+  }
+
+  FreePool (Data);
+  return RetVal;
+}
@@ -0,0 +1,260 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcCryptoLib.h>
+
+#include <sys/time.h>
+
+//
+// Synthetic buffer size, a multiple of AES_BLOCK_SIZE.
+//
+#define CIPHER_DATA_SIZE  SIZE_4MB
+
+//
+// Amount of full buffer passes per measurement.
+//
+#define CIPHER_ITERATIONS  4
+
+typedef enum {
+  CipherAesCbcEncrypt,
+  CipherAesCbcDecrypt,
+  CipherAesCtr,
+  CipherChaCha,
+  CipherMax
+} CIPHER_OPERATION;
+
+STATIC CONST CHAR8  *mOperationNames[] = {
+  "aes-cbc-encrypt",
+  "aes-cbc-decrypt",
+  "aes-ctr",
+  "chacha"
+};
+
+STATIC CONST CHAR8  *mAesModeNames[] = {
+  "portable",
+  "aes-ni"
+};
+
+STATIC CONST CHAR8  *mChaChaModeNames[] = {
+  "portable",
+  "sse2",
+  "avx2"
+};
+
+STATIC CONST UINT8  mKey[CHACHA_KEY_SIZE] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F
+};
+
+STATIC CONST UINT8  mIv[AES_BLOCK_SIZE] = {
+  0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF
+};
+
+STATIC
+UINT64
+GetCurrentTimestampUs (
+  VOID
+  )
+{
+  struct timeval  Time;
+
+  gettimeofday (&Time, NULL);
+  return Time.tv_sec * 1000000ULL + Time.tv_usec;
+}
+
+/**
+  Fill buffer with reproducible pseudo-random data.
+
+  @param[out] Data      Buffer to fill.
+  @param[in]  DataSize  Buffer size.
+**/
+STATIC
+VOID
+FillSyntheticData (
+  OUT UINT8   *Data,
+  IN  UINT32  DataSize
+  )
+{
+  UINT64  State;
+  UINT32  Index;
+
+  State = 0x9E3779B97F4A7C15ULL;
+  for (Index = 0; Index < DataSize; ++Index) {
+    State      ^= State << 13U;
+    State      ^= State >> 7U;
+    State      ^= State << 17U;
+    Data[Index] = (UINT8)State;
+  }
+}
+
+/**
+  Select cipher implementation.
+
+  @param[in] Operation  Cipher operation.
+  @param[in] Mode       Requested implementation.
+
+  @return  Implementation in use.
+**/
+STATIC
+UINT32
+SetCipherMode (
+  IN CIPHER_OPERATION  Operation,
+  IN UINT32            Mode
+  )
+{
+  if (Operation == CipherChaCha) {
+    return OcSetChaChaMode ((OC_CHACHA_MODE)Mode);
+  }
+
+  return OcSetAesMode ((OC_AES_MODE)Mode);
+}
+
+/**
+  Process buffer in place.
+
+  @param[in]     Operation  Cipher operation.
+  @param[in,out] Data       Buffer to process.
+  @param[in]     DataSize   Buffer size.
+**/
+STATIC
+VOID
+CipherBuffer (
+  IN     CIPHER_OPERATION  Operation,
+  IN OUT UINT8             *Data,
+  IN     UINT32            DataSize
+  )
+{
+  AES_CONTEXT     AesContext;
+  CHACHA_CONTEXT  ChaChaContext;
+
+  if (Operation == CipherChaCha) {
+    ChaChaInitCtx (&ChaChaContext, mKey, mIv, 0);
+    ChaChaCryptBuffer (&ChaChaContext, Data, Data, DataSize);
+    return;
+  }
+
+  AesInitCtxIv (&AesContext, mKey, mIv);
+
+  if (Operation == CipherAesCbcEncrypt) {
+    AesCbcEncryptBuffer (&AesContext, Data, DataSize);
+  } else if (Operation == CipherAesCbcDecrypt) {
+    AesCbcDecryptBuffer (&AesContext, Data, DataSize);
+  } else {
+    AesCtrXcryptBuffer (&AesContext, Data, DataSize);
+  }
+}
+
+/**
+  Measure cipher throughput.
+
+  @param[in]     Operation  Cipher operation.
+  @param[in,out] Data       Buffer to process.
+  @param[in]     DataSize   Buffer size.
+
+  @return  Throughput in MB/s.
+**/
+STATIC
+UINT64
+MeasureCipher (
+  IN     CIPHER_OPERATION  Operation,
+  IN OUT UINT8             *Data,
+  IN     UINT32            DataSize
+  )
+{
+  UINT32  Iteration;
+  UINT64  Start;
+  UINT64  Elapsed;
+
+  Start = GetCurrentTimestampUs ();
+  for (Iteration = 0; Iteration < CIPHER_ITERATIONS; ++Iteration) {
+    CipherBuffer (Operation, Data, DataSize);
+  }
+
+  Elapsed = GetCurrentTimestampUs () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  //
+  // Bytes per microsecond equal megabytes per second.
+  //
+  return (UINT64)DataSize * CIPHER_ITERATIONS / Elapsed;
+}
+
+int
+ENTRY_POINT (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINT8        *Data;
+  UINT8        *Expected;
+  UINT8        *Work;
+  UINT32       DataSize;
+  UINT32       Operation;
+  UINT32       Mode;
+  UINT32       MaxMode;
+  CONST CHAR8  *ModeName;
+  UINT64       Speed;
+  int          RetVal;
+
+  DataSize = CIPHER_DATA_SIZE;
+  Data     = AllocatePool (DataSize * 3);
+  if (Data == NULL) {
+    DEBUG ((DEBUG_ERROR, "Failed to allocate %u bytes\n", DataSize * 3));
+    return -1;
+  }
+
+  Expected = &Data[DataSize];
+  Work     = &Data[DataSize * 2];
+
+  FillSyntheticData (Data, DataSize);
+
+  RetVal = 0;
+
+  for (Operation = CipherAesCbcEncrypt; Operation < CipherMax; ++Operation) {
+    SetCipherMode ((CIPHER_OPERATION)Operation, 0);
+    CopyMem (Expected, Data, DataSize);
+    CipherBuffer ((CIPHER_OPERATION)Operation, Expected, DataSize);
+
+    MaxMode = Operation == CipherChaCha ? OcChaChaAvx2 : OcAesNi;
+    for (Mode = 0; Mode <= MaxMode; ++Mode) {
+      ModeName = Operation == CipherChaCha ? mChaChaModeNames[Mode] : mAesModeNames[Mode];
+
+      if (SetCipherMode ((CIPHER_OPERATION)Operation, Mode) != Mode) {
+        DEBUG ((DEBUG_ERROR, "[SKIP] %a %a is unsupported\n", ModeName, mOperationNames[Operation]));
+        continue;
+      }
+
+      CopyMem (Work, Data, DataSize);
+      CipherBuffer ((CIPHER_OPERATION)Operation, Work, DataSize);
+
+      if (CompareMem (Work, Expected, DataSize) != 0) {
+        DEBUG ((DEBUG_ERROR, "[FAIL] %a %a mismatch\n", ModeName, mOperationNames[Operation]));
+        RetVal = -1;
+        continue;
+      }
+
+      Speed = MeasureCipher ((CIPHER_OPERATION)Operation, Work, DataSize);
+
+      DEBUG ((DEBUG_ERROR, "[OK] %a %a - %Lu MB/s\n", ModeName, mOperationNames[Operation], Speed));
+    }
+  }
+
+  FreePool (Data);
+  return RetVal;
+}
@@ -0,0 +1,427 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcCompressionLib.h>
+
+#include <UserFile.h>
+#include <UserMemory.h>
+
+#include <stdlib.h>
+#include <sys/time.h>
+
+//
+// Amount of full decompressions per measurement.
+//
+#define COMPRESSION_ITERATIONS  8
+
+//
+// Output buffer size relative to input when raw size is not given.
+//
+#define COMPRESSION_DEFAULT_RATIO  16U
+
+typedef
+UINTN
+(*COMPRESSION_DECOMPRESS) (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  );
+
+typedef struct {
+  CONST CHAR8               *Extension;
+  CONST CHAR8               *Name;
+  COMPRESSION_DECOMPRESS    Decompress;
+} COMPRESSION_CODEC;
+
+//
+// Codec is chosen by compressed file extension.
+//
+STATIC CONST COMPRESSION_CODEC  mCodecs[] = {
+  { ".adc",   "adc",   DecompressADC   },
+  { ".bz2",   "bzip2", DecompressBZIP2 },
+  { ".lzfse", "lzfse", DecompressLZFSE },
+  { ".lzvn",  "lzvn",  DecompressLZVN  },
+  { ".xz",    "lzma",  DecompressLZMA  },
+  { ".zlib",  "zlib",  DecompressZLIB  }
+};
+
+STATIC
+UINT64
+GetCurrentTimestampUs (
+  VOID
+  )
+{
+  struct timeval  Time;
+
+  gettimeofday (&Time, NULL);
+  return Time.tv_sec * 1000000ULL + Time.tv_usec;
+}
+
+/**
+  Find codec matching file extension.
+
+  @param[in]  Path         File path.
+
+  @return  Codec or NULL.
+**/
+STATIC
+CONST COMPRESSION_CODEC *
+GetCodec (
+  IN CONST CHAR8  *Path
+  )
+{
+  UINTN  Index;
+  UINTN  PathLength;
+  UINTN  ExtensionLength;
+
+  PathLength = AsciiStrLen (Path);
+  for (Index = 0; Index < ARRAY_SIZE (mCodecs); ++Index) {
+    ExtensionLength = AsciiStrLen (mCodecs[Index].Extension);
+    if (  (PathLength >= ExtensionLength)
+       && (AsciiStrCmp (Path + PathLength - ExtensionLength, mCodecs[Index].Extension) == 0))
+    {
+      return &mCodecs[Index];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Measure decompression throughput.
+
+  @param[in]  Codec        Codec to use.
+  @param[in]  Data         Compressed buffer.
+  @param[in]  DataSize     Compressed buffer size.
+  @param[out] Output       Decompressed buffer.
+  @param[in]  OutputSize   Decompressed buffer size.
+  @param[out] RawSize      Decompressed size, 0 on failure.
+
+  @return  Throughput in MB/s of decompressed data.
+**/
+STATIC
+UINT64
+MeasureDecompress (
+  IN  CONST COMPRESSION_CODEC  *Codec,
+  IN  CONST UINT8              *Data,
+  IN  UINT32                   DataSize,
+  OUT UINT8                    *Output,
+  IN  UINT32                   OutputSize,
+  OUT UINTN                    *RawSize
+  )
+{
+  UINT32  Iteration;
+  UINT64  Start;
+  UINT64  Elapsed;
+
+  Start = GetCurrentTimestampUs ();
+  for (Iteration = 0; Iteration < COMPRESSION_ITERATIONS; ++Iteration) {
+    *RawSize = Codec->Decompress (Output, OutputSize, Data, DataSize);
+    if (*RawSize == 0) {
+      return 0;
+    }
+  }
+
+  Elapsed = GetCurrentTimestampUs () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  //
+  // Bytes per microsecond equal megabytes per second.
+  //
+  return (UINT64)*RawSize * COMPRESSION_ITERATIONS / Elapsed;
+}
+
+/**
+  Byte-granular LZVN decoder used as a reference for DecompressLZVN.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+
+  @return  DecompressedLen when the stream is valid up to end-of-stream
+           and fits DstLen, otherwise 0.
+**/
+STATIC
+UINTN
+ReferenceDecompressLzvn (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  )
+{
+  UINTN  SrcPos;
+  UINTN  DstPos;
+  UINTN  OpcodeLen;
+  UINTN  Literal;
+  UINTN  Match;
+  UINTN  Distance;
+  UINTN  Index;
+  UINT8  Opcode;
+
+  SrcPos   = 0;
+  DstPos   = 0;
+  Distance = 0;
+
+  while (SrcPos < SrcLen) {
+    Opcode    = Src[SrcPos];
+    OpcodeLen = 1;
+    Literal   = 0;
+    Match     = 0;
+
+    if (Opcode == 0x06) {
+      //
+      // End of stream.
+      //
+      return SrcLen - SrcPos >= 8 ? DstPos : 0;
+    } else if ((Opcode == 0x0E) || (Opcode == 0x16)) {
+      //
+      // Nop.
+      //
+    } else if (  ((Opcode >= 0x70) && (Opcode <= 0x7F))
+              || ((Opcode >= 0xD0) && (Opcode <= 0xDF))
+              || ((Opcode < 0x40) && ((Opcode & 0x07) == 0x06)))
+    {
+      //
+      // Undefined, the remaining 0x06 low bits below 0x40 are eos, nop and udef.
+      //
+      return 0;
+    } else if (Opcode == 0xE0) {
+      OpcodeLen = 2;
+      if (SrcLen - SrcPos < OpcodeLen) {
+        return 0;
+      }
+
+      Literal = Src[SrcPos + 1] + 16;
+    } else if (Opcode > 0xE0 && Opcode < 0xF0) {
+      Literal = Opcode & 0x0F;
+    } else if (Opcode == 0xF0) {
+      OpcodeLen = 2;
+      if (SrcLen - SrcPos < OpcodeLen) {
+        return 0;
+      }
+
+      Match = Src[SrcPos + 1] + 16;
+    } else if (Opcode > 0xF0) {
+      Match = Opcode & 0x0F;
+    } else if ((Opcode >= 0xA0) && (Opcode <= 0xBF)) {
+      OpcodeLen = 3;
+      if (SrcLen - SrcPos < OpcodeLen) {
+        return 0;
+      }
+
+      Literal  = (Opcode >> 3) & 0x03;
+      Match    = (((Opcode & 0x07) << 2) | (Src[SrcPos + 1] & 0x03)) + 3;
+      Distance = (Src[SrcPos + 1] >> 2) | (Src[SrcPos + 2] << 6);
+    } else {
+      Literal = Opcode >> 6;
+      Match   = ((Opcode >> 3) & 0x07) + 3;
+      if ((Opcode & 0x07) == 0x07) {
+        OpcodeLen = 3;
+        if (SrcLen - SrcPos < OpcodeLen) {
+          return 0;
+        }
+
+        Distance = Src[SrcPos + 1] | (Src[SrcPos + 2] << 8);
+      } else if ((Opcode & 0x07) != 0x06) {
+        OpcodeLen = 2;
+        if (SrcLen - SrcPos < OpcodeLen) {
+          return 0;
+        }
+
+        Distance = ((Opcode & 0x07) << 8) | Src[SrcPos + 1];
+      }
+    }
+
+    SrcPos += OpcodeLen;
+    if ((SrcLen - SrcPos < Literal) || (DstLen - DstPos < Literal)) {
+      return 0;
+    }
+
+    for (Index = 0; Index < Literal; ++Index) {
+      Dst[DstPos++] = Src[SrcPos++];
+    }
+
+    if (Match > 0) {
+      if ((Distance == 0) || (Distance > DstPos) || (DstLen - DstPos < Match)) {
+        return 0;
+      }
+
+      for (Index = 0; Index < Match; ++Index) {
+        Dst[DstPos] = Dst[DstPos - Distance];
+        ++DstPos;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int
+ENTRY_POINT (
+  int   argc,
+  char  *argv[]
+  )
+{
+  CONST COMPRESSION_CODEC  *Codec;
+  UINT8                    *Data;
+  UINT32                   DataSize;
+  UINT8                    *Output;
+  UINT32                   OutputSize;
+  UINTN                    RawSize;
+  UINT64                   Speed;
+
+  if (argc < 2) {
+    DEBUG ((DEBUG_ERROR, "Usage: %a <file.{adc,bz2,lzfse,lzvn,xz,zlib}> [raw size]\n", argv[0]));
+    return -1;
+  }
+
+  Codec = GetCodec (argv[1]);
+  if (Codec == NULL) {
+    DEBUG ((DEBUG_ERROR, "Unknown compression for %a\n", argv[1]));
+    return -1;
+  }
+
+  Data = UserReadFile (argv[1], &DataSize);
+  if (Data == NULL) {
+    DEBUG ((DEBUG_ERROR, "Read fail for %a\n", argv[1]));
+    return -1;
+  }
+
+  if (argc > 2) {
+    OutputSize = (UINT32)strtoul (argv[2], NULL, 0);
+  } else if (DataSize <= OC_COMPRESSION_MAX_LENGTH / COMPRESSION_DEFAULT_RATIO) {
+    OutputSize = DataSize * COMPRESSION_DEFAULT_RATIO;
+  } else {
+    OutputSize = OC_COMPRESSION_MAX_LENGTH;
+  }
+
+  Output = AllocatePool (OutputSize);
+  if (Output == NULL) {
+    DEBUG ((DEBUG_ERROR, "Failed to allocate %u bytes\n", OutputSize));
+    FreePool (Data);
+    return -1;
+  }
+
+  Speed = MeasureDecompress (Codec, Data, DataSize, Output, OutputSize, &RawSize);
+  if (RawSize == 0) {
+    DEBUG ((DEBUG_ERROR, "[FAIL] %a decompression of %a\n", Codec->Name, argv[1]));
+    FreePool (Output);
+    FreePool (Data);
+    return -1;
+  }
+
+  DEBUG ((
+    DEBUG_ERROR,
+    "[OK] %a decompression %u -> %u bytes - %Lu MB/s\n",
+    Codec->Name,
+    DataSize,
+    (UINT32)RawSize,
+    Speed
+    ));
+
+ #if 0
+  UserWriteFile ("out.bin", Output, (UINT32)RawSize);
+ #endif
+
+  FreePool (Output);
+  FreePool (Data);
+  return 0;
+}
+
+int
+LLVMFuzzerTestOneInput (
+  const uint8_t  *Data,
+  size_t         Size
+  )
+{
+  #define  MAX_INPUT   1024
+  #define  MAX_OUTPUT  4096
+
+  UINT8  *Test;
+  UINT8  *Reference;
+  UINTN  Index;
+  UINTN  CurrentLength;
+  UINTN  ReferenceLength;
+  UINT8  *CompressedEnd;
+
+  if (Size > MAX_INPUT) {
+    return 0;
+  }
+
+  Test = AllocateZeroPool (MAX_OUTPUT);
+  if (Test == NULL) {
+    return 0;
+  }
+
+  Reference = AllocateZeroPool (MAX_OUTPUT);
+  if (Reference == NULL) {
+    FreePool (Test);
+    return 0;
+  }
+
+  //
+  // LZVN compressor output must decompress back to the input.
+  //
+  CompressedEnd = CompressLZVN (Reference, MAX_OUTPUT, Data, Size, 0);
+  ASSERT (CompressedEnd != NULL);
+  CurrentLength = DecompressLZVN (Test, MAX_OUTPUT, Reference, (UINTN)(CompressedEnd - Reference));
+  ASSERT (CurrentLength == Size);
+  ASSERT (CompareMem (Test, Data, Size) == 0);
+
+  //
+  // LZVN decoder uses wide copies, compare it against the byte-granular one.
+  //
+  for (Index = 0; Index < MAX_OUTPUT; Index += 64) {
+    ASAN_POISON_MEMORY_REGION (Test + Index, MAX_OUTPUT - Index);
+    CurrentLength = DecompressLZVN (
+                      Test,
+                      Index,
+                      Data,
+                      Size
+                      );
+    ASAN_UNPOISON_MEMORY_REGION (Test + Index, MAX_OUTPUT - Index);
+    ASSERT (CurrentLength <= Index);
+
+    ReferenceLength = ReferenceDecompressLzvn (Reference, Index, Data, Size);
+    if (ReferenceLength > 0) {
+      ASSERT (CurrentLength == ReferenceLength);
+      ASSERT (CompareMem (Test, Reference, CurrentLength) == 0);
+    }
+  }
+
+  for (Index = 0; Index < MAX_OUTPUT; ++Index) {
+    ASAN_POISON_MEMORY_REGION (Test + Index, MAX_OUTPUT - Index);
+    CurrentLength = DecompressLZFSE (
+                      Test,
+                      Index,
+                      Data,
+                      Size
+                      );
+    ASAN_UNPOISON_MEMORY_REGION (Test + Index, MAX_OUTPUT - Index);
+    ASSERT (CurrentLength <= Index);
+  }
+
+  FreePool (Reference);
+  FreePool (Test);
+  return 0;
+}
@@ -14,8 +14,298 @@
 #include <UserFile.h>
 #include <UserMemory.h>
 
+#include <stdlib.h>
+#include <sys/time.h>
+
 #define  NUM_EXTENTS  20
 
+//
+// Amount of trace replays per measurement.
+//
+#define  TRACE_ITERATIONS  4
+
+//
+// Recorded disk image read.
+//
+typedef struct {
+  UINTN    Lba;
+  UINTN    Size;
+} TRACE_READ;
+
+typedef
+UINTN
+(*DISK_IMAGE_DECOMPRESS) (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen
+  );
+
+//
+// Decompressors for every supported DMG chunk type.
+//
+STATIC CONST DISK_IMAGE_DECOMPRESS  mDecompressors[] = {
+  DecompressADC,
+  DecompressZLIB,
+  DecompressBZIP2,
+  DecompressLZFSE,
+  DecompressLZMA
+};
+
+STATIC
+UINT64
+GetCurrentTimestampUs (
+  VOID
+  )
+{
+  struct timeval  Time;
+
+  gettimeofday (&Time, NULL);
+  return Time.tv_sec * 1000000ULL + Time.tv_usec;
+}
+
+/**
+  Load read trace with one "<lba> <sector count>" pair per line.
+  Empty lines and lines starting with # are skipped.
+
+  @param[in]  Path     Trace file path.
+  @param[out] Count    Amount of reads.
+  @param[out] MaxSize  Largest read size in bytes.
+
+  @return  Reads or NULL.
+**/
+STATIC
+TRACE_READ *
+LoadTrace (
+  IN  CONST CHAR8  *Path,
+  OUT UINTN        *Count,
+  OUT UINTN        *MaxSize
+  )
+{
+  CHAR8       *Data;
+  UINT32      DataSize;
+  CHAR8       *Walker;
+  CHAR8       *End;
+  TRACE_READ  *Reads;
+  UINTN       Capacity;
+  UINTN       Lba;
+  UINTN       Sectors;
+
+  Data = (CHAR8 *)UserReadFile (Path, &DataSize);
+  if (Data == NULL) {
+    return NULL;
+  }
+
+  //
+  // Every read takes at least 4 characters, e.g. "0 1\n".
+  //
+  Capacity = DataSize / 4 + 1;
+  Reads    = AllocatePool (Capacity * sizeof (*Reads));
+  if (Reads == NULL) {
+    FreePool (Data);
+    return NULL;
+  }
+
+  *Count   = 0;
+  *MaxSize = 0;
+  Walker   = Data;
+
+  while (*Walker != '\0') {
+    while (*Walker == ' ' || *Walker == '\t' || *Walker == '\r' || *Walker == '\n') {
+      ++Walker;
+    }
+
+    if (*Walker == '#') {
+      while (*Walker != '\0' && *Walker != '\n') {
+        ++Walker;
+      }
+
+      continue;
+    }
+
+    if (*Walker == '\0') {
+      break;
+    }
+
+    Lba     = (UINTN)strtoull (Walker, &End, 0);
+    Sectors = (UINTN)strtoull (End, &Walker, 0);
+    if ((Walker == End) || (Sectors == 0) || (*Count == Capacity)) {
+      DEBUG ((DEBUG_ERROR, "Malformed trace at read %u\n", (UINT32)*Count));
+      FreePool (Reads);
+      FreePool (Data);
+      return NULL;
+    }
+
+    Reads[*Count].Lba  = Lba;
+    Reads[*Count].Size = Sectors * APPLE_DISK_IMAGE_SECTOR_SIZE;
+    *MaxSize           = MAX (*MaxSize, Reads[*Count].Size);
+    ++*Count;
+  }
+
+  FreePool (Data);
+  return Reads;
+}
+
+/**
+  Replay read trace against a disk image.
+
+  @param[in]  Dmg        Disk image data.
+  @param[in]  DmgSize    Disk image size.
+  @param[in]  Reads      Trace reads.
+  @param[in]  ReadCount  Amount of trace reads.
+  @param[out] Buffer     Buffer fitting the largest read.
+  @param[in]  ReadAhead  Amount of chunks to inflate ahead.
+
+  @return  Throughput in MB/s of read data, 0 on failure.
+**/
+STATIC
+UINT64
+ReplayTrace (
+  IN  UINT8             *Dmg,
+  IN  UINT32            DmgSize,
+  IN  CONST TRACE_READ  *Reads,
+  IN  UINTN             ReadCount,
+  OUT UINT8             *Buffer,
+  IN  UINT32            ReadAhead
+  )
+{
+  BOOLEAN                      Result;
+  OC_APPLE_DISK_IMAGE_CONTEXT  DmgContext;
+  APPLE_RAM_DISK_EXTENT_TABLE  ExtentTable;
+  UINT32                       Iteration;
+  UINTN                        Index;
+  UINT64                       Total;
+  UINT64                       Start;
+  UINT64                       Elapsed;
+
+  ExtentTable.Signature         = APPLE_RAM_DISK_EXTENT_SIGNATURE;
+  ExtentTable.Version           = APPLE_RAM_DISK_EXTENT_VERSION;
+  ExtentTable.Reserved          = 0;
+  ExtentTable.Signature2        = APPLE_RAM_DISK_EXTENT_SIGNATURE;
+  ExtentTable.ExtentCount       = 1;
+  ExtentTable.Extents[0].Start  = (UINTN)Dmg;
+  ExtentTable.Extents[0].Length = DmgSize;
+
+  Total   = 0;
+  Elapsed = 0;
+
+  for (Iteration = 0; Iteration < TRACE_ITERATIONS; ++Iteration) {
+    //
+    // Start every replay with an empty cache.
+    //
+    Result = OcAppleDiskImageInitializeContext (&DmgContext, &ExtentTable, DmgSize);
+    if (!Result) {
+      DEBUG ((DEBUG_ERROR, "DMG Context initialization error\n"));
+      return 0;
+    }
+
+    OcAppleDiskImageSetReadAhead (&DmgContext, ReadAhead, TRUE);
+
+    Start = GetCurrentTimestampUs ();
+    for (Index = 0; Index < ReadCount; ++Index) {
+      if (  (Reads[Index].Lba >= DmgContext.SectorCount)
+         || (Reads[Index].Size / APPLE_DISK_IMAGE_SECTOR_SIZE > DmgContext.SectorCount - Reads[Index].Lba))
+      {
+        DEBUG ((DEBUG_ERROR, "Trace read %u is out of bounds\n", (UINT32)Index));
+        OcAppleDiskImageFreeContext (&DmgContext);
+        return 0;
+      }
+
+      Result = OcAppleDiskImageRead (&DmgContext, Reads[Index].Lba, Reads[Index].Size, Buffer);
+      if (!Result) {
+        DEBUG ((DEBUG_ERROR, "DMG read error at trace read %u\n", (UINT32)Index));
+        OcAppleDiskImageFreeContext (&DmgContext);
+        return 0;
+      }
+
+      Total += Reads[Index].Size;
+    }
+
+    Elapsed += GetCurrentTimestampUs () - Start;
+
+    if (Iteration + 1 == TRACE_ITERATIONS) {
+      DEBUG ((
+        DEBUG_ERROR,
+        "Read-ahead %u: hits %Lu misses %Lu read ahead %Lu\n",
+        ReadAhead,
+        DmgContext.CacheStats.Hits,
+        DmgContext.CacheStats.Misses,
+        DmgContext.CacheStats.ReadAhead
+        ));
+    }
+
+    OcAppleDiskImageFreeContext (&DmgContext);
+  }
+
+  return Total / MAX (Elapsed, 1);
+}
+
+/**
+  Measure trace replay throughput without and with read-ahead.
+
+  @param[in]  DmgPath    Disk image path.
+  @param[in]  TracePath  Read trace path.
+
+  @return  0 on success.
+**/
+STATIC
+int
+MeasureTrace (
+  IN CONST CHAR8  *DmgPath,
+  IN CONST CHAR8  *TracePath
+  )
+{
+  UINT8       *Dmg;
+  UINT32      DmgSize;
+  TRACE_READ  *Reads;
+  UINTN       ReadCount;
+  UINTN       MaxSize;
+  UINT8       *Buffer;
+  UINT64      Plain;
+  UINT64      Ahead;
+
+  Dmg = UserReadFile (DmgPath, &DmgSize);
+  if (Dmg == NULL) {
+    DEBUG ((DEBUG_ERROR, "Read fail\n"));
+    return -1;
+  }
+
+  Reads = LoadTrace (TracePath, &ReadCount, &MaxSize);
+  if (Reads == NULL) {
+    DEBUG ((DEBUG_ERROR, "Trace read fail\n"));
+    FreePool (Dmg);
+    return -1;
+  }
+
+  Buffer = AllocatePool (MAX (MaxSize, 1));
+  if (Buffer == NULL) {
+    FreePool (Reads);
+    FreePool (Dmg);
+    return -1;
+  }
+
+  Plain = ReplayTrace (Dmg, DmgSize, Reads, ReadCount, Buffer, 0);
+  Ahead = ReplayTrace (Dmg, DmgSize, Reads, ReadCount, Buffer, OC_APPLE_DISK_IMAGE_DEFAULT_READ_AHEAD);
+
+  FreePool (Buffer);
+  FreePool (Reads);
+  FreePool (Dmg);
+
+  if ((Plain == 0) || (Ahead == 0)) {
+    return -1;
+  }
+
+  DEBUG ((
+    DEBUG_ERROR,
+    "Replayed %u reads: %Lu MB/s, %Lu MB/s with read-ahead\n",
+    (UINT32)ReadCount,
+    Plain,
+    Ahead
+    ));
+
+  return 0;
+}
+
 int
 ENTRY_POINT (
   int   argc,
@@ -35,12 +325,19 @@ ENTRY_POINT (
   APPLE_RAM_DISK_EXTENT_TABLE  ExtentTable;
   UINT32                       Index2;
   OC_APPLE_CHUNKLIST_CONTEXT   ChunklistContext;
+  UINT32                       Offset;
+  UINT32                       ReadSize;
+  UINT8                        SectorBuffer[SIZE_4KB];
 
   //
   // Limit pool allocation size to 3072 MB
   //
   SetPoolAllocationSizeLimit (BASE_1GB | BASE_2GB);
 
+  if ((argc == 4) && (AsciiStrCmp (argv[1], "-trace") == 0)) {
+    return MeasureTrace (argv[2], argv[3]);
+  }
+
   if (argc < 2) {
     DEBUG ((DEBUG_ERROR, "Please provide a valid Disk Image path\n"));
     return -1;
@@ -107,6 +404,15 @@ ENTRY_POINT (
         DEBUG ((DEBUG_ERROR, "Chunklist chunk verification error\n"));
         goto ContinueDmgLoop;
       }
+
+      //
+      // Verify again on first read to cover lazy verification.
+      //
+      Result = OcAppleDiskImageVerifyDataLazy (&DmgContext, &ChunklistContext);
+      if (!Result) {
+        DEBUG ((DEBUG_ERROR, "Chunklist lazy verification error\n"));
+        goto ContinueDmgLoop;
+      }
     }
 
     UncompSize = (DmgContext.SectorCount * APPLE_DISK_IMAGE_SECTOR_SIZE);
@@ -124,6 +430,41 @@ ENTRY_POINT (
 
     DEBUG ((DEBUG_ERROR, "Decompressed the entire DMG...\n"));
 
+    //
+    // Read the image again in small requests like file system drivers do,
+    // inflating chunks ahead.
+    //
+    OcAppleDiskImageSetReadAhead (&DmgContext, OC_APPLE_DISK_IMAGE_DEFAULT_READ_AHEAD, TRUE);
+
+    for (Offset = 0; Offset < UncompSize; Offset += ReadSize) {
+      ReadSize = MIN (sizeof (SectorBuffer), UncompSize - Offset);
+      Result   = OcAppleDiskImageRead (
+                   &DmgContext,
+                   Offset / APPLE_DISK_IMAGE_SECTOR_SIZE,
+                   ReadSize,
+                   SectorBuffer
+                   );
+      if (!Result || (CompareMem (SectorBuffer, UncompDmg + Offset, ReadSize) != 0)) {
+        DEBUG ((DEBUG_ERROR, "DMG sector read error at %u\n", Offset));
+        goto ContinueDmgLoop;
+      }
+    }
+
+    Result = OcAppleDiskImageVerifyRemaining (&DmgContext);
+    if (!Result) {
+      DEBUG ((DEBUG_ERROR, "Chunklist remaining data verification error\n"));
+      goto ContinueDmgLoop;
+    }
+
+    DEBUG ((
+      DEBUG_ERROR,
+      "Chunk cache hits %Lu misses %Lu inflated %Lu bytes read ahead %Lu\n",
+      DmgContext.CacheStats.Hits,
+      DmgContext.CacheStats.Misses,
+      DmgContext.CacheStats.BytesInflated,
+      DmgContext.CacheStats.ReadAhead
+      ));
+
  #if 0
     UserWriteFile ("out.bin", UncompDmg, UncompSize);
  #endif
@@ -177,7 +518,8 @@ LLVMFuzzerTestOneInput (
 
   UINT8   *Test;
   UINTN   Index;
-  UINT32  CurrentLength;
+  UINTN   Codec;
+  UINTN   CurrentLength;
 
   if (Size > MAX_INPUT) {
     return 0;
@@ -188,17 +530,20 @@ LLVMFuzzerTestOneInput (
     return 0;
   }
 
-  for (Index = 0; Index < 4096; ++Index) {
-    ASAN_POISON_MEMORY_REGION (Test + Index, MAX_OUTPUT - Index);
-    CurrentLength = DecompressZLIB (
-                      Test,
-                      Index,
-                      Data,
-                      Size
-                      );
-    ASAN_UNPOISON_MEMORY_REGION (Test + Index, MAX_OUTPUT - Index);
-    ASSERT (CurrentLength <= Index);
+  for (Codec = 0; Codec < ARRAY_SIZE (mDecompressors); ++Codec) {
+    for (Index = 0; Index < MAX_OUTPUT; ++Index) {
+      ASAN_POISON_MEMORY_REGION (Test + Index, MAX_OUTPUT - Index);
+      CurrentLength = mDecompressors[Codec](
+                        Test,
+                        Index,
+                        Data,
+                        Size
+                        );
+      ASAN_UNPOISON_MEMORY_REGION (Test + Index, MAX_OUTPUT - Index);
+      ASSERT (CurrentLength <= Index);
+    }
   }
 
+  FreePool (Test);
   return 0;
 }
@@ -32,6 +32,11 @@ STATIC EFI_FILE_PROTOCOL  NilFileProtocol;
 STATIC UINT8   *mPrelinked    = NULL;
 STATIC UINT32  mPrelinkedSize = 0;
 
+//
+// Amount of benchmark iterations, 0 when not benchmarking.
+//
+STATIC UINT32  mBenchIterations = 0;
+
 STATIC
 CONST CHAR8
   KextInfoPlistData[] = {
@@ -239,6 +244,7 @@ ApplyKextPatches (
              );
   if (!EFI_ERROR (Status)) {
     Status = PatcherApplyGenericPatch (&Patcher, &DisableIOAHCIPatch);
+    PatcherFreeContext (&Patcher);
     if (EFI_ERROR (Status)) {
       DEBUG ((DEBUG_WARN, "[FAIL] Failed to apply patch com.apple.iokit.IOAHCIFamily - %r\n", Status));
       FailedToProcess = TRUE;
@@ -257,6 +263,7 @@ ApplyKextPatches (
              );
   if (!EFI_ERROR (Status)) {
     Status = PatcherBlockKext (&Patcher);
+    PatcherFreeContext (&Patcher);
     if (EFI_ERROR (Status)) {
       DEBUG ((DEBUG_WARN, "[FAIL] Failed to block com.apple.iokit.IOHIDFamily - %r\n", Status));
       FailedToProcess = TRUE;
@@ -275,6 +282,7 @@ ApplyKextPatches (
              );
   if (!EFI_ERROR (Status)) {
     Status = PatcherExcludePrelinkedKext ("com.apple.driver.Intel82574LEthernet", &Patcher, Context);
+    PatcherFreeContext (&Patcher);
     if (EFI_ERROR (Status)) {
       DEBUG ((DEBUG_WARN, "[FAIL] Failed to exclude com.apple.driver.Intel82574LEthernet - %r\n", Status));
       FailedToProcess = TRUE;
@@ -550,6 +558,8 @@ ApplyKernelPatches (
   } else {
     DEBUG ((DEBUG_WARN, "[OK] KernelQuirkPowerTimeoutKernelPanic patch\n"));
   }
+
+  PatcherFreeContext (&Patcher);
 }
 
 EFI_STATUS
@@ -589,10 +599,7 @@ WrapMain (
 {
   UINT32             AllocSize;
   PRELINKED_CONTEXT  Context;
-
-  PcdGet32 (PcdFixedDebugPrintErrorLevel) |= DEBUG_INFO | DEBUG_VERBOSE;
-  PcdGet32 (PcdDebugPrintErrorLevel)      |= DEBUG_INFO | DEBUG_VERBOSE;
-  PcdGet8 (PcdDebugPropertyMask)          |= DEBUG_PROPERTY_DEBUG_CODE_ENABLED;
+  UINT64             PhaseStart;
 
   CONST CHAR8  *FileName;
 
@@ -699,7 +706,9 @@ WrapMain (
     FailedToProcess = TRUE;
   }
 
+  PhaseStart = OcKernelPhaseStart ();
   ApplyKernelPatches (mPrelinked, mPrelinkedSize);
+  OcKernelPhaseStop (KernelPhasePatch, PhaseStart);
 
   PATCHER_CONTEXT  Patcher;
 
@@ -711,6 +720,7 @@ WrapMain (
              );
   if (!EFI_ERROR (Status)) {
     DEBUG ((DEBUG_WARN, "[OK] Patcher init success\n"));
+    PatcherFreeContext (&Patcher);
   } else {
     DEBUG ((DEBUG_WARN, "[FAIL] Patcher init failure - %r\n", Status));
     FailedToProcess = TRUE;
@@ -718,7 +728,9 @@ WrapMain (
 
   Status = PrelinkedContextInit (&Context, mPrelinked, mPrelinkedSize, AllocSize, FALSE);
   if (!EFI_ERROR (Status)) {
+    PhaseStart = OcKernelPhaseStart ();
     ApplyKextPatches (&Context);
+    OcKernelPhaseStop (KernelPhasePatch, PhaseStart);
 
     Status = PrelinkedInjectPrepare (&Context, LinkedExpansion, ReservedExeSize);
     if (EFI_ERROR (Status)) {
@@ -727,6 +739,26 @@ WrapMain (
       return -1;
     }
 
+    //
+    // Reuse linked kexts from the previous run, output must stay the same.
+    // Cache from a different build of this utility is discarded.
+    // Benchmark always links from scratch to measure the linker.
+    //
+    UINT32  LinkCacheSize = 0;
+    VOID    *LinkCache    = NULL;
+
+    if (mBenchIterations == 0) {
+      LinkCache = UserReadFile ("linkcache.bin", &LinkCacheSize);
+    }
+
+    Status = PrelinkedLinkCacheInit (&Context, Sha384, __DATE__ " " __TIME__, LinkCache, LinkCacheSize);
+    if (!EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_WARN, "[OK] Linked kext cache init from %u bytes\n", LinkCacheSize));
+    } else {
+      DEBUG ((DEBUG_WARN, "[FAIL] Linked kext cache init error %r\n", Status));
+      FailedToProcess = TRUE;
+    }
+
     CHAR8  BundleVersion[MAX_INFO_BUNDLE_VERSION_KEY_SIZE];
     //
     // Assume no bundle version from the beginning.
@@ -836,7 +868,10 @@ WrapMain (
     ASSERT (Context.PrelinkedSize - Context.KextsFileOffset <= ReservedExeSize);
 
     Status = PrelinkedInjectComplete (&Context);
-    UserWriteFile ("out.bin", mPrelinked, Context.PrelinkedSize);
+    if (mBenchIterations == 0) {
+      UserWriteFile ("out.bin", mPrelinked, Context.PrelinkedSize);
+    }
+
     if (!EFI_ERROR (Status)) {
       DEBUG ((DEBUG_WARN, "[OK] Prelink inject complete success\n"));
     } else {
@@ -844,6 +879,13 @@ WrapMain (
       FailedToProcess = TRUE;
     }
 
+    LinkCache = mBenchIterations == 0 ? PrelinkedLinkCacheExport (&Context, &LinkCacheSize) : NULL;
+    if (LinkCache != NULL) {
+      UserWriteFile ("linkcache.bin", LinkCache, LinkCacheSize);
+      DEBUG ((DEBUG_WARN, "[OK] Linked kext cache saved %u bytes\n", LinkCacheSize));
+      FreePool (LinkCache);
+    }
+
     PrelinkedContextFree (&Context);
   } else {
     DEBUG ((DEBUG_WARN, "[FAIL] Context creation error %r\n", Status));
@@ -915,6 +957,79 @@ LLVMFuzzerTestOneInput (
   return 0;
 }
 
+STATIC
+int
+BenchMain (
+  int   argc,
+  char  *argv[]
+  )
+{
+  int                       code;
+  UINT32                    Index;
+  UINT64                    StartTsc;
+  UINT64                    TscFrequency;
+  UINT64                    ElapsedUs;
+  struct timeval            StartTime;
+  struct timeval            EndTime;
+  CONST KERNEL_PHASE_STATS  *Stats;
+
+  OcKernelPhaseReset ();
+
+  gettimeofday (&StartTime, NULL);
+  StartTsc = AsmReadTsc ();
+
+  for (Index = 0; Index < mBenchIterations; ++Index) {
+    code = WrapMain (argc, argv);
+    if (code != 0) {
+      printf ("Iteration %u failed\n", Index);
+      return code;
+    }
+  }
+
+  gettimeofday (&EndTime, NULL);
+  ElapsedUs = (UINT64)(EndTime.tv_sec - StartTime.tv_sec) * 1000000ULL
+              + (UINT64)EndTime.tv_usec - (UINT64)StartTime.tv_usec;
+
+  //
+  // Calibrate tick rate against wall time over the whole run.
+  //
+  TscFrequency = ElapsedUs > 0 ? (AsmReadTsc () - StartTsc) * 1000000ULL / ElapsedUs : 0;
+  if (TscFrequency == 0) {
+    printf ("Run is too short to calibrate\n");
+    return -1;
+  }
+
+  printf ("%u iterations in %llu us\n", mBenchIterations, (unsigned long long)ElapsedUs);
+  printf ("%-12s %8s %12s %12s %12s %12s\n", "phase", "spans", "total us", "iter us", "min us", "max us");
+
+  for (Index = 0; Index < KernelPhaseMax; ++Index) {
+    Stats = OcKernelPhaseGetStats (Index);
+    if (Stats->Count == 0) {
+      continue;
+    }
+
+    printf (
+      "%-12s %8u %12llu %12llu %12llu %12llu\n",
+      OcKernelPhaseGetName (Index),
+      Stats->Count,
+      (unsigned long long)(Stats->Ticks * 1000000ULL / TscFrequency),
+      (unsigned long long)(Stats->Ticks * 1000000ULL / TscFrequency / mBenchIterations),
+      (unsigned long long)(Stats->MinTicks * 1000000ULL / TscFrequency),
+      (unsigned long long)(Stats->MaxTicks * 1000000ULL / TscFrequency)
+      );
+  }
+
+  //
+  // Synthetic kernels do not carry the code targeted by Apple patches,
+  // their failures are expected and only reported.
+  //
+  if (FailedToProcess) {
+    printf ("Some steps failed, see the log above\n");
+  }
+
+  return 0;
+}
+
 int
 ENTRY_POINT (
   int   argc,
@@ -923,6 +1038,33 @@ ENTRY_POINT (
 {
   int  code;
 
+  //
+  // KextInject -b <iterations> [prelinkedkernel] [kext plist]...
+  //
+  if ((argc > 2) && (strcmp (argv[1], "-b") == 0)) {
+    mBenchIterations = (UINT32)strtoul (argv[2], NULL, 10);
+    if (mBenchIterations == 0) {
+      printf ("Invalid iteration count %s\n", argv[2]);
+      return -1;
+    }
+
+    argv[2] = argv[0];
+    argc   -= 2;
+    argv   += 2;
+
+    //
+    // Keep per-iteration logging from dominating the measurements.
+    //
+    PcdGet32 (PcdFixedDebugPrintErrorLevel) = DEBUG_ERROR;
+    PcdGet32 (PcdDebugPrintErrorLevel)      = DEBUG_ERROR;
+
+    return BenchMain (argc, argv);
+  }
+
+  PcdGet32 (PcdFixedDebugPrintErrorLevel) |= DEBUG_INFO | DEBUG_VERBOSE;
+  PcdGet32 (PcdDebugPrintErrorLevel)      |= DEBUG_INFO | DEBUG_VERBOSE;
+  PcdGet8 (PcdDebugPropertyMask)          |= DEBUG_PROPERTY_DEBUG_CODE_ENABLED;
+
   code = WrapMain (argc, argv);
   if (FailedToProcess) {
     code = -1;
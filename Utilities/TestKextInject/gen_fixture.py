@@ -0,0 +1,798 @@
+#!/usr/bin/env python3
+
+"""
+Generate synthetic x86_64 prelinkedkernel and kext fixtures for KextInject.
+
+The produced images are not runnable, they only mimic the layout consumed by
+OcAppleKernelLib: a legacy prelinkedkernel with __PRELINK_TEXT and
+__PRELINK_INFO segments, linked kexts within it, and unlinked kexts with
+external and local relocations to be injected.
+
+With --kc a macOS 11+ kernel collection is produced instead: an MH_FILESET
+image with the kernel in __TEXT_EXEC, prelinked kexts in __REGION0, and a
+joint __LINKEDIT holding all symbol tables and the chained fixups header.
+
+Usage: gen_fixture.py [options] <output directory>
+"""
+
+import argparse
+import os
+import random
+import struct
+import sys
+
+CPU_TYPE_X86_64 = 0x01000007
+CPU_SUBTYPE_X86_64_ALL = 3
+
+MH_MAGIC_64 = 0xFEEDFACF
+MH_EXECUTE = 0x2
+MH_KEXT_BUNDLE = 0xB
+MH_FILESET = 0xC
+MH_NOUNDEFS = 0x1
+MH_DYLDLINK = 0x4
+MH_PIE = 0x200000
+MH_DYLIB_IN_CACHE = 0x80000000
+
+LC_REQ_DYLD = 0x80000000
+LC_SEGMENT_64 = 0x19
+LC_SYMTAB = 0x2
+LC_DYSYMTAB = 0xB
+LC_DYLD_CHAINED_FIXUPS = 0x34 | LC_REQ_DYLD
+LC_FILESET_ENTRY = 0x35 | LC_REQ_DYLD
+
+N_UNDF = 0x0
+N_EXT = 0x1
+N_SECT = 0xE
+
+X86_64_RELOC_UNSIGNED = 0
+X86_64_RELOC_BRANCH = 2
+
+S_ATTR_PURE_INSTRUCTIONS = 0x80000000
+S_ATTR_SOME_INSTRUCTIONS = 0x400
+
+VM_PROT_READ = 1
+VM_PROT_WRITE = 2
+VM_PROT_EXECUTE = 4
+
+PAGE_SIZE = 0x1000
+
+MACH_HEADER_SIZE = 32
+SEGMENT_SIZE = 72
+SECTION_SIZE = 80
+SYMTAB_SIZE = 24
+DYSYMTAB_SIZE = 80
+NLIST_SIZE = 16
+RELOC_SIZE = 8
+LINKEDIT_DATA_SIZE = 16
+FILESET_ENTRY_SIZE = 32
+CHAINED_FIXUPS_HEADER_SIZE = 28
+
+DYLD_CHAINED_IMPORT = 1
+
+KMOD_INFO_SIZE = 196
+KMOD_MAX_NAME = 64
+
+FUNCTION_SIZE = 16
+
+KERNEL_BASE = 0xFFFFFF8000200000
+KERNEL_VERSION = b'Darwin Kernel Version 20.6.0: Fixture; root:xnu-7195.141.2~1/RELEASE_X86_64\0'
+KPI_IDENTIFIER = 'com.apple.kpi.libkern'
+KERNEL_KEY = '__kernel__'
+KC_KERNEL_IDENTIFIER = 'com.apple.kernel'
+BUNDLE_PREFIX = 'com.example.fixture'
+
+
+def align(value, alignment=PAGE_SIZE):
+    return (value + alignment - 1) & ~(alignment - 1)
+
+
+def pad(data, size, fill=b'\0'):
+    assert len(data) <= size
+    return data + fill * (size - len(data))
+
+
+def name16(name):
+    return pad(name.encode('ascii'), 16)
+
+
+class Segment:
+    def __init__(self, name, vmaddr, fileoff, data, vmsize=None, prot=VM_PROT_READ):
+        self.name = name
+        self.vmaddr = vmaddr
+        self.fileoff = fileoff
+        self.data = data
+        self.vmsize = align(len(data)) if vmsize is None else vmsize
+        self.prot = prot
+        self.sections = []
+
+    def add_section(self, name, offset, size, flags=0, reloff=0, nreloc=0, alignment=4):
+        self.sections.append((name, offset, size, flags, reloff, nreloc, alignment))
+
+    def command(self):
+        cmd = struct.pack('<II16sQQQQiiII',
+                          LC_SEGMENT_64,
+                          SEGMENT_SIZE + SECTION_SIZE * len(self.sections),
+                          name16(self.name),
+                          self.vmaddr,
+                          self.vmsize,
+                          self.fileoff,
+                          len(self.data),
+                          self.prot,
+                          self.prot,
+                          len(self.sections),
+                          0)
+        for name, offset, size, flags, reloff, nreloc, alignment in self.sections:
+            cmd += struct.pack('<16s16sQQIIIIIIII',
+                               name16(name),
+                               name16(self.name),
+                               self.vmaddr + offset,
+                               size,
+                               self.fileoff + offset,
+                               alignment,
+                               reloff,
+                               nreloc,
+                               flags,
+                               0,
+                               0,
+                               0)
+        return cmd
+
+
+class SymbolTable:
+    """
+    Symbols are emitted in dysymtab order: locals, defined externals, undefined.
+    """
+
+    def __init__(self):
+        self.locals = []
+        self.externals = []
+        self.undefined = []
+
+    def add_local(self, name, section, value):
+        self.locals.append((name, N_SECT, section, value))
+
+    def add_external(self, name, section, value):
+        self.externals.append((name, N_SECT | N_EXT, section, value))
+
+    def add_undefined(self, name):
+        self.undefined.append((name, N_UNDF | N_EXT, 0, 0))
+
+    def sort(self):
+        self.externals.sort()
+        self.undefined.sort()
+
+    def count(self):
+        return len(self.locals) + len(self.externals) + len(self.undefined)
+
+    def index(self, name):
+        for index, symbol in enumerate(self.locals + self.externals + self.undefined):
+            if symbol[0] == name:
+                return index
+        raise KeyError(name)
+
+    def build(self):
+        strtab = bytearray(b' \0')
+        symtab = bytearray()
+        for name, type_, section, value in self.locals + self.externals + self.undefined:
+            symtab += struct.pack('<IBBhQ', len(strtab), type_, section, 0, value)
+            strtab += name.encode('ascii') + b'\0'
+        return bytes(symtab), bytes(pad(strtab, align(len(strtab), 8)))
+
+    def dysymtab(self, extreloff=0, nextrel=0, locreloff=0, nlocrel=0):
+        nlocal = len(self.locals)
+        nextdef = len(self.externals)
+        return struct.pack('<II' + 'I' * 18,
+                           LC_DYSYMTAB,
+                           DYSYMTAB_SIZE,
+                           0, nlocal,
+                           nlocal, nextdef,
+                           nlocal + nextdef, len(self.undefined),
+                           0, 0,
+                           0, 0,
+                           0, 0,
+                           0, 0,
+                           extreloff, nextrel,
+                           locreloff, nlocrel)
+
+
+def symtab_command(symoff, nsyms, stroff, strsize):
+    return struct.pack('<IIIIII', LC_SYMTAB, SYMTAB_SIZE, symoff, nsyms, stroff, strsize)
+
+
+def mach_header(filetype, commands, flags):
+    return struct.pack('<IiiIIIII',
+                       MH_MAGIC_64,
+                       CPU_TYPE_X86_64,
+                       CPU_SUBTYPE_X86_64_ALL,
+                       filetype,
+                       len(commands),
+                       sum(len(command) for command in commands),
+                       flags,
+                       0)
+
+
+def header_size(segments, extra):
+    size = MACH_HEADER_SIZE + extra
+    for segment in segments:
+        size += SEGMENT_SIZE + SECTION_SIZE * segment[1]
+    return size
+
+
+def functions(count, opcode=b'\x31\xC0\xC3'):
+    """
+    Emit count functions returning zero, each FUNCTION_SIZE bytes long.
+    """
+    return pad(opcode, FUNCTION_SIZE, b'\xCC') * count
+
+
+def kmod_info(identifier, version):
+    return struct.pack('<QiI64s64si',
+                       0,
+                       1,
+                       0,
+                       pad(identifier.encode('ascii'), KMOD_MAX_NAME),
+                       pad(version.encode('ascii'), KMOD_MAX_NAME),
+                       -1) + b'\0' * (KMOD_INFO_SIZE - 8 - 4 - 4 - KMOD_MAX_NAME * 2 - 4)
+
+
+def linked_kext_layout(exports):
+    """
+    Returns header, __TEXT and __DATA sizes of a linked kext.
+    """
+    hdr = align(header_size([('__TEXT', 1), ('__DATA', 1), ('__LINKEDIT', 0)], SYMTAB_SIZE + DYSYMTAB_SIZE))
+    text_size = align(hdr + exports * FUNCTION_SIZE)
+    data_size = align(KMOD_INFO_SIZE)
+    return hdr, text_size, data_size
+
+
+def linked_kext_symbols(identifier, exports, base):
+    """
+    Returns symbol table, list of exported names, and kmod_info address of
+    a kext linked at base.
+    """
+    hdr, text_size, _ = linked_kext_layout(exports)
+    names = ['_%s_func%05d' % (identifier.rsplit('.', 1)[-1], index) for index in range(exports)]
+
+    symbols = SymbolTable()
+    symbols.add_external('_kmod_info', 2, base + text_size)
+    for index, name in enumerate(names):
+        symbols.add_external(name, 1, base + hdr + index * FUNCTION_SIZE)
+    symbols.sort()
+    return symbols, names, base + text_size
+
+
+def build_linked_kext(identifier, exports, base, fileoff=0, linkedit=None):
+    """
+    Build a kext linked at base as found within __PRELINK_TEXT.
+    Returns image, list of exported names, and kmod_info address.
+
+    For kernel collections fileoff is the kext offset within the collection
+    and linkedit is a tuple of joint __LINKEDIT segment, symbol table offset,
+    and string table offset. In this case the returned image has no symbols.
+    """
+    hdr, text_size, data_size = linked_kext_layout(exports)
+    text = bytes(hdr) + functions(exports)
+    data = kmod_info(identifier, '1.0.0')
+
+    symbols, names, kmod = linked_kext_symbols(identifier, exports, base)
+    symtab, strtab = symbols.build()
+
+    if linkedit is None:
+        linkedit_off = text_size + data_size
+        symoff = linkedit_off
+        stroff = linkedit_off + len(symtab)
+        linkedit_seg = Segment('__LINKEDIT', base + linkedit_off, linkedit_off, symtab + strtab)
+        flags = MH_NOUNDEFS
+    else:
+        linkedit_seg, symoff, stroff = linkedit
+        flags = MH_NOUNDEFS | MH_DYLIB_IN_CACHE
+
+    text_seg = Segment('__TEXT', base, fileoff, pad(text, text_size), prot=VM_PROT_READ | VM_PROT_EXECUTE)
+    text_seg.add_section('__text', hdr, exports * FUNCTION_SIZE, S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)
+    data_seg = Segment('__DATA', base + text_size, fileoff + text_size, pad(data, data_size),
+                       prot=VM_PROT_READ | VM_PROT_WRITE)
+    data_seg.add_section('__data', 0, len(data), alignment=3)
+
+    commands = [
+        text_seg.command(),
+        data_seg.command(),
+        linkedit_seg.command(),
+        symtab_command(symoff, symbols.count(), stroff, len(strtab)),
+        symbols.dysymtab()
+    ]
+    header = mach_header(MH_KEXT_BUNDLE, commands, flags)
+    header += b''.join(commands)
+    assert len(header) <= hdr
+
+    image = bytearray(pad(text, text_size))
+    image[:len(header)] = header
+    image += pad(data, data_size)
+    if linkedit is None:
+        image += linkedit_seg.data
+
+    return bytes(image), names, kmod
+
+
+def build_injected_kext(identifier, exports, imports, relocs, rng):
+    """
+    Build an unlinked kext referencing imports through external relocations.
+    Half of the relocations are call sites in __text, the rest are data
+    pointers. Every fourth relocation is a local pointer to own code.
+    """
+    hdr = align(header_size([('__TEXT', 1), ('__DATA', 1), ('__LINKEDIT', 0)], SYMTAB_SIZE + DYSYMTAB_SIZE))
+
+    nlocal = relocs // 4
+    nextern = relocs - nlocal
+    ncalls = nextern // 2
+    npointers = nextern - ncalls
+
+    #
+    # Each call site is a separate function: call rel32; xor eax, eax; ret.
+    #
+    code = functions(exports)
+    call_sites = []
+    for index in range(ncalls):
+        call_sites.append(hdr + len(code) + 1)
+        code += pad(b'\xE8\0\0\0\0\x31\xC0\xC3', FUNCTION_SIZE, b'\xCC')
+
+    text = bytes(hdr) + code
+    text_size = align(len(text))
+
+    data = kmod_info(identifier, '1.0.0')
+    data = bytearray(pad(data, align(len(data), 8)))
+    pointer_base = len(data)
+    data += b'\0' * 8 * (npointers + nlocal)
+    data_size = align(len(data))
+
+    names = ['_%s_func%05d' % (identifier.rsplit('.', 1)[-1], index) for index in range(exports)]
+
+    targets = [rng.choice(imports) for _ in range(ncalls + npointers)] if imports else []
+    undefined = sorted(set(targets))
+
+    symbols = SymbolTable()
+    symbols.add_external('_kmod_info', 2, text_size)
+    for index, name in enumerate(names):
+        symbols.add_external(name, 1, hdr + index * FUNCTION_SIZE)
+    for name in undefined:
+        symbols.add_undefined(name)
+    symbols.sort()
+
+    extrel = bytearray()
+    for index, address in enumerate(call_sites):
+        symbolnum = symbols.index(targets[index]) if targets else 0
+        extrel += struct.pack('<iI', address, symbolnum | (1 << 24) | (2 << 25) | (1 << 27) | (X86_64_RELOC_BRANCH << 28))
+    for index in range(npointers):
+        symbolnum = symbols.index(targets[ncalls + index]) if targets else 0
+        extrel += struct.pack('<iI', text_size + pointer_base + index * 8, symbolnum | (3 << 25) | (1 << 27) | (X86_64_RELOC_UNSIGNED << 28))
+
+    locrel = bytearray()
+    for index in range(nlocal):
+        offset = pointer_base + (npointers + index) * 8
+        target = hdr + (index % max(exports, 1)) * FUNCTION_SIZE
+        struct.pack_into('<Q', data, offset, target)
+        locrel += struct.pack('<iI', text_size + offset, 1 | (3 << 25) | (X86_64_RELOC_UNSIGNED << 28))
+
+    symtab, strtab = symbols.build()
+
+    linkedit_off = text_size + data_size
+    locreloff = linkedit_off
+    symoff = locreloff + len(locrel)
+    extreloff = symoff + len(symtab)
+    stroff = extreloff + len(extrel)
+    linkedit = bytes(locrel) + symtab + bytes(extrel) + strtab
+
+    text_seg = Segment('__TEXT', 0, 0, pad(text, text_size), prot=VM_PROT_READ | VM_PROT_EXECUTE)
+    text_seg.add_section('__text', hdr, len(code), S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)
+    data_seg = Segment('__DATA', text_size, text_size, pad(bytes(data), data_size), prot=VM_PROT_READ | VM_PROT_WRITE)
+    data_seg.add_section('__data', 0, len(data), alignment=3)
+    linkedit_seg = Segment('__LINKEDIT', linkedit_off, linkedit_off, linkedit)
+
+    commands = [
+        text_seg.command(),
+        data_seg.command(),
+        linkedit_seg.command(),
+        symtab_command(symoff, symbols.count(), stroff, len(strtab)),
+        symbols.dysymtab(extreloff, len(extrel) // RELOC_SIZE, locreloff, nlocal)
+    ]
+    header = mach_header(MH_KEXT_BUNDLE, commands, MH_DYLDLINK)
+    header += b''.join(commands)
+
+    image = bytearray(pad(text, text_size))
+    image[:len(header)] = header
+    image += pad(bytes(data), data_size)
+    image += linkedit
+
+    return bytes(image)
+
+
+class PlistWriter:
+    """
+    Emit plist XML the way kextcache does, reusing repeated strings via IDREF.
+    """
+
+    def __init__(self, refs, document=False):
+        self.refs = refs
+        self.document = document
+        self.ids = {}
+        self.out = []
+
+    def string(self, value):
+        if not self.refs:
+            return '<string>%s</string>' % value
+        if value in self.ids:
+            return '<string IDREF="%u"/>' % self.ids[value]
+        self.ids[value] = len(self.ids)
+        return '<string ID="%u">%s</string>' % (self.ids[value], value)
+
+    def integer(self, value):
+        return '<integer size="64">0x%x</integer>' % value
+
+    def kext(self, identifier, version, libraries, exe=None):
+        entries = [
+            ('CFBundleIdentifier', '<string>%s</string>' % identifier),
+            ('CFBundleInfoDictionaryVersion', self.string('6.0')),
+            ('CFBundleName', '<string>%s</string>' % identifier.rsplit('.', 1)[-1]),
+            ('CFBundlePackageType', self.string('KEXT')),
+            ('CFBundleVersion', self.string(version)),
+            ('OSBundleCompatibleVersion', self.string(version)),
+            ('OSBundleLibraries', '<dict>' + ''.join(
+                '<key>%s</key>%s' % (library, self.string('1.0.0')) for library in libraries) + '</dict>'),
+            ('IOKitPersonalities', '<dict><key>%s</key><dict><key>IOClass</key>%s'
+             '<key>IOProviderClass</key>%s<key>CFBundleIdentifier</key><string>%s</string></dict></dict>'
+             % (identifier.rsplit('.', 1)[-1], self.string('IOService'), self.string('IOResources'), identifier)),
+            ('_PrelinkBundlePath', '<string>/System/Library/Extensions/%s.kext</string>' % identifier.rsplit('.', 1)[-1]),
+        ]
+        if exe is not None:
+            load_addr, size, kmod = exe
+            entries += [
+                ('CFBundleExecutable', '<string>%s</string>' % identifier.rsplit('.', 1)[-1]),
+                ('_PrelinkExecutableRelativePath', '<string>Contents/MacOS/%s</string>' % identifier.rsplit('.', 1)[-1]),
+                ('_PrelinkExecutableLoadAddr', self.integer(load_addr)),
+                ('_PrelinkExecutableSourceAddr', self.integer(load_addr)),
+                ('_PrelinkExecutableSize', self.integer(size)),
+                ('_PrelinkKmodInfo', self.integer(kmod)),
+            ]
+        self.out.append('<dict>' + ''.join('<key>%s</key>%s' % entry for entry in entries) + '</dict>')
+
+    def build(self):
+        info = '<dict><key>_PrelinkInfoDictionary</key><array>' + ''.join(self.out) + '</array></dict>'
+        if self.document:
+            #
+            # Kernel collections carry a complete plist document.
+            #
+            info = ('<?xml version="1.0" encoding="UTF-8"?>\n'
+                    '<!DOCTYPE plist PUBLIC "-//Apple//DTD PLIST 1.0//EN" "http://www.apple.com/DTDs/PropertyList-1.0.dtd">\n'
+                    '<plist version="1.0">' + info + '</plist>\n')
+        return (info + '\0').encode('ascii')
+
+
+def info_plist(identifier, libraries):
+    items = ''.join('\t\t<key>%s</key>\n\t\t<string>1.0.0</string>\n' % library for library in libraries)
+    name = identifier.rsplit('.', 1)[-1]
+    return ('<?xml version="1.0" encoding="UTF-8"?>\n'
+            '<!DOCTYPE plist PUBLIC "-//Apple//DTD PLIST 1.0//EN" "http://www.apple.com/DTDs/PropertyList-1.0.dtd">\n'
+            '<plist version="1.0">\n<dict>\n'
+            '\t<key>CFBundleExecutable</key>\n\t<string>%s</string>\n'
+            '\t<key>CFBundleIdentifier</key>\n\t<string>%s</string>\n'
+            '\t<key>CFBundleInfoDictionaryVersion</key>\n\t<string>6.0</string>\n'
+            '\t<key>CFBundleName</key>\n\t<string>%s</string>\n'
+            '\t<key>CFBundlePackageType</key>\n\t<string>KEXT</string>\n'
+            '\t<key>CFBundleVersion</key>\n\t<string>1.0.0</string>\n'
+            '\t<key>OSBundleLibraries</key>\n\t<dict>\n%s\t</dict>\n'
+            '\t<key>OSBundleRequired</key>\n\t<string>Root</string>\n'
+            '</dict>\n</plist>\n' % (name, identifier, name, items)).encode('ascii')
+
+
+def build_prelinkedkernel(args, rng):
+    """
+    Build prelinkedkernel with kernel symbols and prelinked kexts.
+    Returns image and mapping of prelinked kext identifiers to exports.
+    """
+    layout = [('__TEXT', 1), ('__DATA', 1), ('__LINKEDIT', 0), ('__PRELINK_TEXT', 1), ('__PRELINK_INFO', 1)]
+    hdr = align(header_size(layout, SYMTAB_SIZE + DYSYMTAB_SIZE))
+
+    kernel_names = ['_IOLog'] + ['_fixture_kernel_func%05d' % index for index in range(args.symbols)]
+    text = bytes(hdr) + KERNEL_VERSION
+    text = pad(text, align(len(text), FUNCTION_SIZE))
+    code_off = len(text)
+    text += functions(len(kernel_names))
+    text_size = align(len(text))
+
+    data = b'\0' * PAGE_SIZE
+    data_off = text_size
+
+    symbols = SymbolTable()
+    for index, name in enumerate(kernel_names):
+        symbols.add_external(name, 1, KERNEL_BASE + code_off + index * FUNCTION_SIZE)
+    symbols.sort()
+    symtab, strtab = symbols.build()
+
+    linkedit_off = data_off + len(data)
+    linkedit = symtab + strtab
+    linkedit_size = align(len(linkedit))
+
+    #
+    # Prelinked kexts are stored back to back, identity mapped like the kernel.
+    #
+    prelink_text_off = linkedit_off + linkedit_size
+    prelink_text = bytearray()
+    plist = PlistWriter(not args.no_refs)
+    kexts = {}
+
+    for index in range(args.kexts):
+        identifier = '%s.kext%03d' % (BUNDLE_PREFIX, index)
+        base = KERNEL_BASE + prelink_text_off + len(prelink_text)
+        image, names, kmod = build_linked_kext(identifier, args.exports, base)
+        plist.kext(identifier, '1.0.0', [KPI_IDENTIFIER], (base, align(len(image)), kmod))
+        prelink_text += pad(image, align(len(image)))
+        kexts[identifier] = names
+
+    for index in range(args.plist_kexts):
+        identifier = '%s.plist%03d' % (BUNDLE_PREFIX, index)
+        plist.kext(identifier, '1.0.0', [KPI_IDENTIFIER])
+
+    if not prelink_text:
+        prelink_text = bytearray(PAGE_SIZE)
+
+    prelink_info_off = prelink_text_off + len(prelink_text)
+    info = plist.build()
+
+    text_seg = Segment('__TEXT', KERNEL_BASE, 0, pad(text, text_size), prot=VM_PROT_READ | VM_PROT_EXECUTE)
+    text_seg.add_section('__text', code_off, len(text) - code_off, S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)
+    data_seg = Segment('__DATA', KERNEL_BASE + data_off, data_off, data, prot=VM_PROT_READ | VM_PROT_WRITE)
+    data_seg.add_section('__data', 0, len(data), alignment=3)
+    linkedit_seg = Segment('__LINKEDIT', KERNEL_BASE + linkedit_off, linkedit_off, linkedit)
+    prelink_text_seg = Segment('__PRELINK_TEXT', KERNEL_BASE + prelink_text_off, prelink_text_off, prelink_text,
+                               prot=VM_PROT_READ | VM_PROT_WRITE | VM_PROT_EXECUTE)
+    prelink_text_seg.add_section('__text', 0, len(prelink_text))
+    prelink_info_seg = Segment('__PRELINK_INFO', KERNEL_BASE + prelink_info_off, prelink_info_off, info,
+                               prot=VM_PROT_READ | VM_PROT_WRITE)
+    prelink_info_seg.add_section('__info', 0, len(info))
+
+    commands = [
+        text_seg.command(),
+        data_seg.command(),
+        linkedit_seg.command(),
+        prelink_text_seg.command(),
+        prelink_info_seg.command(),
+        symtab_command(linkedit_off, symbols.count(), linkedit_off + len(symtab), len(strtab)),
+        symbols.dysymtab()
+    ]
+    header = mach_header(MH_EXECUTE, commands, MH_NOUNDEFS | MH_PIE)
+    header += b''.join(commands)
+    assert len(header) <= hdr
+
+    image = bytearray(pad(text, text_size))
+    image[:len(header)] = header
+    image += data
+    image += pad(linkedit, linkedit_size)
+    image += prelink_text
+    image += info
+
+    kexts[KERNEL_KEY] = kernel_names
+    return bytes(image), kexts
+
+
+def fileset_entry_command(identifier, vmaddr, fileoff):
+    payload = identifier.encode('ascii') + b'\0'
+    size = align(FILESET_ENTRY_SIZE + len(payload), 8)
+    return struct.pack('<IIQQII', LC_FILESET_ENTRY, size, vmaddr, fileoff, FILESET_ENTRY_SIZE, 0) + \
+        pad(payload, size - FILESET_ENTRY_SIZE)
+
+
+def chained_fixups(segments):
+    """
+    Build an empty chained fixups header with a spare segment slot for
+    the injected kexts.
+    """
+    starts_offset = align(CHAINED_FIXUPS_HEADER_SIZE, 8)
+    starts = struct.pack('<I', segments + 1) + b'\0' * 4 * (segments + 1)
+    end = align(starts_offset + len(starts), 8)
+    header = struct.pack('<IIIIIII', 0, starts_offset, end, end, 0, DYLD_CHAINED_IMPORT, 0)
+    return pad(pad(header, starts_offset) + starts, end)
+
+
+def build_kernel_collection(args, rng):
+    """
+    Build kernel collection with kernel symbols and prelinked kexts.
+    Returns image and mapping of prelinked kext identifiers to exports.
+
+    The collection is identity mapped at KERNEL_BASE and laid out as
+    __TEXT (collection header), __PRELINK_INFO, __TEXT_EXEC (kernel),
+    __REGION0 (kexts), and __LINKEDIT (joint symbol tables), which must
+    be the last segment for injection.
+    """
+    outer_layout = [('__TEXT', 0), ('__PRELINK_INFO', 1), ('__TEXT_EXEC', 1), ('__REGION0', 0), ('__LINKEDIT', 0)]
+    inner_layout = [('__TEXT_EXEC', 1), ('__PRELINK_INFO', 1), ('__LINKEDIT', 0)]
+
+    kext_ids = ['%s.kext%03d' % (BUNDLE_PREFIX, index) for index in range(args.kexts)]
+    filesets = sum(align(FILESET_ENTRY_SIZE + len(identifier) + 1, 8) for identifier in [KC_KERNEL_IDENTIFIER] + kext_ids)
+    #
+    # Leave room in __TEXT for the commands added when injecting kexts.
+    #
+    text_size = align(header_size(outer_layout, filesets + LINKEDIT_DATA_SIZE) + PAGE_SIZE + args.inject * 128)
+
+    #
+    # Kernel in __TEXT_EXEC starting with its own Mach-O header.
+    #
+    kernel_names = ['_IOLog'] + ['_fixture_kernel_func%05d' % index for index in range(args.symbols)]
+    kernel_hdr = header_size(inner_layout, SYMTAB_SIZE + DYSYMTAB_SIZE)
+    kernel = pad(bytes(kernel_hdr) + KERNEL_VERSION, align(kernel_hdr + len(KERNEL_VERSION), FUNCTION_SIZE))
+    code_off = len(kernel)
+    kernel += functions(len(kernel_names))
+    kernel_size = align(len(kernel))
+
+    #
+    # Prelinked kexts are stored back to back in __REGION0.
+    #
+    region_sizes = []
+    for identifier in kext_ids:
+        _, kext_text_size, kext_data_size = linked_kext_layout(args.exports)
+        region_sizes.append(kext_text_size + kext_data_size)
+    region_size = max(sum(region_sizes), PAGE_SIZE)
+
+    #
+    # All kext addresses have the same amount of hex digits, so the size of
+    # __PRELINK_INFO is known before the kexts are placed.
+    #
+    plist = PlistWriter(False, True)
+    for identifier, size in zip(kext_ids, region_sizes):
+        plist.kext(identifier, '1.0.0', [KPI_IDENTIFIER], (KERNEL_BASE, size, KERNEL_BASE))
+    for index in range(args.plist_kexts):
+        plist.kext('%s.plist%03d' % (BUNDLE_PREFIX, index), '1.0.0', [KPI_IDENTIFIER])
+    info_size = align(len(plist.build()))
+
+    info_off = text_size
+    kernel_off = info_off + info_size
+    region_off = kernel_off + kernel_size
+    linkedit_off = region_off + region_size
+
+    symbols = SymbolTable()
+    for index, name in enumerate(kernel_names):
+        symbols.add_external(name, 1, KERNEL_BASE + kernel_off + code_off + index * FUNCTION_SIZE)
+    symbols.sort()
+    symtab, strtab = symbols.build()
+
+    #
+    # Joint __LINKEDIT: kernel symbols, kext symbols, chained fixups.
+    #
+    linkedit = bytearray(symtab + strtab)
+    kext_bases = []
+    kext_symtabs = []
+    base = KERNEL_BASE + region_off
+    for identifier, size in zip(kext_ids, region_sizes):
+        kext_symbols, _, _ = linked_kext_symbols(identifier, args.exports, base)
+        kext_symtab, kext_strtab = kext_symbols.build()
+        kext_bases.append(base)
+        kext_symtabs.append((linkedit_off + len(linkedit), linkedit_off + len(linkedit) + len(kext_symtab)))
+        linkedit += kext_symtab + kext_strtab
+        base += size
+
+    fixups_off = linkedit_off + len(linkedit)
+    fixups = chained_fixups(len(outer_layout))
+    linkedit += fixups
+    linkedit = bytes(pad(bytes(linkedit), align(len(linkedit))))
+    linkedit_seg = Segment('__LINKEDIT', KERNEL_BASE + linkedit_off, linkedit_off, linkedit)
+
+    region = bytearray()
+    kexts = {}
+    plist = PlistWriter(False, True)
+    for identifier, base, (symoff, stroff) in zip(kext_ids, kext_bases, kext_symtabs):
+        image, names, kmod = build_linked_kext(identifier, args.exports, base, region_off + len(region),
+                                               (linkedit_seg, symoff, stroff))
+        plist.kext(identifier, '1.0.0', [KPI_IDENTIFIER], (base, len(image), kmod))
+        region += image
+        kexts[identifier] = names
+
+    for index in range(args.plist_kexts):
+        plist.kext('%s.plist%03d' % (BUNDLE_PREFIX, index), '1.0.0', [KPI_IDENTIFIER])
+
+    info = plist.build()
+    assert align(len(info)) == info_size
+    region = pad(bytes(region), region_size)
+
+    info_seg = Segment('__PRELINK_INFO', KERNEL_BASE + info_off, info_off, pad(info, info_size),
+                       prot=VM_PROT_READ | VM_PROT_WRITE)
+    info_seg.add_section('__info', 0, len(info))
+    kernel_seg = Segment('__TEXT_EXEC', KERNEL_BASE + kernel_off, kernel_off, pad(kernel, kernel_size),
+                         prot=VM_PROT_READ | VM_PROT_EXECUTE)
+    kernel_seg.add_section('__text', code_off, len(kernel) - code_off, S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)
+    region_seg = Segment('__REGION0', KERNEL_BASE + region_off, region_off, region,
+                         prot=VM_PROT_READ | VM_PROT_WRITE | VM_PROT_EXECUTE)
+
+    inner_commands = [
+        kernel_seg.command(),
+        info_seg.command(),
+        linkedit_seg.command(),
+        symtab_command(linkedit_off, symbols.count(), linkedit_off + len(symtab), len(strtab)),
+        symbols.dysymtab()
+    ]
+    inner_header = mach_header(MH_EXECUTE, inner_commands, MH_NOUNDEFS | MH_PIE) + b''.join(inner_commands)
+    assert len(inner_header) <= code_off
+    kernel = bytearray(kernel_seg.data)
+    kernel[:len(inner_header)] = inner_header
+
+    text_seg = Segment('__TEXT', KERNEL_BASE, 0, bytes(text_size), prot=VM_PROT_READ)
+    outer_commands = [
+        text_seg.command(),
+        info_seg.command(),
+        kernel_seg.command(),
+        region_seg.command(),
+        linkedit_seg.command(),
+        struct.pack('<IIII', LC_DYLD_CHAINED_FIXUPS, LINKEDIT_DATA_SIZE, fixups_off, len(fixups)),
+        fileset_entry_command(KC_KERNEL_IDENTIFIER, KERNEL_BASE + kernel_off, kernel_off)
+    ]
+    for identifier, base in zip(kext_ids, kext_bases):
+        outer_commands.append(fileset_entry_command(identifier, base, base - KERNEL_BASE))
+    outer_header = mach_header(MH_FILESET, outer_commands, MH_NOUNDEFS | MH_PIE) + b''.join(outer_commands)
+    assert len(outer_header) <= text_size - PAGE_SIZE
+
+    image = bytearray(text_size)
+    image[:len(outer_header)] = outer_header
+    image += info_seg.data
+    image += kernel
+    image += region
+    image += linkedit
+
+    kexts[KERNEL_KEY] = kernel_names
+    return bytes(image), kexts
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate synthetic prelinkedkernel and kexts for KextInject.')
+    parser.add_argument('output', help='output directory')
+    parser.add_argument('--symbols', type=int, default=20000, help='kernel symbol count')
+    parser.add_argument('--kexts', type=int, default=200, help='prelinked kext count')
+    parser.add_argument('--plist-kexts', type=int, default=50, help='prelinked kexts without executable')
+    parser.add_argument('--exports', type=int, default=64, help='symbols exported by each prelinked kext')
+    parser.add_argument('--inject', type=int, default=8, help='kext count to inject')
+    parser.add_argument('--relocs', type=int, default=512, help='relocations per injected kext')
+    parser.add_argument('--deps', type=int, default=3, help='prelinked dependencies per injected kext')
+    parser.add_argument('--no-refs', action='store_true', help='do not use ID/IDREF in prelinked info')
+    parser.add_argument('--seed', type=int, default=0, help='random seed')
+    parser.add_argument('--kc', action='store_true', help='generate kernel collection instead of prelinkedkernel')
+    args = parser.parse_args()
+
+    if min(args.symbols, args.kexts, args.plist_kexts, args.exports, args.inject, args.relocs, args.deps) < 0:
+        parser.error('counts must not be negative')
+
+    rng = random.Random(args.seed)
+    os.makedirs(args.output, exist_ok=True)
+
+    if args.kc:
+        prelinked, kexts = build_kernel_collection(args, rng)
+        kernel_path = os.path.join(args.output, 'BootKernelExtensions.kc')
+    else:
+        prelinked, kexts = build_prelinkedkernel(args, rng)
+        kernel_path = os.path.join(args.output, 'prelinkedkernel')
+    with open(kernel_path, 'wb') as fh:
+        fh.write(prelinked)
+
+    prelinked_ids = sorted(identifier for identifier in kexts if identifier != KERNEL_KEY)
+    command = [os.path.join('.', 'KextInject'), '-b', '10', kernel_path]
+
+    for index in range(args.inject):
+        identifier = '%s.inject%03d' % (BUNDLE_PREFIX, index)
+        deps = rng.sample(prelinked_ids, min(args.deps, len(prelinked_ids)))
+        imports = list(kexts[KERNEL_KEY])
+        for dep in deps:
+            imports += kexts[dep]
+
+        image = build_injected_kext(identifier, 16, imports, args.relocs, rng)
+        plist = info_plist(identifier, [KPI_IDENTIFIER] + deps)
+
+        exe_path = os.path.join(args.output, 'Inject%03d' % index)
+        plist_path = os.path.join(args.output, 'Inject%03d.plist' % index)
+        with open(exe_path, 'wb') as fh:
+            fh.write(image)
+        with open(plist_path, 'wb') as fh:
+            fh.write(plist)
+        command += [exe_path, plist_path]
+
+    print('Generated %u bytes %s with %u kexts, %u to inject' % (len(prelinked), os.path.basename(kernel_path), len(kexts) - 1 + args.plist_kexts, args.inject))
+    print(' '.join(command))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,272 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcMiscLib.h>
+
+#include <sys/time.h>
+
+//
+// Synthetic buffer size, close to a fully unpacked kernel collection.
+//
+#define PATTERN_SEARCH_DATA_SIZE  SIZE_64MB
+
+//
+// Amount of full buffer scans per measurement.
+//
+#define PATTERN_SEARCH_ITERATIONS  8
+
+STATIC CONST UINT8  mPattern[] = {
+  0x55, 0x48, 0x89, 0xE5, 0x41, 0x57, 0x41, 0x56,
+  0x41, 0x55, 0x41, 0x54, 0x53, 0x48, 0x83, 0xEC
+};
+
+//
+// Masked search pattern, matching mPattern.
+//
+STATIC CONST UINT8  mMaskedPattern[] = {
+  0x55, 0x48, 0x89, 0xE5, 0x41, 0x50, 0x00, 0x00,
+  0x41, 0x55, 0x41, 0x54, 0x53, 0x48, 0x83, 0xEC
+};
+
+STATIC CONST UINT8  mPatternMask[] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0, 0x00, 0x00,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+//
+// Fully masked out patterns. Only the zero pattern matches, as
+// (Data & 0) never equals a nonzero pattern byte.
+//
+STATIC CONST UINT8  mZeroPattern[sizeof (mPattern)];
+
+STATIC CONST UINT8  mZeroMask[sizeof (mPattern)];
+
+STATIC CONST CHAR8  *mModeNames[] = {
+  "scalar",
+  "sse2",
+  "avx2"
+};
+
+STATIC
+UINT64
+GetCurrentTimestampUs (
+  VOID
+  )
+{
+  struct timeval  Time;
+
+  gettimeofday (&Time, NULL);
+  return Time.tv_sec * 1000000ULL + Time.tv_usec;
+}
+
+/**
+  Fill buffer with reproducible pseudo-random data.
+
+  @param[out] Data      Buffer to fill.
+  @param[in]  DataSize  Buffer size.
+**/
+STATIC
+VOID
+FillSyntheticData (
+  OUT UINT8   *Data,
+  IN  UINT32  DataSize
+  )
+{
+  UINT64  State;
+  UINT32  Index;
+
+  State = 0x9E3779B97F4A7C15ULL;
+  for (Index = 0; Index < DataSize; ++Index) {
+    State      ^= State << 13U;
+    State      ^= State >> 7U;
+    State      ^= State << 17U;
+    Data[Index] = (UINT8)State;
+  }
+}
+
+/**
+  Measure pattern search throughput.
+
+  @param[in]  Data         Buffer to search in.
+  @param[in]  DataSize     Buffer size.
+  @param[in]  PatternMask  Pattern mask, optional.
+  @param[out] Offset       Found pattern offset.
+
+  @return  Throughput in MB/s.
+**/
+STATIC
+UINT64
+MeasureSearch (
+  IN  CONST UINT8  *Data,
+  IN  UINT32       DataSize,
+  IN  CONST UINT8  *PatternMask OPTIONAL,
+  OUT UINT32       *Offset
+  )
+{
+  UINT32  Iteration;
+  UINT64  Start;
+  UINT64  Elapsed;
+
+  Start = GetCurrentTimestampUs ();
+  for (Iteration = 0; Iteration < PATTERN_SEARCH_ITERATIONS; ++Iteration) {
+    *Offset = 0;
+    if (!FindPattern (
+           PatternMask != NULL ? mMaskedPattern : mPattern,
+           PatternMask,
+           sizeof (mPattern),
+           Data,
+           DataSize,
+           Offset
+           ))
+    {
+      *Offset = MAX_UINT32;
+    }
+  }
+
+  Elapsed = GetCurrentTimestampUs () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  //
+  // Bytes per microsecond equal megabytes per second.
+  //
+  return (UINT64)DataSize * PATTERN_SEARCH_ITERATIONS / Elapsed;
+}
+
+/**
+  Compare fully masked out pattern search with the scalar implementation.
+
+  @param[in] Mode      Pattern search implementation to check.
+  @param[in] Data      Buffer to search in.
+  @param[in] DataSize  Buffer size, larger than vector search threshold.
+
+  @return  TRUE when all results match.
+**/
+STATIC
+BOOLEAN
+CheckMaskedOutSearch (
+  IN OC_PATTERN_SEARCH_MODE  Mode,
+  IN CONST UINT8             *Data,
+  IN UINT32                  DataSize
+  )
+{
+  CONST UINT8  *Pattern;
+  UINT32       Index;
+  UINT32       Start;
+  UINT32       Expected;
+  UINT32       Offset;
+  BOOLEAN      ExpectedFound;
+  BOOLEAN      Found;
+
+  for (Index = 0; Index < 2; ++Index) {
+    Pattern = Index == 0 ? mZeroPattern : mPattern;
+
+    for (Start = 0; Start < 32; ++Start) {
+      OcSetPatternSearchMode (OcPatternSearchScalar);
+      Expected      = Start;
+      ExpectedFound = FindPattern (Pattern, mZeroMask, sizeof (mPattern), Data, DataSize, &Expected);
+
+      OcSetPatternSearchMode (Mode);
+      Offset = Start;
+      Found  = FindPattern (Pattern, mZeroMask, sizeof (mPattern), Data, DataSize, &Offset);
+
+      if ((Found != ExpectedFound) || (Found && (Offset != Expected))) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "[FAIL] %a %a masked out search at %u - %d/%u vs %d/%u\n",
+          mModeNames[Mode],
+          Index == 0 ? "zero" : "nonzero",
+          Start,
+          Found,
+          Offset,
+          ExpectedFound,
+          Expected
+          ));
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+int
+ENTRY_POINT (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINT8                   *Data;
+  UINT32                  DataSize;
+  UINT32                  Mode;
+  OC_PATTERN_SEARCH_MODE  UsedMode;
+  UINT32                  Masked;
+  UINT32                  Offset;
+  UINT64                  Speed;
+  int                     RetVal;
+
+  DataSize = PATTERN_SEARCH_DATA_SIZE;
+  Data     = AllocatePool (DataSize);
+  if (Data == NULL) {
+    DEBUG ((DEBUG_ERROR, "Failed to allocate %u bytes\n", DataSize));
+    return -1;
+  }
+
+  //
+  // Place the only match at the very end to scan the whole buffer.
+  //
+  FillSyntheticData (Data, DataSize);
+  CopyMem (&Data[DataSize - sizeof (mPattern)], mPattern, sizeof (mPattern));
+
+  RetVal = 0;
+
+  for (Masked = 0; Masked < 2; ++Masked) {
+    for (Mode = OcPatternSearchScalar; Mode <= OcPatternSearchAvx2; ++Mode) {
+      UsedMode = OcSetPatternSearchMode ((OC_PATTERN_SEARCH_MODE)Mode);
+      if (UsedMode != Mode) {
+        DEBUG ((DEBUG_ERROR, "[SKIP] %a search is unsupported\n", mModeNames[Mode]));
+        continue;
+      }
+
+      if ((Masked != 0) && !CheckMaskedOutSearch (UsedMode, Data, SIZE_4KB)) {
+        RetVal = -1;
+        continue;
+      }
+
+      OcSetPatternSearchMode (UsedMode);
+      Speed = MeasureSearch (Data, DataSize, Masked != 0 ? mPatternMask : NULL, &Offset);
+
+      if (Offset != DataSize - sizeof (mPattern)) {
+        DEBUG ((DEBUG_ERROR, "[FAIL] %a %a search found %u\n", mModeNames[Mode], Masked != 0 ? "masked" : "plain", Offset));
+        RetVal = -1;
+        continue;
+      }
+
+      DEBUG ((
+        DEBUG_ERROR,
+        "[OK] %a %a search - %Lu MB/s\n",
+        mModeNames[Mode],
+        Masked != 0 ? "masked" : "plain",
+        Speed
+        ));
+    }
+  }
+
+  FreePool (Data);
+  return RetVal;
+}
@@ -13,8 +13,12 @@
   WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 **/
 
+#include <IndustryStandard/AppleCompressedBinaryImage.h>
+
+#include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/OcCompressionLib.h>
 #include <Library/OcTemplateLib.h>
 #include <Library/OcSerializeLib.h>
 #include <Library/OcMiscLib.h>
@@ -25,8 +29,15 @@
 
 #include <UserFile.h>
 
+#include <sys/time.h>
+
 #define  OC_USER_FULL_PATH_MAX_SIZE  256
 
+//
+// Amount of kernel quirk passes per symbol lookup timing run.
+//
+#define  OC_USER_TIMING_ITERATIONS  16
+
 STATIC CHAR8  mFullPath[OC_USER_FULL_PATH_MAX_SIZE] = { 0 };
 STATIC UINTN  mRootPathLen                          = 0;
 
@@ -308,6 +319,178 @@ OcGetFileSize (
   return EFI_SUCCESS;
 }
 
+STATIC
+UINT64
+GetCurrentTimestampUs (
+  VOID
+  )
+{
+  struct timeval  Time;
+
+  gettimeofday (&Time, NULL);
+  return Time.tv_sec * 1000000ULL + Time.tv_usec;
+}
+
+/**
+  Write kernel wrapped into an LZVN compressed image, as found in
+  prelinkedkernel and kernelcache files.
+
+  @param[in] FileName  Output file name.
+  @param[in] Kernel    Kernel binary.
+  @param[in] Size      Kernel binary size.
+
+  @retval TRUE on success.
+**/
+STATIC
+BOOLEAN
+WriteCompressedKernel (
+  IN CONST CHAR8  *FileName,
+  IN CONST UINT8  *Kernel,
+  IN UINT32       Size
+  )
+{
+  MACH_COMP_HEADER  *CompHeader;
+  UINT8             *Image;
+  UINT8             *ImageEnd;
+  UINT32            ImageSize;
+  UINT64            Start;
+  UINT64            Elapsed;
+
+  //
+  // The worst case is a 16 byte literal run with a 2 byte opcode followed
+  // by a 4 byte match with a 3 byte opcode, which grows every 20 bytes by 1.
+  //
+  ImageSize = sizeof (MACH_COMP_HEADER) + Size + Size / 16 + 64;
+  Image     = AllocateZeroPool (ImageSize);
+  if (Image == NULL) {
+    return FALSE;
+  }
+
+  Start    = GetCurrentTimestampUs ();
+  ImageEnd = CompressLZVN (
+               Image + sizeof (MACH_COMP_HEADER),
+               ImageSize - sizeof (MACH_COMP_HEADER),
+               Kernel,
+               Size,
+               0
+               );
+  Elapsed = GetCurrentTimestampUs () - Start;
+  if (ImageEnd == NULL) {
+    FreePool (Image);
+    return FALSE;
+  }
+
+  ImageSize                = (UINT32)(ImageEnd - Image);
+  CompHeader               = (MACH_COMP_HEADER *)Image;
+  CompHeader->Signature    = MACH_COMPRESSED_BINARY_INVERT_SIGNATURE;
+  CompHeader->Compression  = MACH_COMPRESSED_BINARY_INVERT_LZVN;
+  CompHeader->Hash         = SwapBytes32 (Adler32 (Kernel, Size));
+  CompHeader->Decompressed = SwapBytes32 (Size);
+  CompHeader->Compressed   = SwapBytes32 (ImageSize - sizeof (MACH_COMP_HEADER));
+  CompHeader->Version      = SwapBytes32 (1);
+
+  DEBUG ((
+    DEBUG_WARN,
+    "[OK] LZVN compressed %u -> %u bytes in %Lu us\n",
+    Size,
+    ImageSize - (UINT32)sizeof (MACH_COMP_HEADER),
+    Elapsed
+    ));
+
+  UserWriteFile (FileName, Image, ImageSize);
+  FreePool (Image);
+  return TRUE;
+}
+
+//
+// Kernel quirks performing symbol lookups in the kernel binary.
+//
+STATIC CONST KERNEL_QUIRK_NAME  mTimingQuirks[] = {
+  KernelQuirkAppleXcpmCfgLock,
+  KernelQuirkAppleXcpmExtraMsrs,
+  KernelQuirkAppleXcpmForceBoost,
+  KernelQuirkLapicKernelPanic,
+  KernelQuirkLegacyCommpage,
+  KernelQuirkPanicNoKextDump,
+  KernelQuirkPowerTimeoutKernelPanic,
+  KernelQuirkSegmentJettison
+};
+
+/**
+  Apply kernel quirks to a scratch copy of the kernel and report symbol
+  lookup statistics with and without patcher symbol index.
+
+  @param[in] Kernel  Kernel binary.
+  @param[in] Size    Kernel binary size.
+**/
+STATIC
+VOID
+TimeSymbolLookups (
+  IN CONST UINT8  *Kernel,
+  IN UINT32       Size
+  )
+{
+  EFI_STATUS       Status;
+  UINT8            *Scratch;
+  PATCHER_CONTEXT  Patcher;
+  UINT32           Mode;
+  UINT32           Iteration;
+  UINT32           Index;
+  UINT64           Lookups;
+  UINT64           Visited;
+  UINT64           Start;
+  UINT64           Elapsed;
+
+  Scratch = AllocatePool (Size);
+  if (Scratch == NULL) {
+    DEBUG ((DEBUG_WARN, "[FAIL] Timing scratch allocation\n"));
+    FailedToProcess = TRUE;
+    return;
+  }
+
+  for (Mode = 0; Mode < 2; ++Mode) {
+    Lookups = 0;
+    Visited = 0;
+    Elapsed = 0;
+
+    for (Iteration = 0; Iteration < OC_USER_TIMING_ITERATIONS; ++Iteration) {
+      CopyMem (Scratch, Kernel, Size);
+
+      Status = PatcherInitContextFromBuffer (&Patcher, Scratch, Size, FALSE);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((DEBUG_WARN, "[FAIL] Timing patcher init - %r\n", Status));
+        FailedToProcess = TRUE;
+        FreePool (Scratch);
+        return;
+      }
+
+      Patcher.DisableSymbolIndex = Mode == 0;
+
+      Start = GetCurrentTimestampUs ();
+      for (Index = 0; Index < ARRAY_SIZE (mTimingQuirks); ++Index) {
+        KernelApplyQuirk (mTimingQuirks[Index], &Patcher, KernelVersion);
+      }
+
+      Elapsed += GetCurrentTimestampUs () - Start;
+      Lookups += Patcher.SymbolLookups;
+      Visited += Patcher.SymbolsVisited;
+
+      PatcherFreeContext (&Patcher);
+    }
+
+    DEBUG ((
+      DEBUG_WARN,
+      "[OK] Symbol lookup %a: %Lu lookups, %Lu symbols visited, %Lu us per pass\n",
+      Mode == 0 ? "linear" : "indexed",
+      Lookups / OC_USER_TIMING_ITERATIONS,
+      Visited / OC_USER_TIMING_ITERATIONS,
+      Elapsed / OC_USER_TIMING_ITERATIONS
+      ));
+  }
+
+  FreePool (Scratch);
+}
+
 int
 WrapMain (
   int   argc,
@@ -339,11 +522,29 @@ WrapMain (
 
   OC_KERNEL_ADD_ENTRY  *Kext;
 
+  BOOLEAN  TimingMode;
+  BOOLEAN  CompressMode;
+  INT32    ArgIndex;
+
   if (argc < 2) {
-    DEBUG ((DEBUG_ERROR, "Usage: %a <path/to/OC/folder/> [path/to/kernel]\n\n", argv[0]));
+    DEBUG ((DEBUG_ERROR, "Usage: %a <path/to/OC/folder/> [path/to/kernel] [-t] [-c]\n\n", argv[0]));
     return -1;
   }
 
+  //
+  // Optionally report symbol lookup timing before patching,
+  // and write the patched kernel LZVN compressed.
+  //
+  TimingMode   = FALSE;
+  CompressMode = FALSE;
+  for (ArgIndex = 3; ArgIndex < argc; ++ArgIndex) {
+    if (AsciiStrCmp (argv[ArgIndex], "-t") == 0) {
+      TimingMode = TRUE;
+    } else if (AsciiStrCmp (argv[ArgIndex], "-c") == 0) {
+      CompressMode = TRUE;
+    }
+  }
+
   FileName = argc > 2 ? argv[2] : "/System/Library/PrelinkedKernels/prelinkedkernel";
   if ((mPrelinked = UserReadFile (FileName, &mPrelinkedSize)) == NULL) {
     DEBUG ((DEBUG_ERROR, "Read fail %a\n", FileName));
@@ -459,6 +660,10 @@ WrapMain (
 
   ASSERT (Config.Kernel.Force.Count == 0);
 
+  if (TimingMode) {
+    TimeSymbolLookups (NewPrelinked, NewPrelinkedSize);
+  }
+
   //
   // Apply patches to kernel itself, and then process prelinked.
   //
@@ -490,7 +695,14 @@ WrapMain (
 
   DEBUG ((DEBUG_INFO, "OC: Prelinked status - %r\n", PrelinkedStatus));
 
-  UserWriteFile ("out.bin", NewPrelinked, NewPrelinkedSize);
+  if (CompressMode) {
+    if (!WriteCompressedKernel ("out.bin", NewPrelinked, NewPrelinkedSize)) {
+      DEBUG ((DEBUG_WARN, "[FAIL] Kernel compression failure\n"));
+      FailedToProcess = TRUE;
+    }
+  } else {
+    UserWriteFile ("out.bin", NewPrelinked, NewPrelinkedSize);
+  }
 
   FreePool (mPrelinked);
 
@@ -0,0 +1,223 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcCryptoLib.h>
+
+#include <BigNumLib.h>
+
+#include <sys/time.h>
+
+//
+// Amount of signature verifications per measurement.
+//
+#define RSA_VERIFY_ITERATIONS  1000
+
+//
+// Public exponent used by signatures.
+//
+#define RSA_VERIFY_EXPONENT  0x10001
+
+STATIC CONST CHAR8  *mModeNames[] = {
+  "portable",
+  "adx"
+};
+
+STATIC CONST UINT32  mExponents[] = {
+  3,
+  RSA_VERIFY_EXPONENT
+};
+
+STATIC CONST UINT32  mKeyBits[] = {
+  2048,
+  4096
+};
+
+STATIC
+UINT64
+GetCurrentTimestampUs (
+  VOID
+  )
+{
+  struct timeval  Time;
+
+  gettimeofday (&Time, NULL);
+  return Time.tv_sec * 1000000ULL + Time.tv_usec;
+}
+
+/**
+  Fill number with reproducible pseudo-random data.
+
+  @param[out] Num       Number to fill.
+  @param[in]  NumWords  The number of Words of Num.
+  @param[in]  Seed      Non-zero pseudo-random sequence seed.
+**/
+STATIC
+VOID
+FillSyntheticNum (
+  OUT OC_BN_WORD       *Num,
+  IN  OC_BN_NUM_WORDS  NumWords,
+  IN  UINT64           Seed
+  )
+{
+  UINT64  State;
+  UINTN   Index;
+
+  State = Seed;
+  for (Index = 0; Index < NumWords; ++Index) {
+    State     ^= State << 13U;
+    State     ^= State >> 7U;
+    State     ^= State << 17U;
+    Num[Index] = (OC_BN_WORD)State;
+  }
+}
+
+/**
+  Compare modular exponentiation results with the portable implementation
+  and measure signature verification throughput.
+
+  @param[in] Mode     Montgomery multiplication implementation.
+  @param[in] KeyBits  Modulus size in bits.
+
+  @return  TRUE when all results match.
+**/
+STATIC
+BOOLEAN
+MeasureRsaVerify (
+  IN OC_RSA_MODE  Mode,
+  IN UINT32       KeyBits
+  )
+{
+  OC_BN_NUM_WORDS  NumWords;
+  OC_BN_WORD       *Memory;
+  OC_BN_WORD       *N;
+  OC_BN_WORD       *RSqrMod;
+  OC_BN_WORD       *Signature;
+  OC_BN_WORD       *Expected;
+  OC_BN_WORD       *Result;
+  OC_BN_WORD       *ATmp;
+  OC_BN_WORD       *Scratch;
+  OC_BN_WORD       N0Inv;
+  UINTN            Index;
+  UINT32           Iteration;
+  UINT64           Start;
+  UINT64           Elapsed;
+  BOOLEAN          Success;
+
+  NumWords = (OC_BN_NUM_WORDS)(KeyBits / OC_BN_WORD_NUM_BITS);
+  Memory   = AllocatePool (
+               6 * OC_BN_SIZE (NumWords) + BIG_NUM_MONT_PARAMS_SCRATCH_SIZE (NumWords)
+               );
+  if (Memory == NULL) {
+    DEBUG ((DEBUG_ERROR, "Failed to allocate %u-bit key buffers\n", KeyBits));
+    return FALSE;
+  }
+
+  N         = &Memory[0 * NumWords];
+  RSqrMod   = &Memory[1 * NumWords];
+  Signature = &Memory[2 * NumWords];
+  Expected  = &Memory[3 * NumWords];
+  Result    = &Memory[4 * NumWords];
+  ATmp      = &Memory[5 * NumWords];
+  Scratch   = &Memory[6 * NumWords];
+
+  //
+  // Any odd modulus of full size has the cost of a real key. The signature
+  // must be smaller than the modulus.
+  //
+  FillSyntheticNum (N, NumWords, 0x9E3779B97F4A7C15ULL);
+  N[0]            |= 1U;
+  N[NumWords - 1] |= (OC_BN_WORD)1U << (OC_BN_WORD_NUM_BITS - 1U);
+  FillSyntheticNum (Signature, NumWords, 0xD1B54A32D192ED03ULL);
+  Signature[NumWords - 1] >>= 1U;
+
+  N0Inv   = BigNumCalculateMontParams (RSqrMod, NumWords, N, Scratch);
+  Success = N0Inv != 0;
+
+  for (Index = 0; Success && Index < ARRAY_SIZE (mExponents); ++Index) {
+    OcSetRsaMode (OcRsaPortable);
+    BigNumPowMod (Expected, NumWords, Signature, mExponents[Index], N, N0Inv, RSqrMod, ATmp);
+    OcSetRsaMode (Mode);
+    BigNumPowMod (Result, NumWords, Signature, mExponents[Index], N, N0Inv, RSqrMod, ATmp);
+    if (CompareMem (Result, Expected, OC_BN_SIZE (NumWords)) != 0) {
+      DEBUG ((
+        DEBUG_ERROR,
+        "[FAIL] %a %u-bit exponent %u mismatch\n",
+        mModeNames[Mode],
+        KeyBits,
+        mExponents[Index]
+        ));
+      Success = FALSE;
+    }
+  }
+
+  if (!Success) {
+    FreePool (Memory);
+    return FALSE;
+  }
+
+  //
+  // Signature verification time is dominated by the exponentiation.
+  //
+  Start = GetCurrentTimestampUs ();
+  for (Iteration = 0; Iteration < RSA_VERIFY_ITERATIONS; ++Iteration) {
+    BigNumPowMod (Result, NumWords, Signature, RSA_VERIFY_EXPONENT, N, N0Inv, RSqrMod, ATmp);
+  }
+
+  Elapsed = GetCurrentTimestampUs () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  DEBUG ((
+    DEBUG_ERROR,
+    "[OK] %a %u-bit - %Lu verifications/s\n",
+    mModeNames[Mode],
+    KeyBits,
+    (UINT64)RSA_VERIFY_ITERATIONS * 1000000ULL / Elapsed
+    ));
+
+  FreePool (Memory);
+  return TRUE;
+}
+
+int
+ENTRY_POINT (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINT32  Mode;
+  UINTN   Index;
+  int     RetVal;
+
+  RetVal = 0;
+
+  for (Index = 0; Index < ARRAY_SIZE (mKeyBits); ++Index) {
+    for (Mode = OcRsaPortable; Mode <= OcRsaAdx; ++Mode) {
+      if (OcSetRsaMode ((OC_RSA_MODE)Mode) != Mode) {
+        DEBUG ((DEBUG_ERROR, "[SKIP] %a RSA is unsupported\n", mModeNames[Mode]));
+        continue;
+      }
+
+      if (!MeasureRsaVerify ((OC_RSA_MODE)Mode, mKeyBits[Index])) {
+        RetVal = -1;
+      }
+    }
+  }
+
+  return RetVal;
+}
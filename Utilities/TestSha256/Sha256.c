@@ -0,0 +1,230 @@
+/** @file
+  Copyright (C) 2023, Acidanthera. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcCryptoLib.h>
+
+#include <sys/time.h>
+
+//
+// Synthetic buffer size, close to a large DMG chunk batch.
+//
+#define SHA256_DATA_SIZE  SIZE_64MB
+
+//
+// Amount of full buffer passes per measurement.
+//
+#define SHA256_ITERATIONS  4
+
+//
+// Amount of independent messages the buffer is split into for multi-buffer
+// hashing, resembling a batch of DMG chunks.
+//
+#define SHA256_MULTI_COUNT  OC_SHA256_MULTI_LANES
+
+STATIC CONST CHAR8  *mModeNames[] = {
+  "scalar",
+  "sse2",
+  "avx2",
+  "sha-ni"
+};
+
+STATIC
+UINT64
+GetCurrentTimestampUs (
+  VOID
+  )
+{
+  struct timeval  Time;
+
+  gettimeofday (&Time, NULL);
+  return Time.tv_sec * 1000000ULL + Time.tv_usec;
+}
+
+/**
+  Fill buffer with reproducible pseudo-random data.
+
+  @param[out] Data      Buffer to fill.
+  @param[in]  DataSize  Buffer size.
+**/
+STATIC
+VOID
+FillSyntheticData (
+  OUT UINT8   *Data,
+  IN  UINT32  DataSize
+  )
+{
+  UINT64  State;
+  UINT32  Index;
+
+  State = 0x9E3779B97F4A7C15ULL;
+  for (Index = 0; Index < DataSize; ++Index) {
+    State      ^= State << 13U;
+    State      ^= State >> 7U;
+    State      ^= State << 17U;
+    Data[Index] = (UINT8)State;
+  }
+}
+
+/**
+  Measure SHA-256 throughput.
+
+  @param[in]  Data      Buffer to hash.
+  @param[in]  DataSize  Buffer size.
+  @param[out] Hash      Calculated hash.
+
+  @return  Throughput in MB/s.
+**/
+STATIC
+UINT64
+MeasureSha256 (
+  IN  CONST UINT8  *Data,
+  IN  UINT32       DataSize,
+  OUT UINT8        *Hash
+  )
+{
+  UINT32  Iteration;
+  UINT64  Start;
+  UINT64  Elapsed;
+
+  Start = GetCurrentTimestampUs ();
+  for (Iteration = 0; Iteration < SHA256_ITERATIONS; ++Iteration) {
+    Sha256 (Hash, Data, DataSize);
+  }
+
+  Elapsed = GetCurrentTimestampUs () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  //
+  // Bytes per microsecond equal megabytes per second.
+  //
+  return (UINT64)DataSize * SHA256_ITERATIONS / Elapsed;
+}
+
+/**
+  Measure multi-buffer SHA-256 throughput.
+
+  @param[in]  Data      Buffer split into SHA256_MULTI_COUNT messages.
+  @param[in]  DataSize  Buffer size.
+  @param[out] Hashes    Calculated hashes.
+
+  @return  Throughput in MB/s.
+**/
+STATIC
+UINT64
+MeasureSha256Multi (
+  IN  CONST UINT8  *Data,
+  IN  UINT32       DataSize,
+  OUT UINT8        *Hashes
+  )
+{
+  CONST UINT8  *Messages[SHA256_MULTI_COUNT];
+  UINTN        Lengths[SHA256_MULTI_COUNT];
+  UINT32       Index;
+  UINT32       Iteration;
+  UINT64       Start;
+  UINT64       Elapsed;
+
+  for (Index = 0; Index < SHA256_MULTI_COUNT; ++Index) {
+    Messages[Index] = &Data[Index * (DataSize / SHA256_MULTI_COUNT)];
+    Lengths[Index]  = DataSize / SHA256_MULTI_COUNT;
+  }
+
+  Start = GetCurrentTimestampUs ();
+  for (Iteration = 0; Iteration < SHA256_ITERATIONS; ++Iteration) {
+    Sha256Multi (Hashes, Messages, Lengths, SHA256_MULTI_COUNT);
+  }
+
+  Elapsed = GetCurrentTimestampUs () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  return (UINT64)DataSize * SHA256_ITERATIONS / Elapsed;
+}
+
+int
+ENTRY_POINT (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINT8           *Data;
+  UINT32          DataSize;
+  UINT32          Mode;
+  OC_SHA256_MODE  UsedMode;
+  UINT8           Expected[SHA256_DIGEST_SIZE];
+  UINT8           Hash[SHA256_DIGEST_SIZE];
+  UINT8           ExpectedMulti[SHA256_MULTI_COUNT * SHA256_DIGEST_SIZE];
+  UINT8           HashMulti[SHA256_MULTI_COUNT * SHA256_DIGEST_SIZE];
+  UINT32          Index;
+  UINT64          Speed;
+  int             RetVal;
+
+  DataSize = SHA256_DATA_SIZE;
+  Data     = AllocatePool (DataSize);
+  if (Data == NULL) {
+    DEBUG ((DEBUG_ERROR, "Failed to allocate %u bytes\n", DataSize));
+    return -1;
+  }
+
+  FillSyntheticData (Data, DataSize);
+
+  OcSetSha256Mode (OcSha256Scalar);
+  Sha256 (Expected, Data, DataSize);
+  for (Index = 0; Index < SHA256_MULTI_COUNT; ++Index) {
+    Sha256 (
+      &ExpectedMulti[Index * SHA256_DIGEST_SIZE],
+      &Data[Index * (DataSize / SHA256_MULTI_COUNT)],
+      DataSize / SHA256_MULTI_COUNT
+      );
+  }
+
+  RetVal = 0;
+
+  for (Mode = OcSha256Scalar; Mode <= OcSha256ShaNi; ++Mode) {
+    UsedMode = OcSetSha256Mode ((OC_SHA256_MODE)Mode);
+    if (UsedMode != Mode) {
+      DEBUG ((DEBUG_ERROR, "[SKIP] %a sha256 is unsupported\n", mModeNames[Mode]));
+      continue;
+    }
+
+    Speed = MeasureSha256 (Data, DataSize, Hash);
+
+    if (CompareMem (Hash, Expected, SHA256_DIGEST_SIZE) != 0) {
+      DEBUG ((DEBUG_ERROR, "[FAIL] %a sha256 mismatch\n", mModeNames[Mode]));
+      RetVal = -1;
+      continue;
+    }
+
+    DEBUG ((DEBUG_ERROR, "[OK] %a sha256 - %Lu MB/s\n", mModeNames[Mode], Speed));
+
+    Speed = MeasureSha256Multi (Data, DataSize, HashMulti);
+
+    if (CompareMem (HashMulti, ExpectedMulti, sizeof (HashMulti)) != 0) {
+      DEBUG ((DEBUG_ERROR, "[FAIL] %a sha256 multi-buffer mismatch\n", mModeNames[Mode]));
+      RetVal = -1;
+      continue;
+    }
+
+    DEBUG ((DEBUG_ERROR, "[OK] %a sha256 multi-buffer - %Lu MB/s\n", mModeNames[Mode], Speed));
+  }
+
+  FreePool (Data);
+  return RetVal;
+}